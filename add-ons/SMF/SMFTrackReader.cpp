@@ -0,0 +1,545 @@
+// SMFTrackReader -- converts Standard MIDI File track data to MeV events
+
+#include "SMFTrackReader.h"
+
+#include "Error.h"
+
+// Support Kit
+#include <Debug.h>
+// C & Standard Template Library
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using std::vector;
+
+// ---------------------------------------------------------------------------
+// Exception classes
+
+class PrematureEndOfTrack : public IError
+{
+public:
+	virtual	const char*		Description() const
+								{ return "Track data is corrupt."; }
+};
+
+// ---------------------------------------------------------------------------
+// Utility class for reading standard MIDI file tracks
+
+CSMFTrackReader::CSMFTrackReader(const uint8* data, int32 len, const int* destinationIDs,
+                                 const smf_time_base& tBase)
+	:	m_destinationID(destinationIDs),
+		m_pData(data),
+		m_pEnd(data + len),
+		m_trackLength(len),
+		m_timeBase(tBase),
+		m_fileTime_ticks(0),
+		m_runningStatus(0)
+{
+	m_error[0] = '\0';
+}
+
+const char* CSMFTrackReader::Error() const
+{
+	return (m_error[0] != '\0') ? m_error : NULL;
+}
+
+bool CSMFTrackReader::GetNextEvent(CEvent& outEvent)
+{
+	CEvent	event;	// start with fresh event so all fields are initialized
+	uint8	status;
+	bool	gotEvent = false;
+
+	while (!gotEvent)
+	{
+		if (m_pData >= m_pEnd)
+			return false;
+
+		int64 mevTime = GetTime();
+		if (mevTime > 2147483647)
+		{
+			PRINT(("Event time is %Ld (max %ld)\n", mevTime, 2147483647L));
+			SetError( "Track exceeds maximum length." );
+			return false;
+		}
+
+		event.SetStart(mevTime);
+		PRINT(("\t\tEvent time=%ld\n", event.Start()));
+
+		status = GetStatusByte();
+		switch (status & 0xf0)
+		{
+			case 0x80:
+				gotEvent = ReadNoteOff(status, event);
+				break;
+
+			case 0x90:
+				gotEvent = ReadNoteOn(status, event);
+				break;
+
+			case 0xA0:
+				gotEvent = ReadPolyPressure(status, event);
+				break;
+
+			case 0xB0:
+				gotEvent = ReadControlChange(status, event);
+				break;
+
+			case 0xC0:
+				gotEvent = ReadProgramChange(status, event);
+				break;
+
+			case 0xD0:
+				gotEvent = ReadChannelPressure(status, event);
+				break;
+
+			case 0xE0:
+				gotEvent = ReadPitchBend(status, event);
+				break;
+
+			case 0xF0:			// sysex and meta
+				switch (status)
+				{
+					case 0xf0:
+						gotEvent = ReadSystemExclusive(status, event);
+						break;
+
+					case 0xff:
+						gotEvent = ReadMetaEvent(status, event);
+						break;
+
+					default:
+						SetError("Error reading file: %x byte encountered at offset %d in track.",
+						         status, Position());
+						return false;
+				}
+				break;
+
+			default:						// unrecognized event
+				SetError("Error reading file: unrecognized status byte '%x' encountered at offset %d in track.",
+				         status, Position());
+				return false;
+		}
+	}
+
+	outEvent = event;
+	return true;
+}
+
+bool CSMFTrackReader::ReadTrack(vector<CEvent>& outEvents)
+{
+	// The notes which are still on, chained per channel and pitch in the
+	// order they were started, so that overlapping notes of the same pitch
+	// are turned off first-in, first-out. firstNote and lastNote are the
+	// ends of the chain for each key; nextNote runs parallel to outEvents.
+	vector<int32>	firstNote(16 * 128, -1);
+	vector<int32>	lastNote(16 * 128, -1);
+	vector<int32>	nextNote(outEvents.size(), -1);
+	CEvent			event;
+
+	nextNote.reserve(outEvents.capacity());
+
+	try
+	{
+		while (GetNextEvent(event))
+		{
+			if (event.Command() == EvtType_NoteOff)
+			{
+				// The running status is the status of the last channel message
+				int32 key = (m_runningStatus & 0x0F) * 128 + (event.note.pitch & 0x7F);
+				int32 index = firstNote[key];
+				if (index < 0)
+				{
+					PRINT(("\tUnmatched note-off at %ld: vChannel = %d, pitch = %ld\n",
+					       event.Start(), event.GetVChannel(),
+					       event.GetAttribute(EvAttr_Pitch)));
+					continue;
+				}
+
+				CEvent& note = outEvents[index];
+				note.SetDuration(event.Start() - note.Start());
+				note.SetAttribute(EvAttr_ReleaseVelocity,
+								  event.GetAttribute(EvAttr_ReleaseVelocity));
+
+				firstNote[key] = nextNote[index];
+				if (firstNote[key] < 0)
+					lastNote[key] = -1;
+				continue;
+			}
+
+			int32 index = outEvents.size();
+			outEvents.push_back(event);
+			nextNote.push_back(-1);
+
+			if (event.Command() == EvtType_Note)
+			{
+				int32 key = (m_runningStatus & 0x0F) * 128 + (event.note.pitch & 0x7F);
+				if (lastNote[key] < 0)
+					firstNote[key] = index;
+				else
+					nextNote[lastNote[key]] = index;
+				lastNote[key] = index;
+			}
+		}
+	}
+	catch (...)
+	{
+		CloseHungNotes(outEvents, firstNote, nextNote);
+		throw;
+	}
+
+	CloseHungNotes(outEvents, firstNote, nextNote);
+	return Error() == NULL;
+}
+
+void CSMFTrackReader::CloseHungNotes(vector<CEvent>& events,
+									 const vector<int32>& firstNote,
+									 const vector<int32>& nextNote)
+{
+	for (uint32 key = 0; key < firstNote.size(); key++)
+	{
+		for (int32 index = firstNote[key]; index >= 0; index = nextNote[index])
+		{
+			CEvent& event = events[index];
+
+			PRINT(("\tWarning! Hung note at %ld on vChannel %d, pitch %d\n",
+			       event.Start(), event.GetVChannel(), event.note.pitch));
+
+			event.SetDuration(0);
+			event.SetAttribute(EvAttr_ReleaseVelocity, 64);
+		}
+	}
+}
+
+int64 CSMFTrackReader::GetTime()
+{
+	int64 realTime_usec;
+	int64 mevTime;
+
+	uint32 deltaTime = GetVariableLengthNumber();
+	m_fileTime_ticks += deltaTime;
+
+	if (m_timeBase.format == smf_time_base::METERED)
+	{
+		mevTime = (m_fileTime_ticks * Ticks_Per_QtrNote) / m_timeBase.base.metered.ticksPerQuarterNote;
+	}
+	else
+	{
+		switch (m_timeBase.base.timeCode.smpteFormat)
+		{
+			case smf_time_base::SMPTE_24:
+				realTime_usec = (m_fileTime_ticks * 1000000) / (24 * int64(m_timeBase.base.timeCode.ticksPerFrame));
+				break;
+			case smf_time_base::SMPTE_25:
+				realTime_usec = (m_fileTime_ticks * 1000000) / (25 * int64(m_timeBase.base.timeCode.ticksPerFrame));
+				break;
+			case smf_time_base::SMPTE_30_DROP:
+				{
+					// 30 frames per second, but skip two frames at the beginning
+					// of each minute that does not end in 0 (0, 10, 20, ...).
+					// We treat it like 30 non drop, but add time to adjust for dropped frames.
+					int64 frame = m_fileTime_ticks / int64(m_timeBase.base.timeCode.ticksPerFrame);
+					int64 framesDropped = (frame / 17982) * 18 + ((frame % 17982 - 2) / 1798) * 2;
+
+					realTime_usec  = (m_fileTime_ticks * 1000000) / (30 * int64(m_timeBase.base.timeCode.ticksPerFrame));
+					realTime_usec += (framesDropped    * 1000000) /  30;
+				}
+				break;
+			case smf_time_base::SMPTE_30:
+			default:
+				realTime_usec = (m_fileTime_ticks * 1000000) / (30 * int64(m_timeBase.base.timeCode.ticksPerFrame));
+				break;
+		}
+
+		// round to nearest millisecond
+		mevTime = (realTime_usec + 500) / 1000;
+	}
+
+	return mevTime;
+}
+
+uint8 CSMFTrackReader::GetStatusByte()
+{
+	// handle running status
+	if (PeekByte() & 0x80)
+	{
+		uint8 status = GetByte();
+		if (status < 0xF8) // not realtime
+			m_runningStatus = status;
+		return status;
+	}
+	else
+	{
+		return m_runningStatus;
+	}
+}
+
+bool CSMFTrackReader::ReadNoteOn(uint8 status, CEvent& event)
+{
+	uint8 pitch = GetByte();
+	uint8 vel   = GetByte();
+
+	PRINT(("\t\t\tNote "));
+	if (vel == 0)
+	{
+		event.SetCommand(EvtType_NoteOff);
+		vel = 64;
+		PRINT(("Off"));
+	}
+	else
+	{
+		event.SetCommand(EvtType_Note);
+		PRINT(("On"));
+	}
+	event.SetVChannel(m_destinationID[status & 0x0F]);
+	event.SetAttribute(EvAttr_Pitch,          pitch);
+	event.SetAttribute(EvAttr_AttackVelocity, vel);
+
+	PRINT(("       vChannel=%-3d, pitch=%-3ld, vel=%-3ld\n",
+	       event.GetVChannel(),
+	       event.GetAttribute(EvAttr_Pitch),
+	       event.GetAttribute(EvAttr_AttackVelocity)));
+
+	if (event.GetAttribute(EvAttr_AttackVelocity) == 0)
+	{
+		event.SetCommand(EvtType_NoteOff);
+		event.SetAttribute(EvAttr_ReleaseVelocity, 64);
+		PRINT(("\t\t\t--->Converted to Note Off\n"));
+	}
+
+	return true;
+}
+
+bool CSMFTrackReader::ReadNoteOff(uint8 status, CEvent& event)
+{
+	event.SetCommand(EvtType_NoteOff);
+	event.SetVChannel(m_destinationID[status & 0x0F]);
+	event.SetAttribute(EvAttr_Pitch,           GetByte());
+	event.SetAttribute(EvAttr_ReleaseVelocity, GetByte());
+
+	PRINT(("\t\t\tNote Off      vChannel=%-3d, pitch=%-3ld, vel=%-3ld\n",
+	       event.GetVChannel(),
+	       event.GetAttribute(EvAttr_Pitch),
+	       event.GetAttribute(EvAttr_ReleaseVelocity)));
+	return true;
+}
+
+bool CSMFTrackReader::ReadPolyPressure(uint8 status, CEvent& event)
+{
+	event.SetCommand(EvtType_PolyATouch);
+	event.SetVChannel(m_destinationID[status & 0x0F]);
+	event.SetAttribute(EvAttr_Pitch,      GetByte());
+	event.SetAttribute(EvAttr_AfterTouch, GetByte());
+
+	PRINT(("\t\t\tPoly Pressure vChannel=%-3d, pitch=%-3ld, value=%-3ld\n",
+	       event.GetVChannel(),
+	       event.GetAttribute(EvAttr_Pitch),
+	       event.GetAttribute(EvAttr_AfterTouch)));
+
+	return true;
+}
+
+bool CSMFTrackReader::ReadChannelPressure(uint8 status, CEvent& event)
+{
+	event.SetCommand(EvtType_ChannelATouch);
+	event.SetVChannel(m_destinationID[status & 0x0F]);
+	event.SetAttribute(EvAttr_AfterTouch, GetByte());
+	PRINT(("\t\t\tChannel Pressure vChannel=%-3d, value=%-3ld\n",
+	       event.GetVChannel(),
+	       event.GetAttribute(EvAttr_AfterTouch)));
+
+	return true;
+}
+
+bool CSMFTrackReader::ReadControlChange(uint8 status, CEvent& event)
+{
+	event.SetCommand(EvtType_Controller);
+	event.SetVChannel(m_destinationID[status & 0x0F]);
+	event.SetAttribute(EvAttr_ControllerNumber, GetByte());
+	event.SetAttribute(EvAttr_ControllerValue8, GetByte());
+	PRINT(("\t\t\tControl Change vChannel=%-3d, controller=%-3ld, value=%-3ld\n",
+	       event.GetVChannel(),
+	       event.GetAttribute(EvAttr_ControllerNumber),
+	       event.GetAttribute(EvAttr_ControllerValue8)));
+
+	return true;
+}
+
+bool CSMFTrackReader::ReadProgramChange(uint8 status, CEvent& event)
+{
+	// To do: merge with bank select?
+	event.SetCommand(EvtType_ProgramChange);
+	event.SetVChannel(m_destinationID[status & 0x0F]);
+	event.SetAttribute(EvAttr_Program, GetByte());
+	PRINT(("\t\t\tProgram Change vChannel=%-3d, program=%-3ld\n",
+	       event.GetVChannel(),
+	       event.GetAttribute(EvAttr_Program)));
+
+	return true;
+}
+
+bool CSMFTrackReader::ReadPitchBend(uint8 status, CEvent& event)
+{
+	event.SetCommand(EvtType_PitchBend);
+	event.SetVChannel(m_destinationID[status & 0x0F]);
+
+	int16 bendAmount = GetByte() - 8192;
+	bendAmount += GetByte() * 128;
+	event.SetAttribute(EvAttr_BendValue,   bendAmount);
+	event.SetAttribute(EvAttr_InitialBend, bendAmount);
+	PRINT(("\t\t\tPitch Bend vChannel=%-3d, amount=%-3ld\n",
+	       event.GetVChannel(),
+	       event.GetAttribute(EvAttr_BendValue)));
+
+	return true;
+}
+
+bool CSMFTrackReader::ReadSystemExclusive(uint8 status, CEvent& event)
+{
+	vector<uint8> buf;
+	uint8 ch;
+
+	buf.reserve(256); // avoid reallocations for most messages
+
+	while ((ch = GetByte()) != 0xF7)
+		buf.push_back(ch);
+
+	event.SetCommand(EvtType_SysEx);
+	event.SetVChannel(m_destinationID[status & 0x0F]); // is this correct ???
+	if (event.SetExtendedDataSize(buf.size()))
+		memcpy(event.ExtendedData(), &buf[0], buf.size());
+	PRINT(("\t\t\tSystem Exclusive length=%ld\n", buf.size()));
+
+	return true;
+}
+
+bool CSMFTrackReader::ReadMetaEvent(uint8 status, CEvent& event)
+{
+	uint32	usecPerQtr;
+
+	uint8  type   = GetByte();
+	uint32 length = GetVariableLengthNumber();
+
+	switch (type)
+	{
+		case 0x01:			// text
+		case 0x02:			// Copyright notice
+		case 0x03:			// Sequence/track name
+		case 0x04:			// Instrument name
+		case 0x05:			// Lyric
+		case 0x06:			// Marker
+		case 0x07:			// Cue point
+			event.SetCommand(EvtType_Text);
+			event.text.textType = type;
+			if (event.SetExtendedDataSize(length + 1))
+			{
+				GetBytes(reinterpret_cast<uint8*>(event.ExtendedData()), length);
+				reinterpret_cast<char*>(event.ExtendedData())[length] = '\0';
+			}
+			else
+			{
+				SkipBytes(length);
+			}
+			PRINT(("\t\t\tMeta Data text type=%d length=%lu\n",
+			       event.text.textType, length));
+			break;
+
+		case 0x2f:			// End of track
+			event.SetCommand(EvtType_End);
+			SkipBytes(length); // should be 0
+			PRINT(("\t\t\tEnd Of Track\n"));
+			break;
+
+		case 0x51:			// Set tempo
+			usecPerQtr  = GetByte() * 65536;
+			usecPerQtr += GetByte() *   256;
+			usecPerQtr += GetByte();
+			event.SetCommand(EvtType_Tempo);
+			event.SetAttribute(EvAttr_TempoValue, uint32(1000.0 * 60.0 * 1000000.0 / double(usecPerQtr) + 0.5));
+			PRINT(("\t\t\tSet Tempo=%ld (%f BPM, %ld usecs/qtr)\n",
+			       event.GetAttribute(EvAttr_TempoValue),
+			       double(event.GetAttribute(EvAttr_TempoValue)) / 1000.0,
+			       usecPerQtr));
+			break;
+
+		case 0x58:			// Time signaturee
+			event.SetCommand(EvtType_TimeSig);
+			event.SetAttribute(EvAttr_TSigBeatCount, GetByte());
+			// both the file and the event store the exponent of the beat size
+			event.SetAttribute(EvAttr_TSigBeatSize,  GetByte());
+			event.SetDuration(0);
+			SkipBytes(2);
+			PRINT(("\t\t\tTime Signature %ld/%ld\n",
+			       event.GetAttribute(EvAttr_TSigBeatCount),
+			       1L << event.GetAttribute(EvAttr_TSigBeatSize)));
+			break;
+
+		case 0x00:			// sequence ID 						(handled separately)
+		case 0x20:			// MIDI channel prefix				(not handled)
+		case 0x54:			// SMPTE Offset						(not handled)
+		case 0x59:			// Key signaturee					(not handled)
+		case 0x7F:			// Sequencer-specific meta event	(not used)
+		default:
+			PRINT(("\t\t\tMeta code %d, length %ld\n", type, length));
+			SkipBytes(length);
+			return false;
+	}
+
+	return true;
+}
+
+void CSMFTrackReader::SetError(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	vsnprintf(m_error, sizeof(m_error), format, args);
+	va_end(args);
+}
+
+uint8 CSMFTrackReader::GetByte()
+{
+	if (m_pData >= m_pEnd)
+		throw PrematureEndOfTrack();
+
+	return *m_pData++;
+}
+
+uint8 CSMFTrackReader::PeekByte() const
+{
+	if (m_pData >= m_pEnd)
+		throw PrematureEndOfTrack();
+
+	return *m_pData;
+}
+
+void CSMFTrackReader::GetBytes(uint8* buffer, int32 numBytes)
+{
+	if (m_pData + numBytes >= m_pEnd)
+		throw PrematureEndOfTrack();
+
+	memcpy(buffer, m_pData, numBytes);
+	m_pData += numBytes;
+}
+
+void CSMFTrackReader::SkipBytes(int32 numBytes)
+{
+	if (m_pData + numBytes >= m_pEnd && numBytes > 0)
+		throw PrematureEndOfTrack();
+
+	m_pData += numBytes;
+}
+
+uint32 CSMFTrackReader::GetVariableLengthNumber()
+{
+	uint32 v = 0;
+	uint8 b;
+
+	do
+	{
+		b = GetByte();
+		v = (v << 7) | (b & 0x7f);
+	} while (b & 0x80);
+
+	return v;
+}
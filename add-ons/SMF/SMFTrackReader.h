@@ -0,0 +1,142 @@
+/* ===================================================================== *
+ * SMFTrackReader.h (MeV/StandardMidiFile)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical 
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan 
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s): 
+ *		Curt Malouin (malouin)
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ * 	Decodes the events of a Standard MIDI File track
+ * ---------------------------------------------------------------------
+ * History:
+ *	07/11/2000	malouin
+ *		Standard MIDI File parsing
+ * ---------------------------------------------------------------------
+ * To Do:
+ *
+ * ===================================================================== */
+
+#ifndef __C_SMFTrackReader_H__
+#define __C_SMFTrackReader_H__
+
+#include "Event.h"
+#include "TimeUnits.h"
+
+// Standard Template Library
+#include <vector>
+
+struct smf_time_base
+{
+	enum
+	{
+		METERED = 0,
+		TIME_CODE = 0x8000
+	};
+
+	enum
+	{
+		SMPTE_30 = -30,
+		SMPTE_30_DROP = -29,
+		SMPTE_25 = -25,
+		SMPTE_24 = -24
+	};
+
+	int format;
+
+	union
+	{
+		struct
+		{
+			int16 ticksPerQuarterNote;
+		} metered;
+
+		struct
+		{
+			int16 smpteFormat;
+			int16 ticksPerFrame;
+		} timeCode;
+	} base;
+};
+
+// reads events from file track and converts to MeV events
+class CSMFTrackReader
+{
+public:
+	CSMFTrackReader(const uint8* data, int32 length, const int* destinationIDs,
+	                const smf_time_base& tBase);
+
+	// returns the next event in the track.  Event
+	// vChannel is the destination ID for the MIDI channel.
+	bool	GetNextEvent(CEvent& outEvent);
+
+	// reads the rest of the track into outEvents, in the order of the
+	// file. Note-offs are matched with their note-ons, which get the
+	// duration and release velocity; notes which are never turned off
+	// get no duration. Returns false if the track data has an error.
+	bool	ReadTrack(std::vector<CEvent>& outEvents);
+
+	// returns a description of the error that made GetNextEvent()
+	// fail, or NULL if it simply reached the end of the track.
+	const char*	Error() const;
+
+private:
+			uint8	GetByte();
+			uint8	PeekByte() const;
+			void	GetBytes(uint8* buffer, int32 numBytes);
+			void	SkipBytes(int32 numBytes);
+			uint32	GetVariableLengthNumber();
+
+			int64	GetTime();
+			uint8	GetStatusByte();
+
+			bool	ReadNoteOn(			uint8 statusByte, CEvent& outEvent);
+			bool	ReadNoteOff(		uint8 statusByte, CEvent& outEvent);
+			bool	ReadPolyPressure(	uint8 statusByte, CEvent& outEvent);
+			bool	ReadChannelPressure(uint8 statusByte, CEvent& outEvent);
+			bool	ReadControlChange(	uint8 statusByte, CEvent& outEvent);
+			bool	ReadProgramChange(	uint8 statusByte, CEvent& outEvent);
+			bool	ReadPitchBend(		uint8 statusByte, CEvent& outEvent);
+			bool	ReadSystemExclusive(uint8 statusByte, CEvent& outEvent);
+			bool	ReadMetaEvent(		uint8 statusByte, CEvent& outEvent);
+
+			void	SetError(const char* format, ...);
+
+			void	CloseHungNotes(std::vector<CEvent>& events,
+								   const std::vector<int32>& firstNote,
+								   const std::vector<int32>& nextNote);
+
+	inline	uint32	Position() const;	// offset within track data
+
+	const int*			m_destinationID;
+	const uint8*		m_pData;
+	const uint8*		m_pEnd;
+	int32				m_trackLength;
+	smf_time_base		m_timeBase;
+	int64				m_fileTime_ticks;
+	uint8				m_runningStatus;
+	char				m_error[256];
+};
+
+inline uint32 CSMFTrackReader::Position() const
+{
+	return m_pData - (m_pEnd - m_trackLength);
+}
+
+#endif /* __C_SMFTrackReader_H__ */
@@ -0,0 +1,250 @@
+// SMFTrackWriter -- converts MeV events to Standard MIDI File track data
+
+#include "SMFTrackWriter.h"
+
+// C & Standard Template Library
+#include <cstring>
+
+// ---------------------------------------------------------------------------
+// Utility class for writing standard MIDI file tracks
+
+CSMFTrackWriter::CSMFTrackWriter(const uint8* channels)
+	:	m_channels(channels),
+		m_noteOffCount(0),
+		m_lastEventTicks(0),
+		m_runningStatus(0),
+		m_ended(false)
+{
+	// chunk header; the length is filled in when the track is ended
+	static const uint8 header[8] = { 'M', 'T', 'r', 'k', 0, 0, 0, 0 };
+	m_data.reserve(64 * 1024);
+	m_data.insert(m_data.end(), header, header + sizeof header);
+}
+
+void CSMFTrackWriter::WriteTrackName(const char* name, int32 time)
+{
+	uint32 length = strlen(name);
+
+	WriteMetaEvent(time, 0x03, length);
+	m_data.insert(m_data.end(), name, name + length);
+}
+
+void CSMFTrackWriter::WriteTempo(double tempo_bpm, int32 time)
+{
+	uint32 usecPerQtr = uint32((60.0 * 1000000.0) / tempo_bpm);
+
+	WriteMetaEvent(time, 0x51, 3);
+	m_data.push_back((usecPerQtr >> 16) & 0xFF);
+	m_data.push_back((usecPerQtr >>  8) & 0xFF);
+	m_data.push_back( usecPerQtr        & 0xFF);
+}
+
+void CSMFTrackWriter::WriteEvents(const CEvent* events, long count, void* data)
+{
+	CSMFTrackWriter* writer = (CSMFTrackWriter*)data;
+	for (long i = 0; i < count; i++)
+		writer->WriteEvent(events[i]);
+}
+
+void CSMFTrackWriter::WriteEvent(const CEvent& event)
+{
+	if (m_ended)
+		return;
+
+	// check for any pending note-offs whose times have arrived
+	WritePendingNoteOffs(event.Start());
+
+	int32 time = event.Start();
+	if (time < m_lastEventTicks)
+		time = m_lastEventTicks;
+
+	switch (event.Command())
+	{
+		case EvtType_Note:
+			WriteNote(event, time);
+			break;
+
+		case EvtType_NoteOff:
+			WriteChannelStatus(time, 0x80 | Channel(event));
+			m_data.push_back(event.note.pitch & 0x7F);
+			m_data.push_back(event.note.releaseVelocity & 0x7F);
+			break;
+
+		case EvtType_ChannelATouch:
+			WriteChannelStatus(time, 0xD0 | Channel(event));
+			m_data.push_back(event.aTouch.value & 0x7F);
+			break;
+
+		case EvtType_PolyATouch:
+			WriteChannelStatus(time, 0xA0 | Channel(event));
+			m_data.push_back(event.aTouch.pitch & 0x7F);
+			m_data.push_back(event.aTouch.value & 0x7F);
+			break;
+
+		case EvtType_Controller:
+			WriteControlChange(event, time);
+			break;
+
+		case EvtType_ProgramChange:
+			WriteChannelStatus(time, 0xC0 | Channel(event));
+			m_data.push_back(event.programChange.program & 0x7F);
+			break;
+
+		case EvtType_PitchBend:
+			WriteChannelStatus(time, 0xE0 | Channel(event));
+			m_data.push_back( event.pitchBend.targetBend       & 0x7F);
+			m_data.push_back((event.pitchBend.targetBend >> 7) & 0x7F);
+			break;
+
+		case EvtType_SysEx:
+			WriteSystemExclusive(event, time);
+			break;
+
+		case EvtType_Text:
+			WriteTextMetaEvent(event, time);
+			break;
+
+		case EvtType_Tempo:
+			WriteTempoMetaEvent(event, time);
+			break;
+
+		case EvtType_TimeSig:
+			WriteTimeSigMetaEvent(event, time);
+			break;
+
+		case EvtType_End:
+			WriteEndOfTrack(time);
+			break;
+	}
+}
+
+void CSMFTrackWriter::WriteNote(const CEvent& event, int32 time)
+{
+	uint8 status = 0x90 | Channel(event);
+	uint8 pitch = event.note.pitch & 0x7F;
+
+	// a velocity of zero would turn the note off
+	uint8 velocity = event.note.attackVelocity & 0x7F;
+	WriteChannelStatus(time, status);
+	m_data.push_back(pitch);
+	m_data.push_back(velocity > 0 ? velocity : 1);
+
+	note_off noteOff;
+	noteOff.time = time + event.Duration();
+	noteOff.order = m_noteOffCount++;
+	noteOff.pitch = pitch;
+	noteOff.velocity = event.note.releaseVelocity & 0x7F;
+	// the reader takes a note-on without velocity as a note-off with the
+	// default velocity, which saves status bytes
+	if (noteOff.velocity == 64)
+	{
+		noteOff.status = status;
+		noteOff.velocity = 0;
+	}
+	else
+	{
+		noteOff.status = 0x80 | (status & 0x0F);
+	}
+	m_pendingNoteOffs.push(noteOff);
+}
+
+void CSMFTrackWriter::WriteControlChange(const CEvent& event, int32 time)
+{
+	uint8 status = 0xB0 | Channel(event);
+	uint8 controller = event.controlChange.controller & 0x7F;
+
+	WriteChannelStatus(time, status);
+	m_data.push_back(controller);
+	m_data.push_back(event.controlChange.MSB & 0x7F);
+
+	// the first 32 controllers have a fine part, which is a controller
+	// of its own
+	if (controller < 32 && event.controlChange.LSB > 0
+	 && event.controlChange.LSB < 128)
+	{
+		WriteChannelStatus(time, status);
+		m_data.push_back(controller + 32);
+		m_data.push_back(event.controlChange.LSB);
+	}
+}
+
+void CSMFTrackWriter::WriteSystemExclusive(const CEvent& event, int32 time)
+{
+	const uint8* data = (const uint8*)event.ExtendedData();
+	uint32 size = data ? event.ExtendedDataSize() : 0;
+
+	WriteVariableLengthNumber(time - m_lastEventTicks);
+	m_lastEventTicks = time;
+	m_data.push_back(0xF0);
+	WriteVariableLengthNumber(size + 1);
+	m_data.insert(m_data.end(), data, data + size);
+	m_data.push_back(0xF7);
+
+	m_runningStatus = 0;
+}
+
+void CSMFTrackWriter::WriteTextMetaEvent(const CEvent& event, int32 time)
+{
+	// the text is null-terminated
+	const uint8* text = (const uint8*)event.ExtendedData();
+	uint32 length = (text && event.ExtendedDataSize() > 0)
+					? event.ExtendedDataSize() - 1
+					: 0;
+
+	WriteMetaEvent(time, event.text.textType, length);
+	m_data.insert(m_data.end(), text, text + length);
+}
+
+void CSMFTrackWriter::WriteTempoMetaEvent(const CEvent& event, int32 time)
+{
+	uint32 usecPerQtr = uint32(60000000000.0 / double(event.tempo.newTempo) + 0.5);
+
+	WriteMetaEvent(time, 0x51, 3);
+	m_data.push_back((usecPerQtr >> 16) & 0xFF);
+	m_data.push_back((usecPerQtr >>  8) & 0xFF);
+	m_data.push_back( usecPerQtr        & 0xFF);
+}
+
+void CSMFTrackWriter::WriteTimeSigMetaEvent(const CEvent& event, int32 time)
+{
+	WriteMetaEvent(time, 0x58, 4);
+	m_data.push_back(event.sigChange.numerator);
+	// both the file and the event store the exponent of the beat size
+	m_data.push_back(event.sigChange.denominator);
+	m_data.push_back(24);
+	m_data.push_back(8);
+}
+
+void CSMFTrackWriter::WriteEndOfTrack(int32 time)
+{
+	if (m_ended)
+		return;
+
+	// write any remaining note-offs, the last of which may come later
+	WritePendingNoteOffs(INT32_MAX);
+	if (time < m_lastEventTicks)
+		time = m_lastEventTicks;
+
+	WriteMetaEvent(time, 0x2F, 0);
+	m_ended = true;
+
+	// fill in the length of the chunk
+	uint32 length = m_data.size() - 8;
+	m_data[4] = (length >> 24) & 0xFF;
+	m_data[5] = (length >> 16) & 0xFF;
+	m_data[6] = (length >>  8) & 0xFF;
+	m_data[7] =  length        & 0xFF;
+}
+
+void CSMFTrackWriter::WritePendingNoteOffs(int32 time)
+{
+	while (!m_pendingNoteOffs.empty() && m_pendingNoteOffs.top().time <= time)
+	{
+		const note_off& noteOff = m_pendingNoteOffs.top();
+		WriteChannelStatus(noteOff.time, noteOff.status);
+		m_data.push_back(noteOff.pitch);
+		m_data.push_back(noteOff.velocity);
+
+		m_pendingNoteOffs.pop();
+	}
+}
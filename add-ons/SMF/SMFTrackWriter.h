@@ -0,0 +1,167 @@
+/* ===================================================================== *
+ * SMFTrackWriter.h (MeV/StandardMidiFile)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s):
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ * 	Encodes MeV events as a Standard MIDI File track
+ * ---------------------------------------------------------------------
+ * To Do:
+ *
+ * ===================================================================== */
+
+#ifndef __C_SMFTrackWriter_H__
+#define __C_SMFTrackWriter_H__
+
+#include "Event.h"
+
+// Support Kit
+#include <Debug.h>
+// Standard Template Library
+#include <queue>
+#include <vector>
+
+// encodes MeV events as an MTrk chunk in memory, so that the whole track
+// can be written to the file at once
+class CSMFTrackWriter
+{
+public:
+	// channels maps the vChannel of an event (its destination ID) to
+	// the MIDI channel, 0-15. Times are written unchanged, so they have
+	// to be in the file's division already.
+	CSMFTrackWriter(const uint8* channels);
+
+	void	WriteTrackName(const char* name, int32 time = 0);
+	void	WriteTempo(double tempo_bpm, int32 time = 0);
+
+	// encodes the next event; events have to come in the order of their
+	// start times. Notes are followed by their note-offs, which are
+	// merged in at the right time. Anything after an 'end' event is
+	// left out.
+	void	WriteEvent(const CEvent& event);
+
+	// for EventList::ReadBlocks() and MeVTrackRef::ReadEvents(); data
+	// is the CSMFTrackWriter
+	static void	WriteEvents(const CEvent* events, long count, void* data);
+
+	// writes the pending note-offs and the end of the track, which
+	// happens at the given time or after the last note-off, whichever
+	// comes later. Does nothing if the track was ended already.
+	void	WriteEndOfTrack(int32 time);
+
+	// the whole MTrk chunk including its header, once the track has
+	// been ended
+	const uint8*	Chunk() const
+					{ return &m_data[0]; }
+	int32			ChunkSize() const
+					{ return m_data.size(); }
+
+private:
+	// a note-off waiting for its time to come
+	struct note_off
+	{
+		int32	time;
+		uint32	order;	// keeps note-offs of equal time in order
+		uint8	status;
+		uint8	pitch;
+		uint8	velocity;
+
+		bool	operator<(const note_off& other) const
+				{
+					// the earliest one is on top of the heap
+					if (time != other.time)
+						return time > other.time;
+					return order > other.order;
+				}
+	};
+
+			void	WriteNote(const CEvent& event, int32 time);
+			void	WriteControlChange(const CEvent& event, int32 time);
+			void	WriteSystemExclusive(const CEvent& event, int32 time);
+			void	WriteTextMetaEvent(const CEvent& event, int32 time);
+			void	WriteTempoMetaEvent(const CEvent& event, int32 time);
+			void	WriteTimeSigMetaEvent(const CEvent& event, int32 time);
+
+			void	WritePendingNoteOffs(int32 time);
+
+	// writes the delta time and, unless running status allows leaving
+	// it out, the status byte of a channel message
+	inline	void	WriteChannelStatus(int32 time, uint8 status);
+	// writes the delta time and the type of a meta event
+	inline	void	WriteMetaEvent(int32 time, uint8 type, uint32 length);
+	inline	void	WriteVariableLengthNumber(uint32 value);
+	inline	uint8	Channel(const CEvent& event) const;
+
+	const uint8*				m_channels;
+	std::vector<uint8>			m_data;
+	std::priority_queue<note_off>	m_pendingNoteOffs;
+	uint32						m_noteOffCount;
+	int32						m_lastEventTicks;
+	uint8						m_runningStatus;
+	bool						m_ended;
+};
+
+inline uint8 CSMFTrackWriter::Channel(const CEvent& event) const
+{
+	return m_channels[event.GetVChannel()] & 0x0F;
+}
+
+inline void CSMFTrackWriter::WriteVariableLengthNumber(uint32 value)
+{
+	ASSERT(value <= 0x0FFFFFFF); // largest number allowed by SMF spec
+
+	uint8 bytes[4];
+	int32 count = 0;
+	do
+	{
+		bytes[count++] = value & 0x7F;
+		value >>= 7;
+	} while (value > 0 && count < 4);
+	while (count > 1)
+		m_data.push_back(bytes[--count] | 0x80);
+	m_data.push_back(bytes[0]);
+}
+
+inline void CSMFTrackWriter::WriteChannelStatus(int32 time, uint8 status)
+{
+	ASSERT(time >= m_lastEventTicks);
+
+	WriteVariableLengthNumber(time - m_lastEventTicks);
+	m_lastEventTicks = time;
+	if (status != m_runningStatus)
+		m_data.push_back(m_runningStatus = status);
+}
+
+inline void CSMFTrackWriter::WriteMetaEvent(int32 time, uint8 type, uint32 length)
+{
+	ASSERT(time >= m_lastEventTicks);
+
+	WriteVariableLengthNumber(time - m_lastEventTicks);
+	m_lastEventTicks = time;
+	m_data.push_back(0xFF);
+	m_data.push_back(type);
+	WriteVariableLengthNumber(length);
+
+	// meta events and system exclusive messages cancel running status
+	m_runningStatus = 0;
+}
+
+#endif /* __C_SMFTrackWriter_H__ */
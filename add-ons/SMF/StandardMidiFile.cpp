@@ -6,6 +6,7 @@
 #include "BeFileReader.h"
 #include "IFFWriter.h"
 #include "Error.h"
+#include "WorkerPool.h"
 
 // Application Kit
 #include <Message.h>
@@ -19,11 +20,10 @@
 // Support Kit
 #include <Debug.h>
 // C & Standard Template Library
+#include <algorithm>
 #include <cctype>
-#include <cmath>
 #include <cstdio>
-#include <algorithm>
-#include <memory>
+#include <new>
 #include <vector>
 
 using std::vector;
@@ -33,59 +33,6 @@ enum {
 	Export_ID		= 4,
 };
 
-// ---------------------------------------------------------------------------
-// Exception classes
-
-class PrematureEndOfTrack : public IError
-{
-public:
-	virtual	const char*		Description() const
-								{ return "Track data is corrupt."; }
-};
-
-// ---------------------------------------------------------------------------
-// Function objects
-
-class NoteEq
-{
-public:
-	NoteEq(const CEvent& event)
-		:	vChannel(event.GetVChannel()),
-			pitch(event.GetAttribute(EvAttr_Pitch))
-		{
-		}
-
-	bool operator()(const CEvent& event)
-		{
-			return    event.GetAttribute(EvAttr_Pitch) == pitch
-			       && event.GetVChannel()               == vChannel;
-		}
-
-private:
-	int8 vChannel;
-	int8 pitch;
-};
-
-class HandleHungNote
-{
-public:
-	HandleHungNote(MeVTrackHandle trk) : track(trk) { }
-
-	void operator()(CEvent& event)
-		{
-			PRINT(("\tWarning! Hung note at %ld on vChannel %d, pitch %d\n",
-			       event.Start(), event.GetVChannel(), event.note.pitch));
-
-			event.SetDuration(0);
-			event.SetAttribute(EvAttr_ReleaseVelocity, 64);
-
-			track->Merge(&event, 1);
-		}
-
-private:
-	MeVTrackHandle track;
-};
-
 // ---------------------------------------------------------------------------
 // Main function
 
@@ -216,19 +163,55 @@ void CStandardMidiFile::OnImport( BMessage *inMsg, entry_ref *ref, int32 inDetec
 		doc = NewDocument(docName.String(), false);
 		CreateDestinations(doc, name);
 
-			// Read in each of the tracks.
-		for (int trackNum = 0; reader.BytesAvailable() >= 8; trackNum++)
+			// Read in all of the track chunks first...
+		vector<smf_track> tracks;
+		try
 		{
-			reader >> chunkID >> chunkLength;
-			if (chunkID != 'MTrk')
+			while (reader.BytesAvailable() >= 8)
 			{
-				reader.Skip(chunkLength);
-				continue;
+				reader >> chunkID >> chunkLength;
+				if (chunkID != 'MTrk')
+				{
+					reader.Skip(chunkLength);
+					continue;
+				}
+
+				vector<uint8> data(chunkLength);
+				if (chunkLength > 0)
+					reader.MustRead(&data[0], chunkLength);
+
+				tracks.push_back(smf_track());
+				tracks.back().data.swap(data);
+				tracks.back().corrupt = false;
 			}
+		}
+		catch (IError &e)
+		{
+			// Import the tracks up to the one that couldn't be read
+			ShowError( e.Description() );
+		}
+
+			// ...then decode them concurrently, since the tracks of a file
+			// are independent of each other...
+		if (!tracks.empty())
+		{
+			smf_import import;
+			import.destinationIDs = m_destinationID;
+			import.timeBase = timeBase;
+			import.tracks = &tracks[0];
+
+			CWorkerPool pool("SMF Import");
+			pool.Run(tracks.size(), DecodeTrack, &import);
+		}
 
-			auto_ptr<uint8> trackBuffer(new uint8[chunkLength]);
-			reader.MustRead(trackBuffer.get(), chunkLength);
-			if (ReadTrack(doc, trackBuffer.get(), chunkLength, timeBase) == false)
+			// ...then build the tempo map from all of them at once...
+		if (timeBase.format == smf_time_base::METERED)
+			AddMasterEvents(doc, tracks);
+
+			// ...and add them to the document one after the other.
+		for (uint32 i = 0; i < tracks.size(); i++)
+		{
+			if (AddTrack(doc, tracks[i], timeBase) == false)
 				break;
 		}
 
@@ -238,7 +221,6 @@ void CStandardMidiFile::OnImport( BMessage *inMsg, entry_ref *ref, int32 inDetec
 
 	if (doc)
 	{
-		SetInitialTempo(doc);
 		doc->ShowWindow();
 	}
 }
@@ -259,122 +241,169 @@ void CStandardMidiFile::CreateDestinations(MeVDocHandle doc, const char* filenam
 }
 
 bool
-CStandardMidiFile::ReadTrack(
+CStandardMidiFile::AddTrack(
 	MeVDocHandle doc,
-	uint8 *ptr,
-	long length,
+	smf_track& trackData,
 	const smf_time_base& timeBase)
 {
-	CEvent event;
-	MeVTrackHandle track = NULL;
 	TClockType clockType = (timeBase.format == smf_time_base::METERED)
 						   ? ClockType_Metered
 						   : ClockType_Real;
-	vector<CEvent> notesInProgress;
+	vector<CEvent> &trackEvents = trackData.events;
 
-	try
-	{
-		SMFTrackReader fileTrack(*this, ptr, length, m_destinationID,
-								 timeBase);
-		track = doc->NewEventTrack(clockType);
-		PRINT(("\tNew %s track: ID=%ld\n",
-		       (clockType == ClockType_Metered) ? "metered" : "real-time",
-		       track->GetID()));
-
-		while (fileTrack.GetNextEvent(event))
-		{
-			if (event.Command() == EvtType_Text && event.text.textType == 0x03)
-				track->SetName(reinterpret_cast<char *>(event.ExtendedData()));
+	MeVTrackHandle track = doc->NewEventTrack(clockType);
+	PRINT(("\tNew %s track: ID=%ld\n",
+	       (clockType == ClockType_Metered) ? "metered" : "real-time",
+	       track->GetID()));
 
-			if (event.Command() == EvtType_Note)
-			{
-				notesInProgress.push_back(event);
-			}
-			else if (event.Command() == EvtType_NoteOff)
-			{
-				// find matching noteon
-				vector<CEvent>::iterator noteOn = find_if(notesInProgress.begin(),
-														  notesInProgress.end(),
-														  NoteEq(event));
-				if (noteOn != notesInProgress.end())
-				{
-					noteOn->SetDuration(event.Start() - noteOn->Start());
-					noteOn->SetAttribute(EvAttr_ReleaseVelocity,
-										 event.GetAttribute(EvAttr_ReleaseVelocity));
-					track->Merge(&(*noteOn), 1);
-					notesInProgress.erase(noteOn);
-				}
-				else
-				{
-					PRINT(("\tUnmatched note-off at %ld: vChannel = %d, pitch = %ld\n",
-					       event.Start(), event.GetVChannel(),
-					       event.GetAttribute(EvAttr_Pitch)));
-				}
-			}
-			else
-			{
-				track->Merge(&event, 1);
-			}
-		}
+	for (uint32 i = 0; i < trackEvents.size(); i++)
+	{
+		CEvent &event = trackEvents[i];
+		if (event.Command() == EvtType_Text && event.text.textType == 0x03)
+			track->SetName(reinterpret_cast<char *>(event.ExtendedData()));
+	}
 
-		// shut off any hung notes
-		for_each(notesInProgress.begin(), notesInProgress.end(), HandleHungNote(track));
-
-		// create an instance of the track
-		MeVTrackHandle master = doc->ActiveMasterTrack();
-		CEvent trackEv;
-		trackEv.SetCommand(EvtType_Sequence);
-		trackEv.SetStart(0);
-		trackEv.SetDuration(track->Duration());
-		trackEv.sequence.sequence = track->GetID();
-		trackEv.sequence.transposition = 0;
-		trackEv.sequence.transposition = 0;
-		trackEv.sequence.flags = 0;
-		trackEv.sequence.vPos = track->GetID() - 2;
-		master->Merge(&trackEv, 1);
-		doc->ReleaseTrack(master);
+	// hand the whole track over at once; this keeps what could be read
+	// from a corrupt track, too
+	if (!trackEvents.empty())
+		track->Merge(&trackEvents[0], trackEvents.size());
+	vector<CEvent>().swap(trackEvents);
 
+	if (trackData.error.Length() > 0)
+		ShowError("%s", trackData.error.String());
+	if (trackData.corrupt)
+	{
 		doc->ReleaseTrack(track);
-		return true;
+		return false;
+	}
+
+	// create an instance of the track
+	MeVTrackHandle master = doc->ActiveMasterTrack();
+	CEvent trackEv;
+	trackEv.SetCommand(EvtType_Sequence);
+	trackEv.SetStart(0);
+	trackEv.SetDuration(track->Duration());
+	trackEv.sequence.sequence = track->GetID();
+	trackEv.sequence.transposition = 0;
+	trackEv.sequence.transposition = 0;
+	trackEv.sequence.flags = 0;
+	trackEv.sequence.vPos = track->GetID() - 2;
+	master->Merge(&trackEv, 1);
+	doc->ReleaseTrack(master);
+
+	doc->ReleaseTrack(track);
+	return true;
+}
+
+void
+CStandardMidiFile::DecodeTrack(
+	int32 index,
+	void *data)
+{
+	smf_import *import = (smf_import *)data;
+	smf_track &track = import->tracks[index];
+
+	// The whole track is decoded before it is merged into the document,
+	// so that the track is only summarized and updated once. Delta times
+	// can't be negative, so the events come out sorted.
+	try
+	{
+		track.events.reserve(track.data.size() / 3);
+
+		CSMFTrackReader fileTrack(track.data.empty() ? NULL : &track.data[0],
+								  track.data.size(), import->destinationIDs,
+								  import->timeBase);
+		if (!fileTrack.ReadTrack(track.events))
+			track.error = fileTrack.Error();
 	}
 	catch (IError& e)
 	{
-		ShowError(e.Description());
-		if (track)
-			doc->ReleaseTrack(track);
-			return false;
+		track.error = e.Description();
+		track.corrupt = true;
+	}
+	catch (std::bad_alloc&)
+	{
+		track.error = "There was not enough memory to import the track.";
+		track.corrupt = true;
 	}
+	catch (...)
+	{
+		// nothing may be thrown out of a worker thread
+		track.error = "The track could not be imported.";
+		track.corrupt = true;
+	}
+
+	vector<uint8>().swap(track.data);
 }
 
 // ---------------------------------------------------------------------------
-// Function to find and set initial tempo for document
+// Function to set up the tempo map and time signatures of the document
 
-void CStandardMidiFile::SetInitialTempo(MeVDocHandle doc)
+static bool
+IsMasterEvent(const CEvent &event)
 {
-	// default tempo is 120 BPM.  For type 1 files, tempo map should be in first track
-	double tempo = 120.0;
+	return event.Command() == EvtType_Tempo || event.Command() == EvtType_TimeSig;
+}
 
-	MeVTrackHandle track = doc->FirstTrack();
-	if (track)
+static bool
+StartsBefore(const CEvent &a, const CEvent &b)
+{
+	return a.Start() < b.Start();
+}
+
+void
+CStandardMidiFile::AddMasterEvents(
+	MeVDocHandle doc,
+	vector<smf_track>& tracks)
+{
+	// Type 1 files should keep them in the first track, but they only
+	// have an effect on the master track anyway. The tracks after a
+	// corrupt one won't be imported.
+	vector<CEvent> masterEvents;
+	for (uint32 i = 0; i < tracks.size(); i++)
 	{
-		MeVEventHandle pEvent;
-		for (pEvent = track->FirstEvent();
-		     pEvent->Valid() && pEvent->EventPtr()->Start() == 0;
-		     pEvent->Seek(1))
+		vector<CEvent> &trackEvents = tracks[i].events;
+		vector<CEvent>::iterator last = trackEvents.begin();
+		for (vector<CEvent>::iterator ev = trackEvents.begin();
+			 ev != trackEvents.end(); ++ev)
 		{
-			const CEvent* event = pEvent->EventPtr();
-			if (event->Command() == EvtType_Tempo)
-			{
-				tempo = double(event->GetAttribute(EvAttr_TempoValue)) / 1000.0;
-				break;
-			}
+			if (IsMasterEvent(*ev))
+				masterEvents.push_back(*ev);
+			else
+				*last++ = *ev;
 		}
+		trackEvents.erase(last, trackEvents.end());
 
-		track->ReleaseEventRef(pEvent);
-		doc->ReleaseTrack(track);
+		if (tracks[i].corrupt)
+			break;
 	}
+	if (masterEvents.empty())
+		return;
+
+	// Events of equal time keep the order of the tracks
+	std::stable_sort(masterEvents.begin(), masterEvents.end(), StartsBefore);
 
+	// default tempo is 120 BPM, unless the file starts with another one
+	double tempo = 120.0;
+	for (uint32 i = 0; i < masterEvents.size() && masterEvents[i].Start() == 0; i++)
+	{
+		if (masterEvents[i].Command() == EvtType_Tempo)
+		{
+			tempo = double(masterEvents[i].GetAttribute(EvAttr_TempoValue)) / 1000.0;
+			break;
+		}
+	}
 	doc->SetInitialTempo(tempo);
+
+	// The master track compiles the whole tempo map and signature map
+	// once, when the merge is done, and replaces the document's tempo
+	// map in one go.
+	MeVTrackHandle master = doc->FindTrack(1);
+	if (master)
+	{
+		master->Merge(&masterEvents[0], masterEvents.size());
+		doc->ReleaseTrack(master);
+	}
 }
 
 // ---------------------------------------------------------------------------
@@ -416,20 +445,17 @@ void CStandardMidiFile::OnExport( BMessage *inMsg, int32 inDocID, entry_ref *ref
 		if (WriteHeaderChunk(writer, numTracks + 1, clockType) < B_OK)
 			return;
 
-		// write tempo track
+		// destination IDs are what the events know their channels by
+		uint8 channels[256];
+		for (int32 id = 0; id < 256; id++)
 		{
-			SMFTrackWriter tempoTrack(writer, doc);
-
-			// sequence name
-			char name[B_FILE_NAME_LENGTH];
-			doc->GetName(name, B_FILE_NAME_LENGTH);
-			tempoTrack.WriteTrackName(name);
-
-			// tempo
-			tempoTrack.WriteTempo(doc->GetInitialTempo());
-			tempoTrack.WriteEndOfTrack(0);
+			int channel = doc->GetChannelForDestination(id);
+			channels[id] = (channel >= 0) ? channel : 0;
 		}
 
+		// write tempo track
+		WriteTempoTrack(writer, doc, clockType, channels);
+
 		// write tracks
 		MeVTrackHandle track = doc->FirstTrack();
 		for (bool trackExists = track; trackExists; trackExists = track->NextTrack())
@@ -438,10 +464,7 @@ void CStandardMidiFile::OnExport( BMessage *inMsg, int32 inDocID, entry_ref *ref
 			if (track->GetClockType() != clockType)
 				continue;
 
-			if (WriteTrack(writer, doc, track) < B_OK)
-			{
-				return;
-			}
+			WriteTrack(writer, track, channels);
 		}
 
 		doc->ReleaseTrack(track);
@@ -458,24 +481,94 @@ void CStandardMidiFile::OnExport( BMessage *inMsg, int32 inDocID, entry_ref *ref
 	}
 }
 
+// ---------------------------------------------------------------------------
+// Write the tempo track
+
+struct smf_tempo_track
+{
+	CSMFTrackWriter*	writer;
+	double				initialTempo;
+	bool				started;
+};
+
+static void
+WriteMasterEvents(const CEvent* events, long count, void* data)
+{
+	smf_tempo_track* track = (smf_tempo_track*)data;
+	for (long i = 0; i < count; i++)
+	{
+		const CEvent& event = events[i];
+		if (event.Command() != EvtType_Tempo && event.Command() != EvtType_TimeSig)
+			continue;
+
+		// a tempo change at the start replaces the initial tempo
+		if (!track->started)
+		{
+			if (event.Command() != EvtType_Tempo || event.Start() > 0)
+				track->writer->WriteTempo(track->initialTempo);
+			track->started = true;
+		}
+		track->writer->WriteEvent(event);
+	}
+}
+
+void
+CStandardMidiFile::WriteTempoTrack(
+	CIFFWriter& writer,
+	MeVDocHandle doc,
+	TClockType clockType,
+	const uint8* channels)
+{
+	CSMFTrackWriter tempoTrack(channels);
+
+	// sequence name
+	char name[B_FILE_NAME_LENGTH];
+	doc->GetName(name, B_FILE_NAME_LENGTH);
+	tempoTrack.WriteTrackName(name);
+
+	smf_tempo_track track;
+	track.writer = &tempoTrack;
+	track.initialTempo = doc->GetInitialTempo();
+	track.started = false;
+
+	// the tempo map only applies to metered time
+	if (clockType == ClockType_Metered)
+	{
+		MeVTrackHandle master = doc->FindTrack(1);
+		if (master)
+		{
+			master->ReadEvents(WriteMasterEvents, &track);
+			doc->ReleaseTrack(master);
+		}
+	}
+	if (!track.started)
+		tempoTrack.WriteTempo(track.initialTempo);
+
+	tempoTrack.WriteEndOfTrack(0);
+	writer.MustWrite(tempoTrack.Chunk(), tempoTrack.ChunkSize());
+}
+
 // ---------------------------------------------------------------------------
 // Write a track
-status_t CStandardMidiFile::WriteTrack(CIFFWriter& writer, MeVDocHandle doc, MeVTrackHandle track)
+
+void
+CStandardMidiFile::WriteTrack(
+	CIFFWriter& writer,
+	MeVTrackHandle track,
+	const uint8* channels)
 {
-	SMFTrackWriter trackWriter(writer, doc);
+	CSMFTrackWriter trackWriter(channels);
 
 	char name[B_FILE_NAME_LENGTH];
 	track->GetName(name, B_FILE_NAME_LENGTH);
 	trackWriter.WriteTrackName(name);
 
-	MeVEventHandle pEvent;
-	CEvent event;
-	for (pEvent = track->FirstEvent(); pEvent->GetEvent(&event); pEvent->Seek(1))
-		trackWriter.WriteEvent(event);
+	// walks the blocks of the track directly, rather than going through
+	// an event handle
+	track->ReadEvents(CSMFTrackWriter::WriteEvents, &trackWriter);
+	trackWriter.WriteEndOfTrack(0);
 
-	track->ReleaseEventRef(pEvent);
-
-	return true;
+	writer.MustWrite(trackWriter.Chunk(), trackWriter.ChunkSize());
 }
 
 // ---------------------------------------------------------------------------
@@ -573,697 +666,3 @@ int32 CStandardMidiFile::DetectFileType(
 
 	return -1;
 }
-
-// ---------------------------------------------------------------------------
-// Utility class for reading standard MIDI file tracks
-
-CStandardMidiFile::SMFTrackReader::SMFTrackReader(CStandardMidiFile& smfPlugin, const uint8* data, int32 len,
-                                                  int* destinationIDs, const smf_time_base& tBase)
-	:	m_plugin(smfPlugin),
-		m_destinationID(destinationIDs),
-		m_pData(data),
-		m_pEnd(data + len),
-		m_trackLength(len),
-		m_timeBase(tBase),
-		m_fileTime_ticks(0),
-		m_runningStatus(0)
-{
-}
-
-bool CStandardMidiFile::SMFTrackReader::GetNextEvent(CEvent& outEvent)
-{
-	CEvent	event;	// start with fresh event so all fields are initialized
-	uint8	status;
-	bool	gotEvent = false;
-
-	while (!gotEvent)
-	{
-		if (m_pData >= m_pEnd)
-			return false;
-
-		int64 mevTime = GetTime();
-		if (mevTime > 2147483647)
-		{
-			PRINT(("Event time is %Ld (max %ld)\n", mevTime, 2147483647L));
-			m_plugin.ShowError( "Track exceeds maximum length." );
-			return false;
-		}
-
-		event.SetStart(mevTime);
-		PRINT(("\t\tEvent time=%ld\n", event.Start()));
-
-		status = GetStatusByte();
-		switch (status & 0xf0)
-		{
-			case 0x80:
-				gotEvent = ReadNoteOff(status, event);
-				break;
-
-			case 0x90:
-				gotEvent = ReadNoteOn(status, event);
-				break;
-
-			case 0xA0:
-				gotEvent = ReadPolyPressure(status, event);
-				break;
-
-			case 0xB0:
-				gotEvent = ReadControlChange(status, event);
-				break;
-
-			case 0xC0:
-				gotEvent = ReadProgramChange(status, event);
-				break;
-
-			case 0xD0:
-				gotEvent = ReadChannelPressure(status, event);
-				break;
-
-			case 0xE0:
-				gotEvent = ReadPitchBend(status, event);
-				break;
-
-			case 0xF0:			// sysex and meta
-				switch (status)
-				{
-					case 0xf0:
-						gotEvent = ReadSystemExclusive(status, event);
-						break;
-
-					case 0xff:
-						gotEvent = ReadMetaEvent(status, event);
-						break;
-
-					default:
-						m_plugin.ShowError("Error reading file: %x byte encountered at offset %d in track.",
-						                   status, Position());
-						return false;
-				}
-				break;
-
-			default:						// unrecognized event
-				m_plugin.ShowError("Error reading file: unrecognized status byte '%x' encountered at offset %d in track.",
-				                   status, Position());
-				return false;
-		}
-	}
-
-	outEvent = event;
-	return true;
-}
-
-int64 CStandardMidiFile::SMFTrackReader::GetTime()
-{
-	int64 realTime_usec;
-	int64 mevTime;
-
-	uint32 deltaTime = GetVariableLengthNumber();
-	m_fileTime_ticks += deltaTime;
-
-	if (m_timeBase.format == smf_time_base::METERED)
-	{
-		mevTime = (m_fileTime_ticks * Ticks_Per_QtrNote) / m_timeBase.base.metered.ticksPerQuarterNote;
-	}
-	else
-	{
-		switch (m_timeBase.base.timeCode.smpteFormat)
-		{
-			case smf_time_base::SMPTE_24:
-				realTime_usec = (m_fileTime_ticks * 1000000) / (24 * int64(m_timeBase.base.timeCode.ticksPerFrame));
-				break;
-			case smf_time_base::SMPTE_25:
-				realTime_usec = (m_fileTime_ticks * 1000000) / (25 * int64(m_timeBase.base.timeCode.ticksPerFrame));
-				break;
-			case smf_time_base::SMPTE_30_DROP:
-				{
-					// 30 frames per second, but skip two frames at the beginning
-					// of each minute that does not end in 0 (0, 10, 20, ...).
-					// We treat it like 30 non drop, but add time to adjust for dropped frames.
-					int64 frame = m_fileTime_ticks / int64(m_timeBase.base.timeCode.ticksPerFrame);
-					int64 framesDropped = (frame / 17982) * 18 + ((frame % 17982 - 2) / 1798) * 2;
-
-					realTime_usec  = (m_fileTime_ticks * 1000000) / (30 * int64(m_timeBase.base.timeCode.ticksPerFrame));
-					realTime_usec += (framesDropped    * 1000000) /  30;
-				}
-				break;
-			case smf_time_base::SMPTE_30:
-			default:
-				realTime_usec = (m_fileTime_ticks * 1000000) / (30 * int64(m_timeBase.base.timeCode.ticksPerFrame));
-				break;
-		}
-
-		// round to nearest millisecond
-		mevTime = (realTime_usec + 500) / 1000;
-	}
-
-	return mevTime;
-}
-
-uint8 CStandardMidiFile::SMFTrackReader::GetStatusByte()
-{
-	// handle running status
-	if (PeekByte() & 0x80)
-	{
-		uint8 status = GetByte();
-		if (status < 0xF8) // not realtime
-			m_runningStatus = status;
-		return status;
-	}
-	else
-	{
-		return m_runningStatus;
-	}
-}
-
-bool CStandardMidiFile::SMFTrackReader::ReadNoteOn(uint8 status, CEvent& event)
-{
-	uint8 pitch = GetByte();
-	uint8 vel   = GetByte();
-
-	PRINT(("\t\t\tNote "));
-	if (vel == 0)
-	{
-		event.SetCommand(EvtType_NoteOff);
-		vel = 64;
-		PRINT(("Off"));
-	}
-	else
-	{
-		event.SetCommand(EvtType_Note);
-		PRINT(("On"));
-	}
-	event.SetVChannel(m_destinationID[status & 0x0F]);
-	event.SetAttribute(EvAttr_Pitch,          pitch);
-	event.SetAttribute(EvAttr_AttackVelocity, vel);
-
-	PRINT(("       vChannel=%-3d, pitch=%-3ld, vel=%-3ld\n",
-	       event.GetVChannel(),
-	       event.GetAttribute(EvAttr_Pitch),
-	       event.GetAttribute(EvAttr_AttackVelocity)));
-
-	if (event.GetAttribute(EvAttr_AttackVelocity) == 0)
-	{
-		event.SetCommand(EvtType_NoteOff);
-		event.SetAttribute(EvAttr_ReleaseVelocity, 64);
-		PRINT(("\t\t\t--->Converted to Note Off\n"));
-	}
-
-	return true;
-}
-
-bool CStandardMidiFile::SMFTrackReader::ReadNoteOff(uint8 status, CEvent& event)
-{
-	event.SetCommand(EvtType_NoteOff);
-	event.SetVChannel(m_destinationID[status & 0x0F]);
-	event.SetAttribute(EvAttr_Pitch,           GetByte());
-	event.SetAttribute(EvAttr_ReleaseVelocity, GetByte());
-
-	PRINT(("\t\t\tNote Off      vChannel=%-3d, pitch=%-3ld, vel=%-3ld\n",
-	       event.GetVChannel(),
-	       event.GetAttribute(EvAttr_Pitch),
-	       event.GetAttribute(EvAttr_ReleaseVelocity)));
-	return true;
-}
-
-bool CStandardMidiFile::SMFTrackReader::ReadPolyPressure(uint8 status, CEvent& event)
-{
-	event.SetCommand(EvtType_PolyATouch);
-	event.SetVChannel(m_destinationID[status & 0x0F]);
-	event.SetAttribute(EvAttr_Pitch,      GetByte());
-	event.SetAttribute(EvAttr_AfterTouch, GetByte());
-
-	PRINT(("\t\t\tPoly Pressure vChannel=%-3d, pitch=%-3ld, value=%-3ld\n",
-	       event.GetVChannel(),
-	       event.GetAttribute(EvAttr_Pitch),
-	       event.GetAttribute(EvAttr_AfterTouch)));
-
-	return true;
-}
-
-bool CStandardMidiFile::SMFTrackReader::ReadChannelPressure(uint8 status, CEvent& event)
-{
-	event.SetCommand(EvtType_ChannelATouch);
-	event.SetVChannel(m_destinationID[status & 0x0F]);
-	event.SetAttribute(EvAttr_AfterTouch, GetByte());
-	PRINT(("\t\t\tChannel Pressure vChannel=%-3d, value=%-3ld\n",
-	       event.GetVChannel(),
-	       event.GetAttribute(EvAttr_AfterTouch)));
-
-	return true;
-}
-
-bool CStandardMidiFile::SMFTrackReader::ReadControlChange(uint8 status, CEvent& event)
-{
-	event.SetCommand(EvtType_Controller);
-	event.SetVChannel(m_destinationID[status & 0x0F]);
-	event.SetAttribute(EvAttr_ControllerNumber, GetByte());
-	event.SetAttribute(EvAttr_ControllerValue8, GetByte());
-	PRINT(("\t\t\tControl Change vChannel=%-3d, controller=%-3ld, value=%-3ld\n",
-	       event.GetVChannel(),
-	       event.GetAttribute(EvAttr_ControllerNumber),
-	       event.GetAttribute(EvAttr_ControllerValue8)));
-
-	return true;
-}
-
-bool CStandardMidiFile::SMFTrackReader::ReadProgramChange(uint8 status, CEvent& event)
-{
-	// To do: merge with bank select?
-	event.SetCommand(EvtType_ProgramChange);
-	event.SetVChannel(m_destinationID[status & 0x0F]);
-	event.SetAttribute(EvAttr_Program, GetByte());
-	PRINT(("\t\t\tProgram Change vChannel=%-3d, program=%-3ld\n",
-	       event.GetVChannel(),
-	       event.GetAttribute(EvAttr_Program)));
-
-	return true;
-}
-
-bool CStandardMidiFile::SMFTrackReader::ReadPitchBend(uint8 status, CEvent& event)
-{
-	event.SetCommand(EvtType_PitchBend);
-	event.SetVChannel(m_destinationID[status & 0x0F]);
-
-	int16 bendAmount = GetByte() - 8192;
-	bendAmount += GetByte() * 128;
-	event.SetAttribute(EvAttr_BendValue,   bendAmount);
-	event.SetAttribute(EvAttr_InitialBend, bendAmount);
-	PRINT(("\t\t\tPitch Bend vChannel=%-3d, amount=%-3ld\n",
-	       event.GetVChannel(),
-	       event.GetAttribute(EvAttr_BendValue)));
-
-	return true;
-}
-
-bool CStandardMidiFile::SMFTrackReader::ReadSystemExclusive(uint8 status, CEvent& event)
-{
-	vector<uint8> buf;
-	uint8 ch;
-
-	buf.reserve(256); // avoid reallocations for most messages
-
-	while ((ch = GetByte()) != 0xF7)
-		buf.push_back(ch);
-
-	event.SetCommand(EvtType_SysEx);
-	event.SetVChannel(m_destinationID[status & 0x0F]); // is this correct ???
-	if (event.SetExtendedDataSize(buf.size()))
-		memcpy(event.ExtendedData(), &buf[0], buf.size());
-	PRINT(("\t\t\tSystem Exclusive length=%ld\n", buf.size()));
-
-	return true;
-}
-
-bool CStandardMidiFile::SMFTrackReader::ReadMetaEvent(uint8 status, CEvent& event)
-{
-	uint32	usecPerQtr;
-
-	uint8  type   = GetByte();
-	uint32 length = GetVariableLengthNumber();
-
-	switch (type)
-	{
-		case 0x01:			// text
-		case 0x02:			// Copyright notice
-		case 0x03:			// Sequence/track name
-		case 0x04:			// Instrument name
-		case 0x05:			// Lyric
-		case 0x06:			// Marker
-		case 0x07:			// Cue point
-			event.SetCommand(EvtType_Text);
-			event.text.textType = type;
-			if (event.SetExtendedDataSize(length + 1))
-			{
-				GetBytes(reinterpret_cast<uint8*>(event.ExtendedData()), length);
-				reinterpret_cast<char*>(event.ExtendedData())[length] = '\0';
-			}
-			else
-			{
-				SkipBytes(length);
-			}
-			PRINT(("\t\t\tMeta Data text type=%d length=%lu\n",
-			       event.text.textType, length));
-			break;
-
-		case 0x2f:			// End of track
-			event.SetCommand(EvtType_End);
-			SkipBytes(length); // should be 0
-			PRINT(("\t\t\tEnd Of Track\n"));
-			break;
-
-		case 0x51:			// Set tempo
-			usecPerQtr  = GetByte() * 65536;
-			usecPerQtr += GetByte() *   256;
-			usecPerQtr += GetByte();
-			event.SetCommand(EvtType_Tempo);
-			event.SetAttribute(EvAttr_TempoValue, uint32(1000.0 * 60.0 * 1000000.0 / double(usecPerQtr) + 0.5));
-			PRINT(("\t\t\tSet Tempo=%ld (%f BPM, %ld usecs/qtr)\n",
-			       event.GetAttribute(EvAttr_TempoValue),
-			       double(event.GetAttribute(EvAttr_TempoValue)) / 1000.0,
-			       usecPerQtr));
-			break;
-
-		case 0x58:			// Time signaturee
-			event.SetCommand(EvtType_TimeSig);
-			event.SetAttribute(EvAttr_TSigBeatCount, GetByte());
-			event.SetAttribute(EvAttr_TSigBeatSize,  1 << GetByte());
-			event.SetDuration(0);
-			SkipBytes(2);
-			PRINT(("\t\t\tTime Signature %ld/%ld\n",
-			       event.GetAttribute(EvAttr_TSigBeatCount),
-			       event.GetAttribute(EvAttr_TSigBeatSize)));
-			break;
-
-		case 0x00:			// sequence ID 						(handled separately)
-		case 0x20:			// MIDI channel prefix				(not handled)
-		case 0x54:			// SMPTE Offset						(not handled)
-		case 0x59:			// Key signaturee					(not handled)
-		case 0x7F:			// Sequencer-specific meta event	(not used)
-		default:
-			PRINT(("\t\t\tMeta code %d, length %ld\n", type, length));
-			SkipBytes(length);
-			return false;
-	}
-
-	return true;
-}
-
-uint8 CStandardMidiFile::SMFTrackReader::GetByte()
-{
-	if (m_pData >= m_pEnd)
-		throw PrematureEndOfTrack();
-
-	return *m_pData++;
-}
-
-uint8 CStandardMidiFile::SMFTrackReader::PeekByte() const
-{
-	if (m_pData >= m_pEnd)
-		throw PrematureEndOfTrack();
-
-	return *m_pData;
-}
-
-void CStandardMidiFile::SMFTrackReader::GetBytes(uint8* buffer, int32 numBytes)
-{
-	if (m_pData + numBytes >= m_pEnd)
-		throw PrematureEndOfTrack();
-
-	memcpy(buffer, m_pData, numBytes);
-	m_pData += numBytes;
-}
-
-void CStandardMidiFile::SMFTrackReader::SkipBytes(int32 numBytes)
-{
-	if (m_pData + numBytes >= m_pEnd && numBytes > 0)
-		throw PrematureEndOfTrack();
-
-	m_pData += numBytes;
-}
-
-uint32 CStandardMidiFile::SMFTrackReader::GetVariableLengthNumber()
-{
-	uint32 v = 0;
-	uint8 b;
-
-	do
-	{
-		b = GetByte();
-		v = (v << 7) | (b & 0x7f);
-	} while (b & 0x80);
-
-	return v;
-}
-
-// ---------------------------------------------------------------------------
-// Utility class for reading standard MIDI file tracks
-CStandardMidiFile::SMFTrackWriter::SMFTrackWriter(CIFFWriter& writer, MeVDocHandle doc)
-	:	m_writer(writer), m_doc(doc), m_lastEventTicks(0)
-{
-	m_writer.AllowOddLengthChunks();
-	m_writer.Push('MTrk');
-}
-
-CStandardMidiFile::SMFTrackWriter::~SMFTrackWriter()
-{
-	m_writer.Pop();
-}
-
-void CStandardMidiFile::SMFTrackWriter::WriteTempo(double tempo_bpm, uint32 deltaTime)
-{
-	uint32 usecPerQtr = uint32((60.0 * 1000000.0) / tempo_bpm);
-	WriteVariableLengthNumber(deltaTime);
-	m_writer << uint8(0xFF) << uint8(0x51) << uint8(0x03)
-	         << uint8((usecPerQtr >> 16) & 0xFF)
-	         << uint8((usecPerQtr >>  8) & 0xFF)
-	         << uint8( usecPerQtr        & 0xFF);
-}
-
-void CStandardMidiFile::SMFTrackWriter::WriteTrackName(const char* name, uint32 deltaTime)
-{
-	uint32 length = strlen(name);
-
-	WriteVariableLengthNumber(deltaTime);
-	m_writer << uint8(0xFF) << uint8(0x03);
-	WriteVariableLengthNumber(length);
-	m_writer.MustWrite(const_cast<char*>(name), length);
-}
-
-void CStandardMidiFile::SMFTrackWriter::WriteEvent(CEvent& event)
-{
-	// check for any pending note-offs whose times have arrived
-	WritePendingNoteOffs(event.Start());
-
-	uint32 deltaTime = CalculateDeltaTime(event.Start());
-
-	switch (event.Command())
-	{
-		case EvtType_Note:
-			WriteNoteOn(event, deltaTime);
-			break;
-
-		case EvtType_NoteOff:
-			WriteNoteOff(event, deltaTime);
-			break;
-
-		case EvtType_ChannelATouch:
-			WriteChannelPressure(event, deltaTime);
-			break;
-
-		case EvtType_PolyATouch:
-			WritePolyPressure(event, deltaTime);
-			break;
-
-		case EvtType_Controller:
-			WriteControlChange(event, deltaTime);
-			break;
-
-		case EvtType_ProgramChange:
-			WriteProgramChange(event, deltaTime);
-			break;
-
-		case EvtType_PitchBend:
-			WritePitchBend(event, deltaTime);
-			break;
-
-		case EvtType_SysEx:
-			WriteSystemExclusive(event, deltaTime);
-			break;
-
-		case EvtType_Text:
-			WriteTextMetaEvent(event, deltaTime);
-			break;
-
-		case EvtType_Tempo:
-			WriteTempoMetaEvent(event, deltaTime);
-			break;
-
-		case EvtType_TimeSig:
-			WriteTimeSigMetaEvent(event, deltaTime);
-			break;
-
-		case EvtType_End:
-			WriteEndOfTrack(event.Start());
-			break;
-	}
-}
-
-uint32 CStandardMidiFile::SMFTrackWriter::CalculateDeltaTime(int32 startTime)
-{
-	ASSERT(startTime >= m_lastEventTicks);
-
-	int32 delta = startTime - m_lastEventTicks;
-	m_lastEventTicks = startTime;
-	return uint32(delta);
-}
-
-uint8 CStandardMidiFile::SMFTrackWriter::GetMidiChannel(const CEvent& event)
-{
-	int channel = m_doc->GetChannelForDestination(event.GetVChannel());
-
-	ASSERT(1 <= channel && channel <= 16);
-	return uint8(channel);
-}
-
-void CStandardMidiFile::SMFTrackWriter::WriteNoteOn(const CEvent& event, uint32 deltaTime)
-{
-	WriteVariableLengthNumber(deltaTime);
-	m_writer << uint8(0x90 + GetMidiChannel(event))
-	         << uint8(event.GetAttribute(EvAttr_Pitch))
-	         << uint8(event.GetAttribute(EvAttr_AttackVelocity));
-	{
-		// add NoteOff event to list
-		CEvent noteOff;
-		noteOff.SetCommand(EvtType_NoteOff);
-		noteOff.SetStart(event.Start() + event.Duration());
-		noteOff.SetVChannel(event.GetVChannel());
-		noteOff.SetAttribute(EvAttr_Pitch, event.GetAttribute(EvAttr_Pitch));
-		noteOff.SetAttribute(EvAttr_ReleaseVelocity,
-		                     event.GetAttribute(EvAttr_ReleaseVelocity));
-		m_pendingNoteOffs.push(noteOff);
-	}
-}
-
-void CStandardMidiFile::SMFTrackWriter::WriteNoteOff(const CEvent& event, uint32 deltaTime)
-{
-	WriteVariableLengthNumber(deltaTime);
-	m_writer << uint8(0x80 + GetMidiChannel(event))
-	         << uint8(event.GetAttribute(EvAttr_Pitch))
-	         << uint8(event.GetAttribute(EvAttr_ReleaseVelocity));
-}
-
-void CStandardMidiFile::SMFTrackWriter::WritePolyPressure(const CEvent& event, uint32 deltaTime)
-{
-	WriteVariableLengthNumber(deltaTime);
-	m_writer << uint8(0xA0 + GetMidiChannel(event))
-	         << uint8(event.GetAttribute(EvAttr_Pitch))
-	         << uint8(event.GetAttribute(EvAttr_AfterTouch));
-}
-
-void CStandardMidiFile::SMFTrackWriter::WriteChannelPressure(const CEvent& event, uint32 deltaTime)
-{
-	WriteVariableLengthNumber(deltaTime);
-	m_writer << uint8(0xD0 + GetMidiChannel(event))
-	         << uint8(event.GetAttribute(EvAttr_AfterTouch));
-}
-
-void CStandardMidiFile::SMFTrackWriter::WriteControlChange(const CEvent& event, uint32 deltaTime)
-{
-	uint8 controllerNumber = event.GetAttribute(EvAttr_ControllerNumber);
-	WriteVariableLengthNumber(deltaTime);
-	m_writer << uint8(0xB0 + GetMidiChannel(event)) << controllerNumber;
-	if (controllerNumber <= 31)
-	{
-		uint16 val = uint16(event.GetAttribute(EvAttr_ControllerValue16));
-		m_writer << uint8(val >> 8);
-		if (val & 0x00FF)
-		{
-			WriteVariableLengthNumber(deltaTime);
-			m_writer << uint8(0xB0 + GetMidiChannel(event))
-			         << uint8(controllerNumber + 32)
-			         << uint8(val & 0x00FF);
-		}
-	}
-	else
-	{
-		m_writer << uint8(event.GetAttribute(EvAttr_ControllerValue8));
-	}
-}
-
-void CStandardMidiFile::SMFTrackWriter::WriteProgramChange(const CEvent& event, uint32 deltaTime)
-{
-	WriteVariableLengthNumber(deltaTime);
-	m_writer << uint8(0xC0 + GetMidiChannel(event))
-	         << uint8(event.GetAttribute(EvAttr_Program));
-}
-
-void CStandardMidiFile::SMFTrackWriter::WritePitchBend(const CEvent& event, uint32 deltaTime)
-{
-	WriteVariableLengthNumber(deltaTime);
-	m_writer << uint8(0xE0 + GetMidiChannel(event))
-	         << uint8((event.GetAttribute(EvAttr_BendValue) >> 8) & 0x7F)
-	         << uint8(event.GetAttribute(EvAttr_BendValue) & 0x7F);
-}
-
-void CStandardMidiFile::SMFTrackWriter::WriteSystemExclusive(const CEvent& event, uint32 deltaTime)
-{
-	WriteVariableLengthNumber(deltaTime);
-	m_writer << uint8(0xF0);
-	m_writer.MustWrite(reinterpret_cast<uint32*>(event.ExtendedData()),
-	                   event.ExtendedDataSize());
-	m_writer << uint8(0xF7);
-}
-
-void CStandardMidiFile::SMFTrackWriter::WriteTextMetaEvent(const CEvent& event, uint32 deltaTime)
-{
-	int32 count = event.ExtendedDataSize() - 1;
-	uint32* p = reinterpret_cast<uint32*>(event.ExtendedData());
-	WriteVariableLengthNumber(deltaTime);
-	m_writer << uint8(0xFF)
-	         << uint8(event.text.textType);
-	WriteVariableLengthNumber(count);
-	m_writer.MustWrite(p, count);
-}
-
-void CStandardMidiFile::SMFTrackWriter::WriteTempoMetaEvent(const CEvent& event, uint32 deltaTime)
-{
-	WriteVariableLengthNumber(deltaTime);
-	m_writer << uint8(0xFF) << uint8(0x51) << uint8(0x03);
-	uint32 usecPerQtr = uint32(60000000000.0 / double(event.GetAttribute(EvAttr_TempoValue)) + 0.5);
-	m_writer << uint8((usecPerQtr >> 16) & 0xFF)
-	         << uint8((usecPerQtr >>  8) & 0xFF)
-	         << uint8( usecPerQtr        & 0xFF);
-}
-
-void CStandardMidiFile::SMFTrackWriter::WriteTimeSigMetaEvent(const CEvent& event, uint32 deltaTime)
-{
-	WriteVariableLengthNumber(deltaTime);
-	int32 log2Size = int32(log(event.GetAttribute(EvAttr_TSigBeatSize)) / log(2));
-	m_writer << uint8(0xFF) << uint8(0x58) << uint8(0x04)
-	         << uint8(event.GetAttribute(EvAttr_TSigBeatCount))
-	         << uint8(log2Size)
-	         << uint8(24)
-	         << uint8(8);
-}
-
-void CStandardMidiFile::SMFTrackWriter::WriteEndOfTrack(uint32 time)
-{
-	// write any remaining note-offs (shifted forward to current time)
-	WritePendingNoteOffs(time);
-
-	WriteVariableLengthNumber(CalculateDeltaTime(time));
-	m_writer << uint8(0xFF) << uint8(0x2F) << uint8(0x00);
-}
-
-void CStandardMidiFile::SMFTrackWriter::WritePendingNoteOffs(int32 time)
-{
-	while (!m_pendingNoteOffs.empty() &&  m_pendingNoteOffs.top().Start() <= time)
-	{
-		const CEvent& noteOff = m_pendingNoteOffs.top();
-		WriteNoteOff(noteOff, CalculateDeltaTime(noteOff.Start()));
-
-		m_pendingNoteOffs.pop();
-	}
-}
-
-void CStandardMidiFile::SMFTrackWriter::WriteVariableLengthNumber(uint32 value )
-{
-	ASSERT(value <= 0x0FFFFFFF); // largest number allowed by SMF spec
-
-	uint32	buffer = value & 0x7f;
-	while ((value >>= 7) > 0)
-	{
-		buffer <<= 8;
-		buffer |= 0x80;
-		buffer += (value & 0x7f);
-	}
-
-	while (true)
-	{
-		m_writer << uint8(buffer & 0xFF);
-		if (buffer & 0x80)
-			buffer >>= 8;
-		else
-			break;
-	}
-}
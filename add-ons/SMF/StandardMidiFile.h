@@ -38,8 +38,15 @@
 #define __C_StandardMidiFile_H__
  
 #include "MeVPlugin.h"
+#include "SMFTrackReader.h"
+#include "SMFTrackWriter.h"
 
-#include <queue>
+// Support Kit
+#include <String.h>
+// Standard Template Library
+#include <vector>
+
+using std::vector;
 
 class CIFFWriter;
 
@@ -47,41 +54,6 @@ class CStandardMidiFile :
 	public MeVPlugIn
 {
 
-private:						// Types
-
-	struct smf_time_base
-	{
-		enum
-		{
-			METERED = 0,
-			TIME_CODE = 0x8000
-		};
-		
-		enum
-		{
-			SMPTE_30 = -30,
-			SMPTE_30_DROP = -29,
-			SMPTE_25 = -25,
-			SMPTE_24 = -24
-		};
-
-		int format;
-
-		union
-		{
-			struct
-			{
-				int16 ticksPerQuarterNote;
-			} metered;
-			
-			struct
-			{
-				int16 smpteFormat;
-				int16 ticksPerFrame;
-			} timeCode;
-		} base;
-	};
-
 public:							// Constructor/Destructor
 
 								CStandardMidiFile();
@@ -112,20 +84,46 @@ public:							// MeVPlugIn Implementation
 									const char *msg,
 									...);
 
+private:						// Types
+
+	// a track chunk of the file, and the events decoded from it
+	struct smf_track
+	{
+		vector<uint8>			data;
+		vector<CEvent>			events;
+		BString					error;
+		bool					corrupt;
+	};
+
+	// the tracks being imported
+	struct smf_import
+	{
+		const int *				destinationIDs;
+		smf_time_base			timeBase;
+		smf_track *				tracks;
+	};
+
 private:						// Operations
 
 	// functions for import	
 	void						CreateDestinations(
 									MeVDocHandle doc,
 									const char* filename);
-	bool						ReadTrack(
+	bool						AddTrack(
 									MeVDocHandle doc,
-									uint8 *trackBuffer,
-									long length,
-					                const smf_time_base& timeBase);
+									smf_track& track,
+									const smf_time_base& timeBase);
 
-	void						SetInitialTempo(
-									MeVDocHandle doc);
+	// decodes one of the tracks of an smf_import; called on a worker
+	static void					DecodeTrack(
+									int32 index,
+									void *data);
+
+	// moves the tempo and time signature changes out of the decoded
+	// tracks and onto the master track, in a single merge
+	void						AddMasterEvents(
+									MeVDocHandle doc,
+									vector<smf_track>& tracks);
 
 	// functions for export
 	status_t					CountTracks(
@@ -138,115 +136,23 @@ private:						// Operations
 									uint16 numTracks,
 									TClockType clockType);
 
-	status_t					WriteTrack(
+	// writes the tempo and time signature changes of the master track,
+	// or just the initial tempo if there are none
+	void						WriteTempoTrack(
 									CIFFWriter& writer,
 									MeVDocHandle doc,
-									MeVTrackHandle track);
+									TClockType clockType,
+									const uint8* channels);
+
+	// encodes the whole track in memory, and writes it at once
+	void						WriteTrack(
+									CIFFWriter& writer,
+									MeVTrackHandle track,
+									const uint8* channels);
 
 private:						// Instance Data
 
 	int							m_destinationID[16];
-
-private:
-
-	// reads events from file track and converts to MeV events
-	class SMFTrackReader
-	{
-	public:
-		SMFTrackReader(CStandardMidiFile& smfPlugIn, const uint8* data, int32 length,
-		               int* destinationIDs, const smf_time_base& tBase);
-		
-		// returns the next event in the track.  Event
-		// vChannel is the MIDI channel number (0-15).
-		bool	GetNextEvent(CEvent& outEvent);
-
-	private:
-				uint8	GetByte();
-				uint8	PeekByte() const;
-				void	GetBytes(uint8* buffer, int32 numBytes);
-				void	SkipBytes(int32 numBytes);
-				uint32	GetVariableLengthNumber();
-				
-				int64	GetTime();
-				uint8	GetStatusByte();
-		
-				bool	ReadNoteOn(			uint8 statusByte, CEvent& outEvent);
-				bool	ReadNoteOff(		uint8 statusByte, CEvent& outEvent);
-				bool	ReadPolyPressure(	uint8 statusByte, CEvent& outEvent);
-				bool	ReadChannelPressure(uint8 statusByte, CEvent& outEvent);
-				bool	ReadControlChange(	uint8 statusByte, CEvent& outEvent);
-				bool	ReadProgramChange(	uint8 statusByte, CEvent& outEvent);
-				bool	ReadPitchBend(		uint8 statusByte, CEvent& outEvent);
-				bool	ReadSystemExclusive(uint8 statusByte, CEvent& outEvent);
-				bool	ReadMetaEvent(		uint8 statusByte, CEvent& outEvent);
-		
-		inline	uint32	Position() const;	// offset within track data
-		
-		CStandardMidiFile&	m_plugin;
-		int*				m_destinationID;
-		const uint8*		m_pData;
-		const uint8*		m_pEnd;
-		int32				m_trackLength;
-		smf_time_base		m_timeBase;
-		int64				m_fileTime_ticks;
-		uint8				m_runningStatus;
-	};
-	
-	// writes MeV events to file track
-	class SMFTrackWriter
-	{
-	public:
-		SMFTrackWriter(CIFFWriter& writer, MeVDocHandle doc);
-		
-		~SMFTrackWriter();
-		
-				void	WriteEvent(CEvent& event);
-				void	WriteTempo(double tempo_bpm, uint32 deltaTime = 0);
-				void	WriteTrackName(const char* text, uint32 deltaTime = 0);
-
-				void	WriteEndOfTrack(uint32 time);
-
-	private:
-		class CmpEventTime
-		{
-		public:
-			bool operator()(const CEvent& ev1, const CEvent& ev2)
-				{ return ev1.Start() > ev2.Start(); }
-		};
-
-				void	WriteNoteOn(			const CEvent& event, uint32 deltaTime);
-				void	WriteNoteOff(			const CEvent& event, uint32 deltaTime);
-				void	WritePolyPressure(		const CEvent& event, uint32 deltaTime);
-				void	WriteChannelPressure(	const CEvent& event, uint32 deltaTime);
-				void	WriteControlChange(		const CEvent& event, uint32 deltaTime);
-				void	WriteProgramChange(		const CEvent& event, uint32 deltaTime);
-				void	WritePitchBend(			const CEvent& event, uint32 deltaTime);
-				void	WriteSystemExclusive(	const CEvent& event, uint32 deltaTime);
-				void	WriteTextMetaEvent(		const CEvent& event, uint32 deltaTime);
-				void	WriteTempoMetaEvent(	const CEvent& event, uint32 deltaTime);
-				void	WriteTimeSigMetaEvent(	const CEvent& event, uint32 deltaTime);
-				
-				void	WritePendingNoteOffs(	int32 atOrBeforeTime = 0x7FFFFFFF);
-				
-				void	WriteVariableLengthNumber(uint32 value);
-				
-				/**	Converts event start time to delta time from last event. */
-				uint32	CalculateDeltaTime(int32 startTime);
-				
-				/**	Returns the MIDI channel of an event. */
-				uint8	GetMidiChannel(const CEvent& event);
-
-		priority_queue<CEvent,vector<CEvent>,CmpEventTime>	m_pendingNoteOffs;
-		CIFFWriter&											m_writer;
-		MeVDocHandle										m_doc;
-		int32												m_lastEventTicks;
-	};
 };
 
-inline uint32 CStandardMidiFile::SMFTrackReader::Position() const
-{
-	return m_pData - (m_pEnd - m_trackLength);
-}
-
 #endif /* __C_StandardMidiFile_H__ */
- 
@@ -0,0 +1,1152 @@
+/* ===================================================================== *
+ * Benchmark.cpp (MeV/Headless)
+ * ===================================================================== */
+
+// Times the engine core on synthetic songs of increasing size:
+//
+//	insert		merging single events at random times into the song
+//	merge		merging the whole, sorted song into an empty list
+//	range		iterating the events within random one-bar windows
+//	seek		seeking a marker to random times
+//	select		toggling the selection of random events, and summarizing
+//				the selection after each one
+//	serialize	writing the song to memory and reading it back
+//	load		reading the song back from a mapped IFF file
+//	tracks		reading the song split into 16 tracks, one after the other
+//				("tracks 1") and on one thread per CPU ("tracks n")
+//	locate		what the player does when locating: converting the target
+//				time through the tempo map, seeking to it, and stacking
+//				the notes which are still sounding
+//	smf			decoding the song from a Standard MIDI File track, pairing
+//				note-offs with note-ons, all in one track ("smf 1") and
+//				split into 16 tracks decoded on one thread per CPU
+//				("smf n"), the way the importer does it
+//	export		encoding the song as a Standard MIDI File track, streaming
+//				the blocks of the list through the exporter's track writer,
+//				and checking that time signatures come back unchanged
+//	chase		collecting the channel state of 16 destinations up to
+//				a random time, and making the bursts which restore it
+//	tasks		starting and finishing one playback task per event, with
+//				up to 64 of them playing at once, from a task pool the
+//				size of the player's
+//	undo		changing the velocity of random notes as one undoable
+//				edit, then undoing, redoing and undoing it again, and
+//				undoing such an edit from the spill file ("undo file")
+//	publish		publishing a snapshot of the song for the first time, and
+//				again after editing random notes ("publish 1"), while
+//				another thread keeps reading the latest snapshot
+//	lock		read-locking and unlocking a track nobody else uses
+//				("lock 1"), and read-locking it with the timeout the
+//				player uses, on one thread per CPU, while another thread
+//				keeps editing it ("lock n")
+//
+// Usage: mevbench [max events]  (default is 10000000)
+
+#include "EventList.h"
+#include "EventSnapshot.h"
+#include "EventStack.h"
+#include "FixedPool.h"
+#include "Lockable.h"
+#include "IFFReader.h"
+#include "IFFWriter.h"
+#include "MappedFileReader.h"
+#include "MidiChaseState.h"
+#include "Observable.h"
+#include "Reader.h"
+#include "SMFTrackReader.h"
+#include "SMFTrackWriter.h"
+#include "TempoMap.h"
+#include "TimeUnits.h"
+#include "Undo.h"
+#include "WorkerPool.h"
+#include "Writer.h"
+
+// Kernel Kit
+#include <OS.h>
+
+// Gnu C Library
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+// Standard Template Library
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Constants
+
+// Number of operations for the benchmarks which are timed per operation
+const int32			INSERT_COUNT = 10000;
+const int32			RANGE_COUNT = 10000;
+const int32			SEEK_COUNT = 100000;
+const int32			SELECT_COUNT = 10000;
+const int32			LOCATE_COUNT = 10000;
+const int32			CHASE_COUNT = 20;
+const int32			UNDO_COUNT = 10000;
+const int32			LOCK_COUNT = 100000;
+const int32			PUBLISH_COUNT = 20;
+
+// How often the editor in the lock benchmark write-locks, how long it
+// holds the lock, and how long it waits before the next edit. The
+// readers hold their lock a little while, too.
+const int32			EDIT_COUNT = 200;
+const bigtime_t		EDIT_DURATION = 50;
+const bigtime_t		EDIT_INTERVAL = 200;
+const bigtime_t		READ_DURATION = 10;
+
+// Size of a playback task, and how many play at once in the task benchmark
+const size_t		TASK_SIZE = 256;
+const int32			CONCURRENT_TASKS = 64;
+
+// The synthetic songs are in 4/4
+const int32			TICKS_PER_BAR = Ticks_Per_QtrNote * 4;
+
+// Longest note in the synthetic songs (used to chase notes when locating)
+const int32			MAX_NOTE_LENGTH = TICKS_PER_BAR;
+
+// A tempo change every so many bars
+const int32			BARS_PER_TEMPO_CHANGE = 64;
+
+// ---------------------------------------------------------------------------
+// Utilities
+
+// A small deterministic random number generator, so that every run
+// benchmarks the same songs.
+class CRandom
+{
+
+public:
+
+								CRandom(
+									uint32 seed = 1)
+									:	m_state(seed)
+								{ }
+
+	uint32						Next()
+								{
+									m_state = m_state * 1664525 + 1013904223;
+									return m_state >> 8;
+								}
+
+	int32						Range(
+									int32 low,
+									int32 high)
+								{ return low + Next() % (high - low + 1); }
+
+private:
+
+	uint32						m_state;
+};
+
+// Prints one line of results.
+static void
+Report(
+	long size,
+	const char *what,
+	long operations,
+	bigtime_t duration)
+{
+	printf("%10ld  %-10s %10ld ops %10.1f ms %12.1f ns/op\n",
+		   size, what, operations, duration / 1000.0,
+		   operations > 0 ? duration * 1000.0 / operations : 0.0);
+}
+
+// Creates a sorted song of the given number of events: notes of random
+// length on 16 channels, with a controller change every eighth event.
+static CEvent *
+MakeSong(
+	long count,
+	CRandom &random)
+{
+	CEvent *song = new CEvent[count];
+	int32 time = 0;
+
+	for (long i = 0; i < count; i++)
+	{
+		CEvent &ev = song[i];
+
+		time += random.Range(0, Ticks_Per_QtrNote / 4);
+		if ((i % 8) == 7)
+		{
+			ev.SetCommand(EvtType_Controller);
+			ev.SetStart(time);
+			ev.SetVChannel(random.Range(0, 15));
+			ev.SetAttribute(EvAttr_ControllerNumber, random.Range(0, 127));
+			ev.SetAttribute(EvAttr_ControllerValue8, random.Range(0, 127));
+		}
+		else
+		{
+			ev.SetCommand(EvtType_Note);
+			ev.SetStart(time);
+			ev.SetDuration(random.Range(1, MAX_NOTE_LENGTH));
+			ev.SetVChannel(random.Range(0, 15));
+			ev.SetAttribute(EvAttr_Pitch, random.Range(24, 108));
+			ev.SetAttribute(EvAttr_AttackVelocity, random.Range(1, 127));
+			ev.SetAttribute(EvAttr_ReleaseVelocity, 64);
+		}
+	}
+
+	return song;
+}
+
+// Compiles a tempo map with a tempo change every few bars, the way
+// CEventTrack does it for the master track.
+static void
+MakeTempoMap(
+	CTempoMap &map,
+	long songLength)
+{
+	int32 changes = songLength / (TICKS_PER_BAR * BARS_PER_TEMPO_CHANGE);
+
+	map.count = changes + 1;
+	map.list = new CTempoMapEntry[map.count];
+	map.list[0].SetInitialTempo(RateToPeriod(120.0));
+	for (int32 i = 1; i < map.count; i++)
+	{
+		double rate = 90.0 + (i % 7) * 10.0;
+		map.list[i].SetTempo(map.list[i - 1], RateToPeriod(rate),
+							 i * TICKS_PER_BAR * BARS_PER_TEMPO_CHANGE, 0,
+							 ClockType_Metered);
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Benchmarks
+
+static void
+BenchmarkInsert(
+	long size,
+	EventList &list,
+	long songLength,
+	CRandom &random)
+{
+	CEvent ev;
+	ev.SetCommand(EvtType_Note);
+	ev.SetDuration(Ticks_Per_QtrNote);
+	ev.SetAttribute(EvAttr_Pitch, 60);
+	ev.SetAttribute(EvAttr_AttackVelocity, 100);
+
+	bigtime_t start = system_time();
+	for (int32 i = 0; i < INSERT_COUNT; i++)
+	{
+		ev.SetStart(random.Range(0, songLength));
+		list.Merge(&ev, 1, NULL);
+	}
+	Report(size, "insert", INSERT_COUNT, system_time() - start);
+}
+
+static void
+BenchmarkRange(
+	long size,
+	EventList &list,
+	long songLength,
+	CRandom &random)
+{
+	long found = 0;
+
+	bigtime_t start = system_time();
+	for (int32 i = 0; i < RANGE_COUNT; i++)
+	{
+		EventMarker marker(list);
+		long minTime = random.Range(0, songLength);
+		long maxTime = minTime + TICKS_PER_BAR;
+
+		for (const CEvent *ev = marker.FirstItemInRange(minTime, maxTime);
+			 ev != NULL;
+			 ev = marker.NextItemInRange(minTime, maxTime))
+			found++;
+	}
+	Report(size, "range", RANGE_COUNT, system_time() - start);
+
+	if (found == 0)
+		printf("\t!! range queries found no events\n");
+}
+
+static void
+BenchmarkSeek(
+	long size,
+	EventList &list,
+	long songLength,
+	CRandom &random)
+{
+	EventMarker marker(list);
+	long misses = 0;
+
+	bigtime_t start = system_time();
+	for (int32 i = 0; i < SEEK_COUNT; i++)
+	{
+		long time = random.Range(0, songLength);
+		const CEvent *ev = marker.SeekToTime(time);
+		if ((ev != NULL) && (ev->Start() < time))
+			misses++;
+	}
+	Report(size, "seek", SEEK_COUNT, system_time() - start);
+
+	if (misses > 0)
+		printf("\t!! %ld seeks ended before the target time\n", misses);
+}
+
+static void
+BenchmarkSelect(
+	long size,
+	EventList &list,
+	long songLength,
+	CRandom &random)
+{
+	EventMarker marker(list);
+	EventList::Summary summary;
+
+	bigtime_t start = system_time();
+	for (int32 i = 0; i < SELECT_COUNT; i++)
+	{
+		const CEvent *ev = marker.SeekToTime(random.Range(0, songLength));
+		if (ev != NULL)
+			marker.SetSelected(!ev->IsSelected());
+		list.GetSummary(summary);
+	}
+	Report(size, "select", SELECT_COUNT, system_time() - start);
+
+	// Check the summary against a rescan, and deselect everything again
+	long count = 0, minTime = LONG_MAX, maxTime = LONG_MIN;
+	for (const CEvent *ev = marker.First(); ev != NULL; ev = marker.Seek(1))
+	{
+		if (!ev->IsSelected())
+			continue;
+		minTime = MIN(minTime, ev->Start());
+		maxTime = MAX(maxTime, ev->Stop());
+		count++;
+		marker.SetSelected(false);
+	}
+
+	if ((count != summary.selectCount)
+	 || (minTime != summary.minSelectTime)
+	 || (maxTime != summary.maxSelectTime))
+		printf("\t!! selection summary does not match the events\n");
+	list.GetSummary(summary);
+	if (summary.selectCount != 0)
+		printf("\t!! selection summary was not cleared\n");
+}
+
+static void
+BenchmarkSerialize(
+	long size,
+	EventList &list)
+{
+	bigtime_t start = system_time();
+	CDynamicByteArrayWriter writer;
+	WriteEventList(writer, list);
+	bigtime_t written = system_time();
+	Report(size, "write", list.TotalItems(), written - start);
+
+	EventList copy;
+	CByteArrayReader reader(writer.Buffer(), writer.Position());
+	ReadEventList(reader, copy);
+	Report(size, "read", copy.TotalItems(), system_time() - written);
+
+	if (copy.TotalItems() != list.TotalItems())
+		printf("\t!! read back %ld of %ld events\n",
+			   copy.TotalItems(), list.TotalItems());
+
+	EventMarker original(list), readBack(copy);
+	const CEvent *a = original.First(), *b = readBack.First();
+	long differences = 0;
+	for (; (a != NULL) && (b != NULL); a = original.Seek(1), b = readBack.Seek(1))
+	{
+		if ((a->Start() != b->Start()) || (a->Command() != b->Command())
+		 || (a->Stop() != b->Stop()))
+			differences++;
+	}
+	if (differences > 0)
+		printf("\t!! %ld events differ after reading back\n", differences);
+}
+
+static void
+BenchmarkLoad(
+	long size,
+	EventList &list)
+{
+	// Write the song as a track body in an IFF file, the way documents
+	// store it
+	CDynamicByteArrayWriter buffer;
+	{
+		CIFFWriter writer(buffer);
+		writer.Push('FORM');
+		writer << (int32)'MeV ';
+		writer.Push('BODY');
+		WriteEventList(writer, list);
+		writer.Pop();
+		writer.Pop();
+	}
+
+	char path[] = "/tmp/mevbenchXXXXXX";
+	int fd = mkstemp(path);
+	if ((fd < 0) || (write(fd, buffer.Buffer(), buffer.Position())
+					 != (ssize_t)buffer.Position()))
+	{
+		printf("\t!! couldn't write %s\n", path);
+		return;
+	}
+	close(fd);
+
+	bigtime_t start = system_time();
+	EventList copy;
+	{
+		CMappedFileReader file(path);
+		CIFFReader reader(file);
+		if (reader.NextChunk() && (reader.ChunkID() == 'BODY'))
+			ReadEventList(reader, copy);
+	}
+	Report(size, "load", copy.TotalItems(), system_time() - start);
+	unlink(path);
+
+	if (copy.TotalItems() != list.TotalItems())
+		printf("\t!! loaded %ld of %ld events\n",
+			   copy.TotalItems(), list.TotalItems());
+}
+
+static void
+BenchmarkLocate(
+	long size,
+	EventList &list,
+	const CTempoMap &tempoMap,
+	long songLength,
+	CRandom &random)
+{
+	CEventStack stack;
+	long realLength = tempoMap.ConvertMeteredToReal(songLength);
+	long chased = 0;
+
+	bigtime_t start = system_time();
+	for (int32 i = 0; i < LOCATE_COUNT; i++)
+	{
+		long time = tempoMap.ConvertRealToMetered(random.Range(0, realLength));
+
+		// Stack every note that is still sounding at the target time
+		EventMarker marker(list);
+		for (const CEvent *ev = marker.FirstItemInRange(time - MAX_NOTE_LENGTH,
+														time);
+			 ev != NULL;
+			 ev = marker.NextItemInRange(time - MAX_NOTE_LENGTH, time))
+		{
+			if ((ev->Command() == EvtType_Note) && (ev->Stop() > time))
+			{
+				CEvent noteOff(*ev);
+				noteOff.SetCommand(EvtType_NoteOff);
+				noteOff.SetStart(ev->Stop());
+				stack.Push(noteOff);
+			}
+		}
+
+		// And position a marker there to continue playing from
+		marker.SeekToTime(time);
+
+		CEvent ev;
+		while (stack.Pop(ev))
+			chased++;
+	}
+	Report(size, "locate", LOCATE_COUNT, system_time() - start);
+
+	if (chased == 0)
+		printf("\t!! locating chased no notes\n");
+}
+
+// Collects the channel state from the start of the song up to random
+// locate times, the way the MIDI destinations do it while the player
+// locates, and makes the bursts which are sent when it's done.
+static void
+BenchmarkChase(
+	long size,
+	EventList &list,
+	long songLength,
+	CRandom &random)
+{
+	Midi::CMidiChaseState state[16];
+	CEvent burst[Midi::CMidiChaseState::MAX_BURST_EVENTS];
+	long chased = 0, sent = 0;
+
+	bigtime_t start = system_time();
+	for (int32 i = 0; i < CHASE_COUNT; i++)
+	{
+		long time = random.Range(0, songLength);
+
+		EventMarker marker(list);
+		for (const CEvent *ev = marker.First();
+			 (ev != NULL) && (ev->Start() < time);
+			 ev = marker.Seek(1))
+		{
+			if (ev->Command() != EvtType_Note)
+				state[ev->GetVChannel() & 15].Chase(*ev);
+			chased++;
+		}
+
+		for (int32 channel = 0; channel < 16; channel++)
+		{
+			sent += state[channel].MakeBurst(burst);
+			state[channel].Clear();
+		}
+	}
+	Report(size, "chase", chased, system_time() - start);
+
+	if ((sent == 0) && (chased > 8))
+		printf("\t!! chasing sent no controllers\n");
+}
+
+// Encodes the song as the data of a Standard MIDI File track the way the
+// exporter does, with a division of Ticks_Per_QtrNote so that the times
+// come back unchanged.
+static void
+MakeTrackData(
+	EventList &list,
+	std::vector<uint8> &outData)
+{
+	uint8 channels[256];
+	for (int32 i = 0; i < 256; i++)
+		channels[i] = i & 0x0f;
+
+	CSMFTrackWriter writer(channels);
+	list.ReadBlocks(CSMFTrackWriter::WriteEvents, &writer);
+	writer.WriteEndOfTrack(0);
+
+	// leave out the chunk header
+	outData.assign(writer.Chunk() + 8, writer.Chunk() + writer.ChunkSize());
+}
+
+static void
+BenchmarkSMF(
+	long size,
+	EventList &list)
+{
+	bigtime_t start = system_time();
+	std::vector<uint8> data;
+	MakeTrackData(list, data);
+	Report(size, "export", list.TotalItems(), system_time() - start);
+
+	int destinations[16];
+	for (int32 i = 0; i < 16; i++)
+		destinations[i] = i;
+	smf_time_base timeBase;
+	timeBase.format = smf_time_base::METERED;
+	timeBase.base.metered.ticksPerQuarterNote = Ticks_Per_QtrNote;
+
+	std::vector<CEvent> events;
+	start = system_time();
+	CSMFTrackReader reader(&data[0], data.size(), destinations, timeBase);
+	bool ok = reader.ReadTrack(events);
+	Report(size, "smf 1", events.size(), system_time() - start);
+
+	// Pairing overlapping notes of the same pitch first-in, first-out can
+	// trade length between them, but the total stays the same.
+	long notes = 0, length = 0, readNotes = 0, readLength = 0;
+	EventMarker marker(list);
+	for (const CEvent *ev = marker.First(); ev != NULL; ev = marker.Seek(1))
+	{
+		if (ev->Command() == EvtType_Note)
+		{
+			notes++;
+			length += ev->Duration();
+		}
+	}
+	for (uint32 i = 0; i < events.size(); i++)
+	{
+		if (events[i].Command() == EvtType_Note)
+		{
+			readNotes++;
+			readLength += events[i].Duration();
+		}
+	}
+
+	if (!ok || (readNotes != notes) || (readLength != length))
+		printf("\t!! read %ld of %ld notes, %ld of %ld ticks\n",
+			   readNotes, notes, readLength, length);
+}
+
+// Exports a tempo change and a few time signatures, and checks that they
+// are imported unchanged.
+static void
+CheckMetaEvents()
+{
+	static const int32 signatures[][2] = { { 4, 2 }, { 6, 3 }, { 3, 2 }, { 5, 4 } };
+	static const int32 signatureCount = sizeof(signatures) / sizeof(signatures[0]);
+
+	EventList list;
+	CEvent ev;
+	ev.SetCommand(EvtType_Tempo);
+	ev.SetStart(0);
+	ev.SetAttribute(EvAttr_TempoValue, 120000);
+	list.Merge(&ev, 1, NULL);
+	for (int32 i = 0; i < signatureCount; i++)
+	{
+		ev.SetCommand(EvtType_TimeSig);
+		ev.SetStart(i * TICKS_PER_BAR);
+		ev.SetDuration(0);
+		ev.SetAttribute(EvAttr_TSigBeatCount, signatures[i][0]);
+		ev.SetAttribute(EvAttr_TSigBeatSize, signatures[i][1]);
+		list.Merge(&ev, 1, NULL);
+	}
+
+	std::vector<uint8> data;
+	MakeTrackData(list, data);
+
+	int destinations[16];
+	for (int32 i = 0; i < 16; i++)
+		destinations[i] = i;
+	smf_time_base timeBase;
+	timeBase.format = smf_time_base::METERED;
+	timeBase.base.metered.ticksPerQuarterNote = Ticks_Per_QtrNote;
+
+	std::vector<CEvent> events;
+	CSMFTrackReader reader(&data[0], data.size(), destinations, timeBase);
+	reader.ReadTrack(events);
+
+	int32 tempos = 0, matches = 0;
+	for (uint32 i = 0; i < events.size(); i++)
+	{
+		const CEvent &read = events[i];
+		if ((read.Command() == EvtType_Tempo)
+		 && (read.GetAttribute(EvAttr_TempoValue) == 120000))
+			tempos++;
+		if (read.Command() != EvtType_TimeSig)
+			continue;
+		int32 bar = read.Start() / TICKS_PER_BAR;
+		if ((bar < signatureCount)
+		 && (read.Start() == bar * TICKS_PER_BAR)
+		 && (read.GetAttribute(EvAttr_TSigBeatCount) == signatures[bar][0])
+		 && (read.GetAttribute(EvAttr_TSigBeatSize) == signatures[bar][1]))
+			matches++;
+	}
+
+	if ((tempos != 1) || (matches != signatureCount))
+		printf("\t!! %ld of %ld time signatures came back unchanged\n",
+			   (long)matches, (long)signatureCount);
+}
+
+struct smf_tracks
+{
+	std::vector<uint8>			*data;
+	std::vector<CEvent>			*events;
+	const int					*destinations;
+	smf_time_base				timeBase;
+};
+
+static void
+DecodeSMFTrack(
+	int32 index,
+	void *data)
+{
+	smf_tracks *job = (smf_tracks *)data;
+	CSMFTrackReader reader(&job->data[index][0], job->data[index].size(),
+						   job->destinations, job->timeBase);
+	reader.ReadTrack(job->events[index]);
+}
+
+static void
+BenchmarkSMFTracks(
+	long size,
+	EventList &list)
+{
+	const int32 trackCount = 16;
+	int destinations[16];
+	for (int32 i = 0; i < 16; i++)
+		destinations[i] = i;
+
+	smf_tracks job;
+	job.data = new std::vector<uint8>[trackCount];
+	job.events = new std::vector<CEvent>[trackCount];
+	job.destinations = destinations;
+	job.timeBase.format = smf_time_base::METERED;
+	job.timeBase.base.metered.ticksPerQuarterNote = Ticks_Per_QtrNote;
+
+	// Deal the events out to the tracks by channel
+	std::vector<CEvent> *split = new std::vector<CEvent>[trackCount];
+	EventMarker marker(list);
+	for (const CEvent *ev = marker.First(); ev != NULL; ev = marker.Seek(1))
+		split[ev->GetVChannel() % trackCount].push_back(*ev);
+	for (int32 i = 0; i < trackCount; i++)
+	{
+		EventList track;
+		if (!split[i].empty())
+			track.Merge(&split[i][0], split[i].size(), NULL);
+		MakeTrackData(track, job.data[i]);
+	}
+	delete [] split;
+
+	bigtime_t start = system_time();
+	CWorkerPool pool("mevbench smf");
+	pool.Run(trackCount, DecodeSMFTrack, &job);
+	bigtime_t duration = system_time() - start;
+
+	long total = 0;
+	for (int32 i = 0; i < trackCount; i++)
+		total += job.events[i].size();
+	Report(size, "smf n", total, duration);
+
+	delete [] job.data;
+	delete [] job.events;
+}
+
+// Decodes the song split into a number of tracks, once one track after
+// the other and once concurrently, the way documents are opened.
+struct track_bodies
+{
+	CDynamicByteArrayWriter		*bodies;
+	EventList					*tracks;
+};
+
+static void
+DecodeTrack(
+	int32 index,
+	void *data)
+{
+	track_bodies *job = (track_bodies *)data;
+	CByteArrayReader reader(job->bodies[index].Buffer(),
+							job->bodies[index].Position());
+	ReadEventList(reader, job->tracks[index]);
+	job->tracks[index].SummarizeAll();
+}
+
+static void
+BenchmarkTracks(
+	long size,
+	EventList &list)
+{
+	const int32 trackCount = 16;
+	track_bodies job;
+	job.bodies = new CDynamicByteArrayWriter[trackCount];
+
+	// Deal the events out to the tracks by channel
+	std::vector<CEvent> *split = new std::vector<CEvent>[trackCount];
+	EventMarker marker(list);
+	for (const CEvent *ev = marker.First(); ev != NULL; ev = marker.Seek(1))
+		split[ev->GetVChannel() % trackCount].push_back(*ev);
+	for (int32 i = 0; i < trackCount; i++)
+	{
+		EventList track;
+		if (!split[i].empty())
+			track.Merge(&split[i][0], split[i].size(), NULL);
+		WriteEventList(job.bodies[i], track);
+	}
+	delete [] split;
+
+	const char *names[2] = { "tracks 1", "tracks n" };
+	for (int32 pass = 0; pass < 2; pass++)
+	{
+		job.tracks = new EventList[trackCount];
+
+		bigtime_t start = system_time();
+		CWorkerPool pool("mevbench", pass == 0 ? 1 : 0);
+		pool.Run(trackCount, DecodeTrack, &job);
+		bigtime_t duration = system_time() - start;
+
+		long total = 0;
+		for (int32 i = 0; i < trackCount; i++)
+			total += job.tracks[i].TotalItems();
+		Report(size, names[pass], total, duration);
+		if (total != list.TotalItems())
+			printf("\t!! decoded %ld of %ld events\n", total, list.TotalItems());
+
+		delete [] job.tracks;
+	}
+
+	delete [] job.bodies;
+}
+
+// Starts and finishes playback tasks the way sequence events do during
+// playback, allocating them from a task pool like the one of a playback
+// task group. None of them should have to come from the heap.
+static void
+BenchmarkTasks(
+	long size)
+{
+	CFixedPool pool(TASK_SIZE, 250);
+	void *tasks[CONCURRENT_TASKS];
+	for (int32 i = 0; i < CONCURRENT_TASKS; i++)
+		tasks[i] = NULL;
+
+	bigtime_t start = system_time();
+	for (long i = 0; i < size; i++)
+	{
+		// The oldest task finishes as the next one starts
+		void *&task = tasks[i % CONCURRENT_TASKS];
+		CFixedPool::Free(task);
+		task = pool.Allocate(TASK_SIZE);
+	}
+	for (int32 i = 0; i < CONCURRENT_TASKS; i++)
+		CFixedPool::Free(tasks[i]);
+	Report(size, "tasks", size, system_time() - start);
+
+	if (pool.HeapAllocations() > 0)
+		printf("\t!! %ld tasks were allocated on the heap\n",
+			   (long)pool.HeapAllocations());
+}
+
+// Returns a checksum of the velocities of the notes, which depends on
+// their order.
+static uint32
+VelocityChecksum(
+	EventList &list)
+{
+	EventMarker marker(list);
+	uint32 sum = 0;
+	for (const CEvent *ev = marker.First(); ev != NULL; ev = marker.Seek(1))
+	{
+		if (ev->Command() == EvtType_Note)
+			sum = sum * 31 + ev->GetAttribute(EvAttr_AttackVelocity);
+	}
+	return sum;
+}
+
+// Changes the velocity of random notes, returning the number changed
+static long
+EditVelocities(
+	EventList &list,
+	EventListUndoAction &action,
+	long songLength,
+	CRandom &random)
+{
+	EventMarker marker(list);
+	long edits = 0;
+	for (int32 i = 0; i < UNDO_COUNT; i++)
+	{
+		const CEvent *ev = marker.SeekToTime(random.Range(0, songLength));
+		if ((ev == NULL) || (ev->Command() != EvtType_Note))
+			continue;
+		CEvent copy(*ev);
+		copy.SetAttribute(EvAttr_AttackVelocity,
+						  ev->GetAttribute(EvAttr_AttackVelocity) % 127 + 1);
+		marker.Modify(copy, &action);
+		edits++;
+	}
+	return edits;
+}
+
+// Publishes snapshots of the song, while a reader keeps checking that
+// every snapshot it gets has the velocities the song had when it was
+// published.
+struct publish_job
+{
+	EventList					*list;
+	uint32						versions[PUBLISH_COUNT];
+	uint32						checksums[PUBLISH_COUNT];
+	volatile int32				published;
+	volatile int32				reading;
+	int32						reads;
+	int32						wrong;
+};
+
+static uint32
+SnapshotChecksum(
+	CEventSnapshotMarker &marker)
+{
+	uint32 sum = 0;
+	for (const CEvent *ev = marker.First(); ev != NULL; ev = marker.Seek(1))
+	{
+		if (ev->Command() == EvtType_Note)
+			sum = sum * 31 + ev->GetAttribute(EvAttr_AttackVelocity);
+	}
+	return sum;
+}
+
+static int32
+SnapshotReader(
+	void *data)
+{
+	publish_job *job = (publish_job *)data;
+	CEventSnapshotMarker marker;
+	while (atomic_get(&job->reading))
+	{
+		marker.Update(*job->list);
+		uint32 version = marker.Snapshot()->Version();
+		uint32 sum = SnapshotChecksum(marker);
+		int32 published = atomic_get(&job->published);
+		for (int32 i = 0; i < published; i++)
+		{
+			if ((job->versions[i] == version) && (job->checksums[i] != sum))
+				job->wrong++;
+		}
+		job->reads++;
+	}
+	return 0;
+}
+
+static void
+BenchmarkPublish(
+	long size,
+	EventList &list,
+	long songLength,
+	CRandom &random)
+{
+	bigtime_t start = system_time();
+	list.Publish();
+	Report(size, "publish", list.TotalItems(), system_time() - start);
+
+	publish_job job;
+	job.list = &list;
+	job.published = 0;
+	job.reading = 1;
+	job.reads = job.wrong = 0;
+	thread_id reader = spawn_thread(SnapshotReader, "mevbench reader",
+									B_NORMAL_PRIORITY, &job);
+	resume_thread(reader);
+
+	CObservable subject;
+	long edits = 0;
+	bigtime_t duration = 0;
+	for (int32 i = 0; i < PUBLISH_COUNT; i++)
+	{
+		EventListUndoAction action(list, subject, "Velocity");
+		edits += EditVelocities(list, action, songLength, random);
+		job.versions[i] = list.EditCount();
+		job.checksums[i] = VelocityChecksum(list);
+		atomic_add(&job.published, 1);
+
+		start = system_time();
+		list.Publish();
+		duration += system_time() - start;
+		snooze(1000);
+	}
+	atomic_add(&job.reading, -1);
+	status_t result;
+	wait_for_thread(reader, &result);
+	Report(size, "publish 1", edits, duration);
+
+	if ((job.reads == 0) || (job.wrong > 0))
+		printf("\t!! %ld of %ld snapshots read had other events than "
+			   "published\n", (long)job.wrong, (long)job.reads);
+}
+
+static void
+BenchmarkUndo(
+	long size,
+	EventList &list,
+	long songLength,
+	CRandom &random)
+{
+	uint32 original = VelocityChecksum(list);
+
+	CObservable subject;
+	UndoHistory history(INT32_MAX);
+	EventListUndoAction *action = new EventListUndoAction(list, subject,
+														  "Velocity");
+	long edits = EditVelocities(list, *action, songLength, random);
+	history.Add(action);
+	uint32 edited = VelocityChecksum(list);
+
+	bigtime_t start = system_time();
+	history.Undo();
+	bigtime_t duration = system_time() - start;
+	uint32 undone = VelocityChecksum(list);
+
+	start = system_time();
+	history.Redo();
+	duration += system_time() - start;
+	uint32 redone = VelocityChecksum(list);
+
+	start = system_time();
+	history.Undo();
+	duration += system_time() - start;
+	Report(size, "undo", 3 * edits, duration);
+
+	if ((undone != original) || (redone != edited)
+	 || (VelocityChecksum(list) != original))
+		printf("\t!! undo did not restore the events\n");
+
+	// Once more, with the edit moved to the spill file by a second one,
+	// so that undoing it has to read it back
+	history.SetMaxResidentSize(1);
+	action = new EventListUndoAction(list, subject, "Velocity");
+	edits = EditVelocities(list, *action, songLength, random);
+	history.Add(action);
+	action = new EventListUndoAction(list, subject, "Velocity");
+	EditVelocities(list, *action, songLength, random);
+	history.Add(action);
+	history.Undo();
+
+	start = system_time();
+	history.Undo();
+	Report(size, "undo file", edits, system_time() - start);
+
+	if (VelocityChecksum(list) != original)
+		printf("\t!! undo from the spill file did not restore the events\n");
+
+	// Edits which are undone and then replaced by new ones give their
+	// space in the spill file back, so that it doesn't keep growing
+	UndoHistory again(INT32_MAX);
+	again.SetMaxResidentSize(1);
+	long first = 0;
+	for (int32 round = 0; round < 10; round++)
+	{
+		for (int32 i = 0; i < 3; i++)
+		{
+			action = new EventListUndoAction(list, subject, "Velocity");
+			EditVelocities(list, *action, songLength, random);
+			again.Add(action);
+		}
+		if (round == 0)
+			first = again.SpillFileSize();
+		while (again.CanUndo())
+			again.Undo();
+	}
+	if ((first == 0) || (again.SpillFileSize() > 2 * first))
+		printf("\t!! the spill file grew from %ld to %ld bytes\n",
+			   first, again.SpillFileSize());
+	if (VelocityChecksum(list) != original)
+		printf("\t!! undo from the spill file did not restore the events\n");
+}
+// Read-locks a track the way the player does, while an editor keeps
+// write-locking it. The editor changes two numbers that readers must
+// always see equal.
+struct lock_job
+{
+	CLockable					lock;
+	volatile int32				first;
+	volatile int32				second;
+	volatile int32				editing;
+	volatile int32				reads;
+	volatile int32				torn;
+	volatile int32				timeouts;
+};
+
+static void
+Spin(
+	bigtime_t duration)
+{
+	bigtime_t until = system_time() + duration;
+	while (system_time() < until)
+		;
+}
+
+static int32
+LockReader(
+	void *data)
+{
+	lock_job *job = (lock_job *)data;
+	while (atomic_get(&job->editing))
+	{
+		if (!job->lock.ReadLock(500))
+		{
+			atomic_add(&job->timeouts, 1);
+			continue;
+		}
+		if (job->first != job->second)
+			atomic_add(&job->torn, 1);
+		Spin(READ_DURATION);
+		job->lock.ReadUnlock();
+		atomic_add(&job->reads, 1);
+	}
+	return 0;
+}
+
+static void
+BenchmarkLock(
+	long size)
+{
+	lock_job job;
+	job.first = job.second = 0;
+	job.reads = job.torn = job.timeouts = 0;
+	job.editing = 1;
+	long count = (size < LOCK_COUNT) ? size : LOCK_COUNT;
+
+	bigtime_t start = system_time();
+	for (long i = 0; i < count; i++)
+	{
+		job.lock.ReadLock(500);
+		job.lock.ReadUnlock();
+	}
+	Report(size, "lock 1", count, system_time() - start);
+
+	system_info info;
+	get_system_info(&info);
+	int32 readerCount = (info.cpu_count > 1) ? info.cpu_count : 2;
+
+	start = system_time();
+	std::vector<thread_id> readers;
+	for (int32 i = 0; i < readerCount; i++)
+	{
+		readers.push_back(spawn_thread(LockReader, "mevbench reader",
+									   B_NORMAL_PRIORITY, &job));
+		resume_thread(readers.back());
+	}
+	for (int32 i = 0; i < EDIT_COUNT; i++)
+	{
+		job.lock.WriteLock();
+		job.first++;
+		Spin(EDIT_DURATION);
+		job.second++;
+		job.lock.WriteUnlock();
+		snooze(EDIT_INTERVAL);
+	}
+	atomic_add(&job.editing, -1);
+	for (size_t i = 0; i < readers.size(); i++)
+	{
+		status_t result;
+		wait_for_thread(readers[i], &result);
+	}
+	Report(size, "lock n", job.reads, system_time() - start);
+
+	CLockable::statistics stats;
+	job.lock.GetStatistics(&stats);
+	printf("\t%ld reads waited (max %ld usecs), %ld timed out, "
+		   "%ld edits waited (max %ld usecs)\n",
+		   (long)stats.readWaits, (long)stats.maxReadWait,
+		   (long)stats.readTimeouts, (long)stats.writeWaits,
+		   (long)stats.maxWriteWait);
+	if (job.torn > 0)
+		printf("\t!! %ld reads saw an edit in progress\n", (long)job.torn);
+	if ((job.timeouts != stats.readTimeouts) || (stats.writeLocks != EDIT_COUNT))
+		printf("\t!! the lock statistics are off\n");
+}
+
+// ---------------------------------------------------------------------------
+// Main
+
+int
+main(
+	int argc,
+	char **argv)
+{
+	long maxSize = (argc > 1) ? atol(argv[1]) : 10000000;
+
+	CEvent::InitTables();
+
+	printf("%10s  %-10s %14s %13s %18s\n",
+		   "events", "benchmark", "operations", "total", "per operation");
+
+	for (long size = 1000; size <= maxSize; size *= 10)
+	{
+		CRandom random(size);
+		CEvent *song = MakeSong(size, random);
+		long songLength = song[size - 1].Start();
+
+		CTempoMap tempoMap;
+		MakeTempoMap(tempoMap, songLength);
+
+		EventList list;
+		bigtime_t start = system_time();
+		list.Merge(song, size, NULL);
+		Report(size, "merge", size, system_time() - start);
+		delete [] song;
+
+		BenchmarkRange(size, list, songLength, random);
+		BenchmarkSeek(size, list, songLength, random);
+		BenchmarkSelect(size, list, songLength, random);
+		BenchmarkLocate(size, list, tempoMap, songLength, random);
+		BenchmarkChase(size, list, songLength, random);
+		BenchmarkTasks(size);
+		BenchmarkLock(size);
+		BenchmarkSerialize(size, list);
+		BenchmarkLoad(size, list);
+		BenchmarkTracks(size, list);
+		BenchmarkSMF(size, list);
+		CheckMetaEvents();
+		BenchmarkSMFTracks(size, list);
+		BenchmarkPublish(size, list, songLength, random);
+		BenchmarkUndo(size, list, songLength, random);
+		BenchmarkInsert(size, list, songLength, random);
+
+		delete [] tempoMap.list;
+		printf("\n");
+	}
+
+	return 0;
+}
+
+// END - Benchmark.cpp
@@ -0,0 +1,68 @@
+/* ===================================================================== *
+ * Autolock.h (MeV/Headless)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s):
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ *  Portable stand-in for BAutolock
+ * ===================================================================== */
+
+#ifndef __SHIM_Autolock_H__
+#define __SHIM_Autolock_H__
+
+#include <Locker.h>
+
+/**
+ *	Locks a BLocker for the lifetime of the object.
+ */
+class BAutolock
+{
+
+public:							// Constructor/Destructor
+
+								BAutolock(
+									BLocker *locker)
+									:	m_locker(locker),
+										m_locked(locker->Lock())
+								{ }
+
+								BAutolock(
+									BLocker &locker)
+									:	m_locker(&locker),
+										m_locked(locker.Lock())
+								{ }
+
+								~BAutolock()
+								{ if (m_locked) m_locker->Unlock(); }
+
+public:							// Accessors
+
+	bool						IsLocked() const
+								{ return m_locked; }
+
+private:						// Instance Data
+
+	BLocker *					m_locker;
+
+	bool						m_locked;
+};
+
+#endif /* __SHIM_Autolock_H__ */
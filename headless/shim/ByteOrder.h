@@ -0,0 +1,66 @@
+/* ===================================================================== *
+ * ByteOrder.h (MeV/Headless)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s):
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ *  Portable stand-in for the Support Kit byte order macros
+ * ===================================================================== */
+
+#ifndef __SHIM_ByteOrder_H__
+#define __SHIM_ByteOrder_H__
+
+#include <SupportDefs.h>
+
+#include <endian.h>
+
+#define B_SWAP_INT16(x)			((int16)__builtin_bswap16((uint16)(x)))
+#define B_SWAP_INT32(x)			((int32)__builtin_bswap32((uint32)(x)))
+#define B_SWAP_INT64(x)			((int64)__builtin_bswap64((uint64)(x)))
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+	#define B_HOST_IS_LENDIAN			1
+	#define B_HOST_IS_BENDIAN			0
+	#define B_HOST_TO_BENDIAN_INT16(x)	B_SWAP_INT16(x)
+	#define B_HOST_TO_BENDIAN_INT32(x)	B_SWAP_INT32(x)
+	#define B_HOST_TO_BENDIAN_INT64(x)	B_SWAP_INT64(x)
+	#define B_HOST_TO_LENDIAN_INT16(x)	(x)
+	#define B_HOST_TO_LENDIAN_INT32(x)	(x)
+	#define B_HOST_TO_LENDIAN_INT64(x)	(x)
+#else
+	#define B_HOST_IS_LENDIAN			0
+	#define B_HOST_IS_BENDIAN			1
+	#define B_HOST_TO_BENDIAN_INT16(x)	(x)
+	#define B_HOST_TO_BENDIAN_INT32(x)	(x)
+	#define B_HOST_TO_BENDIAN_INT64(x)	(x)
+	#define B_HOST_TO_LENDIAN_INT16(x)	B_SWAP_INT16(x)
+	#define B_HOST_TO_LENDIAN_INT32(x)	B_SWAP_INT32(x)
+	#define B_HOST_TO_LENDIAN_INT64(x)	B_SWAP_INT64(x)
+#endif
+
+#define B_BENDIAN_TO_HOST_INT16(x)	B_HOST_TO_BENDIAN_INT16(x)
+#define B_BENDIAN_TO_HOST_INT32(x)	B_HOST_TO_BENDIAN_INT32(x)
+#define B_BENDIAN_TO_HOST_INT64(x)	B_HOST_TO_BENDIAN_INT64(x)
+#define B_LENDIAN_TO_HOST_INT16(x)	B_HOST_TO_LENDIAN_INT16(x)
+#define B_LENDIAN_TO_HOST_INT32(x)	B_HOST_TO_LENDIAN_INT32(x)
+#define B_LENDIAN_TO_HOST_INT64(x)	B_HOST_TO_LENDIAN_INT64(x)
+
+#endif /* __SHIM_ByteOrder_H__ */
@@ -0,0 +1,51 @@
+/* ===================================================================== *
+ * Debug.h (MeV/Headless)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s):
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ *  Portable stand-in for the Support Kit debugging macros
+ * ===================================================================== */
+
+#ifndef __SHIM_Debug_H__
+#define __SHIM_Debug_H__
+
+#include <OS.h>
+
+#include <stdio.h>
+
+#ifndef DEBUG
+#define DEBUG 0
+#endif
+
+#if DEBUG
+	#define PRINT(ARGS)			printf ARGS
+	#define SERIAL_PRINT(ARGS)	fprintf ARGS
+	#define ASSERT(E)			(!(E) ? debugger(#E) : (void)0)
+#else
+	#define PRINT(ARGS)			(void)0
+	#define SERIAL_PRINT(ARGS)	(void)0
+	#define ASSERT(E)			(void)0
+#endif
+
+#define TRACE()					PRINT(("%s:%d\n", __FILE__, __LINE__))
+
+#endif /* __SHIM_Debug_H__ */
@@ -0,0 +1,395 @@
+/* ===================================================================== *
+ * Kernel.cpp (MeV/Headless)
+ * ===================================================================== */
+
+#include <OS.h>
+
+// Gnu C Library
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+// Standard Template Library
+#include <map>
+
+// ---------------------------------------------------------------------------
+// Semaphores
+
+namespace
+{
+
+struct sem_info
+{
+	pthread_mutex_t		mutex;
+	pthread_cond_t		cond;
+	int32				count;
+	bool				deleted;
+	int32				waiting;
+};
+
+pthread_mutex_t			s_semLock = PTHREAD_MUTEX_INITIALIZER;
+std::map<sem_id, sem_info *> s_sems;
+sem_id					s_nextSem = 1;
+
+sem_info *
+lookup_sem(
+	sem_id sem)
+{
+	pthread_mutex_lock(&s_semLock);
+	std::map<sem_id, sem_info *>::iterator i = s_sems.find(sem);
+	sem_info *info = (i != s_sems.end()) ? i->second : NULL;
+	pthread_mutex_unlock(&s_semLock);
+	return info;
+}
+
+void
+absolute_time(
+	bigtime_t when,
+	struct timespec *outTime)
+{
+	// system_time() is CLOCK_MONOTONIC, which the condition variables
+	// are set up to use as well
+	outTime->tv_sec = when / 1000000;
+	outTime->tv_nsec = (when % 1000000) * 1000;
+}
+
+} // namespace
+
+sem_id
+create_sem(
+	int32 count,
+	const char *)
+{
+	sem_info *info = new sem_info;
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_mutex_init(&info->mutex, NULL);
+	pthread_cond_init(&info->cond, &attr);
+	pthread_condattr_destroy(&attr);
+	info->count = count;
+	info->deleted = false;
+	info->waiting = 0;
+
+	pthread_mutex_lock(&s_semLock);
+	sem_id sem = s_nextSem++;
+	s_sems[sem] = info;
+	pthread_mutex_unlock(&s_semLock);
+	return sem;
+}
+
+status_t
+delete_sem(
+	sem_id sem)
+{
+	pthread_mutex_lock(&s_semLock);
+	std::map<sem_id, sem_info *>::iterator i = s_sems.find(sem);
+	if (i == s_sems.end())
+	{
+		pthread_mutex_unlock(&s_semLock);
+		return B_BAD_SEM_ID;
+	}
+	sem_info *info = i->second;
+	s_sems.erase(i);
+	pthread_mutex_unlock(&s_semLock);
+
+	// wake up everyone still waiting, and wait for them to leave
+	pthread_mutex_lock(&info->mutex);
+	info->deleted = true;
+	pthread_cond_broadcast(&info->cond);
+	while (info->waiting > 0)
+	{
+		pthread_mutex_unlock(&info->mutex);
+		sched_yield();
+		pthread_mutex_lock(&info->mutex);
+	}
+	pthread_mutex_unlock(&info->mutex);
+
+	pthread_cond_destroy(&info->cond);
+	pthread_mutex_destroy(&info->mutex);
+	delete info;
+	return B_OK;
+}
+
+status_t
+acquire_sem(
+	sem_id sem)
+{
+	return acquire_sem_etc(sem, 1, 0, B_INFINITE_TIMEOUT);
+}
+
+status_t
+acquire_sem_etc(
+	sem_id sem,
+	int32 count,
+	uint32 flags,
+	bigtime_t timeout)
+{
+	sem_info *info = lookup_sem(sem);
+	if (info == NULL)
+		return B_BAD_SEM_ID;
+	if (count <= 0)
+		return B_BAD_VALUE;
+
+	// as with the kernel, the timeout only applies if asked for
+	bool timed = false;
+	bigtime_t deadline = 0;
+	if (flags & B_RELATIVE_TIMEOUT)
+	{
+		timed = (timeout != B_INFINITE_TIMEOUT);
+		deadline = system_time() + timeout;
+	}
+	else if (flags & B_ABSOLUTE_TIMEOUT)
+	{
+		timed = (timeout != B_INFINITE_TIMEOUT);
+		deadline = timeout;
+	}
+
+	status_t result = B_OK;
+	pthread_mutex_lock(&info->mutex);
+	info->waiting++;
+	while (!info->deleted && (info->count < count))
+	{
+		if (!timed)
+		{
+			pthread_cond_wait(&info->cond, &info->mutex);
+		}
+		else if (deadline <= system_time())
+		{
+			result = (timeout == 0) ? B_WOULD_BLOCK : B_TIMED_OUT;
+			break;
+		}
+		else
+		{
+			struct timespec when;
+			absolute_time(deadline, &when);
+			pthread_cond_timedwait(&info->cond, &info->mutex, &when);
+		}
+	}
+	if (info->deleted)
+		result = B_BAD_SEM_ID;
+	else if (result == B_OK)
+		info->count -= count;
+	info->waiting--;
+	pthread_mutex_unlock(&info->mutex);
+
+	return result;
+}
+
+status_t
+release_sem(
+	sem_id sem)
+{
+	return release_sem_etc(sem, 1, 0);
+}
+
+status_t
+release_sem_etc(
+	sem_id sem,
+	int32 count,
+	uint32)
+{
+	sem_info *info = lookup_sem(sem);
+	if (info == NULL)
+		return B_BAD_SEM_ID;
+	if (count <= 0)
+		return B_BAD_VALUE;
+
+	pthread_mutex_lock(&info->mutex);
+	info->count += count;
+	pthread_cond_broadcast(&info->cond);
+	pthread_mutex_unlock(&info->mutex);
+
+	return B_OK;
+}
+
+status_t
+get_sem_count(
+	sem_id sem,
+	int32 *outCount)
+{
+	sem_info *info = lookup_sem(sem);
+	if (info == NULL)
+		return B_BAD_SEM_ID;
+
+	pthread_mutex_lock(&info->mutex);
+	*outCount = info->count;
+	pthread_mutex_unlock(&info->mutex);
+
+	return B_OK;
+}
+
+// ---------------------------------------------------------------------------
+// Threads
+
+namespace
+{
+
+struct thread_info
+{
+	thread_id			id;
+	thread_func			function;
+	void *				data;
+	pthread_t			thread;
+	bool				started;
+	status_t			result;
+};
+
+pthread_mutex_t			s_threadLock = PTHREAD_MUTEX_INITIALIZER;
+std::map<thread_id, thread_info *> s_threads;
+thread_id				s_nextThread = 1;
+__thread thread_id		s_currentThread = -1;
+
+void *
+thread_entry(
+	void *data)
+{
+	thread_info *info = (thread_info *)data;
+	s_currentThread = info->id;
+	info->result = info->function(info->data);
+	return NULL;
+}
+
+} // namespace
+
+thread_id
+spawn_thread(
+	thread_func function,
+	const char *,
+	int32,
+	void *data)
+{
+	thread_info *info = new thread_info;
+	info->function = function;
+	info->data = data;
+	info->started = false;
+	info->result = B_OK;
+
+	pthread_mutex_lock(&s_threadLock);
+	info->id = s_nextThread++;
+	s_threads[info->id] = info;
+	pthread_mutex_unlock(&s_threadLock);
+
+	return info->id;
+}
+
+status_t
+resume_thread(
+	thread_id thread)
+{
+	pthread_mutex_lock(&s_threadLock);
+	std::map<thread_id, thread_info *>::iterator i = s_threads.find(thread);
+	if (i == s_threads.end() || i->second->started)
+	{
+		pthread_mutex_unlock(&s_threadLock);
+		return B_BAD_THREAD_ID;
+	}
+	thread_info *info = i->second;
+	info->started = true;
+	pthread_mutex_unlock(&s_threadLock);
+
+	if (pthread_create(&info->thread, NULL, thread_entry, info) != 0)
+		return B_NO_MEMORY;
+	return B_OK;
+}
+
+status_t
+wait_for_thread(
+	thread_id thread,
+	status_t *outResult)
+{
+	pthread_mutex_lock(&s_threadLock);
+	std::map<thread_id, thread_info *>::iterator i = s_threads.find(thread);
+	if (i == s_threads.end())
+	{
+		pthread_mutex_unlock(&s_threadLock);
+		return B_BAD_THREAD_ID;
+	}
+	thread_info *info = i->second;
+	s_threads.erase(i);
+	pthread_mutex_unlock(&s_threadLock);
+
+	// a thread which was never resumed runs now, as on BeOS
+	if (!info->started
+	 && (pthread_create(&info->thread, NULL, thread_entry, info) != 0))
+	{
+		delete info;
+		return B_NO_MEMORY;
+	}
+	pthread_join(info->thread, NULL);
+	if (outResult)
+		*outResult = info->result;
+	delete info;
+
+	return B_OK;
+}
+
+thread_id
+find_thread(
+	const char *name)
+{
+	if (name != NULL)
+		return B_NAME_NOT_FOUND;
+
+	// threads not created by spawn_thread() get an ID the first time
+	if (s_currentThread < 0)
+	{
+		pthread_mutex_lock(&s_threadLock);
+		s_currentThread = s_nextThread++;
+		pthread_mutex_unlock(&s_threadLock);
+	}
+	return s_currentThread;
+}
+
+status_t
+snooze(
+	bigtime_t amount)
+{
+	if (amount <= 0)
+		return B_OK;
+
+	struct timespec delay;
+	delay.tv_sec = amount / 1000000;
+	delay.tv_nsec = (amount % 1000000) * 1000;
+	while (nanosleep(&delay, &delay) != 0 && errno == EINTR)
+		;
+	return B_OK;
+}
+
+// ---------------------------------------------------------------------------
+// Time
+
+bigtime_t
+system_time()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (bigtime_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// ---------------------------------------------------------------------------
+// System Information
+
+status_t
+get_system_info(
+	system_info *info)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	info->cpu_count = (cpus > 0) ? cpus : 1;
+	return B_OK;
+}
+
+// ---------------------------------------------------------------------------
+// Debugging
+
+void
+debugger(
+	const char *message)
+{
+	fprintf(stderr, "debugger(): %s\n", message);
+	abort();
+}
+
+// END - Kernel.cpp
@@ -0,0 +1,100 @@
+/* ===================================================================== *
+ * List.h (MeV/Headless)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s):
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ *  Portable stand-in for BList
+ * ===================================================================== */
+
+#ifndef __SHIM_List_H__
+#define __SHIM_List_H__
+
+#include <SupportDefs.h>
+
+#include <vector>
+
+/**
+ *	An ordered list of untyped pointers, as BList.
+ */
+class BList
+{
+
+public:							// Constructor/Destructor
+
+								BList(
+									int32 count = 20)
+								{ m_items.reserve(count); }
+
+	virtual						~BList()
+								{ }
+
+public:							// Accessors
+
+	int32						CountItems() const
+								{ return (int32)m_items.size(); }
+
+	bool						IsEmpty() const
+								{ return m_items.empty(); }
+
+	void *						ItemAt(
+									int32 index) const
+								{ return (index >= 0 && index < CountItems())
+										 ? m_items[index] : NULL; }
+
+	void *						FirstItem() const
+								{ return ItemAt(0); }
+
+	void *						LastItem() const
+								{ return ItemAt(CountItems() - 1); }
+
+	int32						IndexOf(
+									void *item) const;
+
+	bool						HasItem(
+									void *item) const
+								{ return IndexOf(item) >= 0; }
+
+public:							// Operations
+
+	bool						AddItem(
+									void *item)
+								{ m_items.push_back(item); return true; }
+
+	bool						AddItem(
+									void *item,
+									int32 index);
+
+	bool						RemoveItem(
+									void *item);
+
+	void *						RemoveItem(
+									int32 index);
+
+	void						MakeEmpty()
+								{ m_items.clear(); }
+
+private:						// Instance Data
+
+	std::vector<void *>			m_items;
+};
+
+#endif /* __SHIM_List_H__ */
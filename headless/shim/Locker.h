@@ -0,0 +1,80 @@
+/* ===================================================================== *
+ * Locker.h (MeV/Headless)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s):
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ *  Portable stand-in for BLocker
+ * ===================================================================== */
+
+#ifndef __SHIM_Locker_H__
+#define __SHIM_Locker_H__
+
+#include <OS.h>
+
+#include <pthread.h>
+
+/**
+ *	A recursive lock, as BLocker. Only what the engine uses is provided.
+ */
+class BLocker
+{
+
+public:							// Constructor/Destructor
+
+								BLocker();
+
+								BLocker(
+									const char *name);
+
+								BLocker(
+									const char *name,
+									bool benaphoreStyle);
+
+								~BLocker();
+
+public:							// Operations
+
+	bool						Lock();
+
+	status_t					LockWithTimeout(
+									bigtime_t timeout);
+
+	void						Unlock();
+
+	bool						IsLocked() const;
+
+	thread_id					LockingThread() const
+								{ return m_owner; }
+
+	int32						CountLocks() const
+								{ return m_count; }
+
+private:						// Instance Data
+
+	pthread_mutex_t				m_mutex;
+
+	thread_id					m_owner;
+
+	int32						m_count;
+};
+
+#endif /* __SHIM_Locker_H__ */
@@ -0,0 +1,103 @@
+/* ===================================================================== *
+ * Message.h (MeV/Headless)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s):
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ *  Portable stand-in for BMessage
+ * ===================================================================== */
+
+#ifndef __SHIM_Message_H__
+#define __SHIM_Message_H__
+
+#include <SupportDefs.h>
+
+#include <map>
+#include <string>
+
+/**
+ *	Headless builds have no application server to deliver messages to,
+ *	so this only carries the command constant and simple named values,
+ *	which is all that update hints need.
+ */
+class BMessage
+{
+
+public:							// Constructor/Destructor
+
+								BMessage()
+									:	what(0)
+								{ }
+
+								BMessage(
+									uint32 command)
+									:	what(command)
+								{ }
+
+	virtual						~BMessage()
+								{ }
+
+public:							// Data
+
+	status_t					AddInt32(
+									const char *name,
+									int32 value)
+								{ m_values[name] = value; return B_OK; }
+
+	status_t					AddInt64(
+									const char *name,
+									int64 value)
+								{ m_values[name] = value; return B_OK; }
+
+	status_t					AddBool(
+									const char *name,
+									bool value)
+								{ m_values[name] = value; return B_OK; }
+
+	status_t					FindInt32(
+									const char *name,
+									int32 *value) const;
+
+	status_t					FindInt64(
+									const char *name,
+									int64 *value) const;
+
+	status_t					FindBool(
+									const char *name,
+									bool *value) const;
+
+	bool						HasData(
+									const char *name) const
+								{ return m_values.find(name) != m_values.end(); }
+
+	void						MakeEmpty()
+								{ m_values.clear(); }
+
+public:							// Instance Data
+
+	uint32						what;
+
+private:
+
+	std::map<std::string, int64> m_values;
+};
+
+#endif /* __SHIM_Message_H__ */
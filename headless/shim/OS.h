@@ -0,0 +1,103 @@
+/* ===================================================================== *
+ * OS.h (MeV/Headless)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s):
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ *  Portable stand-in for the Kernel Kit (semaphores, threads, time)
+ * ===================================================================== */
+
+#ifndef __SHIM_OS_H__
+#define __SHIM_OS_H__
+
+#include <SupportDefs.h>
+
+typedef int32					sem_id;
+typedef int32					thread_id;
+typedef int32					team_id;
+typedef int32					port_id;
+
+typedef status_t (*thread_func)(void *data);
+
+#define B_OS_NAME_LENGTH		32
+#define B_PAGE_SIZE				4096
+#define B_INFINITE_TIMEOUT		(9223372036854775807LL)
+
+enum
+{
+	B_CAN_INTERRUPT				= 0x01,
+	B_DO_NOT_RESCHEDULE			= 0x02,
+	B_TIMEOUT					= 0x08,
+	B_RELATIVE_TIMEOUT			= 0x08,
+	B_ABSOLUTE_TIMEOUT			= 0x10
+};
+
+enum
+{
+	B_IDLE_PRIORITY				= 0,
+	B_LOWEST_ACTIVE_PRIORITY	= 1,
+	B_LOW_PRIORITY				= 5,
+	B_NORMAL_PRIORITY			= 10,
+	B_DISPLAY_PRIORITY			= 15,
+	B_URGENT_DISPLAY_PRIORITY	= 20,
+	B_REAL_TIME_DISPLAY_PRIORITY = 100,
+	B_URGENT_PRIORITY			= 110,
+	B_REAL_TIME_PRIORITY		= 120
+};
+
+// Semaphores
+
+sem_id		create_sem(int32 count, const char *name);
+status_t	delete_sem(sem_id sem);
+status_t	acquire_sem(sem_id sem);
+status_t	acquire_sem_etc(sem_id sem, int32 count, uint32 flags,
+						bigtime_t timeout);
+status_t	release_sem(sem_id sem);
+status_t	release_sem_etc(sem_id sem, int32 count, uint32 flags);
+status_t	get_sem_count(sem_id sem, int32 *count);
+
+// Threads
+
+thread_id	spawn_thread(thread_func function, const char *name,
+						int32 priority, void *data);
+status_t	resume_thread(thread_id thread);
+status_t	wait_for_thread(thread_id thread, status_t *returnValue);
+thread_id	find_thread(const char *name);
+status_t	snooze(bigtime_t amount);
+
+// Time
+
+bigtime_t	system_time();
+
+// System information (only what the engine uses)
+
+typedef struct
+{
+	uint32		cpu_count;
+} system_info;
+
+status_t	get_system_info(system_info *info);
+
+// Debugging
+
+void		debugger(const char *message);
+
+#endif /* __SHIM_OS_H__ */
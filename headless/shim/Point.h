@@ -0,0 +1,53 @@
+/* ===================================================================== *
+ * Point.h (MeV/Headless)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s):
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ *  Portable stand-in for BPoint
+ * ===================================================================== */
+
+#ifndef __SHIM_Point_H__
+#define __SHIM_Point_H__
+
+#include <SupportDefs.h>
+
+class BPoint
+{
+
+public:
+
+								BPoint()
+									:	x(0.0), y(0.0)
+								{ }
+
+								BPoint(
+									float inX,
+									float inY)
+									:	x(inX), y(inY)
+								{ }
+
+	float						x;
+
+	float						y;
+};
+
+#endif /* __SHIM_Point_H__ */
@@ -0,0 +1,86 @@
+/* ===================================================================== *
+ * String.h (MeV/Headless)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s):
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ *  Portable stand-in for BString
+ * ===================================================================== */
+
+#ifndef __SHIM_String_H__
+#define __SHIM_String_H__
+
+#include <SupportDefs.h>
+
+#include <string>
+
+/**
+ *	Just enough of BString for the engine's readers and writers.
+ */
+class BString
+{
+
+public:							// Constructor/Destructor
+
+								BString()
+								{ }
+
+								BString(
+									const char *string)
+									:	m_string(string ? string : "")
+								{ }
+
+public:							// Accessors
+
+	const char *				String() const
+								{ return m_string.c_str(); }
+
+	int32						Length() const
+								{ return (int32)m_string.length(); }
+
+public:							// Operations
+
+	BString &					SetTo(
+									const char *string)
+								{ m_string = string ? string : ""; return *this; }
+
+	BString &					operator=(
+									const char *string)
+								{ return SetTo(string); }
+
+	BString &					operator<<(
+									const char *string)
+								{ m_string += string ? string : ""; return *this; }
+
+	BString &					operator<<(
+									int32 value)
+								{ m_string += std::to_string(value); return *this; }
+
+	bool						operator==(
+									const char *string) const
+								{ return m_string == (string ? string : ""); }
+
+private:						// Instance Data
+
+	std::string					m_string;
+};
+
+#endif /* __SHIM_String_H__ */
@@ -0,0 +1,209 @@
+/* ===================================================================== *
+ * Support.cpp (MeV/Headless)
+ * ===================================================================== */
+
+#include <Locker.h>
+#include <List.h>
+#include <Message.h>
+
+// Gnu C Library
+#include <errno.h>
+#include <time.h>
+
+// ---------------------------------------------------------------------------
+// BLocker
+
+BLocker::BLocker()
+	:	m_owner(-1),
+		m_count(0)
+{
+	pthread_mutex_init(&m_mutex, NULL);
+}
+
+BLocker::BLocker(
+	const char *)
+	:	m_owner(-1),
+		m_count(0)
+{
+	pthread_mutex_init(&m_mutex, NULL);
+}
+
+BLocker::BLocker(
+	const char *,
+	bool)
+	:	m_owner(-1),
+		m_count(0)
+{
+	pthread_mutex_init(&m_mutex, NULL);
+}
+
+BLocker::~BLocker()
+{
+	pthread_mutex_destroy(&m_mutex);
+}
+
+bool
+BLocker::Lock()
+{
+	thread_id thread = find_thread(NULL);
+	if (m_owner == thread)
+	{
+		m_count++;
+		return true;
+	}
+
+	if (pthread_mutex_lock(&m_mutex) != 0)
+		return false;
+	m_owner = thread;
+	m_count = 1;
+	return true;
+}
+
+status_t
+BLocker::LockWithTimeout(
+	bigtime_t timeout)
+{
+	thread_id thread = find_thread(NULL);
+	if (m_owner == thread)
+	{
+		m_count++;
+		return B_OK;
+	}
+
+	int error;
+	if (timeout == B_INFINITE_TIMEOUT)
+	{
+		error = pthread_mutex_lock(&m_mutex);
+	}
+	else
+	{
+		struct timespec when;
+		clock_gettime(CLOCK_REALTIME, &when);
+		bigtime_t nsecs = when.tv_nsec + (timeout % 1000000) * 1000;
+		when.tv_sec += timeout / 1000000 + nsecs / 1000000000;
+		when.tv_nsec = nsecs % 1000000000;
+		error = pthread_mutex_timedlock(&m_mutex, &when);
+	}
+	if (error == ETIMEDOUT)
+		return (timeout == 0) ? B_WOULD_BLOCK : B_TIMED_OUT;
+	else if (error != 0)
+		return B_ERROR;
+
+	m_owner = thread;
+	m_count = 1;
+	return B_OK;
+}
+
+void
+BLocker::Unlock()
+{
+	if (m_owner != find_thread(NULL))
+		return;
+
+	if (--m_count == 0)
+	{
+		m_owner = -1;
+		pthread_mutex_unlock(&m_mutex);
+	}
+}
+
+bool
+BLocker::IsLocked() const
+{
+	return m_owner == find_thread(NULL);
+}
+
+// ---------------------------------------------------------------------------
+// BList
+
+int32
+BList::IndexOf(
+	void *item) const
+{
+	for (uint32 i = 0; i < m_items.size(); i++)
+	{
+		if (m_items[i] == item)
+			return i;
+	}
+	return -1;
+}
+
+bool
+BList::AddItem(
+	void *item,
+	int32 index)
+{
+	if (index < 0 || index > CountItems())
+		return false;
+
+	m_items.insert(m_items.begin() + index, item);
+	return true;
+}
+
+bool
+BList::RemoveItem(
+	void *item)
+{
+	int32 index = IndexOf(item);
+	if (index < 0)
+		return false;
+
+	m_items.erase(m_items.begin() + index);
+	return true;
+}
+
+void *
+BList::RemoveItem(
+	int32 index)
+{
+	if (index < 0 || index >= CountItems())
+		return NULL;
+
+	void *item = m_items[index];
+	m_items.erase(m_items.begin() + index);
+	return item;
+}
+
+// ---------------------------------------------------------------------------
+// BMessage
+
+status_t
+BMessage::FindInt32(
+	const char *name,
+	int32 *value) const
+{
+	std::map<std::string, int64>::const_iterator i = m_values.find(name);
+	if (i == m_values.end())
+		return B_NAME_NOT_FOUND;
+
+	*value = (int32)i->second;
+	return B_OK;
+}
+
+status_t
+BMessage::FindInt64(
+	const char *name,
+	int64 *value) const
+{
+	std::map<std::string, int64>::const_iterator i = m_values.find(name);
+	if (i == m_values.end())
+		return B_NAME_NOT_FOUND;
+
+	*value = i->second;
+	return B_OK;
+}
+
+status_t
+BMessage::FindBool(
+	const char *name,
+	bool *value) const
+{
+	std::map<std::string, int64>::const_iterator i = m_values.find(name);
+	if (i == m_values.end())
+		return B_NAME_NOT_FOUND;
+
+	*value = (i->second != 0);
+	return B_OK;
+}
+
+// END - Support.cpp
@@ -0,0 +1,172 @@
+/* ===================================================================== *
+ * SupportDefs.h (MeV/Headless)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s):
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ *  Portable stand-in for the Support Kit type definitions
+ * ===================================================================== */
+
+#ifndef __SHIM_SupportDefs_H__
+#define __SHIM_SupportDefs_H__
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/param.h>
+#include <sys/types.h>
+
+typedef int8_t					int8;
+typedef uint8_t					uint8;
+typedef int16_t					int16;
+typedef uint16_t				uint16;
+typedef int32_t					int32;
+typedef uint32_t				uint32;
+typedef int64_t					int64;
+typedef uint64_t				uint64;
+
+typedef unsigned char			uchar;
+typedef int32					status_t;
+typedef int64					bigtime_t;
+typedef uint32					type_code;
+typedef uintptr_t				addr_t;
+
+enum
+{
+	B_OK						= 0,
+	B_NO_ERROR					= 0,
+	B_ERROR						= -1,
+
+	B_GENERAL_ERROR_BASE		= -2147483647 - 1,
+	B_NO_MEMORY					= B_GENERAL_ERROR_BASE,
+	B_BAD_VALUE					= B_GENERAL_ERROR_BASE + 5,
+	B_TIMED_OUT					= B_GENERAL_ERROR_BASE + 9,
+	B_INTERRUPTED				= B_GENERAL_ERROR_BASE + 10,
+	B_WOULD_BLOCK				= B_GENERAL_ERROR_BASE + 11,
+	B_NAME_NOT_FOUND			= B_GENERAL_ERROR_BASE + 13,
+	B_BAD_INDEX					= B_GENERAL_ERROR_BASE + 15,
+
+	B_OS_ERROR_BASE				= B_GENERAL_ERROR_BASE + 0x1000,
+	B_BAD_SEM_ID				= B_OS_ERROR_BASE + 0x0,
+	B_BAD_THREAD_ID				= B_OS_ERROR_BASE + 0x100
+};
+
+#ifndef min_c
+#define min_c(a, b)				((a) > (b) ? (b) : (a))
+#endif
+#ifndef max_c
+#define max_c(a, b)				((a) > (b) ? (a) : (b))
+#endif
+
+#ifndef NULL
+#define NULL					0
+#endif
+
+#ifndef FALSE
+#define FALSE					0
+#endif
+#ifndef TRUE
+#define TRUE					1
+#endif
+
+/** Atomically adds to the value, and returns the previous value. */
+inline int32
+atomic_add(
+	volatile int32 *value,
+	int32 addValue)
+{
+	return __atomic_fetch_add(value, addValue, __ATOMIC_SEQ_CST);
+}
+
+inline int32
+atomic_and(
+	volatile int32 *value,
+	int32 andValue)
+{
+	return __atomic_fetch_and(value, andValue, __ATOMIC_SEQ_CST);
+}
+
+inline int32
+atomic_or(
+	volatile int32 *value,
+	int32 orValue)
+{
+	return __atomic_fetch_or(value, orValue, __ATOMIC_SEQ_CST);
+}
+
+/** Atomically sets the value to newValue if it equals testAgainst, and
+	returns the previous value.
+*/
+inline int32
+atomic_test_and_set(
+	volatile int32 *value,
+	int32 newValue,
+	int32 testAgainst)
+{
+	__atomic_compare_exchange_n(value, &testAgainst, newValue, false,
+								__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return testAgainst;
+}
+
+inline int32
+atomic_get(
+	volatile int32 *value)
+{
+	return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+inline int64
+atomic_add64(
+	volatile int64 *value,
+	int64 addValue)
+{
+	return __atomic_fetch_add(value, addValue, __ATOMIC_SEQ_CST);
+}
+
+inline int64
+atomic_test_and_set64(
+	volatile int64 *value,
+	int64 newValue,
+	int64 testAgainst)
+{
+	__atomic_compare_exchange_n(value, &testAgainst, newValue, false,
+								__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return testAgainst;
+}
+
+/** Atomically sets the value, and returns the previous value. */
+inline int64
+atomic_set64(
+	volatile int64 *value,
+	int64 newValue)
+{
+	return __atomic_exchange_n(value, newValue, __ATOMIC_SEQ_CST);
+}
+
+inline int64
+atomic_get64(
+	volatile int64 *value)
+{
+	return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+#endif /* __SHIM_SupportDefs_H__ */
@@ -54,6 +54,11 @@ class CMeVDoc;
 
 class BBitmap;
 
+namespace Midi
+{
+	class CMidiChaseState;
+}
+
 #define DESTINATION_NAME_LENGTH 128
 
 /**	Destinations, allow routing and remapping of MIDI data
@@ -104,6 +109,29 @@ public:							// Hook Functions
 									CEvent &event,
 									bigtime_t when) = 0;
 
+	/**	Copies the channel state collected while locating so far, so
+	 *	that a locate snapshot can restore it later. Returns false if
+	 *	the destination doesn't collect any.
+	 */
+	virtual bool				GetChaseState(
+									Midi::CMidiChaseState &outState) const
+								{ return false; }
+
+	/**	Replaces the channel state collected while locating with the
+	 *	one stored in a locate snapshot.
+	 */
+	virtual void				SetChaseState(
+									const Midi::CMidiChaseState &state)
+								{ }
+
+	/**	Returns a value which changes whenever the channel state
+	 *	collected while locating would come out differently, such as
+	 *	when the destination is routed elsewhere, so that locate
+	 *	snapshots know when they are out of date.
+	 */
+	virtual uint32				ChaseKey() const
+								{ return 0; }
+
 	virtual status_t			GetIcon(
 									icon_size which,
 									BBitmap *outIcon) = 0;
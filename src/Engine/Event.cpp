@@ -4,9 +4,10 @@
 
 #include "MeVSpec.h"
 #include "Event.h"
-#include "Destination.h"
+#include "MeV.h"
 #include "MathUtils.h"
 
+#include <stdint.h>
 #include <stdio.h>
 
 /** ======================================================================= **
@@ -66,9 +67,9 @@ void CEvent::InitTables()
 
 UEventAttributeTable::EvAttr UEventAttributeTable::attrTable[ EvAttr_Count ] = {
 	{	"", 				0, 0, 	0			},	// EvAttr_None
-	{	"Start Time",		0, LONG_MIN, LONG_MAX	}, 	// EvAttr_StartTime
-	{	"Stop Time",		0, LONG_MIN, LONG_MAX	}, 	// EvAttr_Duration
-	{	"Duration", 		0, 0, 	LONG_MAX		},	// EvAttr_StopTime
+	{	"Start Time",		0, INT32_MIN, INT32_MAX	}, 	// EvAttr_StartTime
+	{	"Stop Time",		0, INT32_MIN, INT32_MAX	}, 	// EvAttr_Duration
+	{	"Duration", 		0, 0, 	INT32_MAX		},	// EvAttr_StopTime
 	{	"Type", 			0, 0,		EvtType_Count},	// EvAttr_Type
 	{	"Selected",		0, 0,		1			},	// EvAttr_Selected
 	{	"Channel",		1, 0,		63			},	// EvAttr_Channel
@@ -90,7 +91,7 @@ UEventAttributeTable::EvAttr UEventAttributeTable::attrTable[ EvAttr_Count ] = {
 	{	"Part",			0, 2,		0x0ffff		}, 	//?	EvAttr_SequenceNumber
 	{	"Transpose",		0, -128,	127			}, 	// EvAttr_Transposition
 	{	"Level",			0, 0,		255			}, 	// EvAttr_CountourLevel
-	{	"Bytes",			0, 0,		LONG_MAX	}, 	// EvAttr_DataSize
+	{	"Bytes",			0, 0,		INT32_MAX	}, 	// EvAttr_DataSize
 	{	"# Beats",		0, 1,		64			}, 	// EvAttr_TSigBeatCount
 	{	"Beat Size",		0, 0,		6			}, 	// EvAttr_TSigBeatSize
 
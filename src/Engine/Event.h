@@ -302,12 +302,14 @@ class CEvent {
 		inline void Init() { data = NULL; }
 		inline void *Data() const { return data ? (void *)(data + 1) : NULL; }
 		
-		inline void Use() { if (data) data->useCount++; }
+			// The player copies events from snapshots while the editor
+			// copies them from the list, so the count must be atomic.
+		inline void Use() { if (data) atomic_add( &data->useCount, 1 ); }
 		void Release()
 		{
 			if (data)
 			{
-				if (--data->useCount == 0) delete[] (char *)data;
+				if (atomic_add( &data->useCount, -1 ) == 1) delete[] (char *)data;
 				data = NULL;
 			}
 		}
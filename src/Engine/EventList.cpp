@@ -4,17 +4,28 @@
 
 #include "EventList.h"
 
+#include "Error.h"
 #include "Observable.h"
 #include "Writer.h"
 #include "Reader.h"
 
 // Gnu C Library
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+// Standard Template Library
+#include <algorithm>
 // Support Kit
 #include <Debug.h>
 
+	// The summary of no events at all
+static const EventList::Summary EmptySummary = { LONG_MIN, 0, LONG_MAX, LONG_MIN, -1 };
+
 // ---------------------------------------------------------------------------
-// Compute latest stop time of all events in block
+// Compute latest stop time of all events in block, and summarize the
+// selected events and the 'end' events
 
 void EventBlock::Summarize( void )
 {
@@ -22,13 +33,32 @@ void EventBlock::Summarize( void )
 	long			maxTime = 0;
 	int				i;
 
+	selectCount = 0;
+	minSelectTime = LONG_MAX;
+	maxSelectTime = LONG_MIN;
+	endTime = -1;
+
 	for (	i = 0, ev = ItemAddress( 0 );
 			i < count;
 			ev++, i++ )
 	{
+		long		stop;
+
 		if (ev->HasProperty( CEvent::Prop_Duration ))
-			maxTime = maxTime > ev->Stop() ? maxTime : ev->Stop();
-		else maxTime = maxTime > ev->Start() ? maxTime : ev->Start();
+			stop = ev->Stop();
+		else stop = ev->Start();
+		maxTime = maxTime > stop ? maxTime : stop;
+
+		if (ev->IsSelected())
+		{
+			if (selectCount == 0) minSelectTime = ev->Start();
+			maxSelectTime = maxSelectTime > stop ? maxSelectTime : stop;
+			selectCount++;
+		}
+
+			// Only an 'end' event after time zero sets the track's length
+		if (ev->Command() == EvtType_End && endTime <= 0 && stop > 0)
+			endTime = stop;
 	}
 
 	maxStopTime = maxTime;
@@ -36,59 +66,327 @@ void EventBlock::Summarize( void )
 }
 
 // ---------------------------------------------------------------------------
-// Set a marker at a given time
+// Find the first item which starts at or after a given time
 
-const CEvent *EventMarker::SeekForwardToTime( long time, bool fromStart )
+int16 EventBlock::FindStartTime( long inTime, int16 inFrom ) const
 {
-	EventBlock		*b, *goodBlock = NULL;
+	int16			low = inFrom,
+					high = count;
 
-	if (fromStart) b = (EventBlock *)FirstBlock();
-	else b = (EventBlock *)block;
+	while (low < high)
+	{
+		int16		mid = (low + high) / 2;
 
-		// For each block, look for a block who's last event has a time greater than
-		// or equal to the time we are searching for.
-	for (; b; b = (EventBlock *)b->Next() )
+		if (ItemAddress( mid )->Start() < inTime) low = mid + 1;
+		else high = mid;
+	}
+
+	return low;
+}
+
+// ---------------------------------------------------------------------------
+// Constructor
+
+EventList::EventList()
+	:	indexSize( 0 ),
+		validIndex( false ),
+		editCount( 0 ),
+		snapshot( new CEventSnapshot( 0 ) ),
+		snapshotAcquires( 0 )
+{
+}
+
+// ---------------------------------------------------------------------------
+// Destructor. Nobody may read the snapshots anymore.
+
+EventList::~EventList()
+{
+	for (size_t i = 0; i < retiredSnapshots.size(); i++)
+		delete retiredSnapshots[i];
+	delete snapshot;
+}
+
+// ---------------------------------------------------------------------------
+// The events of a block were edited: count the edit, and invalidate the
+// block's summary. (Only called while the list is being edited.)
+
+void EventList::OnBlockChanged( ItemBlock_Base *inChangedBlock )
+{
+	editCount++;
+	((EventBlock *)inChangedBlock)->frozen = NULL;
+	InvalidateBlockSummary( (EventBlock *)inChangedBlock );
+}
+
+// ---------------------------------------------------------------------------
+// Invalidate the summary data for a block, and queue its index entry for
+// refreshing. A change of the selection only needs this.
+
+void EventList::InvalidateBlockSummary( EventBlock *b )
+{
+	b->validSummaryData = false;
+
+		// If the index is going to be rebuilt anyway, don't bother.
+	if (validIndex && !b->indexPending)
 	{
-		const CEvent	*ev;
+		b->indexPending = true;
+		pendingBlocks.push_back( b );
+	}
+}
 
-			// If block has no entries, then skip
+// ---------------------------------------------------------------------------
+// Blocks were allocated or deleted, so positions in the index are no longer
+// valid. Note that the pending list may now hold deleted blocks.
+
+void EventList::OnBlockListChanged()
+{
+	editCount++;
+	validIndex = false;
+	pendingBlocks.clear();
+}
+
+// ---------------------------------------------------------------------------
+// Rebuild the block index from scratch
+
+void EventList::RebuildIndex()
+{
+	EventBlock		*b;
+	int32			i;
+
+	blockIndex.clear();
+	lastStartTimes.clear();
+	for (b = FirstBlock(); b; b = b->Next())
+	{
+		b->indexPos = blockIndex.size();
+		b->indexPending = false;
+		blockIndex.push_back( b );
+
+			// Empty blocks inherit the time of the previous block, so that
+			// the list of times stays sorted.
 		if (b->count > 0)
-		{
-				// Get address of last item in the block
-			ev = b->ItemAddress( b->count - 1 );
+			lastStartTimes.push_back( b->ItemAddress( b->count - 1 )->Start() );
+		else lastStartTimes.push_back( lastStartTimes.empty() ? LONG_MIN : lastStartTimes.back() );
+	}
 
-				// Store the address of the last "good" block that we found.
-			goodBlock = b;
+	for (indexSize = 1; indexSize < (int32)blockIndex.size(); indexSize <<= 1) {}
 
-				// If the start time of the last item in the block is less than
-				// the time we are searching for, then continue; Else if the
-				// start timer is greater or equal, then we've found the block
-				// we're looking for.
-			if (ev->Start() >= time) break;
+		// Empty blocks (and unused leaves) can never overlap anything.
+	indexTree.assign( indexSize * 2, EmptySummary );
+	for (i = 0; i < (int32)blockIndex.size(); i++)
+	{
+		SetIndexLeaf( indexSize + i, blockIndex[ i ] );
+	}
+
+	for (i = indexSize - 1; i > 0; i--)
+	{
+		UpdateIndexNode( i );
+	}
+
+	pendingBlocks.clear();
+	validIndex = true;
+}
+
+// ---------------------------------------------------------------------------
+// Bring the index up to date, either by rebuilding it or by refreshing the
+// entries of the blocks which have changed since the last query.
+
+void EventList::UpdateIndex()
+{
+	if (!validIndex)
+	{
+		RebuildIndex();
+		return;
+	}
+
+	for (uint32 i = 0; i < pendingBlocks.size(); i++)
+	{
+		EventBlock	*b = pendingBlocks[ i ];
+		int32		node = indexSize + b->indexPos;
+
+		SetIndexLeaf( node, b );
+
+		if (b->count > 0)
+			lastStartTimes[ b->indexPos ] = b->ItemAddress( b->count - 1 )->Start();
+		else lastStartTimes[ b->indexPos ] = b->indexPos > 0 ? lastStartTimes[ b->indexPos - 1 ] : LONG_MIN;
+
+			// The empty blocks which follow inherit the new time, or the
+			// list of times would no longer be sorted.
+		for (int32 j = b->indexPos + 1; j < (int32)blockIndex.size() && blockIndex[ j ]->count == 0; j++)
+		{
+			lastStartTimes[ j ] = lastStartTimes[ b->indexPos ];
+		}
+
+		for (node >>= 1; node > 0; node >>= 1)
+		{
+			UpdateIndexNode( node );
 		}
-		fromStart = 1;
+		b->indexPending = false;
 	}
+	pendingBlocks.clear();
+}
 
-	if (goodBlock == NULL) Last();
-	else
+// ---------------------------------------------------------------------------
+// Set a leaf of the index tree from the summary data of its block
+
+void EventList::SetIndexLeaf( int32 inLeaf, EventBlock *b )
+{
+	Summary		&leaf = indexTree[ inLeaf ];
+
+	if (b->count > 0)
+	{
+		if (!b->validSummaryData) b->Summarize();
+		leaf.maxStopTime = b->maxStopTime;
+		leaf.selectCount = b->selectCount;
+		leaf.minSelectTime = b->minSelectTime;
+		leaf.maxSelectTime = b->maxSelectTime;
+		leaf.endTime = b->endTime;
+	}
+	else leaf = EmptySummary;
+}
+
+// ---------------------------------------------------------------------------
+// Recalculate a node of the index tree from its children
+
+void EventList::UpdateIndexNode( int32 inNode )
+{
+	Summary			&node = indexTree[ inNode ];
+	const Summary	&left = indexTree[ inNode * 2 ],
+					&right = indexTree[ inNode * 2 + 1 ];
+
+	node.maxStopTime = MAX( left.maxStopTime, right.maxStopTime );
+	node.selectCount = left.selectCount + right.selectCount;
+	node.minSelectTime = MIN( left.minSelectTime, right.minSelectTime );
+	node.maxSelectTime = MAX( left.maxSelectTime, right.maxSelectTime );
+	node.endTime = (left.endTime > 0) ? left.endTime : right.endTime;
+}
+
+// ---------------------------------------------------------------------------
+// Find the leftmost leaf at or after a position which stops at or after
+// the given time.
+
+int32 EventList::FindIndexLeaf(
+	int32		inNode,
+	int32		inLow,
+	int32		inHigh,
+	int32		inFromPos,
+	long		inTime ) const
+{
+		// Skip subtrees which are entirely before the start position,
+		// or which have nothing reaching the time we are looking for.
+	if (inHigh <= inFromPos || indexTree[ inNode ].maxStopTime < inTime) return -1;
+	if (inHigh - inLow == 1) return inLow;
+
+	int32		mid = (inLow + inHigh) / 2,
+				leaf;
+
+	leaf = FindIndexLeaf( inNode * 2, inLow, mid, inFromPos, inTime );
+	if (leaf < 0) leaf = FindIndexLeaf( inNode * 2 + 1, mid, inHigh, inFromPos, inTime );
+	return leaf;
+}
+
+// ---------------------------------------------------------------------------
+// Find the first block which has an event stopping at or after a given time
+
+EventBlock *EventList::FirstBlockStoppingAfter( long inTime, EventBlock *inFrom )
+{
+	EventBlock		*result = NULL;
+	int32			leaf;
+
+	indexLock.Lock();
+	UpdateIndex();
+
+	if (indexSize > 0 && !blockIndex.empty())
+	{
+		leaf = FindIndexLeaf( 1, 0, indexSize, inFrom ? inFrom->indexPos : 0, inTime );
+		if (leaf >= 0) result = blockIndex[ leaf ];
+	}
+
+	indexLock.Unlock();
+	return result;
+}
+
+// ---------------------------------------------------------------------------
+// Find the first block which has a selected event, by descending the index
+// tree towards the leftmost leaf with a selection
+
+EventBlock *EventList::FirstSelectedBlock()
+{
+	EventBlock		*result = NULL;
+
+	indexLock.Lock();
+	UpdateIndex();
+
+	if (indexSize > 0 && !blockIndex.empty() && indexTree[ 1 ].selectCount > 0)
 	{
-		const CEvent	*ev;
-		int16		i = fromStart ? 0 : index;
+		int32		node = 1;
 
-			// We found the correct block. Now, linearly search for the first
-			// item which has a time greater than or equal to the given time.
-			// (REM: Later we could speed this up by making a BSearch)
-		for (ev = goodBlock->ItemAddress( i ); i < goodBlock->count; i++, ev++)
+		while (node < indexSize)
 		{
-			if (ev->Start() >= time) break;
+			node *= 2;
+			if (indexTree[ node ].selectCount == 0) node++;
 		}
+		result = blockIndex[ node - indexSize ];
+	}
+
+	indexLock.Unlock();
+	return result;
+}
+
+// ---------------------------------------------------------------------------
+// Binary search for the first block whose last event starts at or after
+// a given time
+
+EventBlock *EventList::FirstBlockStartingAfter( long inTime, EventBlock *inFrom )
+{
+	EventBlock		*result = NULL;
+
+	indexLock.Lock();
+	UpdateIndex();
+
+	std::vector<long>::iterator	first = lastStartTimes.begin();
+	if (inFrom) first += inFrom->indexPos;
+
+	std::vector<long>::iterator	it = std::lower_bound( first, lastStartTimes.end(), inTime );
+	if (it != lastStartTimes.end()) result = blockIndex[ it - lastStartTimes.begin() ];
 
-			// Set the block and index within the block to point to
-			// the event we found.
-		SetBlock( goodBlock );
-		SetIndex( i );
+	indexLock.Unlock();
+	return result;
+}
+
+// ---------------------------------------------------------------------------
+// Set a marker at a given time
+
+const CEvent *EventMarker::SeekForwardToTime( long time, bool fromStart )
+{
+	EventList		*list = (EventList *)blockList;
+	EventBlock		*b;
+
+	if (list == NULL) return NULL;
+	if (!fromStart && block == NULL)
+	{
+		Last();
+		return NULL;
 	}
 
+		// Look for the first block who's last event has a time greater than
+		// or equal to the time we are searching for.
+	b = list->FirstBlockStartingAfter( time, fromStart ? NULL : (EventBlock *)block );
+	if (b == NULL)
+	{
+			// All events start before the time, so go to the end.
+		Last();
+		return NULL;
+	}
+
+		// We found the correct block. Now search it for the first item which
+		// has a time greater than or equal to the given time. If we're still
+		// in the block we started from, don't go backwards.
+	int16			i = b->FindStartTime( time, (!fromStart && b == block) ? index : 0 );
+
+		// Set the block and index within the block to point to
+		// the event we found.
+	SetBlock( b );
+	SetIndex( i );
+
 	return (CEvent *)item;
 }
 
@@ -132,24 +430,17 @@ const CEvent *EventMarker::SkipItemsNotInRange( long minTime, long maxTime )
 			// block) overlap the search range.
 		if (index == 0)
 		{
-			for (;;)
-			{
-					// Since blocks are sorted by minTime, we need search
-					// no further if we find a block later than the range
-					// specified.
-				if (	(b == NULL)
-					||	(b->MinTime() > maxTime) ) return NULL;
-
-					// If we find a block where all events in the block
-					// terminate earlier than the minTime, then we need
-					// not look at it.
-				if (b->MaxTime() < minTime)
-				{
-					b = (EventBlock *)b->Next();
-					if (b == NULL) return NULL;
-				}
-				else break;
-			}
+				// If all events in the block terminate earlier than the
+				// minTime, then we need not look at it. Use the block index
+				// to jump straight to the next block that might overlap.
+			if (b != NULL && b->MaxTime() < minTime)
+				b = ((EventList *)blockList)->FirstBlockStoppingAfter( minTime, b );
+
+				// Since blocks are sorted by minTime, we need search
+				// no further if we find a block later than the range
+				// specified.
+			if (	(b == NULL)
+				||	(b->MinTime() > maxTime) ) return NULL;
 		}
 
 			// Scan through all the items in the block, looking for ones
@@ -192,7 +483,21 @@ const CEvent *EventMarker::SkipItemsNotInRange( long minTime, long maxTime )
 
 const CEvent *EventMarker::FirstItemInRange( long minTime, long maxTime )
 {
-	First();
+	EventBlock		*b;
+
+	if (blockList == NULL) return NULL;
+
+		// Start at the first block which reaches into the range, rather
+		// than at the head of the list.
+	b = ((EventList *)blockList)->FirstBlockStoppingAfter( minTime );
+	if (b == NULL)
+	{
+		Last();
+		return NULL;
+	}
+
+	SetBlock( b );
+	SetIndex( 0 );
 	return SkipItemsNotInRange( minTime, maxTime );
 }
 
@@ -245,6 +550,46 @@ void EventMarker::Modify( CEvent &newEvent, EventListUndoAction *inUndoAction )
 	}
 }
 
+// ---------------------------------------------------------------------------
+// The current event was changed in place, so the block has changed
+
+void EventMarker::ChangedInPlace()
+{
+	if (block != NULL) ((EventList *)blockList)->OnBlockChanged( block );
+}
+
+// ---------------------------------------------------------------------------
+// Select or deselect the event in place, and let the list know that the
+// block's summary has changed.
+
+void EventMarker::SetSelected( bool inSelected )
+{
+	CEvent			*ev = (CEvent *)Peek( 0 );
+
+	if (ev == NULL || ev->IsSelected() == inSelected) return;
+
+	ev->SetSelected( inSelected );
+	((EventList *)blockList)->InvalidateBlockSummary( (EventBlock *)block );
+}
+
+// ---------------------------------------------------------------------------
+// Seek to the first selected event in the list
+
+const CEvent *EventMarker::FirstSelected()
+{
+	EventBlock		*b = ((EventList *)blockList)->FirstSelectedBlock();
+
+	if (b == NULL) return NULL;
+
+	SetBlock( b );
+	for (SetIndex( 0 ); index < b->count; SetIndex( index + 1 ))
+	{
+		if (((CEvent *)item)->IsSelected()) return (CEvent *)item;
+	}
+
+	return NULL;
+}
+
 // ---------------------------------------------------------------------------
 // Merge a list of sorted events into the EventList, preserving the
 // order of items in the list.
@@ -412,6 +757,7 @@ bool EventList::AppendRawEvents(
 						
 							// Change the duration
 						(const_cast<CEvent *>(ev))->SetDuration( inEvents->Start() - ev->Start() );
+						matchPos.ChangedInPlace();
 						
 							// And we're done...
 						break;
@@ -647,29 +993,141 @@ long EventList::MaxTime( void )
 }
 
 // ---------------------------------------------------------------------------
-// EventList Undo function
+// Append sorted events to the end of the list. Blocks are only filled to
+// 7/8 of their capacity, so that editing a freshly loaded list doesn't
+// immediately split every block it touches.
 
-		/**	Apply this undo action. */
-void EventListUndoAction::Undo()
+void EventList::Append( CEvent *inEventArray, long inEventCount )
+{
+	ItemList_Base::Append( inEventArray, inEventCount, EventBlock::Cnt * 7 / 8 );
+}
+
+// ---------------------------------------------------------------------------
+// Calculate the summary data of every block which needs it, and rebuild the
+// block index in the same pass rather than waiting for the first query.
+
+void EventList::SummarizeAll( void )
 {
-	int32			maxTime = LONG_MIN,
-					minTime = LONG_MAX;
-	CEvent			*ev;
-	CUndoIterator	iter( sizeof *ev );
-					
-	for (ev = (CEvent *)iter.First( *this ); ev != NULL; ev = (CEvent *)iter.Next() )
+	for (EventBlock *b = FirstBlock(); b; b = b->Next() )
 	{
-		minTime = minTime < ev->Start() ? minTime : ev->Start();
-		maxTime = maxTime > ev->Stop() ? maxTime : ev->Stop();
+		if (!b->validSummaryData) b->Summarize();
 	}
 
-	ItemListUndoAction<CEvent>::Undo();
-	
-	for (ev = (CEvent *)iter.First( *this ); ev != NULL; ev = (CEvent *)iter.Next() )
+	indexLock.Lock();
+	UpdateIndex();
+	indexLock.Unlock();
+}
+
+// ---------------------------------------------------------------------------
+// Get the summary of the entire list from the root of the index tree
+
+void EventList::GetSummary( Summary &outSummary )
+{
+	indexLock.Lock();
+	UpdateIndex();
+
+	if (indexSize > 0 && !blockIndex.empty())
+		outSummary = indexTree[ 1 ];
+	else outSummary = EmptySummary;
+
+	indexLock.Unlock();
+}
+
+// ---------------------------------------------------------------------------
+// Read the events of the whole list, block by block
+
+void EventList::ReadBlocks( block_func inFunc, void *inData ) const
+{
+	for (EventBlock *b = FirstBlock(); b; b = b->Next() )
 	{
-		minTime = minTime < ev->Start() ? minTime : ev->Start();
-		maxTime = maxTime > ev->Stop() ? maxTime : ev->Stop();
+		if (b->count > 0)
+			inFunc( b->ItemAddress( 0 ), b->count, inData );
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Publish the current state of the list as the latest snapshot, sharing
+// the frozen copies of the blocks which haven't changed since the last one.
+
+void EventList::Publish()
+{
+	if (snapshot->Version() == editCount)
+	{
+		ReclaimSnapshots();
+		return;
+	}
+
+	CEventSnapshot	*s = new CEventSnapshot( editCount );
+
+	s->m_blocks.reserve( blockCount );
+	for (EventBlock *b = FirstBlock(); b; b = b->Next() )
+	{
+		if (b->count == 0) continue;
+
+		if (b->frozen == NULL)
+			b->frozen = CEventSnapshot::_freeze( b->ItemAddress( 0 ), b->count );
+		b->frozen->refCount++;
+		s->m_blocks.push_back( b->frozen );
+	}
+	s->m_count = count;
+
+		// Full barriers around the switch: the new snapshot has to be
+		// complete before readers can see it, and they have to see it
+		// before we look for readers of the old one.
+	atomic_add( &snapshotAcquires, 0 );
+	retiredSnapshots.push_back( (CEventSnapshot *)snapshot );
+	snapshot = s;
+	atomic_add( &snapshotAcquires, 0 );
+
+	ReclaimSnapshots();
+}
+
+// ---------------------------------------------------------------------------
+// Get the latest snapshot without locking. A reader which has read the
+// pointer, but not yet acquired the snapshot, is counted in
+// snapshotAcquires, so that it isn't freed under its feet.
+
+CEventSnapshot *EventList::AcquireSnapshot() const
+{
+	atomic_add( &snapshotAcquires, 1 );
+	CEventSnapshot	*s = snapshot;
+	s->Acquire();
+	atomic_add( &snapshotAcquires, -1 );
+
+	return s;
+}
+
+// ---------------------------------------------------------------------------
+// Free the retired snapshots which nobody reads anymore. While a reader is
+// acquiring a snapshot, it could be any of them, so wait for another time.
+
+void EventList::ReclaimSnapshots()
+{
+	if (atomic_get( &snapshotAcquires ) > 0) return;
+
+	size_t			kept = 0;
+
+	for (size_t i = 0; i < retiredSnapshots.size(); i++)
+	{
+		CEventSnapshot	*s = retiredSnapshots[i];
+
+		if (atomic_get( &s->m_readers ) == 0) delete s;
+		else retiredSnapshots[kept++] = s;
 	}
+	retiredSnapshots.resize( kept );
+}
+
+// ---------------------------------------------------------------------------
+// EventList Undo function
+
+		/**	Apply this undo action. */
+void EventListUndoAction::Undo()
+{
+	minTime = INT32_MAX;
+	maxTime = INT32_MIN;
+
+	ItemListUndoAction<CEvent>::Undo();
+	static_cast<EventList &>( list ).Publish();
 
 	CUpdateHint		hint;
 	if (maxTime >= minTime)
@@ -686,24 +1144,11 @@ void EventListUndoAction::Undo()
 		/**	Apply this redo action. */
 void EventListUndoAction::Redo()
 {
-	int32			maxTime = LONG_MIN,
-					minTime = LONG_MAX;
-	CEvent			*ev;
-	CUndoIterator	iter( sizeof *ev );
-					
-	for (ev = (CEvent *)iter.First( *this ); ev != NULL; ev = (CEvent *)iter.Next() )
-	{
-		minTime = minTime < ev->Start() ? minTime : ev->Start();
-		maxTime = maxTime > ev->Stop() ? maxTime : ev->Stop();
-	}
+	minTime = INT32_MAX;
+	maxTime = INT32_MIN;
 
 	ItemListUndoAction<CEvent>::Redo();
-	
-	for (ev = (CEvent *)iter.First( *this ); ev != NULL; ev = (CEvent *)iter.Next() )
-	{
-		minTime = minTime < ev->Start() ? minTime : ev->Start();
-		maxTime = maxTime > ev->Stop() ? maxTime : ev->Stop();
-	}
+	static_cast<EventList &>( list ).Publish();
 
 	CUpdateHint		hint;
 	if (maxTime >= minTime)
@@ -713,6 +1158,21 @@ void EventListUndoAction::Redo()
 	}
 	subject.PostUpdate( &hint );
 }
+
+// ---------------------------------------------------------------------------
+// Widen the time range to update by the events being undone or redone,
+// both as they were and as they become.
+
+void EventListUndoAction::OnItemsChanged( const void *inItems, long inItemCount )
+{
+	const CEvent	*ev = (const CEvent *)inItems;
+
+	for (long i = 0; i < inItemCount; i++, ev++)
+	{
+		minTime = minTime < ev->Start() ? minTime : ev->Start();
+		maxTime = maxTime > ev->Stop() ? maxTime : ev->Stop();
+	}
+}
 	
 
 #if DEBUG
@@ -759,7 +1219,58 @@ void WriteDeltaValue( CWriter &writer, unsigned long value )
 	}
 }
 
-unsigned long ReadDeltaValue( CReader &reader )
+// ---------------------------------------------------------------------------
+// Event data decoding. The decoding functions are templates, so that they can
+// read either from any CReader, or inline from memory when the reader can
+// hand out the data in place.
+
+	// Thrown when the event data in memory ends in the middle of an event.
+class EndOfEventData : public IError
+{
+public:
+	virtual	const char *Description() const
+		{ return "Event data is incomplete or corrupt"; }
+};
+
+	// Reads event data straight from memory.
+class EventDataCursor
+{
+	const uint8			*pos,
+						*end;
+
+public:
+	EventDataCursor( const void *inData, uint32 inLength )
+		: pos( (const uint8 *)inData ),
+		  end( (const uint8 *)inData + inLength )
+	{
+	}
+
+	uint32 BytesAvailable() const { return end - pos; }
+
+	void MustRead( void *buffer, int32 length )
+	{
+		if (length > end - pos) throw EndOfEventData();
+		memcpy( buffer, pos, length );
+		pos += length;
+	}
+
+	EventDataCursor &operator>>( uint8 &d )
+	{
+		if (pos >= end) throw EndOfEventData();
+		d = *pos++;
+		return *this;
+	}
+
+	EventDataCursor &operator>>( int8 &d )
+	{
+		if (pos >= end) throw EndOfEventData();
+		d = (int8)*pos++;
+		return *this;
+	}
+};
+
+template <class R>
+static inline unsigned long DecodeDeltaValue( R &reader )
 {
 	unsigned long		v = 0;
 	uint8				b = 0;
@@ -773,6 +1284,27 @@ unsigned long ReadDeltaValue( CReader &reader )
 	return v;
 }
 
+template <class R>
+static inline unsigned long DecodeFixed( R &reader, unsigned long maxVal )
+{
+	unsigned long		v = 0;
+	uint8				b = 0;
+	
+	while (maxVal != 0)
+	{
+		reader >> b;
+		v = (v << 7) | b;
+		maxVal >>= 7;
+	}
+	
+	return v;
+}
+
+unsigned long ReadDeltaValue( CReader &reader )
+{
+	return DecodeDeltaValue( reader );
+}
+
 void WriteFixed( CWriter &writer, unsigned long value, unsigned long maxVal )
 {
 	uint8	b[ 8 ];
@@ -793,17 +1325,7 @@ void WriteFixed( CWriter &writer, unsigned long value, unsigned long maxVal )
 
 unsigned long ReadFixed( CReader &reader, unsigned long maxVal )
 {
-	unsigned long		v = 0;
-	uint8				b = 0;
-	
-	while (maxVal != 0)
-	{
-		reader >> b;
-		v = (v << 7) | b;
-		maxVal >>= 7;
-	}
-	
-	return v;
+	return DecodeFixed( reader, maxVal );
 }
 
 void WriteEventList( CWriter &writer, EventList &inEvents )
@@ -886,7 +1408,7 @@ void WriteEventList( CWriter &writer, EventList &inEvents )
 			break;
 			
 		case EvtType_Tempo:								// change tempo event
-			WriteFixed( writer, ev->tempo.newTempo, ULONG_MAX);
+			WriteFixed( writer, ev->tempo.newTempo, UINT32_MAX);
 			break;
 
 		case EvtType_TimeSig:								// change time signature event
@@ -931,151 +1453,195 @@ void WriteEventList( CWriter &writer, EventList &inEvents )
 	}
 }
 
-void
-ReadEventList(
-	CReader &reader,
+// Number of events DecodeEventList decodes before appending them to the list
+const long READ_BATCH_SIZE = 1024;
+
+template <class R>
+static void
+DecodeEventList(
+	R &reader,
 	EventList &outEvents)
 {
 	int32 prevTime = 0;
 	bool skip = false;
-	
-	EventMarker	marker(outEvents);
-	marker.First();
-	marker.Track(ItemMarker_Base::Track_Next);
-	
-	while (reader.BytesAvailable() > 0)
-	{
-		uint8 byteRead;
-		unsigned long v = 0;
-
-		//	Special version of read-delta-value to deal with push-back
-		do
-		{
-			if (skip)
-				skip = false;
-			else
-				reader >> byteRead;
-			v = (v << 7) | (byteRead & 0x7f);
-		} while (byteRead & 0x80);
-		
-		prevTime += v;
-		CEvent ev;
-		ev.common.start = prevTime;
-		reader >> ev.common.command;
-		
-		int32 dataSize = 0;
-		if (ev.HasProperty(CEvent::Prop_Duration))
-		{
-			// Read the event's duration
-			ev.common.duration = ReadDeltaValue(reader);
-		}
-		else if (ev.HasProperty(CEvent::Prop_ExtraData))
-		{
-			// Read the event's extended data
-			ev.common.duration = 0;
-			dataSize = ReadDeltaValue(reader);
-			reader.MustRead(ev.ExtendedData(), ev.ExtendedDataSize());
-		}
-		else
-		{
-			// discard fake duration
-			ReadDeltaValue(reader);
-		}
 
-		if (ev.HasProperty(CEvent::Prop_Channel))
-			reader >> ev.common.vChannel;
+	// The events are stored sorted, so rather than inserting them one by
+	// one, decode a batch at a time into raw memory and move the batch to
+	// the end of the list
+	CEvent *batch = (CEvent *)malloc(READ_BATCH_SIZE * sizeof(CEvent));
+	long batchCount = 0;
 
-		switch (ev.Command())
+	try
+	{
+		while (reader.BytesAvailable() > 0)
 		{
-			case EvtType_Note:
-			{
-				reader >> ev.note.pitch >> ev.note.attackVelocity >> ev.note.releaseVelocity;
-				break;
-			}
-			case EvtType_ChannelATouch:
-			{
-				reader >> ev.aTouch.value;
-				ev.aTouch.updatePeriod = ReadFixed(reader, 0x3fff);
-				break;
-			}
-			case EvtType_PolyATouch:
-			{
-				reader >> ev.aTouch.pitch >> ev.aTouch.value;
-				break;
-			}
-			case EvtType_Controller:
-			{
-				reader	>> ev.controlChange.controller
-						>> ev.controlChange.MSB
-						>> ev.controlChange.LSB;
-				ev.controlChange.updatePeriod = ReadFixed( reader, 0x3fff );
-				break;
-			}
-			case EvtType_ProgramChange:
-			{
-				reader	>> ev.programChange.program
-						>> ev.programChange.bankMSB
-						>> ev.programChange.bankLSB
-						>> ev.programChange.vPos;
-				break;
-			}
-			case EvtType_PitchBend:
-			{
-				ev.pitchBend.targetBend = ReadFixed(reader, 0x3fff);
-				ev.pitchBend.startBend = ReadFixed(reader, 0x3fff);
-				ev.pitchBend.updatePeriod = ReadFixed(reader, 0x3fff);
-				break;
-			}
-			case EvtType_SysEx:
-			{
-				reader >> ev.sysEx.vPos;
-				ev.SetExtendedDataSize(dataSize);
-				break;
-			}
-			case EvtType_Text:
+			uint8 byteRead;
+			unsigned long v = 0;
+
+			//	Special version of read-delta-value to deal with push-back
+			do
 			{
-				reader >> ev.text.vPos >> ev.text.textType;
-				ev.SetExtendedDataSize(dataSize);
-				break;
-			}
-			case EvtType_Tempo:
+				if (skip)
+					skip = false;
+				else
+					reader >> byteRead;
+				v = (v << 7) | (byteRead & 0x7f);
+			} while (byteRead & 0x80);
+		
+			prevTime += v;
+			CEvent ev;
+			ev.common.start = prevTime;
+			reader >> ev.common.command;
+		
+			if (ev.HasProperty(CEvent::Prop_Duration))
 			{
-				ev.tempo.newTempo = ReadFixed(reader, ULONG_MAX);
-				break;
+				// Read the event's duration
+				ev.common.duration = DecodeDeltaValue(reader);
 			}
-			case EvtType_TimeSig:
+			else if (ev.HasProperty(CEvent::Prop_ExtraData))
 			{
-				reader >> ev.sigChange.vPos >> ev.sigChange.numerator >> ev.sigChange.denominator;
-				break;
+				// Read the event's extended data
+				ev.common.duration = 0;
+				ev.sysEx.extData.Init();
+				ev.SetExtendedDataSize(DecodeDeltaValue(reader));
+				reader.MustRead(ev.ExtendedData(), ev.ExtendedDataSize());
 			}
-			case EvtType_Repeat:
+			else
 			{
-				reader >> ev.repeat.vPos;
-				ev.repeat.repeatCount = ReadFixed(reader, 0xffff);
-				break;
+				// discard fake duration
+				DecodeDeltaValue(reader);
 			}
-			case EvtType_Sequence:
+
+			if (ev.HasProperty(CEvent::Prop_Channel))
+				reader >> ev.common.vChannel;
+
+			switch (ev.Command())
 			{
-				reader	>> ev.sequence.vPos
-						>> ev.sequence.transposition
-						>> ev.sequence.flags;
-				ev.sequence.sequence = ReadFixed(reader, 0xffff);
-				break;
+				case EvtType_Note:
+				{
+					reader >> ev.note.pitch >> ev.note.attackVelocity >> ev.note.releaseVelocity;
+					break;
+				}
+				case EvtType_ChannelATouch:
+				{
+					reader >> ev.aTouch.value;
+					ev.aTouch.updatePeriod = DecodeFixed(reader, 0x3fff);
+					break;
+				}
+				case EvtType_PolyATouch:
+				{
+					reader >> ev.aTouch.pitch >> ev.aTouch.value;
+					break;
+				}
+				case EvtType_Controller:
+				{
+					reader	>> ev.controlChange.controller
+							>> ev.controlChange.MSB
+							>> ev.controlChange.LSB;
+					ev.controlChange.updatePeriod = DecodeFixed( reader, 0x3fff );
+					break;
+				}
+				case EvtType_ProgramChange:
+				{
+					reader	>> ev.programChange.program
+							>> ev.programChange.bankMSB
+							>> ev.programChange.bankLSB
+							>> ev.programChange.vPos;
+					break;
+				}
+				case EvtType_PitchBend:
+				{
+					ev.pitchBend.targetBend = DecodeFixed(reader, 0x3fff);
+					ev.pitchBend.startBend = DecodeFixed(reader, 0x3fff);
+					ev.pitchBend.updatePeriod = DecodeFixed(reader, 0x3fff);
+					break;
+				}
+				case EvtType_SysEx:
+				{
+					reader >> ev.sysEx.vPos;
+					break;
+				}
+				case EvtType_Text:
+				{
+					reader >> ev.text.vPos >> ev.text.textType;
+					break;
+				}
+				case EvtType_Tempo:
+				{
+					ev.tempo.newTempo = DecodeFixed(reader, UINT32_MAX);
+					break;
+				}
+				case EvtType_TimeSig:
+				{
+					reader >> ev.sigChange.vPos >> ev.sigChange.numerator >> ev.sigChange.denominator;
+					break;
+				}
+				case EvtType_Repeat:
+				{
+					reader >> ev.repeat.vPos;
+					ev.repeat.repeatCount = DecodeFixed(reader, 0xffff);
+					break;
+				}
+				case EvtType_Sequence:
+				{
+					reader	>> ev.sequence.vPos
+							>> ev.sequence.transposition
+							>> ev.sequence.flags;
+					ev.sequence.sequence = DecodeFixed(reader, 0xffff);
+					break;
+				}
+				default:
+				{
+					// Skip over any bytes with high bit clear.
+					// Set the skip flag so that next byte will be read
+					do
+					{
+						reader >> byteRead;
+					} while (!(byteRead & 0x80));
+					skip = true;
+					break;
+				}
 			}
-			default:
+
+			new (&batch[batchCount++]) CEvent(ev);
+			if (batchCount == READ_BATCH_SIZE)
 			{
-				// Skip over any bytes with high bit clear.
-				// Set the skip flag so that next byte will be read
-				do
-				{
-					reader >> byteRead;
-				} while (!(byteRead & 0x80));
-				skip = true;
-				break;
+				outEvents.Append(batch, batchCount);
+				batchCount = 0;
 			}
 		}
+	}
+	catch (...)
+	{
+		// Keep the events read so far, as inserting them one by one did
+		outEvents.Append(batch, batchCount);
+		outEvents.SummarizeAll();
+		free(batch);
+		throw;
+	}
+
+	outEvents.Append(batch, batchCount);
+	outEvents.SummarizeAll();
+	free(batch);
+}
 
-		marker.Insert(&ev, 1, NULL);
+void
+ReadEventList(
+	CReader &reader,
+	EventList &outEvents)
+{
+	// If the reader has the data in memory already (e.g. a mapped file),
+	// decode straight from there
+	uint32 length = reader.BytesAvailable();
+	const void *data = reader.View(length);
+	if (data != NULL)
+	{
+		EventDataCursor cursor(data, length);
+		DecodeEventList(cursor, outEvents);
+	}
+	else
+	{
+		DecodeEventList(reader, outEvents);
 	}
 }
 
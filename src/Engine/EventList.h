@@ -39,8 +39,15 @@
 #define __C_EventList_H__
 
 #include "Event.h"
+#include "EventSnapshot.h"
 #include "ItemList.h"
 
+// Support Kit
+#include <Locker.h>
+
+// Standard Template Library
+#include <vector>
+
 class CReader;
 class CWriter;
 class CObservable;
@@ -68,6 +75,16 @@ private:
 	uint32				lastTSigTime;			// time of last time signature
 	TimeSig				lastTSigValue;			// value of last time signature
 
+		// Summary of the selected events in the block: how many there are,
+		// the start of the first and the latest stop time of any of them.
+	int16				selectCount;
+	long				minSelectTime;
+	long				maxSelectTime;
+
+		// Time of the first 'end' event in the block (which sets the logical
+		// length of a track), or -1 if there isn't any.
+	long				endTime;
+
 		// The summary data listed above is evaluated in a lazy fashion. Each
 		// time we modify the data in the block, validSummaryData is set to
 		// false. Whenever we attempt to access the summary data, it will recalculate
@@ -75,16 +92,33 @@ private:
 
 	bool				validSummaryData;
 
+		// Position of this block in the owning list's block index, and
+		// whether the index entry for it is waiting to be refreshed.
+	int32				indexPos;
+	bool				indexPending;
+
+		// The frozen copy of the block in the latest published snapshot,
+		// or NULL if the block has changed since. It stays valid as long
+		// as that snapshot is the latest.
+	CEventSnapshot::block	*frozen;
+
 // Operations
 	EventBlock *Next( void ) const { return (EventBlock *)ItemBlock_Base::Next(); }
 	EventBlock *Prev( void ) const { return (EventBlock *)ItemBlock_Base::Prev(); }
 
 	void Summarize( void );
 
+		// Binary search for the first item at or after inFrom which starts
+		// at or after the given time. Returns count if there is none.
+	int16 FindStartTime( long inTime, int16 inFrom = 0 ) const;
+
 		// Private constructor
 	EventBlock()
 	{
 		validSummaryData = false;
+		indexPos = -1;
+		indexPending = false;
+		frozen = NULL;
 	}
 
 public:
@@ -121,6 +155,10 @@ class EventList : public ItemList<EventBlock,CEvent> {
 		// Destroy items
 	virtual void DestroyItems( void *outDst, long inItemCount );
 
+		// Events own data only if they have extended data
+	virtual bool IsPlainItem( const void *inItem ) const
+		{ return !((const CEvent *)inItem)->HasProperty( CEvent::Prop_ExtraData ); }
+
 
 	EventBlock *FirstBlock( void ) const
 		{ return (EventBlock *)ItemList<EventBlock,CEvent>::FirstBlock(); }
@@ -130,15 +168,104 @@ class EventList : public ItemList<EventBlock,CEvent> {
 
 		// Notifies subclasses that a block has changed. This can be used in case
 		// of extra information associated with a block that needs to be changed.
-	void OnBlockChanged( ItemBlock_Base *inChangedBlock )
+	void OnBlockChanged( ItemBlock_Base *inChangedBlock );
+
+		// Blocks were added or removed, so the block index must be rebuilt.
+	void OnBlockListChanged();
+
+		// The summary of a block is out of date, but its events are the
+		// same apart from their selection.
+	void InvalidateBlockSummary( EventBlock *inBlock );
+
+public:
+		/**	Summary of a range of events: the latest stop time of any event,
+			the selected events, and the first 'end' event. */
+	struct Summary
 	{
-		((EventBlock *)inChangedBlock)->validSummaryData = false;
-	}
+		long		maxStopTime;		// latest stop time (LONG_MIN if none)
+		int32		selectCount;		// number of selected events
+		long		minSelectTime;		// first selected start (LONG_MAX if none)
+		long		maxSelectTime;		// latest selected stop (LONG_MIN if none)
+		long		endTime;			// time of first 'end' event, or -1
+	};
+
+private:
+		// The block index is a segment tree over the blocks of the list
+		// (in list order), where each node summarizes the blocks below it.
+		// Since blocks are already sorted by their minimum time, the latest
+		// stop times let us find the first block that can overlap a range of
+		// time in O(log blocks) rather than walking the list from the head;
+		// the root summarizes the whole list, so the track summary doesn't
+		// need a pass over the events after every edit.
+		//
+		// The index is brought up to date lazily, when a range query needs
+		// it. Edits only happen under the track's write lock, but queries
+		// may come from several readers at once, hence the indexLock.
+	std::vector<EventBlock *>	blockIndex;		// blocks in list order
+	std::vector<Summary>		indexTree;		// tree of block summaries
+	std::vector<long>			lastStartTimes;	// start of last item in block
+	std::vector<EventBlock *>	pendingBlocks;	// blocks with stale entries
+	int32						indexSize;		// number of leaves in tree
+	bool						validIndex;		// false if rebuild needed
+	BLocker						indexLock;
+
+		// Counts the edits of the list, so that anything derived from its
+		// events can tell whether it is out of date.
+	uint32						editCount;
+
+		// The latest published snapshot, the older ones which may still
+		// be read, and the number of readers that are just acquiring the
+		// latest one (see AcquireSnapshot()).
+	CEventSnapshot * volatile	snapshot;
+	std::vector<CEventSnapshot *>	retiredSnapshots;
+	mutable volatile int32		snapshotAcquires;
+
+		// Free the retired snapshots which nobody reads anymore.
+	void ReclaimSnapshots();
+
+		// Make sure the index reflects the current state of the blocks.
+		// Must be called with the indexLock held.
+	void UpdateIndex();
+
+		// Rebuild the entire index from scratch.
+	void RebuildIndex();
+
+		// Set a leaf of the tree from the summary data of its block.
+	void SetIndexLeaf( int32 inLeaf, EventBlock *inBlock );
+
+		// Recalculate a node of the tree from its children.
+	void UpdateIndexNode( int32 inNode );
+
+		// Return the leftmost leaf at or after inFromPos whose subtree
+		// stops at or after inTime, or -1 if there is none.
+	int32 FindIndexLeaf(	int32 inNode, int32 inLow, int32 inHigh,
+						int32 inFromPos, long inTime ) const;
+
+		// Return the first block which has a selected event, or NULL.
+	EventBlock *FirstSelectedBlock();
+
+		// Return the first block at or after inFrom (or the first block in
+		// the list if inFrom is NULL) which has an event that stops at or
+		// after inTime.
+	EventBlock *FirstBlockStoppingAfter( long inTime, EventBlock *inFrom = NULL );
+
+		// Binary search for the first block at or after inFrom (or the first
+		// block in the list if inFrom is NULL) whose last event starts at or
+		// after inTime. Returns NULL if there is no such block.
+	EventBlock *FirstBlockStartingAfter( long inTime, EventBlock *inFrom = NULL );
 
 public:
+		// Constructor
+	EventList();
+		// Destructor
+	~EventList();
 		// The time of the latest event in the sequence
 	long MaxTime( void );
 
+		/**	Changes whenever events are added, removed or modified, but not
+			when only their selection changes. */
+	uint32 EditCount( void ) const { return editCount; }
+
 		// Merge a list of sorted events into the EventList
 	bool Merge( CEvent *inEventArray, long inEventCount, EventListUndoAction *inAction );
 
@@ -164,8 +291,38 @@ public:
 						EventListUndoAction *ioAction,
 						EventMarker &ioFirstUnmatchedEvent );
 
-		// Summarize entire sequence
-// void SummarizeAll( void );
+		/**	Append sorted events to the end of the list, filling the blocks
+			directly rather than inserting the events one at a time. None of
+			the events may start before the last event already in the list.
+			The events are moved into the list, so the caller must release
+			the array's memory without destructing them. No undo is saved. */
+	void Append( CEvent *inEventArray, long inEventCount );
+
+		// Summarize entire sequence, and bring the block index up to date
+	void SummarizeAll( void );
+
+		/**	Get the summary of the entire list. This only summarizes the
+			blocks which have changed since the last call. */
+	void GetSummary( Summary &outSummary );
+
+		/**	Function which receives the events of one block. */
+	typedef void (*block_func)( const CEvent *inEvents, long inCount, void *inData );
+
+		/**	Hand the events of each block to inFunc, in the order of the
+			list, so that the whole list can be read without the overhead
+			of a marker. The list must not be modified meanwhile. */
+	void ReadBlocks( block_func inFunc, void *inData ) const;
+
+		/**	Make the current state of the list the latest snapshot, unless
+			it hasn't been edited since the last time. Only the blocks which
+			have changed are copied. Must be called by the editor, with the
+			list locked for writing. */
+	void Publish( void );
+
+		/**	Return the latest published snapshot, which the caller has to
+			Release(). This never locks or waits, so it may be called while
+			the list is being edited. */
+	CEventSnapshot *AcquireSnapshot( void ) const;
 
 #if DEBUG
 	void Validate();
@@ -191,9 +348,22 @@ public:
 		/**	COpy constructor */
 	EventMarker( const EventMarker &r ) : ItemMarker<EventBlock,CEvent>( r ) {}
 
-		/**	Sets the marker at a given time. */
+		/**	Sets the marker to the first event which starts at or after the
+			given time. If fromStart is false, only events at or after the
+			current position are considered. Uses a binary search, both
+			across the blocks of the list and within the block. */
 	const CEvent *SeekForwardToTime( long time, bool fromStart = 1 );
 
+		/**	Sets the marker to the first event in the list which starts at
+			or after the given time. */
+	const CEvent *SeekToTime( long time ) { return SeekForwardToTime( time, true ); }
+
+		/**	Must be called after the current event has been changed in
+			place, rather than with Replace(), so that the change is
+			published to the player (see EventList::Publish()). Changes
+			of the selection don't need this. */
+	void ChangedInPlace( void );
+
 		/**	Skip this block, and seek to the start of the next one.
 			Used mainly for operating on summary data. */
 	CEvent *NextBlock( void );
@@ -220,6 +390,14 @@ public:
 		/**	Replace the event with new data, and re-sort if needed. */
 	void Modify( CEvent &newEvent, EventListUndoAction *inUndoAction );
 
+		/**	Select or deselect the current event in place. Unlike changing
+			the event directly, this keeps the summary of the list valid. */
+	void SetSelected( bool inSelected );
+
+		/**	Sets the marker to the first selected event in the list, and
+			returns it, or NULL if no event is selected. */
+	const CEvent *FirstSelected( void );
+
 		/**	Return const pointer to event. */
 	operator ConstEventPtr()	{ return Peek( 0 ); }
 };
@@ -228,9 +406,14 @@ class EventListUndoAction : public ItemListUndoAction<CEvent> {
 	const char			*description;
 	CObservable	&subject;
 
+		// Time range of the events changed by an undo or redo
+	int32				minTime,
+						maxTime;
+
 	const char *Description() const { return description; }
 	void Undo();
 	void Redo();
+	void OnItemsChanged( const void *inItems, long inItemCount );
 
 public:
 	EventListUndoAction( EventList &inList, CObservable &inSubject, const char *inDescription )
@@ -238,6 +421,8 @@ public:
 		  subject( inSubject )
 	{
 		description = inDescription;
+		minTime = INT32_MAX;
+		maxTime = INT32_MIN;
 	}
 };
 
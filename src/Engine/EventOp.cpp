@@ -4,7 +4,6 @@
 
 #include "EventOp.h"
 
-#include "MeVPlugin.h"
 #include "StdEventOps.h"
 #include "MathUtils.h"
 #include <stdio.h>
@@ -14,11 +13,6 @@ EventOp::EventOp( MeVPlugIn *inCreator )
 	creator = inCreator;
 }
 
-const char *EventOp::CreatorName() const
-{
-	return creator ? creator->Name() : "MeV";
-}
-
 // ---------------------------------------------------------------------------
 // A null operation
 
@@ -0,0 +1,96 @@
+/* ===================================================================== *
+ * EventSink.h (MeV/Engine)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s):
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ *  Receives the events of an offline rendering
+ * ===================================================================== */
+
+#ifndef __C_EventSink_H__
+#define __C_EventSink_H__
+
+#include "Event.h"
+
+// Standard Template Library
+#include <vector>
+
+/**
+ *	Takes the events a playback task group plays while rendering
+ *	offline (see CPlayerControl::RenderSong()), instead of the
+ *	destinations. The events are handed over in the order they are
+ *	played, after they have been filtered, repeated and transposed,
+ *	with notes split into note-on and note-off events and pitch bend
+ *	sweeps split into single pitch bends, just as the destinations
+ *	would get them.
+ *	@package	Engine
+ */
+class CEventSink
+{
+
+public:							// Constructor/Destructor
+
+	virtual						~CEventSink()
+								{ }
+
+public:							// Hook Functions
+
+	/**	Called for every event played. The event's destination is
+	 *	in its common.destination field; realTime and meteredTime
+	 *	are the clock times at which it is played.
+	 */
+	virtual void				Execute(
+									const CEvent &event,
+									long realTime,
+									long meteredTime) = 0;
+};
+
+/**
+ *	Keeps the rendered events in memory. Their start times are
+ *	replaced by the real times at which they were played.
+ *	@package	Engine
+ */
+class CEventBuffer
+	:	public CEventSink
+{
+
+public:							// Accessors
+
+	const std::vector<CEvent> &	Events() const
+								{ return m_events; }
+
+public:							// CEventSink Implementation
+
+	virtual void				Execute(
+									const CEvent &event,
+									long realTime,
+									long meteredTime)
+								{
+									m_events.push_back(event);
+									m_events.back().SetStart(realTime);
+								}
+
+private:						// Instance Data
+
+	std::vector<CEvent>			m_events;
+};
+
+#endif /* __C_EventSink_H__ */
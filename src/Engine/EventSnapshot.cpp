@@ -0,0 +1,279 @@
+/* ===================================================================== *
+ * EventSnapshot.cpp (MeV/Engine)
+ * ===================================================================== */
+
+#include "EventSnapshot.h"
+
+#include "EventList.h"
+
+// Standard C Library
+#include <stdlib.h>
+// Standard C++ Library
+#include <new>
+// Support Kit
+#include <Debug.h>
+
+// Debugging Macros
+#define D_ALLOC(x) //PRINT(x)			// Constructor/Destructor
+#define D_OPERATION(x) //PRINT(x)		// Operations
+
+// ---------------------------------------------------------------------------
+// CEventSnapshot: Constructor/Destructor
+
+CEventSnapshot::CEventSnapshot(
+	uint32 version)
+	:	m_version(version),
+		m_count(0),
+		m_readers(0)
+{
+	D_ALLOC(("CEventSnapshot::CEventSnapshot(%lu)\n", version));
+}
+
+CEventSnapshot::~CEventSnapshot()
+{
+	D_ALLOC(("CEventSnapshot::~CEventSnapshot()\n"));
+
+	ASSERT(m_readers == 0);
+	for (size_t i = 0; i < m_blocks.size(); i++)
+	{
+		if (--m_blocks[i]->refCount == 0)
+			_free(m_blocks[i]);
+	}
+}
+
+// ---------------------------------------------------------------------------
+// CEventSnapshot: Accessors
+
+int32
+CEventSnapshot::FindBlock(
+	long time) const
+{
+	int32 low = 0;
+	int32 high = m_blocks.size();
+	while (low < high)
+	{
+		int32 mid = (low + high) / 2;
+		const block *b = m_blocks[mid];
+		if (b->Events()[b->count - 1].Start() < time)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+// ---------------------------------------------------------------------------
+// CEventSnapshot: Internal Operations
+
+CEventSnapshot::block *
+CEventSnapshot::_freeze(
+	const CEvent *events,
+	int32 count)
+{
+	block *frozen = (block *)malloc(sizeof(block) + count * sizeof(CEvent));
+	if (frozen == NULL)
+		throw std::bad_alloc();
+
+	frozen->refCount = 0;
+	frozen->count = count;
+	CEvent *copy = (CEvent *)frozen->Events();
+	for (int32 i = 0; i < count; i++)
+		new (copy + i) CEvent(events[i]);
+
+	return frozen;
+}
+
+void
+CEventSnapshot::_free(
+	block *frozen)
+{
+	CEvent *events = (CEvent *)frozen->Events();
+	for (int32 i = 0; i < frozen->count; i++)
+		events[i].~CEvent();
+	free(frozen);
+}
+
+// ---------------------------------------------------------------------------
+// CEventSnapshotMarker: Constructor/Destructor
+
+CEventSnapshotMarker::CEventSnapshotMarker()
+	:	m_snapshot(NULL),
+		m_block(0),
+		m_index(0)
+{
+}
+
+CEventSnapshotMarker::CEventSnapshotMarker(
+	const CEventSnapshotMarker &other)
+	:	m_snapshot(other.m_snapshot),
+		m_block(other.m_block),
+		m_index(other.m_index)
+{
+	if (m_snapshot != NULL)
+		m_snapshot->Acquire();
+}
+
+CEventSnapshotMarker::~CEventSnapshotMarker()
+{
+	Clear();
+}
+
+CEventSnapshotMarker &
+CEventSnapshotMarker::operator=(
+	const CEventSnapshotMarker &other)
+{
+	_set(other.m_snapshot, other.m_block, other.m_index);
+	return *this;
+}
+
+// ---------------------------------------------------------------------------
+// CEventSnapshotMarker: Accessors
+
+const CEvent *
+CEventSnapshotMarker::Current() const
+{
+	if ((m_snapshot == NULL) || (m_block >= m_snapshot->CountBlocks()))
+		return NULL;
+
+	return m_snapshot->BlockAt(m_block)->Events() + m_index;
+}
+
+// ---------------------------------------------------------------------------
+// CEventSnapshotMarker: Operations
+
+void
+CEventSnapshotMarker::Update(
+	const EventList &list)
+{
+	D_OPERATION(("CEventSnapshotMarker::Update()\n"));
+
+	CEventSnapshot *latest = list.AcquireSnapshot();
+	if (latest == m_snapshot)
+	{
+		latest->Release();
+		return;
+	}
+
+	const CEvent *ev = Current();
+	if (ev == NULL)
+	{
+		// stay at the end, or start at the beginning
+		int32 block = (m_snapshot != NULL) ? latest->CountBlocks() : 0;
+		_set(latest, block, 0);
+		latest->Release();
+		return;
+	}
+
+	// count the events before this one which start at the same time
+	long time = ev->Start();
+	int32 skip = 0;
+	CEventSnapshotMarker previous(*this);
+	while ((previous.m_block > 0) || (previous.m_index > 0))
+	{
+		if (previous.Seek(-1)->Start() != time)
+			break;
+		skip++;
+	}
+
+	_set(latest, 0, 0);
+	latest->Release();
+	for (ev = SeekToTime(time); (skip > 0) && (ev != NULL); skip--)
+	{
+		if (ev->Start() != time)
+			break;
+		ev = Seek(1);
+	}
+}
+
+void
+CEventSnapshotMarker::Clear()
+{
+	_set(NULL, 0, 0);
+}
+
+const CEvent *
+CEventSnapshotMarker::First()
+{
+	m_block = m_index = 0;
+	return Current();
+}
+
+const CEvent *
+CEventSnapshotMarker::Seek(
+	int32 offset)
+{
+	if (m_snapshot == NULL)
+		return NULL;
+
+	int32 blockCount = m_snapshot->CountBlocks();
+	for (; (offset > 0) && (m_block < blockCount); offset--)
+	{
+		if (++m_index >= m_snapshot->BlockAt(m_block)->count)
+		{
+			m_block++;
+			m_index = 0;
+		}
+	}
+	for (; offset < 0; offset++)
+	{
+		if (m_index > 0)
+			m_index--;
+		else if (m_block > 0)
+			m_index = m_snapshot->BlockAt(--m_block)->count - 1;
+		else
+			break;
+	}
+
+	return Current();
+}
+
+const CEvent *
+CEventSnapshotMarker::SeekToTime(
+	long time)
+{
+	if (m_snapshot == NULL)
+		return NULL;
+
+	m_block = m_snapshot->FindBlock(time);
+	m_index = 0;
+	if (m_block < m_snapshot->CountBlocks())
+	{
+		// the last event of the block starts at or after the time
+		const CEventSnapshot::block *b = m_snapshot->BlockAt(m_block);
+		int32 high = b->count - 1;
+		while (m_index < high)
+		{
+			int32 mid = (m_index + high) / 2;
+			if (b->Events()[mid].Start() < time)
+				m_index = mid + 1;
+			else
+				high = mid;
+		}
+	}
+
+	return Current();
+}
+
+// ---------------------------------------------------------------------------
+// CEventSnapshotMarker: Internal Operations
+
+void
+CEventSnapshotMarker::_set(
+	CEventSnapshot *snapshot,
+	int32 block,
+	int32 index)
+{
+	if (snapshot != m_snapshot)
+	{
+		if (snapshot != NULL)
+			snapshot->Acquire();
+		if (m_snapshot != NULL)
+			m_snapshot->Release();
+		m_snapshot = snapshot;
+	}
+	m_block = block;
+	m_index = index;
+}
+
+// END - EventSnapshot.cpp
@@ -0,0 +1,217 @@
+/* ===================================================================== *
+ * EventSnapshot.h (MeV/Engine)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s):
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ *  Immutable versions of an event list, for reading without locking
+ * ---------------------------------------------------------------------
+ * To Do:
+ *
+ * ===================================================================== */
+
+#ifndef __C_EventSnapshot_H__
+#define __C_EventSnapshot_H__
+
+#include "Event.h"
+
+// Standard Template Library
+#include <vector>
+
+class EventList;
+
+/**	A version of the events of an EventList, as it was when the list
+	was last published (see EventList::Publish()). A snapshot never
+	changes, so it can be read without locking the track while the
+	next version is being edited.
+
+	Snapshots are made of frozen copies of the blocks of the list. A
+	block is only copied when it has changed since the last version
+	was published; the other blocks are shared with that version.
+
+	Readers get the latest snapshot from EventList::AcquireSnapshot(),
+	which doesn't lock or wait, and give it back with Release(). The
+	list frees old snapshots once nobody reads them anymore, when it
+	publishes the next one, so readers never free anything.
+	@package	Engine
+ */
+class CEventSnapshot
+{
+	friend class EventList;
+
+public:							// Types
+
+	/**	The frozen events of a block. Since blocks are shared between
+		snapshots, only the list changes refCount, while publishing.
+	 */
+	struct block
+	{
+		int32					refCount;
+		int32					count;
+
+		const CEvent *			Events() const
+								{ return (const CEvent *)(this + 1); }
+	};
+
+public:							// Accessors
+
+	/**	The edit count of the list at the time it was published (see
+		EventList::EditCount()).
+	 */
+	uint32						Version() const
+								{ return m_version; }
+
+	int32						CountEvents() const
+								{ return m_count; }
+
+	int32						CountBlocks() const
+								{ return m_blocks.size(); }
+
+	const block *				BlockAt(
+									int32 index) const
+								{ return m_blocks[index]; }
+
+	/**	Returns the index of the first block whose last event starts
+		at or after the given time, or CountBlocks() if there is none.
+	 */
+	int32						FindBlock(
+									long time) const;
+
+public:							// Operations
+
+	/**	Keep the snapshot from being freed. Doesn't lock. */
+	void						Acquire()
+								{ atomic_add(&m_readers, 1); }
+
+	void						Release()
+								{ atomic_add(&m_readers, -1); }
+
+private:						// Constructor/Destructor
+
+								CEventSnapshot(
+									uint32 version);
+
+	/** Releases the blocks. */
+								~CEventSnapshot();
+
+private:						// Internal Operations
+
+	/**	Returns a frozen copy of the given events, with a refCount of
+		zero.
+	 */
+	static block *				_freeze(
+									const CEvent *events,
+									int32 count);
+
+	static void					_free(
+									block *frozen);
+
+private:						// Instance Data
+
+	uint32						m_version;
+
+	int32						m_count;
+
+	std::vector<block *>		m_blocks;
+
+	/** Number of readers which currently hold the snapshot. */
+	volatile int32				m_readers;
+};
+
+/**	A position in a snapshot, which keeps the snapshot from being
+	freed. When it is moved to a newer version of the list with
+	Update(), it stays in front of the same event, or in front of
+	the event that has taken its place.
+	@package	Engine
+ */
+class CEventSnapshotMarker
+{
+
+public:							// Constructor/Destructor
+
+								CEventSnapshotMarker();
+
+								CEventSnapshotMarker(
+									const CEventSnapshotMarker &other);
+
+								~CEventSnapshotMarker();
+
+	CEventSnapshotMarker &		operator=(
+									const CEventSnapshotMarker &other);
+
+public:							// Accessors
+
+	CEventSnapshot *			Snapshot() const
+								{ return m_snapshot; }
+
+	/**	Returns the event at the marker, or NULL at the end of the
+		snapshot.
+	 */
+	const CEvent *				Current() const;
+
+								operator const CEvent *() const
+								{ return Current(); }
+
+public:							// Operations
+
+	/**	Moves the marker to the latest published version of the list,
+		without locking it. Nothing happens if it is already there. If
+		the marker hasn't been in a snapshot so far, it is placed on
+		the first event.
+	 */
+	void						Update(
+									const EventList &list);
+
+	/**	Lets go of the snapshot. */
+	void						Clear();
+
+	const CEvent *				First();
+
+	/** Moves the marker by the given number of events, and returns
+		the event it ends up at. If that would be before the first
+		event, the marker stays at the first event.
+	 */
+	const CEvent *				Seek(
+									int32 offset);
+
+	/**	Moves the marker to the first event which starts at or after
+		the given time, using a binary search.
+	 */
+	const CEvent *				SeekToTime(
+									long time);
+
+private:						// Internal Operations
+
+	void						_set(
+									CEventSnapshot *snapshot,
+									int32 block,
+									int32 index);
+
+private:						// Instance Data
+
+	CEventSnapshot *			m_snapshot;
+
+	int32						m_block;
+
+	int32						m_index;
+};
+
+#endif /* __C_EventSnapshot_H__ */
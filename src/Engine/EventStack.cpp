@@ -4,34 +4,46 @@
 
 #include "EventStack.h"
 
-#include "Player.h"
+#include "PlayerStatistics.h"
 
+// Gnu C Library
+#include <stdlib.h>
 // Support Kit
 #include <Debug.h>
+#include <Locker.h>
 
 // Debugging Macros
 #define D_ALLOC(x) //PRINT(x)		// Constructor/Destructor
 #define D_ACCESS(x) //PRINT(x)		// Accessors
 #define D_OPERATION(x) //PRINT(x)	// Operations
+#define D_INTERNAL(x) //PRINT(x)	// Internal Operations
 
 // ---------------------------------------------------------------------------
 // Constructor/Destructor
 
 CEventStack::CEventStack(
 	long capacity)
+	:	m_stack(NULL),
+		m_order(NULL),
+		m_count(0),
+		m_capacity(0),
+		m_maxCount(0),
+		m_nextOrder(0),
+		m_statistics(NULL),
+		m_lock(NULL)
 {
 	D_ALLOC(("CEventStack::CEventStack(%ld)\n", capacity));
 
-	m_stack = new CEvent[capacity];
-	m_current = m_stack;
-	m_max = &m_stack[capacity];
+	_reserve(capacity);
 }
 
 CEventStack::~CEventStack()
 {
 	D_ALLOC(("CEventStack::~CEventStack()\n"));
-	
-	delete [] m_stack;
+
+	CEvent::Destruct(m_stack, m_count);
+	free(m_stack);
+	free(m_order);
 }
 
 // ---------------------------------------------------------------------------
@@ -42,7 +54,7 @@ CEventStack::Empty() const
 {
 	D_ACCESS(("CEventStack::Empty()\n"));
 
-	return m_current <= m_stack;
+	return m_count <= 0;
 }
 
 bool
@@ -51,17 +63,35 @@ CEventStack::NextTime(
 {
 	D_ACCESS(("CEventStack::NextTime()\n"));
 
-	thePlayer.CheckLock();
+	_checkLock();
 
 	// If stack has no items, then nothing to pop
-	if (m_current <= m_stack)
+	if (m_count <= 0)
 		return false;
 
 	// return the time of the next item
-	*outTime = m_current[-1].stack.start;
+	*outTime = m_stack[0].stack.start;
 	return true;
 }
 
+void
+CEventStack::SetStatistics(
+	CPlayerStatistics *statistics)
+{
+	D_ACCESS(("CEventStack::SetStatistics()\n"));
+
+	m_statistics = statistics;
+}
+
+void
+CEventStack::SetLock(
+	BLocker *lock)
+{
+	D_ACCESS(("CEventStack::SetLock()\n"));
+
+	m_lock = lock;
+}
+
 // ---------------------------------------------------------------------------
 // Operations
 
@@ -71,25 +101,21 @@ CEventStack::Push(
 {
 	D_OPERATION(("CEventStack::Push()\n"));
 
-	thePlayer.CheckLock();
+	_checkLock();
 
-	// if stack is full then bail
-	if (m_current >= m_max)
+	// if stack is full and can't be grown, then bail
+	if (!_reserve(m_count + 1))
+	{
+		if (m_statistics)
+			m_statistics->RecordStackOverflow();
 		return false;
+	}
 
-	// Insert event onto stack in time order
-
-	// While search pointer is greater than bottom of stack and the
-	// element being displaced is earlier, then bubble old event up
-	// and continue searching.
-	CEvent *search = m_current;
-	while ((search > m_stack) && IsTimeGreater(search[-1].stack.start, ev.stack.start))
-		search--;
-
-	if (search < m_current)
-		CEvent::Relocate(search + 1, search, m_current - search);
-	CEvent::Construct(search, &ev, 1);
-	m_current++;
+	// Add the event at the bottom of the heap, and move it up into place
+	CEvent::Construct(&m_stack[m_count], &ev, 1);
+	m_order[m_count] = m_nextOrder++;
+	_siftUp(m_count++);
+	_countChanged();
 
 	return true;
 }
@@ -101,26 +127,22 @@ CEventStack::Push(
 {
 	D_OPERATION(("CEventStack::Push(time)\n"));
 
-	thePlayer.CheckLock();
+	_checkLock();
 
-	// if stack is full then bail
-	if (m_current >= m_max)
+	// if stack is full and can't be grown, then bail
+	if (!_reserve(m_count + 1))
+	{
+		if (m_statistics)
+			m_statistics->RecordStackOverflow();
 		return false;
+	}
 
-	// Insert event onto stack in time order
-
-	// While search pointer is greater than bottom of stack and the
-	// element being displaced is earlier, then bubble old event up
-	// and continue searching.
-	CEvent *search = m_current;
-	while ((search > m_stack) && (time > search[-1].Start()))
-		search--;
-
-	if (search < m_current)
-		CEvent::Relocate(search + 1, search, m_current - search);
-	CEvent::Construct(search, &ev, 1);
-	search->SetStart(time);
-	m_current++;
+	// Add the event at the bottom of the heap, and move it up into place
+	CEvent::Construct(&m_stack[m_count], &ev, 1);
+	m_stack[m_count].SetStart(time.Milliseconds());
+	m_order[m_count] = m_nextOrder++;
+	_siftUp(m_count++);
+	_countChanged();
 
 	return true;
 }
@@ -133,11 +155,18 @@ CEventStack::PushList(
 {
 	D_OPERATION(("CEventStack::PushList()\n"));
 
-	thePlayer.CheckLock();
+	_checkLock();
 
-	if ((m_current + count) > m_max)
+	// Make room for all of them first, so that it's all or none
+	if (!_reserve(m_count + count))
+	{
+		if (m_statistics)
+			m_statistics->RecordStackOverflow();
 		return false;
+	}
 
+	// Push in reverse order, so that events with the same time
+	// come off the stack in list order.
 	list += count;
 	while (count--)
 	{
@@ -154,15 +183,14 @@ CEventStack::Pop(
 {
 	D_OPERATION(("CEventStack::Pop()\n"));
 
-	thePlayer.CheckLock();
+	_checkLock();
 
 	// If stack has no items, then nothing to pop
-	if (m_current <= m_stack)
+	if (m_count <= 0)
 		return false;
 
 	// pop one item and return it.
-	CEvent::Destruct(&ev, 1);
-	CEvent::Relocate(&ev, --m_current, 1);
+	_popTop(ev);
 
 	return true;
 }
@@ -174,55 +202,211 @@ CEventStack::Pop(
 {
 	D_OPERATION(("CEventStack::Pop(time)\n"));
 
-	thePlayer.CheckLock();
+	_checkLock();
 
 	// If stack has no items, or the top item is greater than the
 	// current time, then return nothing.
-	if ((m_current <= m_stack) || (time < m_current[-1].Start()))
+	if ((m_count <= 0) || (time < m_stack[0].Start()))
 		return false;
 
 	// pop one item and return it.
-	CEvent::Destruct(&ev, 1);
-	CEvent::Relocate(&ev, --m_current, 1);
+	_popTop(ev);
+
+	return true;
+}
+
+// ---------------------------------------------------------------------------
+// Internal Operations
+
+bool
+CEventStack::_before(
+	int32 a,
+	int32 b) const
+{
+	int32 timeA = m_stack[a].stack.start;
+	int32 timeB = m_stack[b].stack.start;
+
+	if (timeA != timeB)
+		return IsTimeGreater(timeA, timeB);
+
+	// Same time: the one pushed last comes off first
+	return IsTimeGreater(m_order[b], m_order[a]);
+}
+
+void
+CEventStack::_checkLock() const
+{
+	// Only checked in debug builds
+	ASSERT((m_lock == NULL) || m_lock->IsLocked());
+}
+
+bool
+CEventStack::_reserve(
+	int32 count)
+{
+	if (count <= m_capacity)
+		return true;
+
+	int32 capacity = (m_capacity > 0) ? m_capacity : 16;
+	while (capacity < count)
+		capacity *= 2;
+
+	D_INTERNAL(("CEventStack::_reserve(%ld): growing to %ld\n",
+				count, capacity));
+
+	// Events can be moved around in memory freely (see CEvent::Relocate)
+	CEvent *stack = (CEvent *)realloc((void *)m_stack,
+									  capacity * sizeof(CEvent));
+	if (stack == NULL)
+		return false;
+	m_stack = stack;
+
+	uint32 *order = (uint32 *)realloc(m_order, capacity * sizeof(uint32));
+	if (order == NULL)
+		return false;
+	m_order = order;
 
+	m_capacity = capacity;
 	return true;
 }
 
+void
+CEventStack::_countChanged()
+{
+	// Only report new highs, to keep the overhead down
+	if (m_count > m_maxCount)
+	{
+		m_maxCount = m_count;
+		if (m_statistics)
+			m_statistics->RecordStackDepth(m_count);
+	}
+}
+
+void
+CEventStack::_siftUp(
+	int32 index)
+{
+	while (index > 0)
+	{
+		int32 parent = (index - 1) / 2;
+		if (!_before(index, parent))
+			break;
+		_swap(index, parent);
+		index = parent;
+	}
+}
+
+void
+CEventStack::_siftDown(
+	int32 index)
+{
+	for (;;)
+	{
+		int32 child = index * 2 + 1;
+		if (child >= m_count)
+			break;
+		if ((child + 1 < m_count) && _before(child + 1, child))
+			child++;
+		if (!_before(child, index))
+			break;
+		_swap(index, child);
+		index = child;
+	}
+}
+
+void
+CEventStack::_swap(
+	int32 a,
+	int32 b)
+{
+	// Events can be swapped bitwise (see CEvent::Relocate)
+	uint8 temp[sizeof(CEvent)];
+	memcpy(temp, (void *)&m_stack[a], sizeof(CEvent));
+	CEvent::Relocate(&m_stack[a], &m_stack[b], 1);
+	memcpy((void *)&m_stack[b], temp, sizeof(CEvent));
+
+	uint32 order = m_order[a];
+	m_order[a] = m_order[b];
+	m_order[b] = order;
+}
+
+void
+CEventStack::_popTop(
+	CEvent &ev)
+{
+	CEvent::Destruct(&ev, 1);
+	CEvent::Relocate(&ev, &m_stack[0], 1);
+
+	// Move the last item to the top, and let it sink into place
+	if (--m_count > 0)
+	{
+		CEvent::Relocate(&m_stack[0], &m_stack[m_count], 1);
+		m_order[0] = m_order[m_count];
+		_siftDown(0);
+	}
+}
+
+void
+CEventStack::_rebuild()
+{
+	for (int32 i = m_count / 2 - 1; i >= 0; i--)
+		_siftDown(i);
+}
+
 // ---------------------------------------------------------------------------
 // CEventStackIterator Implementation
 
 CEventStackIterator::CEventStackIterator(
 	CEventStack &stack)
-	:	m_stack(stack)
+	:	m_read(0),
+		m_write(0),
+		m_stack(stack)
 {
-	m_read = m_write = m_stack.m_stack;
 }
 
 CEventStackIterator::~CEventStackIterator()
 {
-	if (m_read > m_stack.m_current)
-		m_read = m_stack.m_current;
-	if ((m_read > m_write) && (m_stack.m_current > m_read))
+	if (m_read > m_write)
 	{
-		CEvent::Relocate(m_write, m_read, m_stack.m_current - m_read);
-		m_stack.m_current = m_read;
+		// Close the gap left by the removed events
+		int32 remaining = m_stack.m_count - m_read;
+		if (remaining > 0)
+		{
+			CEvent::Relocate(&m_stack.m_stack[m_write],
+							 &m_stack.m_stack[m_read], remaining);
+			memmove(&m_stack.m_order[m_write], &m_stack.m_order[m_read],
+					remaining * sizeof(uint32));
+		}
+		m_stack.m_count = m_write + remaining;
+
+		// Removing events breaks the heap ordering
+		m_stack._rebuild();
 	}
 }
 
 CEvent *
 CEventStackIterator::Current() const
 {
-	return (m_read < m_stack.m_current) ? m_read : NULL;
+	return (m_read < m_stack.m_count) ? &m_stack.m_stack[m_read] : NULL;
+}
+
+uint32
+CEventStackIterator::CurrentOrder() const
+{
+	return (m_read < m_stack.m_count) ? m_stack.m_order[m_read] : 0;
 }
 
 bool
 CEventStackIterator::Next()
 {
-	if (m_read >= m_stack.m_current)
+	if (m_read >= m_stack.m_count)
 		return false;
 
 	if (m_read > m_write)
-		CEvent::Relocate(m_write, m_read, 1);
+	{
+		CEvent::Relocate(&m_stack.m_stack[m_write], &m_stack.m_stack[m_read], 1);
+		m_stack.m_order[m_write] = m_stack.m_order[m_read];
+	}
 
 	m_read++;
 	m_write++;
@@ -232,9 +416,9 @@ CEventStackIterator::Next()
 void
 CEventStackIterator::Remove()
 {
-	if (m_read < m_stack.m_current)
+	if (m_read < m_stack.m_count)
 	{
-		CEvent::Destruct(m_read, 1);
+		CEvent::Destruct(&m_stack.m_stack[m_read], 1);
 		m_read++;
 	}
 }
@@ -35,8 +35,18 @@
 #include "Event.h"
 #include "Time.h"
 
+class CPlayerStatistics;
+class BLocker;
+
 /**
  *	A prioritized stack of events, sorted by time.
+ *
+ *	The events are kept in a binary heap, so pushing and popping are
+ *	O(log n). Events with the same time are popped in the reverse order
+ *	in which they were pushed (as with the original sorted stack), which
+ *	e.g. makes sure that a zero-length note's note-on is executed before
+ *	its note-off. The capacity grows as needed, so events are never
+ *	dropped because the stack is full.
  *	@author Talin, Christopher Lenz
  */
 class CEventStack
@@ -47,7 +57,7 @@ public:							// Constructor/Destructor
 
 	/** Constructor.
 	 *	@param	capacity	Determines how many events the stack is able
-	 * 						to hold at a time. Default is 256.
+	 * 						to hold initially. Default is 256.
 	 */
 								CEventStack(
 									long capacity = 256);
@@ -60,13 +70,32 @@ public:							// Accessors
 	/** Test if stack empty. */
 	bool						Empty() const;
 
+	/** Return the number of events on the stack. */
+	int32						CountItems() const
+								{ return m_count; }
+
 	/** Return time of top event. */
 	bool						NextTime(
 									long *outTime) const;
 
+	/** Set the statistics which overflows and new high water marks
+	 *	are reported to. May be NULL, which is the default.
+	 */
+	void						SetStatistics(
+									CPlayerStatistics *statistics);
+
+	/** Set the lock which must be held while the stack is used. Debug
+	 *	builds assert that the caller holds it. May be NULL, which is
+	 *	the default, for stacks only one thread knows about.
+	 */
+	void						SetLock(
+									BLocker *lock);
+
 public:							// Operations
 
-	/** Add event to stack. */
+	/** Add event to stack. Returns false only if the stack could not
+	 *	be grown to hold the event.
+	 */
 	bool						Push(
 									const CEvent &ev);
 
@@ -90,19 +119,75 @@ public:							// Operations
 									CEvent &ev,
 									CTime time);
 
+private:						// Internal Operations
+
+	/** Returns true if the event at index a should be popped before
+	 *	the event at index b.
+	 */
+	bool						_before(
+									int32 a,
+									int32 b) const;
+
+	/** Assert that the caller holds the lock, if there is one. */
+	void						_checkLock() const;
+
+	/** Make sure there is room for the given number of events. */
+	bool						_reserve(
+									int32 count);
+
+	/** Update the high water mark after a push. */
+	void						_countChanged();
+
+	/** Insert the event at the bottom of the heap into place. */
+	void						_siftUp(
+									int32 index);
+
+	/** Move the event at the given index down into place. */
+	void						_siftDown(
+									int32 index);
+
+	/** Swap two entries of the heap. */
+	void						_swap(
+									int32 a,
+									int32 b);
+
+	/** Remove the top event from the heap, moving it into ev. */
+	void						_popTop(
+									CEvent &ev);
+
+	/** Restore the heap order after the iterator has filtered events. */
+	void						_rebuild();
+
 private:						// Instance Data
 
-	/** The stack of items. */
+	/** The heap of items. The top of the stack is at index 0. */
 	CEvent *					m_stack;
 
-	/** Top item of stack. */
-	CEvent *					m_current;
+	/** Order in which each item was pushed, to break ties. */
+	uint32 *					m_order;
+
+	/** Number of items in the stack. */
+	int32						m_count;
 
-	/** Max item of stack. */
-	CEvent *					m_max;
+	/** Number of items the stack can hold before growing. */
+	int32						m_capacity;
+
+	/** The most items the stack has held at once. */
+	int32						m_maxCount;
+
+	/** Incremented for every item pushed. */
+	uint32						m_nextOrder;
+
+	/** Where to report overflows and stack depth, or NULL. */
+	CPlayerStatistics *			m_statistics;
+
+	/** The lock which guards the stack, or NULL. */
+	BLocker *					m_lock;
 };
 
-/**	A class used in selectively filtering events from the event stack. */
+/**	A class used in selectively filtering events from the event stack.
+ *	Events are visited in no particular order.
+ */
 class CEventStackIterator
 {
 
@@ -120,6 +205,12 @@ public:							// Accessors
 	/**	Returns pointer to current event, if any. */
 	CEvent *					Current() const;
 
+	/**	Returns when the current event was pushed, relative to the other
+	 *	events on the stack. Of two events with the same time, the one
+	 *	with the greater order comes off the stack first.
+	 */
+	uint32						CurrentOrder() const;
+
 public:							// Operations
 
 	/**	Skips to the next event. */
@@ -130,9 +221,9 @@ public:							// Operations
 
 private:						// Instance Data
 
-	CEvent *					m_read;
+	int32						m_read;
 
-	CEvent *					m_write;
+	int32						m_write;
 
 	CEventStack &				m_stack;
 };
@@ -28,18 +28,17 @@ CEventTask::CEventTask(
 	int32			start,
 	int32			end )
 		: CPlaybackTask(group, tr, par, start),
-		  timeBase(inTimeBase),
-		  playPos(tr->Events())
+		  timeBase(inTimeBase)
 {
 	transposition		= 0;
 	clockType			= ClockType_Real;
-	repeatStack		= NULL;
 	trackEndTime		= tr->LogicalLength();
 	taskDuration		= end >= 0 ? end : LONG_MAX;
 	nextRepeatTime	= trackEndTime;
 	interruptable		= true;
 
-	playPos.First();
+	_initRepeats();
+	playPos.Update(tr->Events());
 }
 
 CEventTask::CEventTask( CPlaybackTaskGroup &group, CEventTask &th )
@@ -53,19 +52,28 @@ CEventTask::CEventTask( CPlaybackTaskGroup &group, CEventTask &th )
 	trackEndTime		= th.trackEndTime;
 	taskDuration		= th.taskDuration;
 	interruptable		= th.interruptable;
+	trackAdvance		= th.trackAdvance;
+	eventAdvance		= th.eventAdvance;
+
+	// Copy the pending repeats, outermost first
+	_initRepeats();
+	RepeatState *repeats[maxRepeatNest];
+	int count = 0;
+	for (RepeatState *rps = th.repeatStack; rps != NULL; rps = rps->next)
+		repeats[count++] = rps;
+	while (count > 0)
+	{
+		RepeatState *source = repeats[--count];
+		RepeatState *rps = _pushRepeat(source->pos);
+		rps->endTime = source->endTime;
+		rps->timeOffset = source->timeOffset;
+		rps->repeatCount = source->repeatCount;
+	}
 }
 
 CEventTask::~CEventTask()
 {
 	// REM: Should also search stacks and kill
-
-		// Delete all pending repeats
-	while (repeatStack)
-	{
-		RepeatState	*rps = repeatStack->next;
-		delete repeatStack;
-		repeatStack = rps;
-	}
 }
 
 // ---------------------------------------------------------------------------
@@ -85,23 +93,14 @@ CEventTask::Play()
 	int32 targetTime;
 	bool locating = (group.flags & CPlaybackTaskGroup::Clock_Locating);
 
-	// If we're locating, then we want to lock for certain
 	if (locating)
-	{
 		targetTime = timeBase.seekTime;
-		track->ReadLock();
-	}
 	else
-	{
-		if (!track->ReadLock(500))
-		{
-			// Attempt to lock the track; if we fail, then just continue
-			// and play something else.
-			ReQueue(timeBase.stack, timeBase.seekTime + 10);
-			return;
-		}
 		targetTime = timeBase.seekTime + eventAdvance;
-	}
+
+	// Play from the latest published version of the track, so that we
+	// don't have to lock it, or wait for an edit to finish
+	playPos.Update(((CEventTrack *)track)->Events());
 
 	int32 actualEndTime = originTime + taskDuration - 1;	
 	currentTime = targetTime - originTime;
@@ -135,7 +134,6 @@ CEventTask::Play()
 			{
 				ReQueue(timeBase.stack, nextRepeatTime + originTime - 1);
 			}
-			track->ReadUnlock();
 			return;
 		}
 
@@ -150,7 +148,6 @@ CEventTask::Play()
 		{
 			// past end of task
 			flags |= Task_Finished;
-			track->ReadUnlock();
 			return;
 		}
 
@@ -158,7 +155,6 @@ CEventTask::Play()
 		{
 			// done with this chunk
 			ReQueue(timeBase.stack, locating ? t : t - trackAdvance);
-			track->ReadUnlock();
 			return;
 		}
 
@@ -169,12 +165,10 @@ CEventTask::Play()
 	if ((repeatStack != NULL) || (currentTime < taskDuration))
 	{
 		ReQueue(timeBase.stack, nextRepeatTime + originTime);
-		track->ReadUnlock();
 		return;
 	}
 
 	// REM: Is this incorrect for the master track?
-	track->ReadUnlock();
 	flags |= Task_Finished;
 	ReQueue(timeBase.stack, trackEndTime + originTime);
 }
@@ -182,6 +176,40 @@ CEventTask::Play()
 // ---------------------------------------------------------------------------
 // Internal Operations
 
+void
+CEventTask::_initRepeats()
+{
+	repeatStack = NULL;
+	freeRepeats = NULL;
+	for (int i = 0; i < maxRepeatNest; i++)
+	{
+		repeatStates[i].next = freeRepeats;
+		freeRepeats = &repeatStates[i];
+	}
+}
+
+CEventTask::RepeatState *
+CEventTask::_pushRepeat(
+	const CEventSnapshotMarker &pos)
+{
+	RepeatState *rps = freeRepeats;
+	freeRepeats = rps->next;
+	rps->pos = pos;
+	rps->next = repeatStack;
+	repeatStack = rps;
+	return rps;
+}
+
+void
+CEventTask::_popRepeat()
+{
+	RepeatState *rps = repeatStack;
+	repeatStack = rps->next;
+	rps->pos.Clear();
+	rps->next = freeRepeats;
+	freeRepeats = rps;
+}
+
 void
 CEventTask::_beginRepeat(
 	int32 inRepeatStart,
@@ -192,17 +220,17 @@ CEventTask::_beginRepeat(
 	 || (inRepeatDuration <= 0))
 	 	return;
 
-	// Ignore overlapped repeat events
-	if ((repeatStack == NULL)
-	 || (repeatStack->endTime >= inRepeatStart + inRepeatDuration))
+	// Ignore overlapped repeat events, and repeats nested too deeply
+	if ((freeRepeats != NULL)
+	 && ((repeatStack == NULL)
+	  || (repeatStack->endTime >= inRepeatStart + inRepeatDuration)))
 	{
 		// Make a new repeat state, starting at the next event
-		RepeatState	*rps = new RepeatState(playPos);
+		RepeatState	*rps = _pushRepeat(playPos);
 		rps->pos.Seek(1);
 		rps->endTime = inRepeatStart + inRepeatDuration;
 		rps->timeOffset = inRepeatDuration;
 		rps->repeatCount = inRepeatCount;
-		rps->next = repeatStack;
 
 		// If this is a master track, then adjust something or other...
 		if ((track == group.mainTracks[0])
@@ -213,7 +241,6 @@ CEventTask::_beginRepeat(
 		}
 
 		// Set the time of the next repeat concern
-		repeatStack = rps;
 		nextRepeatTime = MIN(trackEndTime, rps->endTime);
 	}
 }
@@ -232,35 +259,20 @@ CEventTask::_repeat()
 		currentTime = timeBase.seekTime - originTime;
 		result = true;
 
-		// Now, back-seek to find any events which got skipper over.
-		EventMarker	sPos( playPos );
+		// Now, find any events which got skipped over: seek to the
+		// first event at or after the start of the repeat, and queue
+		// for playback everything up to the play position, except for
+		// any repeat events.
+		CEventSnapshotMarker sPos( playPos );
 		const CEvent	*s;
-		int32		count = 0;
+		const CEvent	*end = (const CEvent *)playPos;
 
-		// Back up in sequence, until we reach either the beginning of
-		// the track, or we find an event which occured before the
-		// start of the repeat event.
-		while ((s = sPos.Peek(-1)))
+		for (s = sPos.SeekToTime(repeatStack->endTime - repeatStack->timeOffset);
+			 s != NULL && s != end;
+			 s = sPos.Seek(1))
 		{
-			if (s->Start() < repeatStack->endTime - repeatStack->timeOffset)
-				break;
-				
-			sPos.Seek( -1 );
-			count++;
-		}
-		
-			// Now, play forward again, and queue for playback all of the
-			// events which we skipped over, except for any repeat events.
-		while (count--)
-		{
-			s = sPos.Peek( 0 );
-			if (		s != NULL
-				&&	s->Command() != EvtType_Repeat)
-			{
-				_stackEvent( *s, timeBase.stack, originTime );
-				
-			}
-			sPos.Seek( 1 );
+			if (s->Command() != EvtType_Repeat)
+				_stackEvent(*s, timeBase.stack, originTime);
 		}
 
 		if (repeatStack == NULL) break;
@@ -270,9 +282,7 @@ CEventTask::_repeat()
 			repeatStack->repeatCount--;
 			if (repeatStack->repeatCount <= 1)
 			{
-				RepeatState	*rps = repeatStack->next;
-				delete repeatStack;
-				repeatStack = rps;
+				_popRepeat();
 
 				if (repeatStack)
 					nextRepeatTime = repeatStack->endTime;
@@ -291,11 +301,7 @@ CEventTask::_repeat()
 	{
 			// Delete all pending repeats
 		while (repeatStack != NULL)
-		{
-			RepeatState	*rps = repeatStack->next;
-			delete repeatStack;
-			repeatStack = rps;
-		}
+			_popRepeat();
 		
 		if (taskDuration != LONG_MAX) taskDuration -= track->LogicalLength();
 
@@ -342,6 +348,10 @@ CEventTask::_stackEvent(
 			dest->Stack(stackedEvent, *this, stack, duration);
 			dest->ReadUnlock();
 		}
+		else
+		{
+			thePlayer.Statistics().RecordLockTimeout();
+		}
 		return;
 	}
 	else
@@ -394,8 +404,8 @@ CEventTask::_stackEvent(
 							duration = stop - start;
 						}
 						
-						th = new CRealClockEventTask(group, tk, this, start,
-													 duration);
+						th = new (group) CRealClockEventTask(group, tk, this,
+															 start, duration);
 						th->interruptable = (ev.sequence.flags & CEvent::Seq_Interruptable);
 					}
 					else
@@ -407,8 +417,8 @@ CEventTask::_stackEvent(
 							duration = stop - start;
 						}
 					
-						th = new CMeteredClockEventTask(group, tk, this, start,
-														duration);
+						th = new (group) CMeteredClockEventTask(group, tk, this,
+																start, duration);
 						th->interruptable = (ev.sequence.flags & CEvent::Seq_Interruptable);
 					}
 					th->transposition = ev.sequence.transposition;
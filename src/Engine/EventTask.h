@@ -50,7 +50,7 @@ class CEventTask
 	struct RepeatState
 	{
 		RepeatState		*next;				// next enclosing repeat
-		EventMarker		pos;					// where to jump back to
+		CEventSnapshotMarker pos;				// where to jump back to
 		long				endTime,				// when to jump back
 						timeOffset;			// time offset for repeat
 		uint32			repeatCount;			// repeat coundown
@@ -58,7 +58,7 @@ class CEventTask
 		// REM: For master tracks, we might want to record both time
 		// clock states...
 
-		RepeatState( EventMarker &em ) : pos( em ) {}
+		RepeatState() {}
 	};
 
 public:							// Constructor/Destructor
@@ -72,7 +72,9 @@ public:							// Constructor/Destructor
 									int32 start,
 									int32 end);
 
-	/** Copy constructor. */
+	/** Copy constructor. Copies the whole playback state, including
+	 *	the pending repeats.
+	 */
 								CEventTask(
 									CPlaybackTaskGroup &group,
 									CEventTask &task);
@@ -95,6 +97,18 @@ protected:						// CPlaybackTask Implementation
 
 private:						// Internal Operations
 
+	/** Put all of the repeat states on the free list. */
+	void						_initRepeats();
+
+	/** Put an unused repeat state on top of the repeat stack, with its
+	 *	position set to pos. There must be one left.
+	 */
+	RepeatState *				_pushRepeat(
+									const CEventSnapshotMarker &pos);
+
+	/** Take the innermost repeat off the repeat stack. */
+	void						_popRepeat();
+
 	/** Force a repeat event at the current point in the sequence. */
 	void						_beginRepeat(
 									int32 start,
@@ -114,8 +128,10 @@ protected:						// Instance Data
 
 	TState &					timeBase;
 
-	/** Playback position. */
-	EventMarker					playPos;
+	/** Playback position, in the latest snapshot of the track's events
+	 *	that has been played from.
+	 */
+	CEventSnapshotMarker		playPos;
 
 	/** Key transposition of task. */
 	int8						transposition;
@@ -145,6 +161,15 @@ protected:						// Instance Data
 
 	/** Variables pertaining to Repeat events. */
 	RepeatState *				repeatStack;
+
+	/** The repeat states are part of the task, so that repeats don't
+	 *	allocate memory on the player thread. Repeats nested deeper than
+	 *	this are ignored.
+	 */
+	RepeatState					repeatStates[maxRepeatNest];
+
+	/** Repeat states not on the repeat stack. */
+	RepeatState *				freeRepeats;
 };
 
 // ---------------------------------------------------------------------------
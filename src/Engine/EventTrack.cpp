@@ -93,120 +93,87 @@ CEventTrack::SummarizeSelection()
 	long prevSigStart;
 
 	long time;
-	double initialTempoPeriod = 0.0;
 
 	m_prevAggregateAction = 0;
-	
-	// Initialize selection times to an "inside-out" selection.
-	m_minSelectTime = LONG_MAX;
-	m_maxSelectTime = LONG_MIN;
-	m_selectionCount = 0;
+
+	// The event list keeps the selection range, the latest stop time and
+	// the 'end' event summarized per block, so there's no need to look at
+	// every event here.
+	EventList::Summary summary;
+	events.GetSummary(summary);
+
+	m_selectionCount = summary.selectCount;
+	m_minSelectTime = summary.minSelectTime;
+	m_maxSelectTime = summary.maxSelectTime;
+	lastEventTime = MAX(0, summary.maxStopTime);
+	// An 'end' event overrides the implicit track duration.
+	logicalLength = (summary.endTime > 0) ? summary.endTime : 0;
 
 	EventMarker marker(events);
 	const CEvent *ev;
 
-	lastEventTime = logicalLength = 0;
+	// Set the marker which points to the first selected event -- but only
+	// if it does not already point to a selected event.
+	if (m_selectionCount > 0)
+	{
+		const CEvent *current = m_currentEvent;
+		if (((current == NULL) || !current->IsSelected())
+		 && (marker.FirstSelected() != NULL))
+			m_currentEvent = marker;
+	}
+
+#if DEBUG
+	_validateSummary();
+#endif
 
 	// Only metered sequences can have time signature events, so there's
 	// no point in even checking.
 	if (sigMap.clockType != ClockType_Metered)
 		m_validSigMap = true;
 
-	// Every track starts at 4/4 (the default), but can be immediately
-	// changed by the very first event.
-	prevSigStart = 0;
-	prevMinorUnitDur = Ticks_Per_QtrNote;
-	prevMajorUnitDur = Ticks_Per_QtrNote * 4;
-
-	// Loop through every event in the sequence and compile summary
-	// information
-	for (ev = marker.First(); ev != NULL; ev = marker.Seek(1))
+	if (m_validSigMap == false)
 	{
-		long first = ev->Start();
-		long last;
+		// Every track starts at 4/4 (the default), but can be immediately
+		// changed by the very first event.
+		prevSigStart = 0;
+		prevMinorUnitDur = Ticks_Per_QtrNote;
+		prevMajorUnitDur = Ticks_Per_QtrNote * 4;
+
+		// Count the time signature changes
+		for (ev = marker.First(); ev != NULL; ev = marker.Seek(1))
+		{
+			if (ev->Command() != EvtType_TimeSig)
+				continue;
 
-		// last <== the stop time of the event
-		if (ev->HasProperty(CEvent::Prop_Duration))
-			last = ev->Stop();
-		else
-			last = first;
+			time = ev->Start();
+			if (time < 0)
+				time = 0;
+			minorUnitDur = (Ticks_Per_QtrNote * 4) >> ev->sigChange.denominator;
+			majorUnitDur = minorUnitDur * ev->sigChange.numerator;
 
-		switch (ev->Command())
-		{
-			case EvtType_End:
-			{
-				// An 'end' event overrides the implicit track duration.
-				if (logicalLength <= 0)
-					logicalLength = last;
-				break;
-			}
-			case EvtType_TimeSig:
+			if (majorUnitDur <= 0)
+				majorUnitDur = Ticks_Per_QtrNote * 3;
+			if (minorUnitDur <= 0)
+				minorUnitDur = Ticks_Per_QtrNote * 1;
+
+			// If it's effectively the same time signature...
+			if ((prevMinorUnitDur != minorUnitDur)
+			 ||	(prevMajorUnitDur != majorUnitDur))
 			{
-				if (m_validSigMap)
-					break;
-
-				time = ev->Start();
-				if (time < 0)
-					time = 0;
-				minorUnitDur = (Ticks_Per_QtrNote * 4) >> ev->sigChange.denominator;
-				majorUnitDur = minorUnitDur * ev->sigChange.numerator;
-
-				if (majorUnitDur <= 0)
-					majorUnitDur = Ticks_Per_QtrNote * 3;
-				if (minorUnitDur <= 0)
-					minorUnitDur = Ticks_Per_QtrNote * 1;
-
-				// If it's effectively the same time signature...
-				if ((prevMinorUnitDur != minorUnitDur)
-				 ||	(prevMajorUnitDur != majorUnitDur))
+				// Justify this time to the beginning of the bar.
+				sigStart = time - (time - prevSigStart) % prevMajorUnitDur;
+
+				// Only if one or more bars have elapsed do we create a new entry.
+				if (sigStart > prevSigStart)
 				{
-					// Justify this time to the beginning of the bar.
-					sigStart = time - (time - prevSigStart) % prevMajorUnitDur;
-	
-					// Only if one or more bars have elapsed do we create a new entry.
-					if (sigStart > prevSigStart)
-					{
-						sigChangeCount++;
-						prevSigStart = sigStart;
-					}
-					prevMinorUnitDur = minorUnitDur;
-					prevMajorUnitDur = majorUnitDur;
+					sigChangeCount++;
+					prevSigStart = sigStart;
 				}
-				break;
-			}			
-			case EvtType_Tempo:
-			{
-				tempoChangeCount++;
-				if (initialTempoPeriod == 0.0)
-					initialTempoPeriod = RateToPeriod((double)ev->tempo.newTempo / 1000.0);
-				break;
+				prevMinorUnitDur = minorUnitDur;
+				prevMajorUnitDur = majorUnitDur;
 			}
 		}
 
-		if (ev->IsSelected())
-		{
-			// Add the event to the selection range
-			m_minSelectTime = MIN(m_minSelectTime, first);
-			m_maxSelectTime = MAX(m_maxSelectTime, last);
-
-			// Set the marker which points to the first selected event
-			// -- but only if it does not already point to a selected event.
-			if (m_selectionCount == 0)
-			{
-				const CEvent *current = m_currentEvent;
-				if ((current == NULL) || !current->IsSelected())
-					m_currentEvent = marker;
-			}
-			m_selectionCount++;
-		}
-
-		// Compute the time of the last event stop time in the track
-		if (last > lastEventTime)
-			lastEventTime = last;
-	}
-	
-	if (m_validSigMap == false)
-	{
 		CSignatureMap::SigChange *sigList, *prevSig;
 		int32 sigIndex = 0;
 		
@@ -274,40 +241,45 @@ CEventTrack::SummarizeSelection()
 	if ((GetID() == 1) && !Document().ValidTempoMap())
 	{
 		CTempoMapEntry *newTempoMap, *nextEntry;
-		
-		if (initialTempoPeriod == 0)
-			initialTempoPeriod = RateToPeriod(Document().InitialTempo());
 
-		// We know how many tempo events there are already (since we counted them
-		// in the last section) so we can go ahead and allocate the new array of tempomap
-		// entries.
-		if (tempoChangeCount <= 1)
+		// Count the tempo changes
+		for (ev = marker.First(); ev != NULL; ev = marker.Seek(1))
 		{
-			newTempoMap = new CTempoMapEntry[1];
-			newTempoMap->SetInitialTempo(initialTempoPeriod);
+			if (ev->Command() == EvtType_Tempo)
+				tempoChangeCount++;
 		}
-		else
+
+		// Allocate one entry for the initial tempo plus one per tempo
+		// change, and compile them all in a single pass. A tempo change
+		// right at the start replaces the document's initial tempo.
+		newTempoMap = new CTempoMapEntry[tempoChangeCount + 1];
+		newTempoMap->SetInitialTempo(RateToPeriod(Document().InitialTempo()));
+		nextEntry = newTempoMap;
+		for (ev = marker.First(); ev != NULL; ev = marker.Seek(1))
 		{
-			newTempoMap = new CTempoMapEntry[tempoChangeCount + 1];
-			newTempoMap->SetInitialTempo(initialTempoPeriod);
-			nextEntry = &newTempoMap[1];
-			for (ev = marker.First(); ev != NULL; ev = marker.Seek(1))
+			if (ev->Command() != EvtType_Tempo)
+				continue;
+
+			// Calculate tempo period
+			double period = RateToPeriod((double)ev->tempo.newTempo / 1000.0);
+
+			if ((nextEntry == newTempoMap) && (ev->Start() <= 0)
+			 && (ev->Duration() <= 0))
 			{
-				if (ev->Command() == EvtType_Tempo)
-				{
-					// Calculate tempo period
-					double period = RateToPeriod((double)ev->tempo.newTempo / 1000.0);
-	
-					// Set up a tempo entry based off the previous one.
-					nextEntry->SetTempo(nextEntry[-1], period,
-										ev->Start(), ev->Duration(),
-										ClockType());
-				}
+				nextEntry->SetInitialTempo(period);
+				continue;
 			}
+
+			// Set up a tempo entry based off the previous one.
+			nextEntry++;
+			nextEntry->SetTempo(nextEntry[-1], period,
+								ev->Start(), ev->Duration(),
+								ClockType());
 		}
-		
+
 		// Replace old tempo map with new
-		Document().ReplaceTempoMap(newTempoMap, tempoChangeCount);
+		Document().ReplaceTempoMap(newTempoMap,
+								   nextEntry - newTempoMap + 1);
 		NotifyUpdate(CTrack::Update_TempoMap, NULL);
 		if (Sibling())
 			Sibling()->NotifyUpdate(CTrack::Update_TempoMap, NULL);
@@ -327,6 +299,52 @@ CEventTrack::SummarizeSelection()
 	}
 }
 
+#if DEBUG
+
+void
+CEventTrack::_validateSummary()
+{
+	ASSERT(IsWriteLocked());
+
+	// Rescan every event, the way the summary used to be compiled, and
+	// check it against what the event list has accumulated.
+	long minSelectTime = LONG_MAX;
+	long maxSelectTime = LONG_MIN;
+	long selectionCount = 0;
+	long lastStop = 0;
+	long endTime = 0;
+
+	EventMarker marker(events);
+	for (const CEvent *ev = marker.First(); ev != NULL; ev = marker.Seek(1))
+	{
+		long first = ev->Start();
+		long last = first;
+		if (ev->HasProperty(CEvent::Prop_Duration))
+			last = ev->Stop();
+
+		if ((ev->Command() == EvtType_End) && (endTime <= 0))
+			endTime = last;
+
+		if (ev->IsSelected())
+		{
+			minSelectTime = MIN(minSelectTime, first);
+			maxSelectTime = MAX(maxSelectTime, last);
+			selectionCount++;
+		}
+
+		if (last > lastStop)
+			lastStop = last;
+	}
+
+	ASSERT(selectionCount == m_selectionCount);
+	ASSERT(minSelectTime == m_minSelectTime);
+	ASSERT(maxSelectTime == m_maxSelectTime);
+	ASSERT(lastStop == lastEventTime);
+	ASSERT(MAX(endTime, 0) == logicalLength);
+}
+
+#endif
+
 // ---------------------------------------------------------------------------
 //	Indicates that a tempo event has been moved.
 //	(only applies to master tracks)
@@ -378,7 +396,7 @@ CEventTrack::SelectAll(
 	{
 		if (!ev->IsSelected())
 		{
-			const_cast<CEvent *>(ev)->SetSelected(true);
+			marker.SetSelected(true);
 			if (editor != NULL)
 				editor->RendererFor(*ev)->Invalidate(*ev);
 		}
@@ -408,7 +426,7 @@ CEventTrack::DeselectAll(
 	{
 		if (ev->IsSelected())
 		{
-			const_cast<CEvent *>(ev)->SetSelected(false);
+			marker.SetSelected(false);
 			if (editor != NULL)
 				editor->RendererFor(*ev)->Invalidate(*ev);
 		}
@@ -1130,10 +1148,7 @@ CEventTrack::ReadChunk(
 		}
 		case Body_ID:
 		{
-			CWriteLock lock(this);
-			ReadEventList(reader, events);
-			SummarizeSelection();
-			_initUsedDestinations();
+			ReadEvents(reader);
 			break;
 		}
 		default:
@@ -1167,6 +1182,25 @@ CEventTrack::Serialize(
 	// +++ we need to write the operators to the track. We need IDs and keys...
 }
 
+void
+CEventTrack::ReadEvents(
+	CReader &reader)
+{
+	CWriteLock lock(this);
+	ReadEventList(reader, events);
+	SummarizeSelection();
+	_initUsedDestinations();
+}
+
+// ---------------------------------------------------------------------------
+// CLockable Implementation
+
+void
+CEventTrack::WriteUnlocking()
+{
+	events.Publish();
+}
+
 // ---------------------------------------------------------------------------
 // CEventSelectionUpdateHint Implementation
 
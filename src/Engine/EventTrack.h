@@ -275,6 +275,19 @@ public:							// CSerializable Implementation
 	virtual void				Serialize(
 									CIFFWriter &writer);
 
+	/**	Read the events of the track (the body chunk), and summarize
+		them. Only touches the track itself, so different tracks can be
+		read concurrently; except for the master real track, which
+		compiles the document's tempo map.
+	*/
+	void						ReadEvents(
+									CReader &reader);
+
+protected:						// CLockable Implementation
+
+	/**	Publishes the edits to the player (see EventList::Publish()). */
+	void						WriteUnlocking();
+
 private:						// Internal Operations
 
 	void						_eventAdded(
@@ -285,6 +298,12 @@ private:						// Internal Operations
 
 	void						_initUsedDestinations();
 
+#if DEBUG
+								/** Rescan all events and check the summary
+									data against the result. */
+	void						_validateSummary();
+#endif
+
 	int32						Bytes()
 								{ return sizeof *this + CountEvents() * sizeof(CEvent); }
 
@@ -92,6 +92,51 @@ CPlaybackTask::~CPlaybackTask()
 	Remove();
 }
 
+// ---------------------------------------------------------------------------
+// Memory Management
+
+void *
+CPlaybackTask::operator new(
+	size_t size,
+	CPlaybackTaskGroup &group)
+{
+	bool fromHeap;
+	void *task = group.taskPool.Allocate(size, &fromHeap);
+	thePlayer.Statistics().RecordTaskAllocation(fromHeap);
+	return task;
+}
+
+void *
+CPlaybackTask::operator new(
+	size_t size,
+	CFixedPool &pool)
+{
+	return pool.Allocate(size);
+}
+
+void
+CPlaybackTask::operator delete(
+	void *task)
+{
+	CFixedPool::Free(task);
+}
+
+void
+CPlaybackTask::operator delete(
+	void *task,
+	CPlaybackTaskGroup &group)
+{
+	CFixedPool::Free(task);
+}
+
+void
+CPlaybackTask::operator delete(
+	void *task,
+	CFixedPool &pool)
+{
+	CFixedPool::Free(task);
+}
+
 // ---------------------------------------------------------------------------
 // Accessors
 
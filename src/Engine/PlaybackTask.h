@@ -45,6 +45,7 @@
 #define MAX_NORMAL_TASKS 	250
 #define MAX_FEEDBACK_TASKS	251
 
+class CFixedPool;
 class CPlaybackTaskGroup;
 
 // ---------------------------------------------------------------------------
@@ -95,6 +96,35 @@ public:							// Constructor/Destructor
 	/** Destructor. */
 	virtual						~CPlaybackTask();
 
+public:							// Memory Management
+
+	/** Tasks are allocated from the task pool of their group, so that
+	 *	starting and finishing them doesn't touch the heap on the player
+	 *	thread: new (group) CRealClockEventTask(group, ...).
+	 */
+	static void *				operator new(
+									size_t size,
+									CPlaybackTaskGroup &group);
+
+	/** For copies of tasks which are kept outside of the player, such
+	 *	as those in locate snapshots.
+	 */
+	static void *				operator new(
+									size_t size,
+									CFixedPool &pool);
+
+	static void					operator delete(
+									void *task);
+
+	/** Only called if a constructor throws. */
+	static void					operator delete(
+									void *task,
+									CPlaybackTaskGroup &group);
+
+	static void					operator delete(
+									void *task,
+									CFixedPool &pool);
+
 public:							// Hook Functions
 
 	/**	Returns the current time of this track. */
@@ -5,12 +5,16 @@
 #include "PlaybackTask.h"
 #include "PlaybackTaskGroup.h"
 #include "Player.h"
+#include "EventSink.h"
 #include "EventTask.h"
 #include "Idents.h"
 
 //#include <stdio.h>
 // Support Kit
 #include <Debug.h>
+// Standard Template Library
+#include <algorithm>
+#include <map>
 
 #define D_ALLOC(x) //PRINT(x)			// Constructor/Destructor
 #define D_EXECUTE(x) //PRINT(x)
@@ -18,11 +22,126 @@
 
 #define LOCATE_MAX 200
 
+// Metered time between locate snapshots (sixteen bars of 4/4), and the
+// most snapshots kept per group
+#define LOCATE_SNAPSHOT_INTERVAL (16 * 4 * Ticks_Per_QtrNote)
+#define LOCATE_SNAPSHOT_MAX 256
+
+// Maps the tasks of the group to the indices of their copies in a locate
+// snapshot
+typedef std::map<CPlaybackTask *, int32> task_map;
+
+// Adds the value to an FNV-1a hash.
+static inline void
+hash_value(
+	uint32 &hash,
+	int32 value)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		hash ^= (value >> (i * 8)) & 0xff;
+		hash *= 16777619UL;
+	}
+}
+
+// Sorts the events of a stack by the order in which they were pushed.
+// The order wraps around like the clock does.
+struct push_order
+{
+	bool operator()(
+		const std::pair<uint32, CEvent *> &a,
+		const std::pair<uint32, CEvent *> &b) const
+	{ return IsTimeGreater(a.first, b.first); }
+};
+
+// Returns the index of the copy of the task, or -1 if it hasn't been
+// copied.
+static int32
+find_copy(
+	const task_map &copies,
+	CPlaybackTask *task)
+{
+	task_map::const_iterator i = copies.find(task);
+	return (i != copies.end()) ? i->second : -1;
+}
+
+// Copies the events of a stack, with the index of the task copy of each
+// task marker in outTasks (-1 for other events). The events are copied in
+// the order in which they were pushed, so that pushing them again in that
+// order makes events with the same time come off the stack as they would
+// have.
+static void
+copy_stack(
+	CEventStack &stack,
+	std::vector<CEvent> &outEvents,
+	std::vector<int32> &outTasks,
+	const task_map &copies)
+{
+	std::vector<std::pair<uint32, CEvent *> > pushed;
+	pushed.reserve(stack.CountItems());
+
+	CEventStackIterator iter(stack);
+	for (CEvent *ev = iter.Current(); ev != NULL; ev = iter.Current())
+	{
+		pushed.push_back(std::make_pair(iter.CurrentOrder(), ev));
+		iter.Next();
+	}
+	std::sort(pushed.begin(), pushed.end(), push_order());
+
+	for (uint32 i = 0; i < pushed.size(); i++)
+	{
+		const CEvent &ev = *pushed[i].second;
+		int32 task = -1;
+		if (ev.Command() == EvtType_TaskMarker)
+		{
+			// drop the markers of tasks which are gone
+			task = find_copy(copies, ev.task.taskPtr);
+			if (task < 0)
+				continue;
+		}
+		outEvents.push_back(ev);
+		outTasks.push_back(task);
+	}
+}
+
+// The other way around, pointing the task markers at the restored tasks.
+// Doesn't allocate anything: the stack has held all of the events before.
+static void
+copy_stack(
+	const std::vector<CEvent> &events,
+	const std::vector<int32> &tasks,
+	CEventStack &outStack,
+	const std::vector<CPlaybackTask *> &restored)
+{
+	for (uint32 i = 0; i < events.size(); i++)
+	{
+		CEvent copy(events[i]);
+		if (tasks[i] >= 0)
+			copy.task.taskPtr = restored[tasks[i]];
+		outStack.Push(copy);
+	}
+}
+
+// Turns an interpolation event into a plain pitch bend to the value.
+static void
+make_pitch_bend(
+	CEvent &ev,
+	int32 value)
+{
+	CDestination *destination = ev.common.destination;
+	ev.pitchBend.command = EvtType_PitchBend;
+	ev.pitchBend.duration = 0;
+	ev.pitchBend.vChannel = (destination != NULL) ? destination->ID() : 0;
+	ev.pitchBend.targetBend = ev.pitchBend.startBend = value;
+	ev.pitchBend.updatePeriod = 0;
+}
+
 // ---------------------------------------------------------------------------
 // Constructor/Destructor
 
 CPlaybackTaskGroup::CPlaybackTaskGroup(
 	CMeVDoc *inDocument)
+	:	taskPool(sizeof(CEventTask), MAX_NORMAL_TASKS)
 {
 	LOCK_PLAYER;
 	
@@ -35,9 +154,21 @@ CPlaybackTaskGroup::CPlaybackTaskGroup(
 	syncType = SyncType_FreeRunning;
 	locateType = LocateTarget_Continue;
 	locatorThread = -1;
+	snapshotKey = 0;
+	loopSnapshot = NULL;
+	loopSnapshotKey = 0;
+	sink = NULL;
 	mainTracks[0] = mainTracks[ 1 ] = NULL;
 	pbOptions = 0;
 
+	// Let the player keep track of how deep the stacks get
+	real.stack.SetStatistics(&thePlayer.Statistics());
+	metered.stack.SetStatistics(&thePlayer.Statistics());
+
+	// The player thread and the locator share the stacks
+	real.stack.SetLock(&thePlayer.m_lock);
+	metered.stack.SetLock(&thePlayer.m_lock);
+
 	// Setup the initial tempo variables
 	tempo.SetInitialTempo(RateToPeriod(doc ? doc->InitialTempo()
 										   : CMeVDoc::DEFAULT_TEMPO));
@@ -55,6 +186,8 @@ CPlaybackTaskGroup::~CPlaybackTaskGroup()
 
 	// delete all active tasks
 	_flushTasks();
+	_clearSnapshots();
+	delete loopSnapshot;
 
 	// Remove from list of playback contexts
 	Remove();
@@ -242,6 +375,66 @@ CPlaybackTaskGroup::Pause(
 		flags &= ~Clock_Paused;
 }
 
+long
+CPlaybackTaskGroup::Render(
+	CTrack *inTrack1,
+	CTrack *inTrack2,
+	CEventSink &inSink,
+	int32 inLocTime,
+	int32 inDuration,
+	int32 inOptionFlags)
+{
+	// Keep the player thread from updating the group
+	{
+		LOCK_PLAYER;
+		Remove();
+	}
+
+	sink = &inSink;
+	flags = Clock_Locating | Locator_Find | Locator_Reset;
+	pbOptions = inOptionFlags & ~(PB_Paused | PB_Record | PB_Loop);
+	mainTracks[0] = inTrack1;
+	mainTracks[1] = inTrack2;
+	syncType = SyncType_FreeRunning;
+	locateType = LocateTarget_Metered;
+
+	origin = 0;
+	metered.time = metered.start = inLocTime;
+	real.time = real.start = doc->TempoMap().ConvertMeteredToReal(inLocTime);
+	real.end = metered.end = -1;
+	real.expansion = metered.expansion = 0;
+	if (inDuration >= 0)
+	{
+		metered.end = inLocTime + inDuration;
+		real.end = doc->TempoMap().ConvertMeteredToReal(metered.end);
+	}
+	tempo.SetInitialTempo(RateToPeriod(doc->InitialTempo()));
+
+	// Launch the main tracks and locate to the start on this thread
+	_locate();
+	origin = 0;
+
+	// Instead of waiting for the time of the next event, go there
+	// right away
+	long now = real.time;
+	while (!(flags & Clock_Stopped))
+	{
+		LOCK_PLAYER;
+
+		nextEventTime = LONG_MAX;
+		_update(now);
+
+		// Converting metered times to real time may round down, so
+		// make sure the clock keeps moving
+		now = MAX(nextEventTime, real.time + 1);
+	}
+
+	sink = NULL;
+	renderBends.clear();
+
+	return real.time;
+}
+
 void
 CPlaybackTaskGroup::Stop()
 {
@@ -249,6 +442,24 @@ CPlaybackTaskGroup::Stop()
 	FlushNotes();
 }
 
+// ---------------------------------------------------------------------------
+// LocateSnapshot
+
+CPlaybackTaskGroup::LocateSnapshot::LocateSnapshot(
+	int32 taskCount)
+	:	taskPool(sizeof(CEventTask), taskCount),
+		restored(taskCount)
+{
+	parents.reserve(taskCount);
+}
+
+CPlaybackTaskGroup::LocateSnapshot::~LocateSnapshot()
+{
+	CPlaybackTask *task;
+	while ((task = (CPlaybackTask *)tasks.First()) != NULL)
+		delete task;
+}
+
 // ---------------------------------------------------------------------------
 // Internal Operations
 
@@ -265,6 +476,14 @@ CPlaybackTaskGroup::_changeTempo(
 	tempo.SetTempo(tempo, newRate, start, duration, (TClockType)clockType);
 }
 
+void
+CPlaybackTaskGroup::_clearSnapshots()
+{
+	for (uint32 i = 0; i < snapshots.size(); i++)
+		delete snapshots[i];
+	snapshots.clear();
+}
+
 void
 CPlaybackTaskGroup::_executeEvent(
 	CEvent &ev,
@@ -280,7 +499,7 @@ CPlaybackTaskGroup::_executeEvent(
 			if (ev.task.taskPtr->flags & CPlaybackTask::Task_Finished)
 			{
 				delete ev.task.taskPtr;
-				if (tasks.Empty())
+				if (tasks.Empty() && (sink == NULL))
 				{
 					BMessage message(Player_ChangeTransportState);
 					be_app->PostMessage(&message);
@@ -294,6 +513,12 @@ CPlaybackTaskGroup::_executeEvent(
 		}
 		case EvtType_Interpolate:
 		{
+			if (sink != NULL)
+			{
+				_renderEvent(ev, tState);
+				return;
+			}
+
 			// I was originally supposed to have executed at ev.Start() + timeStep,
 			// but I may be a bit later than that -- take the difference into account.
 			// Here's how much time has elapsed since I was dispatched...
@@ -313,22 +538,57 @@ CPlaybackTaskGroup::_executeEvent(
 									  elapsed);
 					dest->ReadUnlock();
 				}
+				else
+				{
+					thePlayer.Statistics().RecordLockTimeout();
+				}
 			}
 			return;
 		}
 	}
 
+	if (sink != NULL)
+	{
+		_renderEvent(ev, tState);
+		return;
+	}
+
 	CDestination *dest = ev.common.destination;
 	if (dest != NULL)
 	{
 		if (dest->ReadLock(500))
 		{
 			dest->Execute(ev, system_time());
+			thePlayer.Statistics().RecordEventSent(dest->ID());
 			dest->ReadUnlock();
 		}
+		else
+		{
+			thePlayer.Statistics().RecordLockTimeout();
+		}
 	}
 }
 
+CPlaybackTaskGroup::LocateSnapshot *
+CPlaybackTaskGroup::_findSnapshot() const
+{
+	for (int32 i = snapshots.size() - 1; i >= 0; i--)
+	{
+		LocateSnapshot *snapshot = snapshots[i];
+		if (locateType == LocateTarget_Real)
+		{
+			if (snapshot->realSeekTime <= real.time)
+				return snapshot;
+		}
+		else if (snapshot->meteredSeekTime <= metered.time)
+		{
+			return snapshot;
+		}
+	}
+
+	return NULL;
+}
+
 void
 CPlaybackTaskGroup::_flushNotes(
 	CEventStack &stack)
@@ -354,6 +614,69 @@ CPlaybackTaskGroup::_flushTasks()
 		delete th;
 }
 
+uint32
+CPlaybackTaskGroup::_getSnapshotKey()
+{
+	uint32 key = 2166136261UL;
+
+	// The document played and where playback starts from
+	hash_value(key, (int32)(addr_t)doc);
+	for (int i = 0; i < 2; i++)
+		hash_value(key, mainTracks[i] ? mainTracks[i]->GetID() : -1);
+	hash_value(key, (int32)(doc->InitialTempo() * 1000.0));
+
+	// When looping, the tasks play on past the end
+	hash_value(key, pbOptions & PB_Loop);
+	if (!(pbOptions & PB_Loop))
+	{
+		hash_value(key, real.end);
+		hash_value(key, metered.end);
+	}
+
+	// The master tracks aren't in the document's list of tracks, but
+	// hold the arrangement, the repeats and the tempo changes
+	for (int i = 0; i < 2; i++)
+	{
+		CEventTrack *eventTrack = dynamic_cast<CEventTrack *>(mainTracks[i]);
+		if (eventTrack != NULL)
+			hash_value(key, eventTrack->Events().EditCount());
+	}
+	const CTempoMap &tempoMap = doc->TempoMap();
+	hash_value(key, tempoMap.count);
+	for (int32 i = 0; i < tempoMap.count; i++)
+	{
+		hash_value(key, tempoMap.list[i].mOrigin);
+		hash_value(key, tempoMap.list[i].mDuration);
+		hash_value(key, (int32)(tempoMap.list[i].finalPeriod * 1000.0));
+	}
+
+	// The contents of the tracks, and which of them are played
+	for (int32 i = 0; i < doc->CountTracks(); i++)
+	{
+		CTrack *track = doc->TrackAt(i);
+		hash_value(key, track->GetID());
+		hash_value(key, (track->Deleted() ? 1 : 0)
+						| (track->Muted() ? 2 : 0)
+						| (track->MutedFromSolo() ? 4 : 0));
+		CEventTrack *eventTrack = dynamic_cast<CEventTrack *>(track);
+		if (eventTrack != NULL)
+			hash_value(key, eventTrack->Events().EditCount());
+	}
+
+	// Muted destinations don't collect any channel state, and the
+	// state collected depends on where the destination plays
+	CDestination *destination = NULL;
+	int32 index = 0;
+	while ((destination = doc->GetNextDestination(&index)) != NULL)
+	{
+		hash_value(key, destination->ID());
+		hash_value(key, destination->IsMuted() ? 1 : 0);
+		hash_value(key, destination->ChaseKey());
+	}
+
+	return key;
+}
+
 void
 CPlaybackTaskGroup::_killChildTasks(
 	CPlaybackTask *parent)
@@ -377,8 +700,10 @@ CPlaybackTaskGroup::_locate()
 {
 	D_INTERNAL(("CPlaybackTaskGroup::_locate()\n"));
 
+	bigtime_t locateStart = system_time();
 	CPlaybackTask *th[2];
 	th[0] = th[1] = NULL;
+	bool snapshotting = false;
 
 	// If the locator has to seek around in the sequence, then
 	// kill all of the stuff that's playing now and re-launch
@@ -390,6 +715,10 @@ CPlaybackTaskGroup::_locate()
 		// Stop all notes for this song.
 		FlushEvents();
 
+		// The state at the start of the loop is going to change
+		delete loopSnapshot;
+		loopSnapshot = NULL;
+
 		if (flags & Locator_Reset)
 		{
 			// Stop all playback tasks for this song.
@@ -397,34 +726,58 @@ CPlaybackTaskGroup::_locate()
 
 			real.seekTime = metered.seekTime = 0;
 
-			// Launch each of the two main tracks
-			for (int i = 0; i < 2; i++)
+			// Snapshots are only taken while locating from the start (or
+			// from another snapshot), and are thrown away once the song
+			// has been edited.
+			LocateSnapshot *snapshot = NULL;
+			if (!(pbOptions & PB_Folded) && doc->ReadLock(500))
 			{
-				CEventTrack	*tr = (CEventTrack *)mainTracks[i];
-				if (tr == NULL)
-					continue;
-				
-				// REM: This use of "track duration" is incorrect if
-				// both the master sequences are playing.
-				CReadLock lock(tr);
-				if (!tr->Events().IsEmpty())
+				snapshotting = true;
+				uint32 key = _getSnapshotKey();
+				if (key != snapshotKey)
 				{
-					// Start the new tasks at time 0 with no parent task.
-					if (tr->ClockType() == ClockType_Real)
-					{
-						int32 endTime = pbOptions & PB_Loop ? LONG_MAX
-															: real.end;
-						th[0] = new CRealClockEventTask(*this,
-														(CEventTrack *)tr,
-														NULL, 0, endTime);
-					}
-					else
+					_clearSnapshots();
+					snapshotKey = key;
+				}
+
+				// Continue from the latest snapshot before the target
+				snapshot = _findSnapshot();
+				if (snapshot != NULL)
+					_restoreSnapshot(*snapshot);
+				doc->ReadUnlock();
+			}
+
+			if (snapshot == NULL)
+			{
+				// Launch each of the two main tracks
+				for (int i = 0; i < 2; i++)
+				{
+					CEventTrack	*tr = (CEventTrack *)mainTracks[i];
+					if (tr == NULL)
+						continue;
+					
+					// REM: This use of "track duration" is incorrect if
+					// both the master sequences are playing.
+					CReadLock lock(tr);
+					if (!tr->Events().IsEmpty())
 					{
-						int32 endTime = pbOptions & PB_Loop ? LONG_MAX
-															: metered.end;
-						th[1] = new CMeteredClockEventTask(*this,
-														   (CEventTrack *)tr,
-														   NULL, 0, endTime);
+						// Start the new tasks at time 0 with no parent task.
+						if (tr->ClockType() == ClockType_Real)
+						{
+							int32 endTime = pbOptions & PB_Loop ? LONG_MAX
+																: real.end;
+							th[0] = new (*this) CRealClockEventTask(*this,
+															(CEventTrack *)tr,
+															NULL, 0, endTime);
+						}
+						else
+						{
+							int32 endTime = pbOptions & PB_Loop ? LONG_MAX
+																: metered.end;
+							th[1] = new (*this) CMeteredClockEventTask(*this,
+															(CEventTrack *)tr,
+															NULL, 0, endTime);
+						}
 					}
 				}
 			}
@@ -444,7 +797,10 @@ CPlaybackTaskGroup::_locate()
 			// time locating and didn't give other tasks a chance to run.
 			// Also, check to see if the locate should be abandoned.
 			if (flags & (Locator_Reset | Locator_Find))
+			{
+				thePlayer.Statistics().RecordLocate(0, false);
 				return;
+			}
 
 			LOCK_PLAYER;
 
@@ -452,6 +808,8 @@ CPlaybackTaskGroup::_locate()
 			_locateNextChunk(real);
 			metered.seekTime = tempo.ConvertRealToMetered(real.seekTime);
 			_locateNextChunk(metered);
+			if (snapshotting)
+				_saveSnapshot();
 
 			if (!real.stack.NextTime(&real.seekTime))
 				real.seekTime = real.time;
@@ -471,7 +829,10 @@ CPlaybackTaskGroup::_locate()
 				// time locating and didn't give other tasks a chance to run.
 				// Also, check to see if the locate should be abandoned.
 				if (flags & (Locator_Reset | Locator_Find))
+				{
+					thePlayer.Statistics().RecordLocate(0, false);
 					return;
+				}
 
 				// Lock the player for another batch of events we are seeking.
 				LOCK_PLAYER;
@@ -479,6 +840,8 @@ CPlaybackTaskGroup::_locate()
 				_locateNextChunk(metered);
 				real.seekTime = tempo.ConvertMeteredToReal(metered.seekTime);
 				_locateNextChunk(real);
+				if (snapshotting)
+					_saveSnapshot();
 	
 				int32 target = metered.time;
 				if (pbOptions & PB_Folded)
@@ -503,7 +866,27 @@ CPlaybackTaskGroup::_locate()
 	// REM: Is this correct for synced sequences???
 	// +++++ REMOVE THIS DEPENDANCY +++++
 	origin = thePlayer.m_internalTimerTick - real.time;
+
+	// Keep the state at the start of the loop, so that each pass can
+	// start right away, without locating again
+	if ((pbOptions & PB_Loop) && !(pbOptions & PB_Folded)
+	 && (syncType <= SyncType_SongInternal))
+	{
+		LOCK_PLAYER;
+
+		if (doc->ReadLock(500))
+		{
+			delete loopSnapshot;
+			loopSnapshot = _takeSnapshot();
+			loopSnapshotKey = _getSnapshotKey();
+			doc->ReadUnlock();
+		}
+	}
+
 	flags &= ~Clock_Locating;
+	if (sink != NULL)
+		return;
+	thePlayer.Statistics().RecordLocate(system_time() - locateStart, true);
 
 	// notify all destinations that locating has finished
 	if (doc->ReadLock(500))
@@ -550,6 +933,101 @@ CPlaybackTaskGroup::_locatorTaskFunc(
 	return 0;
 }
 
+bool
+CPlaybackTaskGroup::_loop()
+{
+	D_INTERNAL(("CPlaybackTaskGroup::_loop()\n"));
+
+	if ((loopSnapshot == NULL) || (syncType > SyncType_SongInternal))
+		return false;
+
+	// Don't wait for the document on the player thread; if it's busy,
+	// or has been edited, locate the next pass as usual
+	if (!doc->ReadLock(0))
+		return false;
+	if (_getSnapshotKey() != loopSnapshotKey)
+	{
+		doc->ReadUnlock();
+		return false;
+	}
+
+	// Stop whatever is left of the last pass
+	FlushEvents();
+	_flushTasks();
+
+	real.time		= real.start;
+	metered.time	= metered.start;
+
+	// Unlike _restart(), keep the clock going, so that the next pass
+	// begins exactly one loop after the last one
+	origin += real.end - real.start + real.expansion;
+
+	_restoreSnapshot(*loopSnapshot);
+
+	// Send the controller state at the start of the loop
+	CDestination *destination = NULL;
+	int32 index = 0;
+	bigtime_t now = system_time();
+	while ((destination = doc->GetNextDestination(&index)) != NULL)
+		destination->DoneLocating(now);
+	doc->ReadUnlock();
+
+	return true;
+}
+
+void
+CPlaybackTaskGroup::_renderEvent(
+	CEvent &ev,
+	TimeState &tState)
+{
+	CDestination *dest = ev.common.destination;
+	switch (ev.Command())
+	{
+		case EvtType_StartInterpolate:
+		{
+			if (ev.startInterpolate.interpolationType != Interpolation_PitchBend)
+				return;
+
+			int32 startValue = ev.startInterpolate.startValue;
+			renderBends[dest] = std::make_pair(startValue,
+											   (int32)ev.startInterpolate.targetValue);
+			make_pitch_bend(ev, startValue);
+			break;
+		}
+		case EvtType_Interpolate:
+		{
+			if (ev.interpolate.interpolationType != Interpolation_PitchBend)
+				return;
+
+			// Same as CMidiDestination::Interpolate()
+			int32 elapsed = tState.time - ev.Start() + ev.interpolate.timeStep;
+			if ((unsigned long)elapsed > ev.interpolate.duration)
+				elapsed = ev.interpolate.duration;
+
+			std::pair<int32, int32> &bend = renderBends[dest];
+			int32 newValue = bend.first + (bend.second - bend.first)
+										  * elapsed
+										  / (int32)ev.interpolate.duration;
+			ev.interpolate.start += elapsed;
+			ev.interpolate.duration -= elapsed;
+			if ((unsigned long)elapsed < ev.interpolate.duration)
+				tState.stack.Push(ev);
+			else
+				newValue = bend.second;
+
+			if (newValue == bend.first)
+				return;
+			bend.first = newValue;
+			make_pitch_bend(ev, newValue);
+			break;
+		}
+	}
+
+	// The events located through only keep the pitch bends up to date
+	if (!(flags & Clock_Locating))
+		sink->Execute(ev, real.time, metered.time);
+}
+
 void
 CPlaybackTaskGroup::_restart()
 {
@@ -579,6 +1057,138 @@ CPlaybackTaskGroup::_restart()
 		resume_thread(locatorThread);
 }
 
+void
+CPlaybackTaskGroup::_restoreSnapshot(
+	LocateSnapshot &snapshot)
+{
+	D_INTERNAL(("CPlaybackTaskGroup::_restoreSnapshot(%ld)\n",
+				snapshot.meteredSeekTime));
+
+	// Rendering leaves the destinations alone
+	for (uint32 i = 0; (sink == NULL) && (i < snapshot.chaseStates.size()); i++)
+	{
+		CDestination *destination = doc->FindDestination(snapshot.chaseStates[i].first);
+		if (destination != NULL)
+			destination->SetChaseState(snapshot.chaseStates[i].second);
+	}
+
+	// Copy the tasks back, in order, so that each parent is copied
+	// before its children. The tasks come from the group's pool, so
+	// this doesn't allocate anything when starting a loop pass.
+	int32 i = 0;
+	for (CPlaybackTask *task = (CPlaybackTask *)snapshot.tasks.First();
+		 task != NULL;
+		 task = (CPlaybackTask *)task->Next(), i++)
+	{
+		CPlaybackTask *copy = new (*this) CEventTask(*this, *(CEventTask *)task);
+		int32 parent = snapshot.parents[i];
+		copy->parent = (parent >= 0) ? snapshot.restored[parent] : NULL;
+		snapshot.restored[i] = copy;
+	}
+	copy_stack(snapshot.realEvents, snapshot.realTasks, real.stack,
+			   snapshot.restored);
+	copy_stack(snapshot.meteredEvents, snapshot.meteredTasks, metered.stack,
+			   snapshot.restored);
+
+	real.seekTime = snapshot.realSeekTime;
+	metered.seekTime = snapshot.meteredSeekTime;
+	real.expansion = snapshot.realExpansion;
+	metered.expansion = snapshot.meteredExpansion;
+	tempo = snapshot.tempo;
+}
+
+void
+CPlaybackTaskGroup::_saveSnapshot()
+{
+	if ((metered.seekTime < LOCATE_SNAPSHOT_INTERVAL)
+	 || (snapshots.size() >= LOCATE_SNAPSHOT_MAX))
+		return;
+
+	// Only if there is nothing left to do up to the seek times
+	long nextTime;
+	if ((real.stack.NextTime(&nextTime) && (nextTime <= real.seekTime))
+	 || (metered.stack.NextTime(&nextTime) && (nextTime <= metered.seekTime)))
+		return;
+
+	// Only one snapshot per interval
+	long intervalStart = metered.seekTime - metered.seekTime
+											% LOCATE_SNAPSHOT_INTERVAL;
+	std::vector<LocateSnapshot *>::iterator pos = snapshots.begin();
+	while ((pos != snapshots.end()) && ((*pos)->meteredSeekTime < intervalStart))
+		pos++;
+	if ((pos != snapshots.end())
+	 && ((*pos)->meteredSeekTime < intervalStart + LOCATE_SNAPSHOT_INTERVAL))
+		return;
+
+	D_INTERNAL(("CPlaybackTaskGroup::_saveSnapshot(%ld)\n",
+				metered.seekTime));
+
+	if (!doc->ReadLock(500))
+		return;
+	LocateSnapshot *snapshot = _takeSnapshot();
+	doc->ReadUnlock();
+
+	if (snapshot != NULL)
+		snapshots.insert(pos, snapshot);
+}
+
+CPlaybackTaskGroup::LocateSnapshot *
+CPlaybackTaskGroup::_takeSnapshot()
+{
+	D_INTERNAL(("CPlaybackTaskGroup::_takeSnapshot(%ld)\n",
+				metered.seekTime));
+
+	int32 taskCount = 0;
+	for (CPlaybackTask *task = (CPlaybackTask *)tasks.First();
+		 task != NULL;
+		 task = (CPlaybackTask *)task->Next())
+	{
+		if (dynamic_cast<CEventTask *>(task) == NULL)
+			return NULL;
+		taskCount++;
+	}
+
+	LocateSnapshot *snapshot = new LocateSnapshot(taskCount);
+
+	CDestination *destination = NULL;
+	int32 index = 0;
+	while ((destination = doc->GetNextDestination(&index)) != NULL)
+	{
+		Midi::CMidiChaseState state;
+		if (destination->GetChaseState(state))
+			snapshot->chaseStates.push_back(std::make_pair(destination->ID(),
+														   state));
+	}
+
+	// The copy constructor adds the copy to our task list, so take it
+	// out again right away
+	task_map copies;
+	CPlaybackTask *task = (CPlaybackTask *)tasks.First();
+	for (int32 i = 0; i < taskCount; i++)
+	{
+		CPlaybackTask *next = (CPlaybackTask *)task->Next();
+		CPlaybackTask *copy = new (snapshot->taskPool) CEventTask(*this,
+																  *(CEventTask *)task);
+		copy->Remove();
+		copy->parent = NULL;
+		snapshot->tasks.AddTail(copy);
+		snapshot->parents.push_back(find_copy(copies, task->parent));
+		copies[task] = i;
+		task = next;
+	}
+	copy_stack(real.stack, snapshot->realEvents, snapshot->realTasks, copies);
+	copy_stack(metered.stack, snapshot->meteredEvents, snapshot->meteredTasks,
+			   copies);
+
+	snapshot->realSeekTime = real.seekTime;
+	snapshot->meteredSeekTime = metered.seekTime;
+	snapshot->realExpansion = real.expansion;
+	snapshot->meteredExpansion = metered.expansion;
+	snapshot->tempo = tempo;
+
+	return snapshot;
+}
+
 void
 CPlaybackTaskGroup::_update(
 	long internalTicks)
@@ -658,7 +1268,8 @@ CPlaybackTaskGroup::_update(
 			{
 				if (real.end < 0)
 					real.end = real.seekTime;
-				_restart();
+				if (!_loop())
+					_restart();
 				nextEventTime = real.time;
 			}
 		}
@@ -670,8 +1281,11 @@ CPlaybackTaskGroup::_update(
 				flags |= Clock_Stopped;
 
 				// Notify the UI that we've changed state.
-				BMessage message(Player_ChangeTransportState);
-				be_app->PostMessage(&message);
+				if (sink == NULL)
+				{
+					BMessage message(Player_ChangeTransportState);
+					be_app->PostMessage(&message);
+				}
 			}
 		}
 	}
@@ -36,9 +36,18 @@
 #include "MeVDoc.h"
 #include "EventTrack.h"
 #include "EventStack.h"
+#include "FixedPool.h"
+#include "MidiChaseState.h"
 #include "PlayerControl.h"
 #include "TempoMap.h"
 
+// Standard Template Library
+#include <map>
+#include <utility>
+#include <vector>
+
+class CEventSink;
+
 /**
  *	A playback task group represents a set of related tasks, such as a song.
  *	@author Talin, Christopher Lenz
@@ -148,6 +157,24 @@ public:							// Operations
 	void						Pause(
 									bool pause);
 
+	/** Play the tracks offline, as fast as possible, from the given
+	 *	metered time for the given metered duration (or to the end),
+	 *	handing every event to the sink instead of its destination.
+	 *	The events before the start are located through, but not
+	 *	handed to the sink. The calling thread drives the clock, so
+	 *	the group is taken off the player's list and can't be used
+	 *	for playback afterwards, but it may render again, using the
+	 *	locate snapshots it took before. Looping is ignored. Returns
+	 *	the real time at which playback ended.
+	 */
+	long						Render(
+									CTrack *track1,
+									CTrack *track2,
+									CEventSink &sink,
+									int32 locTime = 0,
+									int32 duration = -1,
+									int32 optionFlags = 0);
+
 	/** Start playing. */
 	void						Start(
 									CTrack *track1,
@@ -161,6 +188,55 @@ public:							// Operations
 	/** Halt playing and flush all pending note-offs. */
 	void						Stop();
 
+private:						// Types
+
+	/** The state of the group at some point of a locate from the start
+	 *	of the song: copies of the tasks, the pending events, the tempo
+	 *	and the channel state collected by the destinations. A later
+	 *	locate can continue from the latest snapshot before its target,
+	 *	rather than from the start.
+	 */
+	struct LocateSnapshot
+	{
+								LocateSnapshot(
+									int32 taskCount);
+
+								~LocateSnapshot();
+
+		/** Memory for the copies of the tasks. */
+		CFixedPool				taskPool;
+
+		/** Copies of the tasks, in the order of the group's list. */
+		DList					tasks;
+
+		/** The index of the parent of each task copy, or -1. */
+		std::vector<int32>		parents;
+
+		/** The tasks restored from the copies by the latest
+		 *	_restoreSnapshot(), allocated up front.
+		 */
+		std::vector<CPlaybackTask *> restored;
+
+		/** The events pending on the real and metered stacks, in the
+		 *	order in which they were pushed, and for each task marker
+		 *	the index of its task (-1 for other events).
+		 */
+		std::vector<CEvent>		realEvents;
+		std::vector<int32>		realTasks;
+		std::vector<CEvent>		meteredEvents;
+		std::vector<int32>		meteredTasks;
+
+		long					realSeekTime;
+		long					meteredSeekTime;
+		long					realExpansion;
+		long					meteredExpansion;
+
+		CTempoMapEntry			tempo;
+
+		/** The chase state of each destination, by ID. */
+		std::vector<std::pair<long, Midi::CMidiChaseState> > chaseStates;
+	};
+
 private:						// Internal Operations
 
 	// Note that nonoe of the private functions have any locking,
@@ -173,6 +249,9 @@ private:						// Internal Operations
 									long duration,
 									long clockType);
 
+	/** Delete all locate snapshots. */
+	void						_clearSnapshots();
+
 	/** Takes a MeV event sends it out to the MIDI stream.
 	 *	Handles the actual playing of an event. This is where events
 	 *	are sent to AFTER they have been pulled of the player stack, 
@@ -183,12 +262,24 @@ private:						// Internal Operations
 									CEvent &ev,
 									TimeState &);
 								
+	/** Returns the latest snapshot before the locate target, or NULL
+	 *	if there is none.
+	 */
+	LocateSnapshot *			_findSnapshot() const;
+
 	/**	Kill all tasks. */
 	void						_flushTasks();
 
 	void						_flushNotes(
 									CEventStack &stack);
 
+	/** Returns a value that changes with every edit of the document
+	 *	and with every setting which affects playback from the start,
+	 *	so that locate snapshots can be checked for being up to date.
+	 *	The document must be read locked.
+	 */
+	uint32						_getSnapshotKey();
+
 	/** Set all tasks belonging to a particular parent as
 	 *	having expired.
 	 */
@@ -206,9 +297,50 @@ private:						// Internal Operations
 	static int32				_locatorTaskFunc(
 									void *data);
 
+	/** Starts the next pass of an auto-loop from the loop snapshot,
+	 *	without locating. Returns false if there is no snapshot or it
+	 *	is out of date (see _getSnapshotKey()), in which case
+	 *	_restart() has to be used. Restoring the snapshot doesn't
+	 *	allocate memory.
+	 *
+	 *	This is called on the player thread once both stacks have run
+	 *	dry, which is at the loop end, when the main tasks finish. The
+	 *	next pass can't be stacked any earlier, since both passes
+	 *	would have to share the group's clock. The clock keeps going,
+	 *	so the next pass is still timed from the exact loop end, but
+	 *	its first events may come late by the time the restore takes.
+	 *	That jitter at the boundary is accepted.
+	 */
+	bool						_loop();
+
+	/** Hand an event to the sink while rendering, turning pitch bend
+	 *	sweeps into single pitch bends the way a MIDI destination
+	 *	would.
+	 */
+	void						_renderEvent(
+									CEvent &ev,
+									TimeState &tState);
+
 	/** Restarts the track when an auto-loop happens. */
 	void						_restart();
 
+	/** Restore the state of a snapshot. The task list and the stacks
+	 *	must be empty, and the document must be read locked.
+	 */
+	void						_restoreSnapshot(
+									LocateSnapshot &snapshot);
+
+	/** Take a snapshot of the current state, if there isn't one yet
+	 *	for this part of the song and all events up to the seek times
+	 *	have been executed.
+	 */
+	void						_saveSnapshot();
+
+	/** Returns a copy of the current state, or NULL if some of the
+	 *	tasks can't be copied. The document must be read locked.
+	 */
+	LocateSnapshot *			_takeSnapshot();
+
 	/** Update the local time of the playback context. */
 	void						_update(
 									long internalTicks);
@@ -218,6 +350,11 @@ private:						// Instance Data
 	/** List of active tasks for this musical set. */
 	DList						tasks;
 
+	/** The memory the tasks are allocated from, with room for as
+	 *	many tasks as there can be task IDs.
+	 */
+	CFixedPool					taskPool;
+
 	/** Pointer to document (only one document per context, or NULL). */
 	CMeVDoc *					doc;
 
@@ -251,8 +388,30 @@ private:						// Instance Data
 	/** Seperate thread for locating. */
 	thread_id					locatorThread;
 
+	/** Snapshots taken while locating, in the order of time. */
+	std::vector<LocateSnapshot *>	snapshots;
+
+	/** The key of the document state the snapshots belong to. */
+	uint32						snapshotKey;
+
+	/** The state at the start of an auto-loop, taken once locating
+	 *	has finished, or NULL.
+	 */
+	LocateSnapshot *			loopSnapshot;
+
+	/** The key of the document state the loop snapshot belongs to. */
+	uint32						loopSnapshotKey;
+
 	/** Current tempo state. */
 	CTempoMapEntry				tempo;
+
+	/** Where events go while rendering, or NULL when playing. */
+	CEventSink *				sink;
+
+	/** The current and target pitch bend of each destination while
+	 *	rendering.
+	 */
+	std::map<CDestination *, std::pair<int32, int32> >	renderBends;
 };
 
 #endif /* __C_PlaybackTaskGroup_H__ */
@@ -173,9 +173,11 @@ CPlayer::ControlThread()
 		
 		int32 command;
 		CommandArgs args;
+		bool timedOut = true;
 		if (read_port_etc(m_port, &command, &args, sizeof(args),
 						  B_TIMEOUT, wakeUp) >= 0)
 		{
+			timedOut = false;
 			switch (command)
 			{
 				case Command_Start:
@@ -247,7 +249,13 @@ CPlayer::ControlThread()
 		}
 		
 		// And then process any waiting events.
-		m_internalTimerTick = system_time() / 1000;
+		bigtime_t now = system_time();
+		if (timedOut)
+		{
+			// This is the scheduled wakeup, check whether we're late
+			m_statistics.RecordWakeup(now - (bigtime_t)nextEventTime * 1000);
+		}
+		m_internalTimerTick = now / 1000;
 		nextEventTime = m_internalTimerTick + maxSleep;
 		StPlayerLock lock;
 
@@ -65,6 +65,7 @@
 #include "PlaybackTask.h"
 #include "PlaybackTaskGroup.h"
 #include "PlayerControl.h"
+#include "PlayerStatistics.h"
 
 // Support Kit
 #include <Locker.h>
@@ -127,6 +128,10 @@ public:							// Accessors
 	void						CheckLock()
 								{ /* ASSERT( m_lock.IsLocked() ); */ }
 
+	/** Counters for dropped events, late wakeups etc. */
+	CPlayerStatistics &			Statistics()
+								{ return m_statistics; }
+
 public:							// Operations
 
 	// Start all tasks and threads
@@ -190,6 +195,9 @@ private:						// Instance Data
 
 	/** context for playing seperate data */
 	CPlaybackTaskGroup *		m_wildGroup;
+
+	/** Telemetry */
+	CPlayerStatistics			m_statistics;
 };
 
 // Global instance of the player
@@ -4,6 +4,7 @@
 
 #include "PlayerControl.h"
 
+#include "EventSink.h"
 #include "MeVDoc.h"
 #include "PlaybackTask.h"
 #include "Player.h"
@@ -146,6 +147,141 @@ CPlayerControl::PlaySong(
 	write_port(thePlayer.Port(), Command_Start, &args, sizeof(args));
 }
 
+long
+CPlayerControl::RenderSong(
+	CMeVDoc *document,
+	CEventSink &sink,
+	long duration,
+	int16 options)
+{
+	CTrack *meterTrack = document->FindTrack((int32)0);
+	CTrack *realTrack = document->FindTrack(1);
+	if ((meterTrack == NULL) || (realTrack == NULL))
+		return -1;
+
+	CPlaybackTaskGroup *group = new CPlaybackTaskGroup(document);
+	long endTime = group->Render(meterTrack, realTrack, sink, 0, duration,
+								 options);
+	delete group;
+
+	return endTime;
+}
+
+#if DEBUG
+
+// Keeps what a render plays, with the times at which it is played
+class CRenderLog
+	:	public CEventSink
+{
+
+public:
+
+	struct played
+	{
+		CEvent					event;
+		long					realTime;
+		long					meteredTime;
+	};
+
+								CRenderLog()
+									:	m_end(0)
+								{ }
+
+	/** The metered time of the last event played. */
+	long						End() const
+								{ return m_end; }
+
+	/** Returns true if both have played the same events after the
+	 *	given metered time, at the same times.
+	 */
+	bool						Matches(
+									const CRenderLog &other,
+									long after) const
+								{
+									uint32 i = _skip(after);
+									uint32 j = other._skip(after);
+									if (m_played.size() - i != other.m_played.size() - j)
+										return false;
+									for (; i < m_played.size(); i++, j++)
+									{
+										if (!_same(m_played[i], other.m_played[j]))
+											return false;
+									}
+									return true;
+								}
+
+	virtual void				Execute(
+									const CEvent &event,
+									long realTime,
+									long meteredTime)
+								{
+									played p = { event, realTime, meteredTime };
+									m_played.push_back(p);
+									if (meteredTime > m_end)
+										m_end = meteredTime;
+								}
+
+private:
+
+	uint32						_skip(
+									long after) const
+								{
+									uint32 i = 0;
+									while ((i < m_played.size())
+									 && (m_played[i].meteredTime <= after))
+										i++;
+									return i;
+								}
+
+	// Compares the command, channel and data bytes, but not the
+	// task and duration fields, which differ between renders
+	static bool					_same(
+									const played &a,
+									const played &b)
+								{
+									const CEvent &x = a.event;
+									const CEvent &y = b.event;
+									return (a.realTime == b.realTime)
+										&& (a.meteredTime == b.meteredTime)
+										&& (x.common.destination == y.common.destination)
+										&& (x.common.command == y.common.command)
+										&& (x.common.vChannel == y.common.vChannel)
+										&& (x.common.data1 == y.common.data1)
+										&& (x.common.data2 == y.common.data2)
+										&& (x.common.data3 == y.common.data3)
+										&& (x.common.data4 == y.common.data4)
+										&& (x.common.data5 == y.common.data5)
+										&& (x.common.data6 == y.common.data6);
+								}
+
+	std::vector<played>			m_played;
+
+	long						m_end;
+};
+
+bool
+CPlayerControl::ValidateLocate(
+	CMeVDoc *document,
+	long duration)
+{
+	CTrack *meterTrack = document->FindTrack((int32)0);
+	CTrack *realTrack = document->FindTrack(1);
+	if ((meterTrack == NULL) || (realTrack == NULL))
+		return true;
+
+	CRenderLog full, located, restored;
+	CPlaybackTaskGroup *group = new CPlaybackTaskGroup(document);
+	group->Render(meterTrack, realTrack, full, 0, duration);
+	long middle = full.End() / 2;
+	group->Render(meterTrack, realTrack, located, middle, duration - middle);
+	group->Render(meterTrack, realTrack, restored, middle, duration - middle);
+	delete group;
+
+	return full.Matches(located, middle) && full.Matches(restored, middle);
+}
+
+#endif
+
 void
 CPlayerControl::StopSong(
 	CMeVDoc *document)
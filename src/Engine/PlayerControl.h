@@ -43,6 +43,7 @@
 #include "Event.h"
 #include "MeV.h"
 
+class CEventSink;
 class CMeVDoc;
 class CTrack;
 
@@ -146,6 +147,31 @@ public:							// Operations
 									enum ESyncType syncType,
 									int16 options);
 
+	/**	Play a song offline, as fast as possible, handing its events to
+		the sink instead of the destinations. Runs on the calling thread
+		and doesn't affect the song if it is playing at the same time.
+		Returns the real time at which the song ended, or -1 if it has
+		no master tracks.
+	*/
+	static long					RenderSong(
+									CMeVDoc *document,
+									CEventSink &sink,
+									long duration = -1,
+									int16 options = 0);
+
+#if DEBUG
+	/**	Render the song up to the given metered duration from the
+		start, and then twice from the middle, first locating from the
+		start, then from the locate snapshots taken meanwhile. Returns
+		false if the three renders don't play the same events from the
+		middle on. This renders on the calling thread, so it takes a
+		while on long songs.
+	*/
+	static bool					ValidateLocate(
+									CMeVDoc *document,
+									long duration);
+#endif
+
 	/**	Stop playing a song. */
 	static void					StopSong(
 									CMeVDoc *document);
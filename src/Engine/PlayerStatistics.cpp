@@ -0,0 +1,302 @@
+/* ===================================================================== *
+ * PlayerStatistics.cpp (MeV/Engine)
+ * ===================================================================== */
+
+#include "PlayerStatistics.h"
+
+// Gnu C Library
+#include <stdio.h>
+// Support Kit
+#include <Debug.h>
+
+// The slot of m_eventsSent which counts the destinations with other IDs
+#define OTHER_DESTINATIONS (Max_Destinations + 1)
+
+// Upper limits of the lateness histogram buckets (the last bucket
+// takes everything else)
+static const bigtime_t LATENESS_LIMITS[CPlayerStatistics::LATENESS_BUCKETS - 1] =
+{
+	1000LL, 2000LL, 5000LL, 10000LL, 20000LL, 50000LL, 100000LL
+};
+
+// ---------------------------------------------------------------------------
+// Constructor/Destructor
+
+CPlayerStatistics::CPlayerStatistics()
+{
+	Reset();
+}
+
+// ---------------------------------------------------------------------------
+// Accessors
+
+int64
+CPlayerStatistics::StackOverflows() const
+{
+	return atomic_get64((volatile int64 *)&m_stackOverflows);
+}
+
+int32
+CPlayerStatistics::MaxStackDepth() const
+{
+	return (int32)atomic_get64((volatile int64 *)&m_maxStackDepth);
+}
+
+int64
+CPlayerStatistics::Wakeups() const
+{
+	return atomic_get64((volatile int64 *)&m_wakeups);
+}
+
+int64
+CPlayerStatistics::LateWakeups() const
+{
+	return atomic_get64((volatile int64 *)&m_lateWakeups);
+}
+
+int64
+CPlayerStatistics::LatenessCount(
+	int32 bucket) const
+{
+	if ((bucket < 0) || (bucket >= LATENESS_BUCKETS))
+		return 0;
+
+	return atomic_get64((volatile int64 *)&m_latenessHistogram[bucket]);
+}
+
+bigtime_t
+CPlayerStatistics::LatenessLimit(
+	int32 bucket)
+{
+	if ((bucket < 0) || (bucket >= LATENESS_BUCKETS - 1))
+		return B_INFINITE_TIMEOUT;
+
+	return LATENESS_LIMITS[bucket];
+}
+
+bigtime_t
+CPlayerStatistics::MaxLateness() const
+{
+	return atomic_get64((volatile int64 *)&m_maxLateness);
+}
+
+int64
+CPlayerStatistics::EventsSent(
+	long destinationID) const
+{
+	if ((destinationID < 0) || (destinationID > Max_Destinations))
+		return 0;
+
+	return atomic_get64((volatile int64 *)&m_eventsSent[destinationID]);
+}
+
+int64
+CPlayerStatistics::TotalEventsSent() const
+{
+	int64 total = 0;
+	for (int32 i = 0; i <= OTHER_DESTINATIONS; i++)
+		total += atomic_get64((volatile int64 *)&m_eventsSent[i]);
+	return total;
+}
+
+int32
+CPlayerStatistics::Locates() const
+{
+	return (int32)atomic_get64((volatile int64 *)&m_locates);
+}
+
+int32
+CPlayerStatistics::AbandonedLocates() const
+{
+	return (int32)atomic_get64((volatile int64 *)&m_abandonedLocates);
+}
+
+bigtime_t
+CPlayerStatistics::LastLocateDuration() const
+{
+	return atomic_get64((volatile int64 *)&m_lastLocateDuration);
+}
+
+bigtime_t
+CPlayerStatistics::MaxLocateDuration() const
+{
+	return atomic_get64((volatile int64 *)&m_maxLocateDuration);
+}
+
+bigtime_t
+CPlayerStatistics::TotalLocateDuration() const
+{
+	return atomic_get64((volatile int64 *)&m_totalLocateDuration);
+}
+
+int64
+CPlayerStatistics::TaskAllocations() const
+{
+	return atomic_get64((volatile int64 *)&m_taskAllocations);
+}
+
+int64
+CPlayerStatistics::HeapTaskAllocations() const
+{
+	return atomic_get64((volatile int64 *)&m_heapTaskAllocations);
+}
+
+int64
+CPlayerStatistics::LockTimeouts() const
+{
+	return atomic_get64((volatile int64 *)&m_lockTimeouts);
+}
+
+// ---------------------------------------------------------------------------
+// Operations
+
+void
+CPlayerStatistics::RecordStackOverflow()
+{
+	atomic_add64(&m_stackOverflows, 1);
+}
+
+void
+CPlayerStatistics::RecordStackDepth(
+	int32 depth)
+{
+	_max(m_maxStackDepth, depth);
+}
+
+void
+CPlayerStatistics::RecordWakeup(
+	bigtime_t lateness)
+{
+	atomic_add64(&m_wakeups, 1);
+	if (lateness <= 0)
+		return;
+
+	atomic_add64(&m_lateWakeups, 1);
+	_max(m_maxLateness, lateness);
+
+	int32 bucket = 0;
+	while ((bucket < LATENESS_BUCKETS - 1) && (lateness >= LATENESS_LIMITS[bucket]))
+		bucket++;
+	atomic_add64(&m_latenessHistogram[bucket], 1);
+}
+
+void
+CPlayerStatistics::RecordEventSent(
+	long destinationID)
+{
+	if ((destinationID < 0) || (destinationID > Max_Destinations))
+		destinationID = OTHER_DESTINATIONS;
+	atomic_add64(&m_eventsSent[destinationID], 1);
+}
+
+void
+CPlayerStatistics::RecordLocate(
+	bigtime_t duration,
+	bool completed)
+{
+	if (!completed)
+	{
+		atomic_add64(&m_abandonedLocates, 1);
+		return;
+	}
+
+	atomic_add64(&m_locates, 1);
+	atomic_set64(&m_lastLocateDuration, duration);
+	atomic_add64(&m_totalLocateDuration, duration);
+	_max(m_maxLocateDuration, duration);
+}
+
+void
+CPlayerStatistics::RecordTaskAllocation(
+	bool fromHeap)
+{
+	atomic_add64(&m_taskAllocations, 1);
+	if (fromHeap)
+		atomic_add64(&m_heapTaskAllocations, 1);
+}
+
+void
+CPlayerStatistics::RecordLockTimeout()
+{
+	atomic_add64(&m_lockTimeouts, 1);
+}
+
+void
+CPlayerStatistics::Reset()
+{
+	atomic_set64(&m_stackOverflows, 0);
+	atomic_set64(&m_maxStackDepth, 0);
+	atomic_set64(&m_wakeups, 0);
+	atomic_set64(&m_lateWakeups, 0);
+	for (int32 i = 0; i < LATENESS_BUCKETS; i++)
+		atomic_set64(&m_latenessHistogram[i], 0);
+	atomic_set64(&m_maxLateness, 0);
+	for (int32 i = 0; i <= OTHER_DESTINATIONS; i++)
+		atomic_set64(&m_eventsSent[i], 0);
+	atomic_set64(&m_locates, 0);
+	atomic_set64(&m_abandonedLocates, 0);
+	atomic_set64(&m_lastLocateDuration, 0);
+	atomic_set64(&m_maxLocateDuration, 0);
+	atomic_set64(&m_totalLocateDuration, 0);
+	atomic_set64(&m_taskAllocations, 0);
+	atomic_set64(&m_heapTaskAllocations, 0);
+	atomic_set64(&m_lockTimeouts, 0);
+}
+
+void
+CPlayerStatistics::PrintToStream() const
+{
+	printf("CPlayerStatistics:\n");
+	printf("\tstack overflows:      %lld\n", (long long)StackOverflows());
+	printf("\tmax stack depth:      %ld\n", (long)MaxStackDepth());
+	printf("\twakeups:              %lld (%lld late, max %lld usecs)\n",
+		   (long long)Wakeups(), (long long)LateWakeups(),
+		   (long long)MaxLateness());
+	for (int32 i = 0; i < LATENESS_BUCKETS; i++)
+	{
+		if (i < LATENESS_BUCKETS - 1)
+			printf("\t\t< %6lld usecs:     %lld\n",
+				   (long long)LATENESS_LIMITS[i], (long long)LatenessCount(i));
+		else
+			printf("\t\t>= %5lld usecs:     %lld\n",
+				   (long long)LATENESS_LIMITS[i - 1], (long long)LatenessCount(i));
+	}
+	printf("\tlocates:              %ld (%ld abandoned)\n",
+		   (long)Locates(), (long)AbandonedLocates());
+	printf("\tlocate duration:      last %lld, max %lld, total %lld usecs\n",
+		   (long long)LastLocateDuration(), (long long)MaxLocateDuration(),
+		   (long long)TotalLocateDuration());
+	printf("\ttasks started:        %lld (%lld from the heap)\n",
+		   (long long)TaskAllocations(), (long long)HeapTaskAllocations());
+	printf("\tlock timeouts:        %lld\n", (long long)LockTimeouts());
+	printf("\tevents sent:\n");
+	for (int32 i = 0; i <= Max_Destinations; i++)
+	{
+		int64 sent = EventsSent(i);
+		if (sent > 0)
+			printf("\t\tdestination %ld:     %lld\n", (long)i, (long long)sent);
+	}
+	int64 other = atomic_get64((volatile int64 *)&m_eventsSent[OTHER_DESTINATIONS]);
+	if (other > 0)
+		printf("\t\tother destinations: %lld\n", (long long)other);
+}
+
+// ---------------------------------------------------------------------------
+// Internal Operations
+
+void
+CPlayerStatistics::_max(
+	volatile int64 &value,
+	int64 atLeast)
+{
+	int64 current = atomic_get64(&value);
+	while (current < atLeast)
+	{
+		int64 previous = atomic_test_and_set64(&value, atLeast, current);
+		if (previous == current)
+			break;
+		current = previous;
+	}
+}
+
+// END - PlayerStatistics.cpp
@@ -0,0 +1,216 @@
+/* ===================================================================== *
+ * PlayerStatistics.h (MeV/Engine)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s):
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ *  Counters describing the health of the playback engine
+ * ===================================================================== */
+
+#ifndef __C_PlayerStatistics_H__
+#define __C_PlayerStatistics_H__
+
+#include "MeV.h"
+
+// Kernel Kit
+#include <OS.h>
+
+/**
+ *	Keeps track of events that indicate the player is not keeping up:
+ *	events which couldn't be stacked, late wakeups of the player thread
+ *	(with a histogram of how late), the number of events sent to each
+ *	destination, how long locating takes, the deepest the event
+ *	stacks have been, how many playback tasks had to be allocated
+ *	on the heap because their group's task pool was exhausted, and
+ *	how often a track or destination was skipped because it stayed
+ *	locked too long.
+ *
+ *	All operations are thread-safe. The counters are updated with
+ *	atomic operations, so recording never blocks or allocates memory
+ *	on the player thread. They accumulate until Reset() is called;
+ *	a reset or a dump during playback may see some counters updated
+ *	before others.
+ */
+class CPlayerStatistics
+{
+
+public:							// Constants
+
+	enum
+	{
+		/** Number of buckets in the lateness histogram. */
+		LATENESS_BUCKETS		= 8
+	};
+
+public:							// Constructor/Destructor
+
+								CPlayerStatistics();
+
+public:							// Accessors
+
+	/** Number of events that couldn't be pushed on an event stack. */
+	int64						StackOverflows() const;
+
+	/** The largest number of events that have been on a single event
+	 *	stack at once. Stacks only report new highs, so after Reset()
+	 *	this stays zero until a stack exceeds its previous maximum.
+	 */
+	int32						MaxStackDepth() const;
+
+	/** Number of times the player thread has woken up to process
+	 *	events.
+	 */
+	int64						Wakeups() const;
+
+	/** Number of times the player thread woke up after the time it
+	 *	was scheduled for.
+	 */
+	int64						LateWakeups() const;
+
+	/** Number of late wakeups in the given bucket of the lateness
+	 *	histogram.
+	 */
+	int64						LatenessCount(
+									int32 bucket) const;
+
+	/** Upper limit of the given bucket of the lateness histogram. Returns
+	 *	B_INFINITE_TIMEOUT for the last bucket.
+	 */
+	static bigtime_t			LatenessLimit(
+									int32 bucket);
+
+	/** How late the latest wakeup was. */
+	bigtime_t					MaxLateness() const;
+
+	/** Number of events executed by the destination with the given ID.
+	 *	Destinations with IDs above Max_Destinations are only counted
+	 *	in the total.
+	 */
+	int64						EventsSent(
+									long destinationID) const;
+
+	/** Number of events executed by all destinations. */
+	int64						TotalEventsSent() const;
+
+	/** Number of locates that ran to completion. */
+	int32						Locates() const;
+
+	/** Number of locates that were interrupted by a new one. */
+	int32						AbandonedLocates() const;
+
+	/** Duration of the last completed locate. */
+	bigtime_t					LastLocateDuration() const;
+
+	/** Duration of the longest completed locate. */
+	bigtime_t					MaxLocateDuration() const;
+
+	/** Combined duration of all completed locates. */
+	bigtime_t					TotalLocateDuration() const;
+
+	/** Number of playback tasks that have been started. */
+	int64						TaskAllocations() const;
+
+	/** Number of playback tasks that didn't fit into their group's
+	 *	task pool, and were allocated on the heap instead. In steady
+	 *	state this should stay zero.
+	 */
+	int64						HeapTaskAllocations() const;
+
+	/** Number of times the player gave up waiting for a track or a
+	 *	destination to be unlocked, and skipped it for the moment.
+	 */
+	int64						LockTimeouts() const;
+
+public:							// Operations
+
+	void						RecordStackOverflow();
+
+	void						RecordStackDepth(
+									int32 depth);
+
+	/** Record a wakeup of the player thread. A lateness of zero or less
+	 *	means the thread woke up in time.
+	 */
+	void						RecordWakeup(
+									bigtime_t lateness);
+
+	void						RecordEventSent(
+									long destinationID);
+
+	void						RecordLocate(
+									bigtime_t duration,
+									bool completed);
+
+	void						RecordTaskAllocation(
+									bool fromHeap);
+
+	void						RecordLockTimeout();
+
+	/** Clear all counters. */
+	void						Reset();
+
+	/** Dump all counters to stdout. */
+	void						PrintToStream() const;
+
+private:						// Internal Operations
+
+	/** Raise the value to at least the given one. */
+	static void					_max(
+									volatile int64 &value,
+									int64 atLeast);
+
+private:						// Instance Data
+
+	volatile int64				m_stackOverflows;
+
+	volatile int64				m_maxStackDepth;
+
+	volatile int64				m_wakeups;
+
+	volatile int64				m_lateWakeups;
+
+	volatile int64				m_latenessHistogram[LATENESS_BUCKETS];
+
+	volatile int64				m_maxLateness;
+
+	/** Events sent, by destination ID; the last one counts the events
+	 *	of destinations with greater IDs.
+	 */
+	volatile int64				m_eventsSent[Max_Destinations + 2];
+
+	volatile int64				m_locates;
+
+	volatile int64				m_abandonedLocates;
+
+	volatile int64				m_lastLocateDuration;
+
+	volatile int64				m_maxLocateDuration;
+
+	volatile int64				m_totalLocateDuration;
+
+	volatile int64				m_taskAllocations;
+
+	volatile int64				m_heapTaskAllocations;
+
+	volatile int64				m_lockTimeouts;
+};
+
+#endif /* __C_PlayerStatistics_H__ */
@@ -61,7 +61,7 @@ double CTempoMapEntry::InterpolatePeriod( long time, TClockType inClockType ) co
 // ---------------------------------------------------------------------------
 // converts metered time to real time, taking accelerando and such into account.
 
-long CTempoMapEntry::ConvertMeteredToReal( long mTime ) const
+int32 CTempoMapEntry::ConvertMeteredToReal( int32 mTime ) const
 {
 		// Convert relative to last tempo change
 	mTime -= mOrigin;
@@ -81,7 +81,7 @@ long CTempoMapEntry::ConvertMeteredToReal( long mTime ) const
 // ---------------------------------------------------------------------------
 // converts real time to metered time, taking accelerando and such into account.
 
-long CTempoMapEntry::ConvertRealToMetered( long rTime ) const
+int32 CTempoMapEntry::ConvertRealToMetered( int32 rTime ) const
 {
 		// Convert relative to last tempo change
 	rTime -= rOrigin;
@@ -88,7 +88,10 @@ void
 CTrack::SetName(
 	const char *name)
 {
+	char oldName[TRACK_NAME_LENGTH];
+	strncpy(oldName, m_name, TRACK_NAME_LENGTH);
 	strncpy(m_name, name, TRACK_NAME_LENGTH);
+	Document()._trackRenamed(this, oldName);
 
 	// Tell everyone that the name of the track changed
 	CUpdateHint hint;
@@ -209,6 +212,7 @@ CTrack::Delete()
 {
 	if (Document().tracks.RemoveItem(this))
 	{
+		Document()._unindexTrack(this);
 		m_deleted = true;
 		Document().SetModified();
 
@@ -227,6 +231,7 @@ CTrack::Undelete(
 {
 	if (Document().tracks.AddItem(this, originalIndex))
 	{
+		Document()._indexTrack(this);
 		m_deleted = false;
 		Document().SetModified();
 
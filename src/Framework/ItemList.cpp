@@ -4,6 +4,9 @@
 
 #include "ItemList.h"
 
+// Standard C Library
+#include <string.h>
+
 /* ===================================================================== *
    Dummy class for measuring offsets
  * ===================================================================== */
@@ -34,6 +37,8 @@ ItemList_Base::ItemList_Base( short inItemSize, short inItemsPerBlock )
 	itemSize = inItemSize;
 	itemsPerBlock = inItemsPerBlock;
 	count = blockCount = 0;
+	root = NULL;
+	seed = 1;
 }
 
 ItemList_Base::~ItemList_Base()
@@ -88,11 +93,13 @@ void ItemList_Base::Compact( ItemBlock_Base *block )
 					copyCount );
 					
 		block->count += (short)copyCount;
+		CountChanged( block );
 		OnBlockChanged( block );
 
 			// Copy the data from the end of the next block to the
 			// start of the next block
 		nextBlock->count -= (short)copyCount;
+		CountChanged( nextBlock );
 		if (nextBlock->count > 0)
 		{
 			MoveItems(	ItemBlock_Metric::address( nextBlock, 0, itemSize ),
@@ -143,8 +150,11 @@ void ItemList_Base::Compact( ItemBlock_Base *block )
 
 		if (nextBlock->count == 0)
 		{
+			UnlinkBlock( nextBlock );
 			nextBlock->Remove();
 			delete nextBlock;
+			blockCount--;
+			OnBlockListChanged();
 		}
 		else
 		{
@@ -171,6 +181,8 @@ bool ItemList_Base::Split( ItemBlock_Base *block, short index )
 	newBlk = (ItemBlock_Base *)NewBlock();	// alloc block to hold spit
 	newBlk->count = 0;
 	block->InsertAfter( newBlk );
+	blockCount++;
+	LinkBlock( newBlk );
 	
 	MoveItems(	ItemBlock_Metric::address( newBlk, 0, itemSize ),
 				ItemBlock_Metric::address( block, index, itemSize ),
@@ -179,8 +191,11 @@ bool ItemList_Base::Split( ItemBlock_Base *block, short index )
 		// Adjust item counts for both blocks
 	block->count -= copyCount;
 	newBlk->count = copyCount;
+	CountChanged( block );
+	CountChanged( newBlk );
 
 	OnBlockChanged( block );
+	OnBlockListChanged();
 
 #if 0
 		// Update all marker positions in this next block
@@ -215,9 +230,9 @@ long ItemList_Base::Replace(
 	long				actual = 0,
 					start = where->index;
 				
-	if (inSaveUndo)
+	if (inSaveUndo && !SaveChanges( where, list, inItemCount, inSaveUndo ))
 	{
-		un = new UndoItem( *inSaveUndo, inItemCount, itemSize );
+		un = new ( *inSaveUndo ) UndoItem( *inSaveUndo, inItemCount, itemSize );
 		unData = (char *)un->undoData;
 		un->actionType = UndoItem::Action_Change;
 		un->index = where->AbsIndex();
@@ -256,6 +271,74 @@ long ItemList_Base::Replace(
 	return actual;
 }
 
+	// Save the bytes in which the items at a position differ from a list of
+	// new items. This only works for items which can be restored from their
+	// bytes, and which aren't too large to have their offsets kept in a
+	// byte. The bytes are saved as the XOR of the old and new bytes, so that
+	// applying them again turns either version into the other.
+bool ItemList_Base::SaveChanges(
+	ItemMarker_Base	*where,
+	void				*list,
+	long				inItemCount,
+	ItemListUndoAction_Base *inSaveUndo )
+{
+	ItemBlock_Base	*blk;
+	char				*srcData;
+	long				actual,
+					start,
+					first;
+
+	if (itemSize > 255) return false;
+
+		// First make sure that none of the items, old or new, owns data.
+	srcData = (char *)list;
+	actual = 0;
+	start = where->index;
+	for (blk = where->block; blk && actual < inItemCount; blk = blk->Next())
+	{
+		long		copyCount = MIN( blk->count - start, inItemCount - actual );
+
+		for (long i = 0; i < copyCount; i++, srcData += itemSize)
+		{
+			if (	!IsPlainItem( ItemBlock_Metric::address( blk, start + i, itemSize ) )
+				||	!IsPlainItem( srcData ))
+			{
+				return false;
+			}
+		}
+		actual += copyCount;
+		start = 0;
+	}
+
+		// Then save the range of bytes that changed in each item.
+	first = where->AbsIndex();
+	srcData = (char *)list;
+	actual = 0;
+	start = where->index;
+	for (blk = where->block; blk && actual < inItemCount; blk = blk->Next())
+	{
+		long		copyCount = MIN( blk->count - start, inItemCount - actual );
+
+		for (long i = 0; i < copyCount; i++, srcData += itemSize)
+		{
+			uint8	*oldItem = (uint8 *)ItemBlock_Metric::address( blk, start + i, itemSize ),
+					*newItem = (uint8 *)srcData;
+			int32	lo = 0,
+					hi = itemSize;
+
+			while (lo < hi && oldItem[ lo ] == newItem[ lo ]) lo++;
+			if (lo == hi) continue;
+			while (oldItem[ hi - 1 ] == newItem[ hi - 1 ]) hi--;
+
+			if (!inSaveUndo->SaveChange( first + actual + i, oldItem, newItem, lo, hi - lo ))
+				throw std::bad_alloc();
+		}
+		actual += copyCount;
+		start = 0;
+	}
+	return true;
+}
+
 	// Swap the contents of a buffer and a range of data in the list. This is
 	// used for undoing a change operation. No new undo record is made.
 
@@ -317,7 +400,7 @@ void ItemList_Base::Remove(
 		// Build an undo record for this action
 	if (inSaveUndo)
 	{
-		un = new UndoItem( *inSaveUndo, inItemCount, itemSize );
+		un = new ( *inSaveUndo ) UndoItem( *inSaveUndo, inItemCount, itemSize );
 		unData = (char *)un->undoData;
 		un->actionType = UndoItem::Action_Delete;
 		un->index = where->AbsIndex();
@@ -357,6 +440,7 @@ void ItemList_Base::Remove(
 
 		blk->count -= (short)copyCount;		// subtract from length of block
 		count -= copyCount;
+		CountChanged( blk );
 		OnBlockChanged( blk );
 
 			// Adjust all markers in this block
@@ -406,8 +490,11 @@ void ItemList_Base::Remove(
 		if (blk->count == 0)
 		{
 			if (cBlk == blk) cBlk = nextBlk;
+			UnlinkBlock( blk );
 			blk->Remove();
 			delete blk;
+			blockCount--;
+			OnBlockListChanged();
 		}
 		
 		actual += copyCount;				// increment the count of copied items
@@ -448,6 +535,9 @@ bool ItemList_Base::Insert(
 		blk = (ItemBlock_Base *)NewBlock();
 		blk->count = 0;
 		blocks.AddTail( blk );
+		blockCount++;
+		LinkBlock( blk );
+		OnBlockListChanged();
 
 			// set the marker to the beginning of the list.
 		where->First();
@@ -459,7 +549,7 @@ bool ItemList_Base::Insert(
 		// Build an undo record for this action
 	if (inSaveUndo)
 	{
-		un = new UndoItem( *inSaveUndo, inItemCount, itemSize );
+		un = new ( *inSaveUndo ) UndoItem( *inSaveUndo, inItemCount, itemSize );
 		unData = (char *)un->undoData;
 		un->actionType = UndoItem::Action_Insert;
 		un->index = where->AbsIndex();
@@ -481,6 +571,7 @@ bool ItemList_Base::Insert(
 						inItemCount );
 		blk->count += (short)inItemCount;
 		count += inItemCount;
+		CountChanged( blk );
 		OnBlockChanged( blk );
 
 			// Keep the undo data
@@ -584,6 +675,8 @@ bool ItemList_Base::Insert(
 						copyCount );
 		baseBlock->count += (short)copyCount;
 		count += copyCount;
+		CountChanged( baseBlock );
+		OnBlockChanged( baseBlock );
 		
 			// Also, move a copy to the undo area.
 		if (unData)
@@ -606,6 +699,7 @@ bool ItemList_Base::Insert(
 
 			// Insert the block after the previous block
 		prevBlock->InsertAfter( blk );
+		blockCount++;
 		
 			// Copy in the data, and set the block size
 		ConstructItems(	ItemBlock_Metric::address( blk, 0, itemSize ),
@@ -613,6 +707,7 @@ bool ItemList_Base::Insert(
 						copyCount );
 		blk->count = (short)copyCount;
 		count += copyCount;
+		LinkBlock( blk );
 		
 			// Also, move a copy to the undo area.
 		if (unData)
@@ -626,6 +721,8 @@ bool ItemList_Base::Insert(
 		actual += copyCount;
 	}
 
+	OnBlockListChanged();
+
 	if (where->index >= itemsPerBlock)
 	{	
 			// Since we didn't insert anything into the first block, it means that
@@ -697,6 +794,187 @@ bool ItemList_Base::Insert(
 	return true;
 }
 
+void ItemList_Base::Append(
+	void				*items,
+	long				inItemCount,
+	short			inFillCount )
+{
+	ItemBlock_Base	*blk = LastBlock(),		// block being filled
+					*oldLast = blk;			// last block before the append
+	char				*srcData = (char *)items;
+	bool				oldLastChanged = false,
+					blocksAdded = false;
+
+	if (inFillCount < 1) inFillCount = 1;
+	if (inFillCount > itemsPerBlock) inFillCount = itemsPerBlock;
+
+	while (inItemCount > 0)
+	{
+		long			actual;
+
+			// Start a new block once the current one is full enough
+		if (blk == NULL || blk->count >= inFillCount)
+		{
+			blk = (ItemBlock_Base *)NewBlock();
+			blk->count = 0;
+			blocks.AddTail( blk );
+			blockCount++;
+			LinkBlock( blk );
+			blocksAdded = true;
+		}
+		else if (blk == oldLast) oldLastChanged = true;
+
+		actual = inFillCount - blk->count;
+		if (actual > inItemCount) actual = inItemCount;
+
+		MoveItems( ItemBlock_Metric::address( blk, blk->count, itemSize ),
+				   srcData,
+				   actual );
+
+		blk->count += actual;
+		count += actual;
+		CountChanged( blk );
+		srcData += actual * itemSize;
+		inItemCount -= actual;
+	}
+
+		// Only one notification for the whole lot
+	if (oldLastChanged) OnBlockChanged( oldLast );
+	if (blocksAdded) OnBlockListChanged();
+}
+
+	// Add a block to the block tree. It has to be in the list already, so
+	// that it can go right after its predecessor.
+void ItemList_Base::LinkBlock( ItemBlock_Base *block )
+{
+	ItemBlock_Base	*prev = block->Prev(),
+					*p;
+
+	block->left = block->right = NULL;
+	block->total = block->count;
+	seed = seed * 1664525 + 1013904223;
+	block->priority = seed;
+
+	if (root == NULL)
+	{
+		block->parent = NULL;
+		root = block;
+		return;
+	}
+
+		// Its place is the leftmost one after the predecessor, or the
+		// leftmost one of all if there is none.
+	if (prev != NULL && prev->right == NULL)
+	{
+		prev->right = block;
+		p = prev;
+	}
+	else
+	{
+		for (p = prev ? prev->right : root; p->left; p = p->left) ;
+		p->left = block;
+	}
+	block->parent = p;
+
+	for (; p != NULL; p = p->parent) p->total += block->count;
+
+		// Then rotate it up until the priorities are in order again
+	while (block->parent && block->parent->priority < block->priority)
+		RotateUp( block );
+}
+
+	// Take a block out of the block tree.
+void ItemList_Base::UnlinkBlock( ItemBlock_Base *block )
+{
+	ItemBlock_Base	*child,
+					*p;
+
+		// Rotate it down until it has only one child, which then takes
+		// its place.
+	while (block->left && block->right)
+	{
+		RotateUp( block->left->priority > block->right->priority
+					? block->left : block->right );
+	}
+
+	child = block->left ? block->left : block->right;
+	long removed = block->total - Total( child );
+
+	p = block->parent;
+	if (child) child->parent = p;
+	if (p == NULL) root = child;
+	else if (p->left == block) p->left = child;
+	else p->right = child;
+
+	for (; p != NULL; p = p->parent) p->total -= removed;
+}
+
+void ItemList_Base::RotateUp( ItemBlock_Base *block )
+{
+	ItemBlock_Base	*p = block->parent,
+					*g = p->parent;
+
+	if (p->left == block)
+	{
+		p->left = block->right;
+		if (block->right) block->right->parent = p;
+		block->right = p;
+	}
+	else
+	{
+		p->right = block->left;
+		if (block->left) block->left->parent = p;
+		block->left = p;
+	}
+	p->parent = block;
+
+	block->parent = g;
+	if (g == NULL) root = block;
+	else if (g->left == p) g->left = block;
+	else g->right = block;
+
+	p->total = Total( p->left ) + Total( p->right ) + p->count;
+	block->total = Total( block->left ) + Total( block->right ) + block->count;
+}
+
+void ItemList_Base::CountChanged( ItemBlock_Base *block )
+{
+	for (; block != NULL; block = block->parent)
+		block->total = Total( block->left ) + Total( block->right ) + block->count;
+}
+
+long ItemList_Base::BlockStart( ItemBlock_Base *block ) const
+{
+	long			pos = Total( block->left );
+
+	for (; block->parent; block = block->parent)
+	{
+		if (block->parent->right == block)
+			pos += Total( block->parent->left ) + block->parent->count;
+	}
+	return pos;
+}
+
+ItemBlock_Base *ItemList_Base::FindBlock( long &index ) const
+{
+	ItemBlock_Base	*b = root;
+
+	for (;;)
+	{
+		long		leftTotal = Total( b->left );
+
+		if (index < leftTotal)
+		{
+			b = b->left;
+			continue;
+		}
+		index -= leftTotal;
+		if (index < b->count) return b;
+		index -= b->count;
+		b = b->right;
+	}
+}
+
 #if DEBUG
 void ItemList_Base::Validate()
 {
@@ -797,20 +1075,13 @@ void ItemMarker_Base::SetIndex( short n )
 	// return the absolute item number in the list
 long ItemMarker_Base::AbsIndex() const
 {
-	ItemBlock_Base	*b;
-	long			pos = 0;
-	
 	if (block == NULL || blockList == NULL) return 0;
-	
-	for (b = blockList->FirstBlock(); b && b != block; b = b->Next())
-	{
-		pos += b->count;
-	}
-	return pos + index;
+
+	return blockList->BlockStart( block ) + index;
 }
 
 	// peek forward or backwards some items
-void *ItemMarker_Base::Peek( signed long offset ) const
+void *ItemMarker_Base::Peek( int32 offset ) const
 {
 	ItemBlock_Base	*b = block;
 	signed long		pos = index + offset;
@@ -836,11 +1107,11 @@ void *ItemMarker_Base::Peek( signed long offset ) const
 		}
 	}
 	
-	return (void *)( ItemBlock_Metric::address( block, pos, blockList->itemSize ) );
+	return (void *)( ItemBlock_Metric::address( b, pos, blockList->itemSize ) );
 }
 
 	// seek forward or backwards in the list
-void *ItemMarker_Base::Seek( signed long offset )
+void *ItemMarker_Base::Seek( int32 offset )
 {
 	ItemBlock_Base	*b = block;
 	signed long		pos = index + offset;
@@ -918,13 +1189,22 @@ void *ItemMarker_Base::Last()
 	return NULL;
 }
 
-	// point the position marker to a specific item
-	// REM: This can be optimized a bit...
-void *ItemMarker_Base::Set( long index )
+	// point the position marker to a specific item. Like seeking there
+	// from the start, this returns NULL for the first item.
+void *ItemMarker_Base::Set( long inIndex )
 {
-	First();
-	if (index == 0 && block == NULL) return NULL;
-	return Seek( index );
+	if (inIndex <= 0 || blockList == NULL || blockList->FirstBlock() == NULL)
+		return First();
+
+	if (inIndex >= blockList->count)
+	{
+		Last();
+		return NULL;
+	}
+
+	SetBlock( blockList->FindBlock( inIndex ) );
+	SetIndex( (short)inIndex );
+	return item;
 }
 
 	// true if at start of list
@@ -974,17 +1254,263 @@ long ItemMarker_Base::Get( void *list, long inItemCount ) const
 
 UndoItem::UndoItem( ItemListUndoAction_Base &inAction, long itemCount, size_t itemSize )
 {
-	undoData = (void *)(new char [ itemCount * itemSize ]);
+	dataSize = dataCapacity = itemCount * itemSize;
+	undoData = dataSize > 0 ? inAction.data.Allocate( dataSize ) : NULL;
+	if (dataSize > 0 && undoData == NULL) throw std::bad_alloc();
 
+	index = 0;
 	numItems = itemCount;
 	inAction.editList.AddTail( this );
-	inAction.size += sizeof *this + itemCount * itemSize;
+	inAction.dirty = true;
 }
 
 UndoItem::~UndoItem()
 {
 	Remove();
-	if (undoData) delete undoData;
+}
+
+/* ===================================================================== *
+   ItemListUndoAction_Base member functions.
+ * ===================================================================== */
+
+	// Write a number in as few bytes as possible, seven bits at a time
+static inline uint8 *write_varint( uint8 *p, uint32 value )
+{
+	while (value >= 0x80)
+	{
+		*p++ = (uint8)(value | 0x80);
+		value >>= 7;
+	}
+	*p++ = (uint8)value;
+	return p;
+}
+
+static inline const uint8 *read_varint( const uint8 *p, uint32 &value )
+{
+	int			shift = 0;
+
+	value = 0;
+	while (*p & 0x80)
+	{
+		value |= (uint32)(*p++ & 0x7f) << shift;
+		shift += 7;
+	}
+	value |= (uint32)*p++ << shift;
+	return p;
+}
+
+	// The memory held by the records and their data. What's in the spill
+	// file isn't counted.
+int32 ItemListUndoAction_Base::Size()
+{
+	return sizeof *this + headers.Size() + data.Size();
+}
+
+	// Save the bytes in which an item has changed. Each change is saved as
+	// the number of items since the last change in the same record, the
+	// offset and length of the changed bytes, and the changed bytes XORed
+	// with the old ones. A record keeps growing as long as the changes move
+	// forward through the list, which is what most edits do.
+bool ItemListUndoAction_Base::SaveChange(
+	long				inIndex,
+	const uint8		*inOldItem,
+	const uint8		*inNewItem,
+	int32			inOffset,
+	int32			inLength )
+{
+	UndoItem			*un = (UndoItem *)editList.Last();
+	int32			skip = 0;
+
+	if (	un != NULL
+		&&	un->actionType == UndoItem::Action_Delta
+		&&	inIndex >= un->index + un->numItems - 1)
+	{
+		skip = inIndex - (un->index + un->numItems - 1);
+		un->numItems += skip;
+	}
+	else
+	{
+		un = new ( *this ) UndoItem( *this, 0, 0 );
+		un->actionType = UndoItem::Action_Delta;
+		un->index = inIndex;
+		un->numItems = 1;
+	}
+
+		// Make room for the change, in place if possible
+	int32			needed = un->dataSize + 5 + 2 + inLength;
+
+	if (needed > un->dataCapacity)
+	{
+		if (un->undoData != NULL && data.Extend( un->undoData, un->dataCapacity, needed ))
+			un->dataCapacity = needed;
+		else
+		{
+			int32	capacity = MAX( needed, un->dataCapacity * 2 );
+			void		*newData = data.Allocate( capacity );
+
+			if (newData == NULL) return false;
+			if (un->dataSize > 0) memcpy( newData, un->undoData, un->dataSize );
+			un->undoData = newData;
+			un->dataCapacity = capacity;
+		}
+	}
+
+	uint8			*p = (uint8 *)un->undoData + un->dataSize;
+
+	p = write_varint( p, skip );
+	*p++ = (uint8)inOffset;
+	*p++ = (uint8)inLength;
+	for (int32 i = 0; i < inLength; i++)
+		*p++ = inOldItem[ inOffset + i ] ^ inNewItem[ inOffset + i ];
+
+	un->dataSize = p - (uint8 *)un->undoData;
+	dirty = true;
+	return true;
+}
+
+	// Apply the changes saved by SaveChange(). Since they are XORed, this
+	// swaps the old and new bytes either way.
+void ItemListUndoAction_Base::ApplyChanges( UndoItem *inItem )
+{
+	long				absIndex = inItem->index,
+					pos = absIndex;
+	ItemBlock_Base	*blk = list.FindBlock( pos );
+	const uint8		*p = (const uint8 *)inItem->undoData,
+					*end = p + inItem->dataSize;
+
+	while (p < end)
+	{
+		uint32		skip;
+		int32		offset,
+					length;
+
+		p = read_varint( p, skip );
+		offset = *p++;
+		length = *p++;
+
+			// Changes may be far apart, so look up the block of any
+			// item beyond the current one.
+		absIndex += skip;
+		pos += skip;
+		if (pos >= blk->count)
+		{
+			list.OnBlockChanged( blk );
+			pos = absIndex;
+			blk = list.FindBlock( pos );
+		}
+
+		uint8		*item = (uint8 *)ItemBlock_Metric::address( blk, pos, list.itemSize );
+
+		OnItemsChanged( item, 1 );
+		for (int32 i = 0; i < length; i++)
+			item[ offset + i ] ^= *p++;
+		OnItemsChanged( item, 1 );
+	}
+	list.OnBlockChanged( blk );
+}
+
+	// Write the undo data to a file. Items which own data can't be written
+	// out, since they would have to be destroyed along with the action.
+int32 ItemListUndoAction_Base::Spill( UndoSpillFile &inFile )
+{
+	UndoItem			*un;
+	int32			before = Size();
+
+	if (spilled || editList.Empty()) return 0;
+
+	for (un = (UndoItem *)editList.First(); un != NULL; un = (UndoItem *)un->Next())
+	{
+		if (!un->HoldsItems()) continue;
+
+		for (long i = 0; i < un->numItems; i++)
+		{
+			if (!list.IsPlainItem( (char *)un->undoData + i * list.itemSize ))
+				return 0;
+		}
+	}
+
+		// If the file already has the data from the last time, it needn't
+		// be written again.
+	if (dirty || spillFile != &inFile)
+	{
+		int32		size = 0;
+
+		for (un = (UndoItem *)editList.First(); un != NULL; un = (UndoItem *)un->Next())
+			size += un->dataSize;
+
+			// Give back the out of date copy, so that its space can be used
+		if (spillFile != NULL) spillFile->Free( spillOffset, spillSize );
+		spillFile = NULL;
+		spillOffset = 0;
+		spillSize = 0;
+
+		long			offset = size > 0 ? inFile.Allocate( size ) : 0;
+		FILE			*file = inFile.File();
+
+		if (offset < 0) return 0;
+		if (size > 0 && fseek( file, offset, SEEK_SET ) != 0)
+		{
+			inFile.Free( offset, size );
+			return 0;
+		}
+
+		for (un = (UndoItem *)editList.First(); un != NULL; un = (UndoItem *)un->Next())
+		{
+			if (un->dataSize == 0) continue;
+			if (fwrite( un->undoData, un->dataSize, 1, file ) != 1)
+			{
+				inFile.Free( offset, size );
+				return 0;
+			}
+		}
+
+		spillFile = &inFile;
+		spillOffset = offset;
+		spillSize = size;
+		dirty = false;
+	}
+
+	for (un = (UndoItem *)editList.First(); un != NULL; un = (UndoItem *)un->Next())
+	{
+		un->undoData = NULL;
+		un->dataCapacity = 0;
+	}
+	data.Clear();
+	spilled = true;
+
+	return before - Size();
+}
+
+	// Read back the undo data written by Spill().
+void ItemListUndoAction_Base::Reload()
+{
+	if (!spilled) return;
+
+		// Nothing but the headers was spilled if there was no data.
+	if (spillSize == 0)
+	{
+		spilled = false;
+		return;
+	}
+
+	char				*buffer = (char *)data.Allocate( spillSize );
+	FILE				*file = spillFile->File();
+
+	if (	buffer == NULL
+		||	fseek( file, spillOffset, SEEK_SET ) != 0
+		||	fread( buffer, spillSize, 1, file ) != 1)
+	{
+		throw std::bad_alloc();
+	}
+
+	for (UndoItem *un = (UndoItem *)editList.First(); un != NULL; un = (UndoItem *)un->Next())
+	{
+		if (un->dataSize == 0) continue;
+		un->undoData = buffer;
+		un->dataCapacity = un->dataSize;
+		buffer += un->dataSize;
+	}
+	spilled = false;
 }
 
 	// undo last action
@@ -992,11 +1518,20 @@ void ItemListUndoAction_Base::Undo()
 {
 	ItemMarker_Base	iPos( list );
 	
+	Reload();
+
 	for (DNode *d = editList.Last(); d != NULL; d = d->Prev())
 	{
 		UndoItem		*uItem = (UndoItem *)d;
 
+		if (uItem->actionType == UndoItem::Action_Delta)
+		{
+			ApplyChanges( uItem );
+			continue;
+		}
+
 		iPos.Set( uItem->index );
+		OnItemsChanged( uItem->undoData, uItem->numItems );
 
 		switch (uItem->actionType) {
 	    case UndoItem::Action_Delete:
@@ -1009,6 +1544,8 @@ void ItemListUndoAction_Base::Undo()
 
 	    case UndoItem::Action_Change:
 			list.Swap( &iPos, uItem->undoData, uItem->numItems );
+			OnItemsChanged( uItem->undoData, uItem->numItems );
+			dirty = true;
 			break;
 		}
 	}
@@ -1019,11 +1556,21 @@ void ItemListUndoAction_Base::Redo()
 {
 	ItemMarker_Base	iPos( list );
 
+	Reload();
+
 	for (DNode *d = editList.First(); d != NULL; d = d->Next())
 	{
 		UndoItem		*uItem = (UndoItem *)d;
 		
+		if (uItem->actionType == UndoItem::Action_Delta)
+		{
+			ApplyChanges( uItem );
+			continue;
+		}
+
 		iPos.Set( uItem->index );
+		OnItemsChanged( uItem->undoData, uItem->numItems );
+
 		switch (uItem->actionType) {
 	    case UndoItem::Action_Insert:
 			list.Insert( &iPos, uItem->undoData, uItem->numItems, 0);
@@ -1035,31 +1582,9 @@ void ItemListUndoAction_Base::Redo()
 
 	    case UndoItem::Action_Change:
 			list.Swap( &iPos, uItem->undoData, uItem->numItems );
+			OnItemsChanged( uItem->undoData, uItem->numItems );
+			dirty = true;
 	        break;
 		}
 	}
 }
-
-void *ItemListUndoAction_Base::CUndoIterator::Next()
-{
-	if (item == NULL) return NULL;
-	if (++index >= item->numItems)
-	{
-		DNode		*d = item->Next();
-	
-		index = 0;
-		if (d == NULL)
-		{
-			item = NULL;
-			return NULL;
-		}
-		item = (UndoItem *)d;
-	}
-	return (uint8 *)item->undoData + index * itemSize;
-}
-		
-void *ItemListUndoAction_Base::CUndoIterator::Item()
-{
-	if (item == NULL) return NULL;
-	return (uint8 *)item->undoData + index * itemSize;
-}
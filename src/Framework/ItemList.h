@@ -92,11 +92,19 @@ class ItemBlock_Base : private DNode {
 
 	friend class	ItemList_Base;
 	friend class	ItemMarker_Base;
+	friend class	ItemListUndoAction_Base;
 
 protected:
 	uint16			count;					// number of items in block
 	DList			markers;				// markers pointing to this block
 
+		// The block's node in the block tree of the list (see ItemList_Base)
+	ItemBlock_Base	*parent,
+					*left,
+					*right;
+	uint32			priority;				// higher than that of the children
+	int32			total;					// number of items in the subtree
+
 		// Member functions to iterate through list of blocks.
 	ItemBlock_Base *Next() const { return (ItemBlock_Base *)DNode::Next(); }
 	ItemBlock_Base *Prev() const { return (ItemBlock_Base *)DNode::Prev(); }
@@ -127,6 +135,14 @@ protected:
 
 	DList			blocks;					// list of item blocks
 
+		// The blocks are also kept in a tree, in list order and balanced by
+		// random priorities (a treap), where each block knows how many
+		// items there are in its subtree. This takes absolute positions to
+		// blocks and back in logarithmic time. Whatever changes the blocks
+		// or their counts has to keep it up to date.
+	ItemBlock_Base	*root;					// root of the block tree
+	uint32			seed;					// for the block priorities
+
 protected:
 		// constructor
 	ItemList_Base( short inItemSize, short inItemsPerBlock );
@@ -155,11 +171,35 @@ protected:
 					void				*inItemArray,		// List of items to swap
 					long				inItemCount );		// # of items in list
 
+		// Append items at the end of the list, moving them out of the array
+		// instead of inserting them one at a time. The last block is topped
+		// up, and new blocks are filled, to inFillCount items. No undo is
+		// saved and markers are not adjusted, so this is for building lists.
+	void Append(		void				*inItemArray,		// Items to append (moved)
+					long				inNumItems,			// Number of items to append
+					short			inFillCount );		// Items per block to fill up to
+
 	ItemBlock_Base *FirstBlock() const
 		{ return (ItemBlock_Base *)blocks.First(); }
 	ItemBlock_Base *LastBlock() const
 		{ return (ItemBlock_Base *)blocks.Last(); }
 
+		// Maintenance of the block tree. LinkBlock() adds a block which has
+		// just been linked into the list, UnlinkBlock() takes one out before
+		// it is removed from the list, and CountChanged() has to be called
+		// whenever the count of a block changes.
+	void LinkBlock(	ItemBlock_Base *inBlock );
+	void UnlinkBlock( ItemBlock_Base *inBlock );
+	void CountChanged( ItemBlock_Base *inBlock );
+
+		// Absolute position of the first item in a block
+	long BlockStart( ItemBlock_Base *inBlock ) const;
+
+		// Find the block holding the item at an absolute position, which
+		// has to be within the list. On return, ioIndex is the position
+		// within the block.
+	ItemBlock_Base *FindBlock( long &ioIndex ) const;
+
 		// Allocate a new block. Must be overridden.
 	virtual void *NewBlock() = 0;
 
@@ -167,7 +207,17 @@ protected:
 		// of extra information associated with a block that needs to be changed.
 	virtual void OnBlockChanged( ItemBlock_Base * ) {}
 
+		// Notifies subclasses that blocks have been added to or removed from
+		// the list. Any block pointers cached by the subclass may be stale.
+	virtual void OnBlockListChanged() {}
+
 private:
+		// Number of items in a subtree of the block tree
+	static int32 Total( ItemBlock_Base *b ) { return b ? b->total : 0; }
+
+		// Rotate a block of the block tree above its parent
+	void RotateUp( ItemBlock_Base *inBlock );
+
 		// These functions are used in the management of items. Since we
 		// have problems using real destructors, these serve as "fake"
 		// constructors and destructors which can be over-ridden by
@@ -185,6 +235,19 @@ private:
 		// Destroy items
 	virtual void DestroyItems( void *outDst, long inItemCount ) = 0;
 
+		// Return true if an item doesn't refer to any data that it owns,
+		// so that it can be restored from its bytes alone. Changes to such
+		// items are saved for undo as just the bytes that changed.
+	virtual bool IsPlainItem( const void *inItem ) const { return false; }
+
+		// Save the bytes in which the items at a position differ from a
+		// list of new items. Returns false, without saving anything, if
+		// the items have to be saved whole.
+	bool SaveChanges(	ItemMarker_Base *inListPos,
+					void				*inItemArray,
+					long				inItemCount,
+					ItemListUndoAction_Base *inSaveUndo );
+
 public:
 	long TotalItems() const { return count; }
 
@@ -517,48 +580,45 @@ class ItemListUndoAction_Base : public UndoAction {
 	friend class		ItemList_Base;
 	friend class		UndoItem;
 
-	int32			size;
+	UndoPool			headers,				// pool of undo records
+					data;					// pool of undo data
+
+		// Where the undo data was written to by Spill(). If it has been
+		// changed since, it has to be written again. The range is kept
+		// after a reload, and given back when the action is destroyed.
+	UndoSpillFile		*spillFile;
+	long				spillOffset;
+	int32			spillSize;
+	bool				spilled,				// undo data is only in the file
+					dirty;					// file is out of date
+
+		// Save the bytes in which an item has changed, adding to the last
+		// undo record if it holds changes to items at or before it.
+	bool SaveChange(	long				inIndex,
+					const uint8		*inOldItem,
+					const uint8		*inNewItem,
+					int32			inOffset,
+					int32			inLength );
+
+		// Apply the changes saved by SaveChange(). Does the same for undo
+		// as for redo.
+	void ApplyChanges( UndoItem *inItem );
+
+		// Read back the undo data written by Spill().
+	void Reload();
 
 protected:
 	ItemList_Base	&list;
 	DList			editList;
 
-		/**	An embedded class used by subclasses to iterate through the
-			undo data. The main purpose is to allow for smarter screen updates
-			by peeking at the undo data. */
-	class CUndoIterator {
-		UndoItem		*item;
-		int32		index;
-		int32		itemSize;
-	public:
-			/**	Constructor */
-		CUndoIterator( int32 inItemSize )
-		{
-			item = NULL;
-			index = 0;
-			itemSize = inItemSize;
-		}
-
-			/**	Returns pointer to first item. */
-		void *First( ItemListUndoAction_Base &inBase )
-		{
-			if (inBase.editList.First() != NULL)
-				item = (UndoItem *)inBase.editList.First();
-			else item = NULL;
-			index = 0;
-			return Item();
-		}
+		/**	Return the number of bytes of memory this undo action holds. */
+	virtual int32 Size();
 
-			/**	returns pointer to next item. */
-		void *Next();
+		/**	Write the undo data to a file, if it can be read back as it is. */
+	virtual int32 Spill( UndoSpillFile &inFile );
 
-			/**	Returns pointer to current item. */
-		void *Item();
-	};
-	friend class		CUndoIterator;
-
-		/**	Return the estimated size of this undo action. */
-	virtual int32 Size() { return size; }
+		/**	Return the number of bytes of undo data in the file. */
+	virtual int32 SpilledSize() { return spilled ? spillSize : 0; }
 
 		/**	Apply this undo action. */
 	virtual void Undo();
@@ -566,18 +626,27 @@ protected:
 		/**	Apply this redo action. */
 	virtual void Redo();
 
+		/**	Called with the items an undo or redo is about to change, and
+			again with the same items once they have been changed. This
+			can be used for smarter screen updates. */
+	virtual void OnItemsChanged( const void *inItems, long inItemCount ) {}
+
 public:
 
 		/**	Constructor -- takes a list to apply changes to. */
 	ItemListUndoAction_Base( ItemList_Base &inList )
 		: list( inList )
 	{
-		size = sizeof *this;
+		spillFile = NULL;
+		spillOffset = 0;
+		spillSize = 0;
+		spilled = dirty = false;
 	}
 
 		/**	Destroy all child undo items. */
 	virtual ~ItemListUndoAction_Base()
 	{
+		if (spillFile != NULL) spillFile->Free( spillOffset, spillSize );
 	}
 
 	void Rollback() { Undo(); }
@@ -590,12 +659,12 @@ public:
 class UndoItem : public DNode {
 	friend class		ItemList_Base;
 	friend class		ItemListUndoAction_Base;
-	friend class		ItemListUndoAction_Base::CUndoIterator;
 
 	enum {
 		Action_Insert,
 		Action_Delete,
-		Action_Change
+		Action_Change,
+		Action_Delta						// changed bytes only
 	};
 
 	short			actionType;				// add, delete, or change
@@ -608,10 +677,18 @@ class UndoItem : public DNode {
 		 * occured.	*/
 	int32			index;
 	int32			numItems;				// number of items in this set
+	int32			dataSize,				// size of undo data
+					dataCapacity;			// size of block holding it
 	void				*undoData;				// actual saved undo data
 
 	UndoItem( ItemListUndoAction_Base &inAction, long inNumItems, size_t inItemSize );
 
+		// Undo records are allocated from the pool of their undo action,
+		// and freed along with it.
+	void *operator new( size_t inSize, ItemListUndoAction_Base &inAction )
+		{ return inAction.headers.Allocate( inSize ); }
+	void operator delete( void *, ItemListUndoAction_Base & ) {}
+
 // UndoItem *Next() { return (UndoItem *)DNode::Next(); }
 // UndoItem *Prev() { return (UndoItem *)DNode::Prev(); }
 
@@ -620,8 +697,13 @@ class UndoItem : public DNode {
 public:
 	~UndoItem();
 
+	void operator delete( void * ) {}
+
 	void *UndoData() { return undoData; }
 	long NumItems()  { return numItems; }
+
+		// Returns true if the undo data is a set of items to be destroyed.
+	bool HoldsItems() { return actionType != Action_Delta && undoData; }
 };
 /**
  *	Template version of ItemListUndoAction_Base
@@ -640,10 +722,12 @@ public:
 	{
 		UndoItem		*ui;
 
-			// Delete any remaining undo records
+			// Delete any remaining undo records. Items written to the
+			// spill file are plain, so they needn't be destroyed.
 		while (	(ui = (UndoItem *)editList.First() ) != NULL )
 		{
-			ItemFuncs<Item>::Destroy( (Item *)ui->UndoData(), ui->NumItems() );
+			if (ui->HoldsItems())
+				ItemFuncs<Item>::Destroy( (Item *)ui->UndoData(), ui->NumItems() );
 			delete ui;
 		}
 	}
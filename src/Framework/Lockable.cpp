@@ -7,6 +7,9 @@
 // Support Kit
 #include <Debug.h>
 
+// Standard C Library
+#include <string.h>
+
 #define D_ALLOC(x) //PRINT(x)		// Constructor/Destructor
 #define D_ACCESS(x) //PRINT(x)		// Accessors
 #define D_OPERATION(x) //PRINT(x)	// Operations
@@ -14,22 +17,34 @@
 // ---------------------------------------------------------------------------
 // Constants
 
-const int32			MAX_READER_COUNT = 10000;
+// m_state keeps the number of active readers in the lower bits
+const int32			READER_MASK			= 0x00ffffff;
+const int32			WRITER_WAITING		= 0x20000000;
+const int32			WRITER_ACTIVE		= 0x40000000;
 
 // ---------------------------------------------------------------------------
 // Constructor/Destructor
 
 CLockable::CLockable(
 	const char *name)
-	:	m_sem(-1),
+	:	m_state(0),
+		m_benaphoreCount(0),
+		m_benaphoreSem(-1),
+		m_readerSem(-1),
+		m_waitingReaders(0),
+		m_writerSem(-1),
+		m_waitingWriters(0),
 		m_writerStackBase(0),
 		m_writerThread(-1),
 		m_writerNest(0),
-		m_readerCount(0)
+		m_writeLockTime(0)
 {
 	D_ALLOC(("CLockable::CLockable(%s)\n", name ? name : "NULL"));
 
-	m_sem = create_sem(MAX_READER_COUNT, name);
+	m_benaphoreSem = create_sem(0, name);
+	m_readerSem = create_sem(0, name);
+	m_writerSem = create_sem(0, name);
+	ResetStatistics();
 }
 
 CLockable::~CLockable()
@@ -40,8 +55,12 @@ CLockable::~CLockable()
 	if (!IsWriteLocked())
 		WriteLock();
 
-	delete_sem(m_sem);
-	m_sem = -1;
+	delete_sem(m_writerSem);
+	m_writerSem = -1;
+	delete_sem(m_readerSem);
+	m_readerSem = -1;
+	delete_sem(m_benaphoreSem);
+	m_benaphoreSem = -1;
 }
 
 // ---------------------------------------------------------------------------
@@ -50,7 +69,7 @@ CLockable::~CLockable()
 status_t
 CLockable::InitCheck() const
 {
-	if (m_sem > 0)
+	if ((m_benaphoreSem >= 0) && (m_readerSem >= 0) && (m_writerSem >= 0))
 		return B_OK;
 
 	return B_ERROR;
@@ -61,7 +80,8 @@ CLockable::IsReadLocked() const
 {
 	D_ACCESS(("CLockable::IsReadLocked()\n"));
 
-	return ((m_readerCount > 0) || IsWriteLocked());
+	return (((atomic_get((volatile int32 *)&m_state) & READER_MASK) > 0)
+			|| IsWriteLocked());
 }
 
 bool 
@@ -79,7 +99,7 @@ CLockable::IsWriteLocked(
 	// this is managed by taking the address of the item on the
 	// stack and dividing it by the size of the memory pages
 	// if it is the same as the cached stack_page, there is a match 
-	stackBase = (uint32)&locked / B_PAGE_SIZE;
+	stackBase = (uint32)((addr_t)&locked / B_PAGE_SIZE);
 	if (stackBase == m_writerStackBase)
 	{
 		locked = true;
@@ -102,6 +122,27 @@ CLockable::IsWriteLocked(
 	return locked;
 }
 
+void
+CLockable::GetStatistics(
+	statistics *outStatistics) const
+{
+	D_ACCESS(("CLockable::GetStatistics()\n"));
+
+	_lock();
+	*outStatistics = m_statistics;
+	_unlock();
+}
+
+void
+CLockable::ResetStatistics()
+{
+	D_ACCESS(("CLockable::ResetStatistics()\n"));
+
+	_lock();
+	memset(&m_statistics, 0, sizeof(m_statistics));
+	_unlock();
+}
+
 // ---------------------------------------------------------------------------
 // Operations
 
@@ -111,22 +152,74 @@ CLockable::ReadLock(
 {
 	D_OPERATION(("CLockable::ReadLock(%Ld)\n", timeout));
 
-	bool locked = false;
+#if DEBUG
+	// a nested read lock deadlocks as soon as a writer waits, so
+	// catch it even when none does
+	bool reader = !IsWriteLocked();
+	if (reader)
+		_addReader();
+#endif
+
+	// as long as no writer is around, readers only need to count
+	// themselves in
+	int32 state = atomic_get(&m_state);
+	while ((state & (WRITER_ACTIVE | WRITER_WAITING)) == 0)
+	{
+		if (atomic_test_and_set(&m_state, state + 1, state) == state)
+			return true;
+		state = atomic_get(&m_state);
+	}
 
-	if (IsWriteLocked())
+	if ((state & WRITER_ACTIVE) && IsWriteLocked())
 	{
 		// the writer simply increments the nesting
 		m_writerNest++;
-		locked = true;
+		return true;
 	}
-	else
+
+	_lock();
+	state = atomic_get(&m_state);
+	while ((state & (WRITER_ACTIVE | WRITER_WAITING)) == 0)
 	{
-		// acquire sem and increment reader count
-		locked = (acquire_sem_etc(m_sem, 1, B_DO_NOT_RESCHEDULE,
-								  timeout) == B_OK);
-		if (locked)
-			m_readerCount++;
+		// the writer has left in the meantime
+		if (atomic_test_and_set(&m_state, state + 1, state) == state)
+		{
+			_unlock();
+			return true;
+		}
+		state = atomic_get(&m_state);
+	}
+	m_waitingReaders++;
+	_unlock();
+
+	// the writer counts us in as an active reader before waking us up
+	bigtime_t waitStart = system_time();
+	bool locked = _wait(m_readerSem, timeout);
+
+	_lock();
+	if (!locked)
+	{
+		if (m_waitingReaders > 0)
+		{
+			m_waitingReaders--;
+			m_statistics.readTimeouts++;
+		}
+		else
+		{
+			// we have been let in while timing out
+			locked = true;
+			_unlock();
+			_wait(m_readerSem, B_INFINITE_TIMEOUT);
+			_lock();
+		}
 	}
+	_recordWait(system_time() - waitStart, false);
+	_unlock();
+
+#if DEBUG
+	if (!locked && reader)
+		_removeReader();
+#endif
 
 	return locked;
 }
@@ -136,24 +229,28 @@ CLockable::ReadUnlock()
 {
 	D_OPERATION(("CLockable::ReadUnlock()\n"));
 
-	bool unlocked = false;
-
-	if (IsWriteLocked())
+	if ((atomic_get(&m_state) & WRITER_ACTIVE) && IsWriteLocked())
 	{
 		// writers simply decrement the nesting count
 		m_writerNest--;
-		unlocked = true;	
+		return true;
 	}
-	else
+
+#if DEBUG
+	_removeReader();
+#endif
+
+	int32 state = atomic_add(&m_state, -1);
+	ASSERT((state & READER_MASK) > 0);
+	if (((state & READER_MASK) == 1) && (state & WRITER_WAITING))
 	{
-		// release sem and decrement reader count
-		unlocked = (release_sem_etc(m_sem, 1,
-									B_DO_NOT_RESCHEDULE) == B_OK);
-		if (unlocked)
-			m_readerCount--;
+		// the last reader hands the lock over to the waiting writer
+		_lock();
+		_admit();
+		_unlock();
 	}
-	
-	return unlocked;	
+
+	return true;
 }
 
 bool 
@@ -162,7 +259,6 @@ CLockable::WriteLock(
 {
 	D_OPERATION(("CLockable::WriteLock(%Ld)\n", timeout));
 
-	bool locked = false;
 	uint32 stackBase = 0;
 	thread_id thread = -1;
 
@@ -170,20 +266,81 @@ CLockable::WriteLock(
 	{
 		// already the writer - increment the nesting count
 		m_writerNest++;
-		locked = true;
+		return true;
+	}
+
+#if DEBUG
+	// the readers would wait for each other
+	ASSERT(!_isReader());
+#endif
+
+	bool locked = false;
+	_lock();
+	if (m_waitingWriters == 0)
+	{
+		int32 state = atomic_get(&m_state);
+		while ((state & (READER_MASK | WRITER_ACTIVE)) == 0)
+		{
+			if (atomic_test_and_set(&m_state, state | WRITER_ACTIVE,
+									state) == state)
+			{
+				locked = true;
+				break;
+			}
+			state = atomic_get(&m_state);
+		}
+	}
+
+	if (locked)
+	{
+		m_statistics.writeLocks++;
 	}
 	else
 	{
-		// another writer in the lock - acquire the semaphore
-		locked = (acquire_sem_etc(m_sem, MAX_READER_COUNT,
-								  B_DO_NOT_RESCHEDULE, timeout) == B_OK);
-		if (locked)
+		// keep out new readers, and wait for the lock to be handed over
+		m_waitingWriters++;
+		atomic_or(&m_state, WRITER_WAITING);
+		// the last reader might have left before seeing that
+		_admit();
+		_unlock();
+
+		bigtime_t waitStart = system_time();
+		locked = _wait(m_writerSem, timeout);
+
+		_lock();
+		if (!locked)
 		{
-			ASSERT(m_writerThread == -1);
-			// record thread information
-			m_writerThread = thread;
-			m_writerStackBase = stackBase;
+			if (m_waitingWriters > 0)
+			{
+				m_waitingWriters--;
+				if (m_waitingWriters == 0)
+					atomic_and(&m_state, ~WRITER_WAITING);
+				m_statistics.writeTimeouts++;
+				// the readers waiting behind us may go ahead now
+				_admit();
+			}
+			else
+			{
+				// we have been handed the lock while timing out
+				locked = true;
+				_unlock();
+				_wait(m_writerSem, B_INFINITE_TIMEOUT);
+				_lock();
+			}
 		}
+		if (locked)
+			m_statistics.writeLocks++;
+		_recordWait(system_time() - waitStart, true);
+	}
+	_unlock();
+
+	if (locked)
+	{
+		ASSERT(m_writerThread == -1);
+		// record thread information
+		m_writerThread = thread;
+		m_writerStackBase = stackBase;
+		m_writeLockTime = system_time();
 	}
 
 	return locked;
@@ -192,37 +349,183 @@ CLockable::WriteLock(
 bool 
 CLockable::WriteUnlock()
 {
-	D_OPERATION(("CLockable::WriteUnlock()\n", m_sem));
+	D_OPERATION(("CLockable::WriteUnlock()\n"));
 
-	bool unlocked = false;
+	if (!IsWriteLocked())
+	{
+		debugger("Non-writer attempting to WriteUnlock()\n");
+		return false;
+	}
 
-	if (IsWriteLocked())
+	// if this is a nested lock simply decrement the nest count
+	if (m_writerNest > 0)
 	{
-		// if this is a nested lock simply decrement the nest count
-		if (m_writerNest > 0)
-		{
-			m_writerNest--;
-			unlocked = true;
-		}
+		m_writerNest--;
+		return true;
+	}
+
+	// the hook may lock again, that's only nesting
+	WriteUnlocking();
+
+	bigtime_t holdTime = system_time() - m_writeLockTime;
+
+	//clear the information
+	m_writerThread = -1;
+	m_writerStackBase = 0;
+
+	_lock();
+	m_statistics.writeHoldTime += holdTime;
+	if (holdTime > m_statistics.maxWriteHold)
+		m_statistics.maxWriteHold = holdTime;
+
+	if (m_waitingReaders > 0)
+	{
+		// readers which waited for this writer go before the next one,
+		// so they never wait for more than one writer
+		int32 count = m_waitingReaders;
+		m_waitingReaders = 0;
+		atomic_add(&m_state, count - WRITER_ACTIVE);
+		release_sem_etc(m_readerSem, count, 0);
+	}
+	else if (m_waitingWriters > 0)
+	{
+		// hand the lock over to the next writer directly
+		m_waitingWriters--;
+		if (m_waitingWriters == 0)
+			atomic_and(&m_state, ~WRITER_WAITING);
+		release_sem(m_writerSem);
+	}
+	else
+	{
+		atomic_and(&m_state, ~WRITER_ACTIVE);
+	}
+	_unlock();
+
+	return true;
+}
+
+// ---------------------------------------------------------------------------
+// Internal Operations
+
+void
+CLockable::_lock() const
+{
+	if (atomic_add(&m_benaphoreCount, 1) > 0)
+	{
+		while (acquire_sem(m_benaphoreSem) == B_INTERRUPTED)
+			;
+	}
+}
+
+void
+CLockable::_unlock() const
+{
+	if (atomic_add(&m_benaphoreCount, -1) > 1)
+		release_sem(m_benaphoreSem);
+}
+
+bool
+CLockable::_wait(
+	sem_id sem,
+	bigtime_t timeout)
+{
+	status_t error;
+	do
+	{
+		if (timeout == B_INFINITE_TIMEOUT)
+			error = acquire_sem(sem);
 		else
-		{
-			unlocked = (release_sem_etc(m_sem, MAX_READER_COUNT,
-										B_DO_NOT_RESCHEDULE) == B_OK);
-			if (unlocked)
-			{
-				//clear the information
-				m_writerThread = -1;
-				m_writerStackBase = 0;
-			}
-		}
-		
+			error = acquire_sem_etc(sem, 1, B_RELATIVE_TIMEOUT, timeout);
+	}
+	while (error == B_INTERRUPTED);
+
+	return (error == B_OK);
+}
+
+void
+CLockable::_admit()
+{
+	int32 state = atomic_get(&m_state);
+	if (state & WRITER_ACTIVE)
+		return;
+
+	if (m_waitingWriters > 0)
+	{
+		if ((state & READER_MASK) > 0)
+			return;
+
+		// no new readers get in while a writer is waiting, so the lock
+		// stays free until the writer is marked active
+		m_waitingWriters--;
+		atomic_or(&m_state, WRITER_ACTIVE);
+		if (m_waitingWriters == 0)
+			atomic_and(&m_state, ~WRITER_WAITING);
+		release_sem(m_writerSem);
+	}
+	else if (m_waitingReaders > 0)
+	{
+		int32 count = m_waitingReaders;
+		m_waitingReaders = 0;
+		atomic_add(&m_state, count);
+		release_sem_etc(m_readerSem, count, 0);
+	}
+}
+
+void
+CLockable::_recordWait(
+	bigtime_t waitTime,
+	bool write)
+{
+	if (write)
+	{
+		m_statistics.writeWaits++;
+		m_statistics.writeWaitTime += waitTime;
+		if (waitTime > m_statistics.maxWriteWait)
+			m_statistics.maxWriteWait = waitTime;
 	}
 	else
 	{
-		debugger("Non-writer attempting to WriteUnlock()\n");
+		m_statistics.readWaits++;
+		m_statistics.readWaitTime += waitTime;
+		if (waitTime > m_statistics.maxReadWait)
+			m_statistics.maxReadWait = waitTime;
 	}
+}
+
+#if DEBUG
+
+bool
+CLockable::_isReader() const
+{
+	_lock();
+	bool reader = (m_readerThreads.find(find_thread(NULL))
+				   != m_readerThreads.end());
+	_unlock();
+
+	return reader;
+}
+
+void
+CLockable::_addReader()
+{
+	_lock();
+	bool added = m_readerThreads.insert(find_thread(NULL)).second;
+	_unlock();
+
+	// nested read locks are only allowed for the writer
+	ASSERT(added);
+}
+
+void
+CLockable::_removeReader()
+{
+	_lock();
+	size_t removed = m_readerThreads.erase(find_thread(NULL));
+	_unlock();
 
-	return unlocked;
+	ASSERT(removed == 1);
 }
 
+#endif
+
 // END - Lockable.cpp
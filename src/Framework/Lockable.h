@@ -40,23 +40,70 @@
 // Kernel Kit
 #include <OS.h>
 
+#if DEBUG
+// Standard Template Library
+#include <set>
+#endif
+
 /**
  *  Implements single writer, multiple readers locking.
+ *
+ *	Readers are let in by a single atomic operation on the lock state
+ *	as long as no writer holds or waits for the lock, so uncontended
+ *	reading never touches a semaphore. Writers are preferred: once a
+ *	writer waits, new readers queue up behind it, so an editor can't
+ *	be starved by the player. In turn, when a writer unlocks, all the
+ *	readers which have been waiting for it are let in before the next
+ *	writer, so readers never wait for more than one writer at a time.
+ *
+ *	A thread which holds the write lock may lock again for reading or
+ *	writing. A thread which holds a read lock must not ask for a write
+ *	lock, and must not ask for another read lock while a writer might
+ *	be waiting, or it will deadlock. DEBUG builds keep track of the
+ *	reading threads, and ASSERT when a reader asks for either.
  *	@author		Christopher Lenz
  */
 class CLockable
 {
 
+public:							// Types
+
+	/** How the lock has been used since it was created or the
+	 *	statistics were last reset. Readers which get in on the fast
+	 *	path aren't counted.
+	 */
+	struct statistics
+	{
+		/** Number of read locks which had to wait. */
+		int32					readWaits;
+		/** Number of read locks which timed out. */
+		int32					readTimeouts;
+		bigtime_t				readWaitTime;
+		bigtime_t				maxReadWait;
+
+		/** Number of write locks, not counting nested ones. */
+		int32					writeLocks;
+		/** Number of write locks which had to wait. */
+		int32					writeWaits;
+		/** Number of write locks which timed out. */
+		int32					writeTimeouts;
+		bigtime_t				writeWaitTime;
+		bigtime_t				maxWriteWait;
+		/** How long the lock has been held by writers. */
+		bigtime_t				writeHoldTime;
+		bigtime_t				maxWriteHold;
+	};
+
 public:							// Constructor/Destructor
 
 								CLockable(
 									const char *name = "CLockable");
 
-								~CLockable();
+	virtual						~CLockable();
 
 public:							// Accessors
 
-	/**	Returns B_OK if the semaphore initialized correctly. */
+	/**	Returns B_OK if the semaphores initialized correctly. */
 	status_t					InitCheck() const;
 
 	/**	Determines whether the object is locked for read access.
@@ -74,6 +121,11 @@ public:							// Accessors
 									uint32 *stack_base = NULL,
 									thread_id *thread = NULL) const;
 
+	void						GetStatistics(
+									statistics *outStatistics) const;
+
+	void						ResetStatistics();
+
 public:							// Operations
 
 	/**	Locks the object for read access. Many readers can hold a read 
@@ -96,15 +148,79 @@ public:							// Operations
 	/** Unlocks the object. */
 	bool						WriteUnlock();
 
+protected:						// Hook Functions
+
+	/**	Called by the last WriteUnlock() of a writer, while it still
+	 *	holds the lock, so that the changes it has made can be
+	 *	published to readers who don't lock.
+	 */
+	virtual void				WriteUnlocking()
+								{ }
+
+private:						// Internal Operations
+
+	/** Locks the internal benaphore, which guards everything but the
+	 *	fast paths.
+	 */
+	void						_lock() const;
+
+	void						_unlock() const;
+
+	/** Waits on one of the semaphores. Returns true if it was acquired,
+	 *	or false if it timed out.
+	 */
+	bool						_wait(
+									sem_id sem,
+									bigtime_t timeout);
+
+	/** Lets in the waiting readers, or the next waiting writer, once
+	 *	the lock is free. Call with the benaphore locked.
+	 */
+	void						_admit();
+
+	void						_recordWait(
+									bigtime_t waitTime,
+									bool write);
+
+#if DEBUG
+	/** Returns whether the calling thread holds a read lock. */
+	bool						_isReader() const;
+
+	void						_addReader();
+
+	void						_removeReader();
+#endif
+
 private:						// Instance Data
 
-	sem_id						m_sem;
+	/** The number of active readers in the lower bits, and whether
+	 *	a writer holds or waits for the lock in the upper bits.
+	 */
+	volatile int32				m_state;
+
+	/** The benaphore guarding the slow paths. */
+	mutable volatile int32		m_benaphoreCount;
+	sem_id						m_benaphoreSem;
+
+	/** Readers wait here until the writer unlocks. */
+	sem_id						m_readerSem;
+	int32						m_waitingReaders;
+
+	/** Writers wait here until they are handed the lock. */
+	sem_id						m_writerSem;
+	int32						m_waitingWriters;
 
 	uint32						m_writerStackBase;
 	thread_id					m_writerThread;
 	uint32						m_writerNest;
+	bigtime_t					m_writeLockTime;
+
+	statistics					m_statistics;
 
-	int32						m_readerCount;
+#if DEBUG
+	/** The threads holding a read lock, guarded by the benaphore. */
+	std::set<thread_id>			m_readerThreads;
+#endif
 };
 
 /**
@@ -4,11 +4,8 @@
 
 #include "Observable.h"
 
-#include "AppHelp.h"
 #include "Observer.h"
 
-// Application Kit
-#include <Looper.h>
 // Support Kit
 #include <Debug.h>
 
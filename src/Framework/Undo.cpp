@@ -4,16 +4,216 @@
 
 #include "Undo.h"
 
+// Standard C Library
+#include <stdlib.h>
+// POSIX
+#include <unistd.h>
+
+	//	Size of the chunks of an UndoPool, unless a larger block is needed
+const int32 UNDO_CHUNK_SIZE = 4096 - 16;
+
+	//	Round a block size up so that the next block stays aligned
+static inline int32 align_size( int32 inSize )
+{
+	return (inSize + 7) & ~7;
+}
+
+	//	Return a block of memory of the given size.
+void *UndoPool::Allocate( int32 inSize )
+{
+	Chunk		*c = chunks;
+
+	inSize = align_size( inSize );
+	if (c == NULL || c->used + inSize > c->size)
+	{
+		int32	size = inSize > UNDO_CHUNK_SIZE ? inSize : UNDO_CHUNK_SIZE;
+
+		c = (Chunk *)malloc( sizeof *c + size );
+		if (c == NULL) return NULL;
+		c->size = size;
+		c->used = 0;
+		bytes += sizeof *c + size;
+
+			//	A block which takes a chunk of its own goes behind the
+			//	current one, which may still have room for others.
+		if (inSize >= UNDO_CHUNK_SIZE && chunks != NULL)
+		{
+			c->next = chunks->next;
+			chunks->next = c;
+		}
+		else
+		{
+			c->next = chunks;
+			chunks = c;
+		}
+	}
+
+	void		*block = Data( c ) + c->used;
+	c->used += inSize;
+	return block;
+}
+
+	//	Grow the most recently allocated block without moving it, if
+	//	there is room for it.
+bool UndoPool::Extend( void *inBlock, int32 inSize, int32 inNewSize )
+{
+	Chunk		*c = chunks;
+
+	inSize = align_size( inSize );
+	inNewSize = align_size( inNewSize );
+	if (	c == NULL
+		||	(char *)inBlock + inSize != Data( c ) + c->used
+		||	c->used - inSize + inNewSize > c->size)
+	{
+		return false;
+	}
+
+	c->used += inNewSize - inSize;
+	return true;
+}
+
+	//	Free all blocks at once.
+void UndoPool::Clear()
+{
+	while (chunks != NULL)
+	{
+		Chunk	*next = chunks->next;
+
+		free( chunks );
+		chunks = next;
+	}
+	bytes = 0;
+}
+
+	//	Return the file, or NULL if it couldn't be opened.
+FILE *UndoSpillFile::File()
+{
+	if (file == NULL) file = tmpfile();
+	return file;
+}
+
+	//	Return the offset of a range of the given size, reusing free space
+	//	if possible.
+long UndoSpillFile::Allocate( int32 inSize )
+{
+	if (File() == NULL) return -1;
+
+	for (	std::map<long, int32>::iterator i = freeRanges.begin();
+			i != freeRanges.end();
+			i++ )
+	{
+		if (i->second < inSize) continue;
+
+		long		offset = i->first;
+		int32		left = i->second - inSize;
+
+		freeRanges.erase( i );
+		if (left > 0) freeRanges[ offset + inSize ] = left;
+		return offset;
+	}
+
+	long			offset = size;
+
+	size += inSize;
+	return offset;
+}
+
+	//	Give back a range returned by Allocate(), joining it with the free
+	//	ranges next to it, or cutting the file short if it is at the end.
+void UndoSpillFile::Free( long inOffset, int32 inSize )
+{
+	if (inSize <= 0) return;
+
+	std::map<long, int32>::iterator	next = freeRanges.lower_bound( inOffset );
+
+	if (next != freeRanges.end() && inOffset + inSize == next->first)
+	{
+		inSize += next->second;
+		freeRanges.erase( next++ );
+	}
+	if (next != freeRanges.begin())
+	{
+		std::map<long, int32>::iterator	prev = next;
+
+		prev--;
+		if (prev->first + prev->second == inOffset)
+		{
+			inOffset = prev->first;
+			inSize += prev->second;
+			freeRanges.erase( prev );
+		}
+	}
+
+	if (inOffset + inSize < size)
+	{
+		freeRanges[ inOffset ] = inSize;
+		return;
+	}
+
+	size = inOffset;
+	if (file != NULL)
+	{
+		fflush( file );
+		ftruncate( fileno( file ), size );
+	}
+}
+
+UndoHistory::~UndoHistory()
+{
+	DNode		*d;
+
+	while ((d = undoList.First()) != NULL)
+	{
+		d->Remove();
+		delete (UndoAction *)d;
+	}
+}
+
+	//	Bring the undo data within its limits, first by moving the oldest
+	//	actions out of RAM, then by discarding them.
 void UndoHistory::TrimUndo()
 {
-	while (currentUndoSize > maxUndoSize)
+	int32		resident = 0,
+				spilled = 0;
+	DNode		*d;
+
+		//	Add up the sizes every time, since the most recent action may
+		//	have grown since it was added.
+	for (d = undoList.First(); d != NULL; d = d->Next())
 	{
-		DNode		*d = undoList.Last();
+		resident += ((UndoAction *)d)->Size();
+		spilled += ((UndoAction *)d)->SpilledSize();
+	}
+
+	if (maxResidentSize > 0 && resident > maxResidentSize)
+	{
+		DNode	*redoPos = undoPos ? undoPos->Prev() : undoList.Last();
+
+		for (	d = undoList.Last();
+				d != NULL && resident > maxResidentSize;
+				d = d->Prev() )
+		{
+			UndoAction	*ua = (UndoAction *)d;
+			int32		moved;
+
+			if (d == undoList.First() || ua == undoPos || d == redoPos)
+				continue;
+
+			moved = ua->Spill( spillFile );
+			resident -= moved;
+			spilled += moved;
+		}
+	}
+
+	while (resident + spilled > maxUndoSize)
+	{
+		d = undoList.Last();
 		UndoAction	*ua = (UndoAction *)d;
 		
 		if (d == NULL || d == undoList.First() || ua == undoPos) break;
 		
-		currentUndoSize -= ua->Size();
+		resident -= ua->Size();
+		spilled -= ua->SpilledSize();
 		ua->Remove();
 		
 		delete ua;
@@ -61,6 +261,7 @@ bool UndoHistory::Undo()
 		undoPos->Undo();
 		if (undoPos->Next()) undoPos = (UndoAction *)undoPos->Next();
 		else undoPos = NULL;
+		TrimUndo();
 		return true;
 	}
 	return false;
@@ -80,6 +281,7 @@ bool UndoHistory::Redo()
 		
 		ua->Redo();
 		undoPos = ua;
+		TrimUndo();
 		return true;
 	}
 	return false;
@@ -99,7 +301,6 @@ void UndoHistory::Add( UndoAction *inAction )
 		
 		if (ua == undoPos) break;
 
-		currentUndoSize -= ua->Size();
 		ua->Remove();
 		
 		delete ua;
@@ -117,6 +318,13 @@ void UndoHistory::SetMaxUndoSize( int32 inMaxUndo )
 	TrimUndo();
 }
 
+	//	Set how much of the undo information may be kept in RAM.
+void UndoHistory::SetMaxResidentSize( int32 inMaxResident )
+{
+	maxResidentSize = inMaxResident;
+	TrimUndo();
+}
+
 bool UndoHistory::IsMostRecent( UndoAction *inAction )
 {
 	return (		undoPos == inAction
@@ -36,6 +36,13 @@
 
 #include "DList.h"
 
+// Standard C Library
+#include <stdio.h>
+// Standard Template Library
+#include <map>
+
+class UndoSpillFile;
+
 /**
  *	Generalized undo framework.  	UndoAction is a single
  *	undoable user action. It should be subclassed
@@ -51,8 +58,20 @@ protected:
 		/**	Virtual destructor will come in handy. */
 	virtual ~UndoAction() {}
 
-		/**	Return the estimated size of this undo action. */
+		/**	Return the number of bytes of memory this undo action holds. */
 	virtual int32 Size() = 0;
+
+		/**	Write the bulk of this undo action to a file, to be read back
+		*		once it is undone or redone. Returns the number of bytes of
+		*		memory given back, which is 0 if the action can't be written
+		*		out.
+		*/
+	virtual int32 Spill( UndoSpillFile &inFile ) { return 0; }
+
+		/**	Return the number of bytes of this undo action which are kept
+		*		in a file instead of memory.
+		*/
+	virtual int32 SpilledSize() { return 0; }
 	
 		/**	Apply this undo action. */
 	virtual void Undo() = 0;
@@ -65,6 +84,78 @@ protected:
 	virtual const char *Description() const { return NULL; }
 };
 
+		/**	UndoSpillFile is the temporary file which undo actions are moved
+		*		to by an UndoHistory. Space that is given back is used again,
+		*		and the file is cut short when the space at its end is free.
+		*/
+
+class UndoSpillFile {
+
+	FILE		*file;						//	Opened when first needed
+	long		size;						//	End of the space in use
+
+		//	Free ranges of the file before its end, by offset, with the
+		//	adjacent ones joined
+	std::map<long, int32>	freeRanges;
+
+public:
+
+	UndoSpillFile() { file = NULL; size = 0; }
+	~UndoSpillFile() { if (file) fclose( file ); }
+
+		/**	Return the file, or NULL if it couldn't be opened. */
+	FILE *File();
+
+		/**	Return the offset of a range of the given size, reusing free
+		*		space if possible, or -1 if the file couldn't be opened.
+		*/
+	long Allocate( int32 inSize );
+
+		/**	Give back a range returned by Allocate(). */
+	void Free( long inOffset, int32 inSize );
+
+		/**	Return the size of the file. */
+	long Size() const { return size; }
+};
+
+		/**	UndoPool hands out memory for the data of a single undo action.
+		*		It is allocated in large chunks and freed all at once, so that
+		*		small undo records don't each carry the overhead of the heap.
+		*/
+
+class UndoPool {
+
+	struct Chunk {
+		Chunk		*next;					//	Next older chunk
+		int32		size,					//	Bytes of data in chunk
+					used;					//	Bytes handed out
+	};
+
+	Chunk		*chunks;					//	Most recent chunk first
+	int32		bytes;						//	Total size of all chunks
+
+	static char *Data( Chunk *inChunk ) { return (char *)(inChunk + 1); }
+
+public:
+
+	UndoPool() { chunks = NULL; bytes = 0; }
+	~UndoPool() { Clear(); }
+
+		/**	Return a block of memory of the given size. */
+	void *Allocate( int32 inSize );
+
+		/**	Grow the most recently allocated block without moving it, if
+		*		there is room for it. Returns false if not.
+		*/
+	bool Extend( void *inBlock, int32 inSize, int32 inNewSize );
+
+		/**	Free all blocks at once. */
+	void Clear();
+
+		/**	Return the number of bytes of memory taken by the pool. */
+	int32 Size() const { return bytes; }
+};
+
 		/**	UndoHistory is a series of undoable actions.	*/
 
 class UndoHistory {
@@ -74,8 +165,9 @@ class UndoHistory {
 		*/
 
 	DList		undoList;	
-	int32		currentUndoSize,			//	Size of undo data
-				maxUndoSize;				//	Limit size of undo data
+	int32		maxUndoSize,				//	Limit size of undo data
+				maxResidentSize;			//	Limit size of undo data in RAM, or 0
+	UndoSpillFile	spillFile;				//	Undo data which isn't in RAM
 				
 		/**	Position of current item in undo list. This is the item
 		*	which will be undone if an undo command is given; The
@@ -88,18 +180,21 @@ class UndoHistory {
 
 public:
 		
-		/**	Constructor. Optional parameter specifies how much undo
-		*		information should be kept in RAM. (At least one is always
+		/**	Constructor. Optional parameter specifies how many bytes of
+		*		undo information should be kept. (At least one is always
 		*		kept).
 		*/
 		
-	UndoHistory( int32 inMaxUndoSize = (1024 * 10) )
+	UndoHistory( int32 inMaxUndoSize = (1024 * 1024 * 16) )
 	{
-		currentUndoSize	= 0;
 		maxUndoSize		= inMaxUndoSize;
+		maxResidentSize	= 0;
 		undoPos			= NULL;
 	}
 
+		/**	Destructor. Deletes all undo actions. */
+	~UndoHistory();
+
 		/**	Return true if there is an undoable action.	*/
 	bool CanUndo();
 	
@@ -134,6 +229,18 @@ public:
 
 		/**	Set how much undo information we wish to keep.	*/
 	void SetMaxUndoSize( int32 inMaxUndo );
+
+		/**	Set how much of the undo information may be kept in RAM. The
+		*		oldest actions beyond that are written to a temporary file.
+		*		The undo position and the most recent action always stay
+		*		in RAM. 0, which is the default, keeps it all in RAM.
+		*/
+	void SetMaxResidentSize( int32 inMaxResident );
+
+		/**	Return the size of the temporary file, which is 0 unless
+		*		SetMaxResidentSize() has been used.
+		*/
+	long SpillFileSize() const { return spillFile.Size(); }
 	
 		/**	Query if this is the most recent undo action.
 		*		Can be used to build up undo's cumulatively.
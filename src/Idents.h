@@ -90,6 +90,7 @@ enum EMenuIDs	{
 	MENU_FF,
 	MENU_LOCATE_START,
 	MENU_LOCATE_END,
+	MENU_VALIDATE_LOCATE,		// DEBUG builds only
 
 		// Track editing menus
 	MENU_SET_SECTION,			// Set section markers from 
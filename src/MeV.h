@@ -38,7 +38,13 @@
 #ifndef __MeV_H__
 #define __MeV_H__
 
+// The headless engine build has no Interface Kit
+#ifndef MEV_HEADLESS
 #include "AppHelp.h"
+#endif
+
+// Support Kit
+#include <SupportDefs.h>
 
 const uint32			Max_MidiPorts = 16;
 const int			Max_Destinations = 64;		
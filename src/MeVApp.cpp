@@ -14,6 +14,7 @@
 #include "Idents.h"
 #include "InspectorWindow.h"
 #include "LinearWindow.h"
+#include "MappedFileReader.h"
 #include "MidiModule.h"
 #include "MeV.h"
 #include "MeVModule.h"
@@ -884,8 +885,14 @@ CMeVApp::NewDocument(
 			return NULL;
 		}
 	
-		// Create reader and IFF reader.
-		CBeFileReader reader(file);
+		// Create reader and IFF reader. Read from a mapping of the file
+		// if possible, so that the chunks can be decoded in place.
+		BPath path(ref);
+		CMappedFileReader mappedReader(path.Path());
+		CBeFileReader fileReader(file);
+		CReader &reader = (mappedReader.InitCheck() == B_OK)
+						  ? (CReader &)mappedReader
+						  : (CReader &)fileReader;
 		CIFFReader iffReader(reader);
 		doc = new CMeVDoc(this, *ref, iffReader);
 	}
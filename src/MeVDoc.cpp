@@ -7,6 +7,7 @@
 #include "AssemblyWindow.h"
 #include "BeFileWriter.h"
 #include "BeFileReader.h"
+#include "Error.h"
 #include "EventOp.h"
 #include "EventTrack.h"
 #include "Idents.h"
@@ -22,9 +23,13 @@
 #include "ScreenUtils.h"
 #include "StdEventOps.h"
 #include "TrackWindow.h"
+#include "WorkerPool.h"
 
 // Gnu C Library
+#include <limits.h>
 #include <stdio.h>
+// Standard C++ Library
+#include <new>
 // Interface Kit
 #include <Bitmap.h>
 // Storage Kit
@@ -89,6 +94,7 @@ CMeVDoc::CMeVDoc(
 
 	while (reader.NextChunk())
 		ReadChunk(reader);
+	_readTrackBodies();
 
 	if (m_masterRealTrack == NULL)
 		m_masterRealTrack  = new CEventTrack(*this, ClockType_Real, 0,
@@ -100,12 +106,17 @@ CMeVDoc::CMeVDoc(
 
 	m_activeMaster = m_masterMeterTrack;
 
+	// The tracks have read their IDs and names from the file
+	_rebuildTrackIndex();
+
 	for (int32 i = 0; i < CountTracks(); i++)
 	{
 		if (TrackAt(i)->m_openWindow)
 			ShowWindowFor(TrackAt(i));
 
-		if (TrackAt(i)->GetID() >= m_newTrackID)
+		// Don't let the largest possible ID wrap the counter around
+		if ((TrackAt(i)->GetID() >= m_newTrackID)
+		 && (TrackAt(i)->GetID() < LONG_MAX))
 			m_newTrackID = TrackAt(i)->GetID() + 1;
 	}
 
@@ -314,23 +325,10 @@ CMeVDoc::ShowWindowFor(
 
 long CMeVDoc::GetUniqueTrackID()
 {
-	long			trialID = 2,
-				prevID = -1;
-
-		// Loop until we can run through the entire list
-		// without a collision.
-	while (trialID != prevID)
-	{
-		prevID = trialID;
-
-			// If we collide, then increase the ID by one
-		for (int i = 0; i < tracks.CountItems(); i++)
-		{
-			CTrack		*track = (CTrack *)tracks.ItemAt( i );
-
-			if (trialID == track->GetID()) trialID++;
-		}
-	}
+	// The first free ID after the master tracks
+	long trialID = 2;
+	while (m_tracksByID.find(trialID) != m_tracksByID.end())
+		trialID++;
 
 	return trialID;
 }
@@ -352,6 +350,7 @@ CMeVDoc::NewTrack(
 				name << " " << track->GetID() - 1;
 				track->SetName(name.String());
 				tracks.AddItem(track);
+				_indexTrack(track);
 				return track;
 			}
 			break;
@@ -369,52 +368,49 @@ CTrack *CMeVDoc::FindTrack( long inTrackID )
 	else if (inTrackID == 1)
 		return (CTrack *)m_masterMeterTrack;
 
-	for (int i = 0; i < tracks.CountItems(); i++)
-	{
-		CTrack *track = (CTrack *)tracks.ItemAt(i);
-		if (track->Deleted())
-			continue;
-		if (inTrackID == track->GetID())
-			 return track;
-	}
-	return NULL;
+	std::map<int32, CTrack *>::const_iterator i = m_tracksByID.find(inTrackID);
+	if (i == m_tracksByID.end())
+		return NULL;
+	return i->second;
 }
 
 	// Locate a track by it's name, and Acquire it.
 CTrack *CMeVDoc::FindTrack( char *inTrackName )
 {
-	for (int i = 0; i < tracks.CountItems(); i++)
-	{
-		CTrack		*track = (CTrack *)tracks.ItemAt( i );
+	typedef std::multimap<BString, CTrack *>::const_iterator iterator;
+	std::pair<iterator, iterator> range = m_tracksByName.equal_range(inTrackName);
+	if (range.first == range.second)
+		return NULL;
 
-		if (track->Deleted()) continue;
+	CTrack *bestTrack = range.first->second;
+	iterator i = range.first;
+	if (++i == range.second)
+		return bestTrack;
 
-		if (strcmp(track->Name(), inTrackName) == 0)
-			return track;
+	// If several tracks have the same name, the one which comes first
+	// in the list wins
+	int32 bestIndex = tracks.IndexOf(bestTrack);
+	for (; i != range.second; ++i)
+	{
+		int32 index = tracks.IndexOf(i->second);
+		if (index < bestIndex)
+		{
+			bestTrack = i->second;
+			bestIndex = index;
+		}
 	}
-	return NULL;
+	return bestTrack;
 }
 
 	// Get the first track with an ID greater than the given one.
 CTrack *CMeVDoc::FindNextHigherTrackID( int32 inID )
 {
-	CTrack		*bestTrack = NULL;
-	int32		bestID = LONG_MAX;
-
-	for (int i = 0; i < tracks.CountItems(); i++)
-	{
-		CTrack		*track = (CTrack *)tracks.ItemAt( i );
-
-		if (track->Deleted()) continue;
-
-		if (		track->GetID() < bestID
-			&&	track->GetID() > inID)
-		{
-			bestTrack = track;
-			bestID = track->GetID();
-		}
-	}
-	return bestTrack;
+	// Regular tracks start at 2
+	std::map<int32, CTrack *>::const_iterator i
+		= m_tracksByID.upper_bound((inID < 2) ? 1 : inID);
+	if (i == m_tracksByID.end())
+		return NULL;
+	return i->second;
 }
 
 void CMeVDoc::PostUpdateAllTracks( CUpdateHint *inHint )
@@ -512,7 +508,7 @@ void CMeVDoc::ReplaceTempoMap( CTempoMapEntry *entries, int length )
 {
 		// REM: Should be exclusively locked when this occurs
 
-	delete tempoMap.list;
+	delete [] tempoMap.list;
 	tempoMap.list = entries;
 	tempoMap.count = length;
 	validTempoMap = true;
@@ -830,9 +826,29 @@ CMeVDoc::_readTrack(
 	if (track == NULL)
 		return;
 
+	// The events of regular tracks only depend on the track itself, so
+	// if they can be decoded straight from the file, put them aside to be
+	// decoded together with those of the other tracks
+	CEventTrack *eventTrack = NULL;
+	if (track->GetID() >= 2)
+		eventTrack = dynamic_cast<CEventTrack *>(track);
+
 	reader.Push();
 	while (reader.NextChunk())
+	{
+		if ((eventTrack != NULL) && (reader.ChunkID() == Body_ID))
+		{
+			int32 length = reader.BytesAvailable();
+			const void *data = reader.View(length);
+			if (data != NULL)
+			{
+				track_body body = { eventTrack, data, length, "", false };
+				m_trackBodies.push_back(body);
+				continue;
+			}
+		}
 		track->ReadChunk(reader);
+	}
 	reader.Pop();
 
 	if (type == TrackType_Event)
@@ -880,6 +896,72 @@ CMeVDoc::_readEnvironment(
 	reader.Pop();
 }
 
+void
+CMeVDoc::_readTrackBodies()
+{
+	D_SERIALIZE(("CMeVDoc::_readTrackBodies(%ld)\n", m_trackBodies.size()));
+
+	class Error
+		:	public IError
+	{
+	public:
+								Error(const BString &description)
+									:	m_description(description) { }
+		virtual const char *	Description() const
+								{ return m_description.String(); }
+	private:
+		BString					m_description;
+	};
+
+	CWorkerPool pool("MeV Track Reader");
+	pool.Run(m_trackBodies.size(), _readTrackBody, this);
+
+	// The workers can't throw, so pass on the first error from here
+	for (uint32 i = 0; i < m_trackBodies.size(); i++)
+	{
+		if (m_trackBodies[i].failed)
+		{
+			Error error(m_trackBodies[i].error);
+			m_trackBodies.clear();
+			throw error;
+		}
+	}
+	m_trackBodies.clear();
+}
+
+void
+CMeVDoc::_readTrackBody(
+	int32 index,
+	void *data)
+{
+	track_body &body = ((CMeVDoc *)data)->m_trackBodies[index];
+	CByteArrayReader reader(const_cast<void *>(body.data), body.length);
+
+	try
+	{
+		body.track->ReadEvents(reader);
+	}
+	catch (IError &error)
+	{
+		D_SERIALIZE((" -> track %ld: %s\n", body.track->GetID(),
+					 error.Description()));
+		body.error = error.Description();
+		body.failed = true;
+	}
+	catch (std::bad_alloc &)
+	{
+		body.error = "There was not enough memory to read the events of "
+					 "a track.";
+		body.failed = true;
+	}
+	catch (...)
+	{
+		// Nothing may leave a worker thread
+		body.error = "The events of a track could not be read.";
+		body.failed = true;
+	}
+}
+
 // ---------------------------------------------------------------------------
 // Internal Operations
 
@@ -913,6 +995,81 @@ CMeVDoc::_addDefaultOperators()
 	}
 }
 
+void
+CMeVDoc::_indexTrack(
+	CTrack *track)
+{
+	int32 id = track->GetID();
+	if (id < 2)
+		return;
+
+	// If IDs collide, the track which was indexed first keeps it
+	m_tracksByID.insert(std::make_pair(id, track));
+
+	m_tracksByName.insert(std::make_pair(BString(track->Name()), track));
+}
+
+void
+CMeVDoc::_unindexTrack(
+	CTrack *track)
+{
+	int32 id = track->GetID();
+	std::map<int32, CTrack *>::iterator pos = m_tracksByID.find(id);
+	if ((pos != m_tracksByID.end()) && (pos->second == track))
+	{
+		m_tracksByID.erase(pos);
+
+		// Another track with the same ID takes over
+		for (int32 i = 0; i < CountTracks(); i++)
+		{
+			if ((TrackAt(i) != track) && (TrackAt(i)->GetID() == id))
+			{
+				m_tracksByID[id] = TrackAt(i);
+				break;
+			}
+		}
+	}
+
+	typedef std::multimap<BString, CTrack *>::iterator iterator;
+	std::pair<iterator, iterator> range = m_tracksByName.equal_range(track->Name());
+	for (iterator i = range.first; i != range.second; ++i)
+	{
+		if (i->second == track)
+		{
+			m_tracksByName.erase(i);
+			break;
+		}
+	}
+}
+
+void
+CMeVDoc::_rebuildTrackIndex()
+{
+	m_tracksByID.clear();
+	m_tracksByName.clear();
+	for (int32 i = 0; i < CountTracks(); i++)
+		_indexTrack(TrackAt(i));
+}
+
+void
+CMeVDoc::_trackRenamed(
+	CTrack *track,
+	const char *oldName)
+{
+	typedef std::multimap<BString, CTrack *>::iterator iterator;
+	std::pair<iterator, iterator> range = m_tracksByName.equal_range(oldName);
+	for (iterator i = range.first; i != range.second; ++i)
+	{
+		if (i->second == track)
+		{
+			// Only indexed tracks are moved to their new name
+			m_tracksByName.erase(i);
+			m_tracksByName.insert(std::make_pair(BString(track->Name()), track));
+			break;
+		}
+	}
+}
+
 void
 CMeVDoc::_init()
 {
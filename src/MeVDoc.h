@@ -49,6 +49,12 @@
 #include "WindowState.h"
 #include "TempoMap.h"
 
+// Support Kit
+#include <String.h>
+// Standard Template Library
+#include <map>
+#include <vector>
+
 class CAssemblyWindow;
 class CDestinationList;
 class EventOp;
@@ -331,6 +337,24 @@ private:						// Internal Operations
 
 	void						_init();
 
+	/**	Add a track to the ID and name indexes, or take it out. Only
+		tracks which are in the track list are indexed.
+	*/
+	void						_indexTrack(
+									CTrack *track);
+	void						_unindexTrack(
+									CTrack *track);
+
+	/**	Index all tracks from scratch, after reading them changed their
+		IDs and names.
+	*/
+	void						_rebuildTrackIndex();
+
+	/**	Called by CTrack::SetName() to keep the name index up to date. */
+	void						_trackRenamed(
+									CTrack *track,
+									const char *oldName);
+
 	/** Read a single track. */
 	void						_readTrack(
 									uint32 inTrackType,
@@ -340,10 +364,39 @@ private:						// Internal Operations
 	void						_readEnvironment(
 									CIFFReader &iffReader);
 
+	/**	Decode the events of the tracks whose bodies were put aside by
+		_readTrack(), concurrently. If a body can't be read, the first
+		error is thrown once all of them are done.
+	*/
+	void						_readTrackBodies();
+
+	static void					_readTrackBody(
+									int32 index,
+									void *data);
+
 private:						// Instance Data
 
+	// The body of a track, left in the file to be decoded later
+	struct track_body
+	{
+		CEventTrack *			track;
+		const void *			data;
+		int32					length;
+		// why the body couldn't be read, if it couldn't
+		BString					error;
+		bool					failed;
+	};
+
 	BList						tracks;
 	int32						m_newTrackID;
+
+	// The tracks by ID, so that the player finds the track of a
+	// sequence event without searching the list. The IDs come from the
+	// file, so they may be far apart.
+	std::map<int32, CTrack *>	m_tracksByID;
+
+	// The tracks by name; the same name can be used more than once
+	std::multimap<BString, CTrack *>	m_tracksByName;
 	
 	BList						m_destinations;
 
@@ -377,6 +430,9 @@ private:						// Instance Data
 	CAssemblyWindow *			assemblyWindow;
 
 	CWindowState				m_windowState[WINDOW_TYPE_COUNT];
+
+	// Track bodies waiting to be decoded while the document is read
+	std::vector<track_body>		m_trackBodies;
 };
 
 #endif /* __C_MeVDoc_H__ */
@@ -82,6 +82,13 @@ void MeVPlugIn::NotifyOperatorChanged( EventOp *inOper )
 	app.Unlock();
 }
 
+// The plug-in name is kept out of EventOp.cpp, so that the event operators
+// don't drag in the plug-in interface.
+const char *EventOp::CreatorName() const
+{
+	return creator ? creator->Name() : "MeV";
+}
+
 MeVDocHandle
 MeVPlugIn::NewDocument(
 	const char *name,
@@ -474,6 +481,16 @@ void MeVTrackRef::ReleaseEventRef(MeVEventHandle event)
 	delete event;
 }
 
+void MeVTrackRef::ReadEvents(
+	void (*inFunc)( const CEvent *inEvents, long inCount, void *inData ),
+	void *inData )
+{
+	CEventTrack		*track = (CEventTrack *)trackData;
+	CReadLock		lock(track);
+
+	track->Events().ReadBlocks( inFunc, inData );
+}
+
 	/**	Start a new undo record for this track */
 bool MeVTrackRef::BeginUndoAction( char *inActionLabel )
 {
@@ -587,6 +604,13 @@ bool MeVEventRef::Seek(int32 inSeekCount)
 	return marker->Seek(inSeekCount) != 0;
 }
 
+bool MeVEventRef::SeekToTime(int32 inStartTime)
+{
+	EventMarker* marker = reinterpret_cast<EventMarker*>(data);
+
+	return marker->SeekToTime(inStartTime) != 0;
+}
+
 bool MeVEventRef::SeekToFirst()
 {
 	EventMarker* marker = reinterpret_cast<EventMarker*>(data);
@@ -363,7 +363,10 @@ public:
 		/**	End a undo record for this track */
 	void EndUndoAction( bool keep );
 
-		/* Merge a list of sorted events into the EventList. */
+		/**	Merge a list of sorted events into the track. The track is
+			summarized and its observers are notified once per call, so
+			importers should merge as many events at a time as they can.
+		*/
 	void Merge( CEvent *inEventArray, long inEventCount );
 
 		/**	Returns a handle to the first event in track. */
@@ -371,6 +374,14 @@ public:
 
 		/**	Function to release a track handle */
 	void ReleaseEventRef( MeVEventHandle );
+
+		/**	Hands all events of the track to inFunc, in order, one
+			block of events at a time, while the track is locked for
+			reading. Exporters should use this rather than stepping
+			through the track with an event handle.
+		*/
+	void ReadEvents( void (*inFunc)( const CEvent *inEvents, long inCount, void *inData ),
+					 void *inData );
 	
 	int32 Duration() const;
 
@@ -547,13 +558,13 @@ public:
 		*/
 	bool Seek( int32 inSeekCount );
 	
-#if 0
 		/**	Position the reference to the first event which has a start time
 			that is greater than or equal to the given time.
 			@return false if inStartTime is greater than the start time of any event.
 		*/
 	bool SeekToTime( int32 inStartTime );
 	
+#if 0
 		/**	Position the reference to the first selected event in the track.
 			@return true if there was in fact a selected event.
 		*/
@@ -39,11 +39,10 @@ public:							// Constructor/Destructor
 
 public:							// Operations
 
+	/**	Takes the velocities of all 128 notes. */
+	void						SetNotes(
+									const unsigned char *notes);
 	void						NoteOn(
-									unsigned char note,
-									unsigned char velocity);
-	void						NoteOff(
-									unsigned char note,
 									unsigned char velocity);
 
 	void						Tick();
@@ -122,9 +121,10 @@ public:							// Constructor/Destructor
 
 public:							// Operations
 
+	/**	value has 14 bits. */
 	void						ControlChange(
 									BString controllerName,
-									unsigned char value);
+									uint16 value);
 
 	void						Tick();
 
@@ -137,7 +137,7 @@ private:						// Instance Data
 
 	BString						m_controllerName;
 	unsigned char				m_freshController;
-	unsigned char				m_value;
+	uint16						m_value;
 	unsigned char				m_freshValue;
 	bool						m_set;
 
@@ -195,10 +195,15 @@ CDestinationMonitorView::CDestinationMonitorView(
 	CMidiDestination *destination)
 	:	CConsoleView(frame, "Monitor"),
 		m_destination(destination),
+		m_messageRunner(NULL),
 		m_noteMeter(NULL),
 		m_programMeter(NULL),
 		m_pitchBendMeter(NULL),
-		m_controllerMeter(NULL)
+		m_controllerMeter(NULL),
+		m_noteOnCount(0),
+		m_programChangeCount(0),
+		m_controlChangeCount(0),
+		m_pitchBendCount(0)
 {
 	D_ALLOC(("CDestinationMonitorView::CDestinationMonitorView()\n"));
 
@@ -243,17 +248,12 @@ CDestinationMonitorView::AttachedToWindow()
 	BMessenger messenger(this, Window());
 	BMessage message(TICK);
 	m_messageRunner = new BMessageRunner(messenger, &message, 50000);
-
-	Destination()->MonitorOpened(messenger);
 }
 
 void
 CDestinationMonitorView::DetachedFromWindow()
 {
 	CConsoleView::DetachedFromWindow();
-
-	BMessenger messenger(this, Window());
-	Destination()->MonitorClosed(messenger);	
 }
 
 void
@@ -347,6 +347,7 @@ CDestinationMonitorView::MessageReceived(
 	{
 		case TICK:
 		{
+			_poll();
 			m_noteMeter->Tick();
 			if (IsExpanded())
 			{
@@ -356,72 +357,6 @@ CDestinationMonitorView::MessageReceived(
 			}
 			break;
 		}
-		case NOTE_ON:
-		{
-			unsigned char note;
-			unsigned char velocity;
-			if ((message->FindInt8("mev:note", (int8 *)&note) != B_OK)
-			 || (message->FindInt8("mev:velocity", (int8 *)&velocity) != B_OK))
-				return;
-			m_noteMeter->NoteOn(note, velocity);
-			break;
-		}
-		case NOTE_OFF:
-		{
-			unsigned char note;
-			unsigned char velocity;
-			if ((message->FindInt8("mev:note", (int8 *)&note) != B_OK)
-			 || (message->FindInt8("mev:velocity", (int8 *)&velocity) != B_OK))
-				return;
-			m_noteMeter->NoteOff(note, velocity);
-			break;
-		}
-		case PROGRAM_CHANGE:
-		{
-			unsigned short bank;
-			unsigned char program;
-			if ((message->FindInt16("mev:bank", (int16 *)&bank) != B_OK)
-			 || (message->FindInt8("mev:program", (int8 *)&program) != B_OK))
-				return;
-			// try to acquire program name from the destination
-			char name[PROGRAM_NAME_LENGTH];
-			if (!Destination()->GetProgramName(bank, program, name))
-				sprintf(name, "%d", program);
-			m_programMeter->ProgramChange(name);
-			if (IsExpanded())
-				m_programMeter->Invalidate();
-			break;
-		}
-		case PITCH_BEND:
-		{
-			unsigned short pitch;
-			if (message->FindInt16("mev:pitch", (int16 *)&pitch) != B_OK)
-				return;
-			m_pitchBendMeter->PitchBend(pitch);
-			if (IsExpanded())
-				m_pitchBendMeter->Invalidate();
-			break;
-		}
-		case CONTROL_CHANGE:
-		{
-			unsigned char control;
-			if (message->FindInt8("mev:control", (int8 *)&control) != B_OK)
-				return;
-			// try to acquire controller name from the destination
-			char name[CONTROLLER_NAME_LENGTH];
-			if (!Destination()->GetControllerName(control, name))
-				sprintf(name, "controller %d", control);
-			unsigned char value1;
-			unsigned short value2;
-			if (message->FindInt8("mev:value", (int8 *)&value1) == B_OK)
-				m_controllerMeter->ControlChange(name, value1);
-			else if (message->FindInt16("mev:value", (int16 *)&value2) == B_OK)
-				m_controllerMeter->ControlChange(name,
-												 (unsigned char)(value2 / 128));
-			if (IsExpanded())
-				m_controllerMeter->Invalidate();
-			break;
-		}
 		default:
 		{
 			CConsoleView::MessageReceived(message);
@@ -456,6 +391,59 @@ CDestinationMonitorView::SubjectUpdated(
 		return;
 }
 
+// ---------------------------------------------------------------------------
+// Internal Operations
+
+void
+CDestinationMonitorView::_poll()
+{
+	if (m_destination == NULL)
+		return;
+
+	const CMidiActivity &activity = Destination()->Activity();
+
+	unsigned char notes[128];
+	activity.GetNotes(notes);
+	m_noteMeter->SetNotes(notes);
+	uint8 velocity;
+	if (activity.GetNoteOn(m_noteOnCount, &velocity))
+		m_noteMeter->NoteOn(velocity);
+
+	uint16 bank;
+	uint8 program;
+	if (activity.GetProgramChange(m_programChangeCount, &bank, &program))
+	{
+		// try to acquire program name from the destination
+		char name[PROGRAM_NAME_LENGTH];
+		if (!Destination()->GetProgramName(bank, program, name))
+			sprintf(name, "%d", program);
+		m_programMeter->ProgramChange(name);
+		if (IsExpanded())
+			m_programMeter->Invalidate();
+	}
+
+	int16 pitch;
+	if (activity.GetPitchBend(m_pitchBendCount, &pitch))
+	{
+		m_pitchBendMeter->PitchBend(pitch);
+		if (IsExpanded())
+			m_pitchBendMeter->Invalidate();
+	}
+
+	uint8 control;
+	uint16 value;
+	if (activity.GetControlChange(m_controlChangeCount, &control, &value))
+	{
+		// try to acquire controller name from the destination
+		char name[CONTROLLER_NAME_LENGTH];
+		if (!Destination()->GetControllerName(control, name))
+			sprintf(name, "controller %d", control);
+		m_controllerMeter->ControlChange(name, value);
+		if (IsExpanded())
+			m_controllerMeter->Invalidate();
+	}
+}
+
 // ---------------------------------------------------------------------------
 // CNoteMonitorView Implementation
 
@@ -483,49 +471,30 @@ CNoteMonitorView::CNoteMonitorView(
 }
 
 void
-CNoteMonitorView::NoteOn(
-	unsigned char note,
-	unsigned char velocity)
+CNoteMonitorView::SetNotes(
+	const unsigned char *notes)
 {
-	m_notes[note] = velocity;
-	m_current = velocity;
+	if (memcmp(m_notes, notes, sizeof(m_notes)) == 0)
+		return;
 
-	if (velocity > *m_max)
-	{
-		// a new max velocity
-		m_max = &m_notes[note];
-		Invalidate();
-	}
-	else if (&m_notes[note] == m_max)
+	memcpy(m_notes, notes, sizeof(m_notes));
+
+	// look for a max among the playing notes
+	m_max = m_notes;
+	for (int i = 1; i < 128; i++)
 	{
-		// look for a max among other playing notes
-		for (int i = 0; i < 127; i++)
-		{
-			if (m_notes[note] > *m_max)
-				m_max = &m_max[note];
-		}
-		Invalidate();
+		if (m_notes[i] > *m_max)
+			m_max = &m_notes[i];
 	}
+	Invalidate();
 }
 
 void
-CNoteMonitorView::NoteOff(
-	unsigned char note,
+CNoteMonitorView::NoteOn(
 	unsigned char velocity)
 {
-	m_notes[note] = 0;
-
-	// if this is the current max velocity note ...
-	if (&m_notes[note] == m_max)
-	{
-		// ... look for a max among other playing notes
-		for (int i = 0; i < 127; i++)
-		{
-			if (m_notes[note] > *m_max)
-				m_max = &m_max[note];
-		}
-		Invalidate();
-	}
+	m_current = velocity;
+	Invalidate();
 }
 
 void
@@ -688,7 +657,7 @@ CControlChangeMonitorView::CControlChangeMonitorView(
 void
 CControlChangeMonitorView::ControlChange(
 	BString controllerName,
-	unsigned char value)
+	uint16 value)
 {
 	if (controllerName != m_controllerName)
 	{
@@ -742,7 +711,7 @@ CControlChangeMonitorView::Draw(
 
 	rect.bottom = m_labelRect.top - 1.0;
 
-	float val = (float)m_value / 127.f;
+	float val = (float)m_value / 16383.f;
 	int current = (int)rect.left + (int)(val * rect.Width());
 	for (int i = (int)rect.left; i <= (int)rect.right; i++)
 	{
@@ -55,37 +55,10 @@ public:							// Constants
 
 	enum messages
 	{
-								TICK = 'dmvA',
-
-								/** Note On event
-								 *	int8	"mev:note"		note number
-								 *	int8	"mev:velocity"	attack velocity
-								 */
-								NOTE_ON,
-
-								/** Note Off event
-								 *	int8	"mev:note"		note number
-								 *	int8	"mev:velocity"	release velocity
-								 */
-								NOTE_OFF,
-
-								/** Program Change event
-								 *	int16	"mev:bank"		program bank
-								 *	int8	"mev:program"	program number
-								 */
-								PROGRAM_CHANGE,
-
-								/** MIDI Pitch Bend event
-								 *	int16	"mev:pitch"		pitch bend value
+								/** Time to poll the destination's activity
+								 *	and to let the meters fade.
 								 */
-								PITCH_BEND,
-
-								/** Control Change event
-								 *	int8	"mev:control"	control number
-								 *	int8	"mev:value"		control value (single-byte)
-								 *	int16	"mev:value"		control value (two-byte)
-								 */
-								CONTROL_CHANGE
+								TICK = 'dmvA'
 	};
 
 public:							// Constructor/Destructor
@@ -126,6 +99,11 @@ public:							// CConsoleView Implementation
 	virtual void				SubjectUpdated(
 									BMessage *message);
 
+private:						// Internal Operations
+
+	/**	Shows what the destination has played since the last poll. */
+	void						_poll();
+
 private:						// Instance Data
 
 	CMidiDestination *			m_destination;
@@ -139,6 +117,17 @@ private:						// Instance Data
 	CPitchBendMonitorView *		m_pitchBendMeter;
 
 	CControlChangeMonitorView *	m_controllerMeter;
+
+	/** Counts of the events of the destination's activity, as of the
+	 *	last poll.
+	 */
+	int32						m_noteOnCount;
+
+	int32						m_programChangeCount;
+
+	int32						m_controlChangeCount;
+
+	int32						m_pitchBendCount;
 };
 
 };
@@ -0,0 +1,212 @@
+/* ===================================================================== *
+ * MidiActivity.h (MeV/Midi)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s):
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ *  What a MIDI destination has played lately, for its monitors
+ * ---------------------------------------------------------------------
+ * To Do:
+ *
+ * ===================================================================== */
+
+#ifndef __C_MidiActivity_H__
+#define __C_MidiActivity_H__
+
+// Kernel Kit
+#include <OS.h>
+// Support Kit
+#include <SupportDefs.h>
+
+// Standard C Library
+#include <string.h>
+
+namespace Midi {
+
+/**	The state of a MIDI channel as far as the destination monitors show
+	it: the velocities of the sounding notes, and the latest note-on,
+	program change, control change and pitch bend. The player thread
+	writes it while playing, without locking or allocating anything,
+	and any number of monitors read it whenever they redraw, so events
+	that come faster than that are simply coalesced.
+
+	Each of the latest values fits into a single int32, which is
+	written before the count of values written so far is incremented.
+	A reader which finds a different count than last time reads the
+	value after it, which may be even newer, but is never torn.
+	@package	Midi
+ */
+class CMidiActivity
+{
+
+public:							// Types
+
+	/** The latest of a kind of event. */
+	struct latest
+	{
+		volatile int32			value;
+		volatile int32			count;
+	};
+
+public:							// Constructor/Destructor
+
+								CMidiActivity()
+								{
+									memset((void *)m_notes, 0, sizeof(m_notes));
+									memset((void *)&m_noteOn, 0, sizeof(latest));
+									memset((void *)&m_programChange, 0, sizeof(latest));
+									memset((void *)&m_controlChange, 0, sizeof(latest));
+									memset((void *)&m_pitchBend, 0, sizeof(latest));
+								}
+
+public:							// Writing (player thread only)
+
+	void						NoteOn(
+									uint8 note,
+									uint8 velocity)
+								{
+									m_notes[note & 0x7f] = velocity;
+									_set(m_noteOn, velocity);
+								}
+
+	void						NoteOff(
+									uint8 note)
+								{ m_notes[note & 0x7f] = 0; }
+
+	void						ProgramChange(
+									uint16 bank,
+									uint8 program)
+								{ _set(m_programChange, (bank << 8) | program); }
+
+	/**	value has 14 bits, MSB * 128 + LSB, so that 7-bit controllers
+		pass their value * 128.
+	*/
+	void						ControlChange(
+									uint8 controller,
+									uint16 value)
+								{ _set(m_controlChange, (controller << 16) | (value & 0x3fff)); }
+
+	/**	pitch is relative to the center, -8192 to 8191. */
+	void						PitchBend(
+									int16 pitch)
+								{ _set(m_pitchBend, pitch); }
+
+public:							// Reading
+
+	/**	Copies the velocities of all 128 notes, 0 for notes which are
+		not sounding.
+	*/
+	void						GetNotes(
+									uint8 *outNotes) const
+								{ memcpy(outNotes, (const void *)m_notes, sizeof(m_notes)); }
+
+	/**	Each of these returns true if there has been such an event since
+		ioCount was last updated, and then updates ioCount and returns
+		the latest event.
+	*/
+	bool						GetNoteOn(
+									int32 &ioCount,
+									uint8 *outVelocity) const
+								{
+									int32 value;
+									if (!_get(m_noteOn, ioCount, value))
+										return false;
+									*outVelocity = (uint8)value;
+									return true;
+								}
+
+	bool						GetProgramChange(
+									int32 &ioCount,
+									uint16 *outBank,
+									uint8 *outProgram) const
+								{
+									int32 value;
+									if (!_get(m_programChange, ioCount, value))
+										return false;
+									*outBank = (uint16)(value >> 8);
+									*outProgram = (uint8)value;
+									return true;
+								}
+
+	bool						GetControlChange(
+									int32 &ioCount,
+									uint8 *outController,
+									uint16 *outValue) const
+								{
+									int32 value;
+									if (!_get(m_controlChange, ioCount, value))
+										return false;
+									*outController = (uint8)(value >> 16);
+									*outValue = (uint16)(value & 0x3fff);
+									return true;
+								}
+
+	bool						GetPitchBend(
+									int32 &ioCount,
+									int16 *outPitch) const
+								{
+									int32 value;
+									if (!_get(m_pitchBend, ioCount, value))
+										return false;
+									*outPitch = (int16)value;
+									return true;
+								}
+
+private:						// Internal Operations
+
+	static void					_set(
+									latest &slot,
+									int32 value)
+								{
+									slot.value = value;
+									// a full barrier, so the value is out first
+									atomic_add(&slot.count, 1);
+								}
+
+	static bool					_get(
+									const latest &slot,
+									int32 &ioCount,
+									int32 &outValue)
+								{
+									int32 count = atomic_get((volatile int32 *)&slot.count);
+									if (count == ioCount)
+										return false;
+									ioCount = count;
+									outValue = atomic_get((volatile int32 *)&slot.value);
+									return true;
+								}
+
+private:						// Instance Data
+
+	volatile uint8				m_notes[128];
+
+	latest						m_noteOn;
+
+	latest						m_programChange;
+
+	latest						m_controlChange;
+
+	latest						m_pitchBend;
+};
+
+};
+
+#endif /* __C_MidiActivity_H__ */
@@ -0,0 +1,385 @@
+/* ===================================================================== *
+ * MidiChaseState.cpp (MeV/Midi)
+ * ===================================================================== */
+
+#include "MidiChaseState.h"
+
+// Gnu C Library
+#include <string.h>
+// Support Kit
+#include <Debug.h>
+
+using namespace Midi;
+
+// ---------------------------------------------------------------------------
+// Constants
+
+const uint8 BANK_SELECT				= 0;
+const uint8 DATA_ENTRY				= 6;
+const uint8 DATA_ENTRY_LSB			= 38;
+const uint8 DATA_INCREMENT			= 96;
+const uint8 DATA_DECREMENT			= 97;
+const uint8 NRPN_LSB				= 98;
+const uint8 NRPN_MSB				= 99;
+const uint8 RPN_LSB					= 100;
+const uint8 RPN_MSB					= 101;
+
+// Controllers from here on are channel mode messages
+const uint8 FIRST_MODE_MESSAGE		= 120;
+const uint8 RESET_ALL_CONTROLLERS	= 121;
+
+// ---------------------------------------------------------------------------
+// Constructor/Destructor
+
+CMidiChaseState::CMidiChaseState()
+{
+	Clear();
+}
+
+// ---------------------------------------------------------------------------
+// Operations
+
+void
+CMidiChaseState::Clear()
+{
+	memset(m_controllers, MIDIValueUnset, sizeof m_controllers);
+	m_program = MIDIValueUnset;
+	m_pitchBend = 0xffff;
+	m_pressure = MIDIValueUnset;
+	m_reset = false;
+	m_changed = false;
+
+	m_parameterType = NO_PARAMETER;
+	memset(m_parameterNumber, MIDIValueUnset, sizeof m_parameterNumber);
+	m_parameterCount = 0;
+}
+
+void
+CMidiChaseState::Chase(
+	const CEvent &event)
+{
+	switch (event.Command())
+	{
+		case EvtType_Controller:
+		{
+			_chaseController(event.controlChange.controller & 0x7f,
+							 event.controlChange.MSB,
+							 event.controlChange.LSB);
+			break;
+		}
+		case EvtType_ProgramChange:
+		{
+			m_program = event.programChange.program;
+			break;
+		}
+		case EvtType_PitchBend:
+		{
+			m_pitchBend = event.pitchBend.targetBend;
+			break;
+		}
+		case EvtType_ChannelATouch:
+		{
+			m_pressure = event.aTouch.value;
+			break;
+		}
+		default:
+		{
+			return;
+		}
+	}
+
+	m_changed = true;
+}
+
+int32
+CMidiChaseState::MakeBurst(
+	CEvent *outEvents) const
+{
+	int32 count = 0;
+
+	// Everything else was chased after the reset
+	if (m_reset)
+		_makeController(outEvents[count++], RESET_ALL_CONTROLLERS,
+						0, MIDIValueUnset);
+
+	// The bank only takes effect with the next program change
+	uint8 bankLSB = controllerInfoTable[BANK_SELECT].LSBNumber;
+	if ((m_controllers[BANK_SELECT] < 128) || (m_controllers[bankLSB] < 128))
+		_makeController(outEvents[count++], BANK_SELECT,
+						m_controllers[BANK_SELECT], m_controllers[bankLSB]);
+	if (m_program < 128)
+	{
+		CEvent &event = outEvents[count++];
+		event.SetCommand(EvtType_ProgramChange);
+		event.programChange.start = 0;
+		event.programChange.duration = 0;
+		event.programChange.program = m_program;
+		event.programChange.bankMSB = m_controllers[BANK_SELECT];
+		event.programChange.bankLSB = m_controllers[bankLSB];
+	}
+
+	for (uint8 controller = BANK_SELECT + 1;
+		 controller < FIRST_MODE_MESSAGE;
+		 controller++)
+	{
+		// Parameters are sent below
+		if ((controller == DATA_ENTRY)
+		 || ((controller >= DATA_INCREMENT) && (controller <= RPN_MSB)))
+			continue;
+
+		uint8 lsbIndex = controllerInfoTable[controller].LSBNumber;
+		if (lsbIndex > 127)
+		{
+			// An LSB, which goes out together with its MSB
+			continue;
+		}
+		else if (lsbIndex != controller)
+		{
+			if ((m_controllers[controller] < 128)
+			 || (m_controllers[lsbIndex] < 128))
+				_makeController(outEvents[count++], controller,
+								m_controllers[controller],
+								m_controllers[lsbIndex]);
+		}
+		else if (m_controllers[controller] < 128)
+		{
+			_makeController(outEvents[count++], controller,
+							m_controllers[controller], MIDIValueUnset);
+		}
+	}
+
+	// Select each parameter and set its value
+	uint8 selectedType = NO_PARAMETER;
+	const parameter *selected = NULL;
+	for (int32 i = 0; i < m_parameterCount; i++)
+	{
+		const parameter &param = m_parameters[i];
+		if ((param.valueMSB > 127) && (param.valueLSB > 127))
+			continue;
+
+		_makeController(outEvents[count++],
+						param.type == REGISTERED_PARAMETER ? RPN_MSB : NRPN_MSB,
+						param.numberMSB, param.numberLSB);
+		_makeController(outEvents[count++], DATA_ENTRY,
+						param.valueMSB, param.valueLSB);
+		selectedType = param.type;
+		selected = &param;
+	}
+
+	// ...and leave the one selected which was selected last
+	if (m_parameterType != NO_PARAMETER)
+	{
+		const uint8 *number = m_parameterNumber[m_parameterType];
+		if ((selected == NULL)
+		 || (selectedType != m_parameterType)
+		 || (selected->numberMSB != number[0])
+		 || (selected->numberLSB != number[1]))
+			_makeController(outEvents[count++],
+							m_parameterType == REGISTERED_PARAMETER ? RPN_MSB
+																	: NRPN_MSB,
+							number[0], number[1]);
+	}
+	else if (selected != NULL)
+	{
+		// Nothing was selected, or a reset deselected it
+		_makeController(outEvents[count++], RPN_MSB, 127, 127);
+	}
+
+	if (m_pitchBend < 0x4000)
+	{
+		CEvent &event = outEvents[count++];
+		event.SetCommand(EvtType_PitchBend);
+		event.pitchBend.start = 0;
+		event.pitchBend.duration = 0;
+		event.pitchBend.startBend = m_pitchBend;
+		event.pitchBend.targetBend = m_pitchBend;
+		event.pitchBend.updatePeriod = 0;
+	}
+
+	if (m_pressure < 128)
+	{
+		CEvent &event = outEvents[count++];
+		event.SetCommand(EvtType_ChannelATouch);
+		event.aTouch.start = 0;
+		event.aTouch.duration = 0;
+		event.aTouch.value = m_pressure;
+		event.aTouch.updatePeriod = 0;
+	}
+
+	ASSERT(count <= MAX_BURST_EVENTS);
+	return count;
+}
+
+// ---------------------------------------------------------------------------
+// Internal Operations
+
+void
+CMidiChaseState::_chaseController(
+	uint8 controller,
+	uint8 msb,
+	uint8 lsb)
+{
+	switch (controller)
+	{
+		case RESET_ALL_CONTROLLERS:
+		{
+			_resetControllers();
+			m_reset = true;
+			return;
+		}
+		case RPN_MSB:
+		case NRPN_MSB:
+		{
+			m_parameterType = (controller == RPN_MSB) ? REGISTERED_PARAMETER
+													  : NON_REGISTERED_PARAMETER;
+			if (msb < 128)
+				m_parameterNumber[m_parameterType][0] = msb;
+			if (lsb < 128)
+				m_parameterNumber[m_parameterType][1] = lsb;
+			return;
+		}
+		case RPN_LSB:
+		case NRPN_LSB:
+		{
+			m_parameterType = (controller == RPN_LSB) ? REGISTERED_PARAMETER
+													  : NON_REGISTERED_PARAMETER;
+			m_parameterNumber[m_parameterType][1] = msb;
+			return;
+		}
+		case DATA_ENTRY:
+		{
+			parameter *param = _selectedParameter(true);
+			if (param == NULL)
+				return;
+			// A new MSB leaves the LSB undefined
+			if (msb < 128)
+			{
+				param->valueMSB = msb;
+				param->valueLSB = MIDIValueUnset;
+			}
+			if (lsb < 128)
+				param->valueLSB = lsb;
+			return;
+		}
+		case DATA_ENTRY_LSB:
+		{
+			parameter *param = _selectedParameter(true);
+			if (param != NULL)
+				param->valueLSB = msb;
+			return;
+		}
+		case DATA_INCREMENT:
+		case DATA_DECREMENT:
+		{
+			// Can only be followed if the value is known
+			parameter *param = _selectedParameter(false);
+			if ((param == NULL) || (param->valueMSB > 127))
+				return;
+			int32 step = (controller == DATA_INCREMENT) ? 1 : -1;
+			if (param->valueLSB < 128)
+			{
+				int32 value = param->valueMSB * 128 + param->valueLSB + step;
+				value = MAX(0, MIN(value, 0x3fff));
+				param->valueMSB = value >> 7;
+				param->valueLSB = value & 0x7f;
+			}
+			else
+			{
+				param->valueMSB = MAX(0, MIN(param->valueMSB + step, 127));
+			}
+			return;
+		}
+	}
+
+	// Apart from the reset, mode messages leave no state to chase
+	if (controller >= FIRST_MODE_MESSAGE)
+		return;
+
+	uint8 lsbIndex = controllerInfoTable[controller].LSBNumber;
+	if ((lsbIndex != controller) && (lsbIndex < 128))
+	{
+		// A new MSB leaves the LSB undefined
+		if (msb < 128)
+		{
+			m_controllers[controller] = msb;
+			m_controllers[lsbIndex] = MIDIValueUnset;
+		}
+		if (lsb < 128)
+			m_controllers[lsbIndex] = lsb;
+	}
+	else
+	{
+		m_controllers[controller] = msb;
+	}
+}
+
+void
+CMidiChaseState::_resetControllers()
+{
+	// These are the controllers which a 'reset all controllers' resets
+	// according to the MIDI recommended practice (RP-015); the others
+	// keep their values.
+	static const uint8 RESET_CONTROLLERS[] =
+	{ 1, 33, 11, 43, 64, 65, 66, 67 };
+
+	for (uint32 i = 0; i < sizeof RESET_CONTROLLERS; i++)
+		m_controllers[RESET_CONTROLLERS[i]] = MIDIValueUnset;
+	m_pitchBend = 0xffff;
+	m_pressure = MIDIValueUnset;
+
+	m_parameterType = NO_PARAMETER;
+	memset(m_parameterNumber, MIDIValueUnset, sizeof m_parameterNumber);
+}
+
+CMidiChaseState::parameter *
+CMidiChaseState::_selectedParameter(
+	bool add)
+{
+	if (m_parameterType == NO_PARAMETER)
+		return NULL;
+
+	uint8 numberMSB = m_parameterNumber[m_parameterType][0];
+	uint8 numberLSB = m_parameterNumber[m_parameterType][1];
+
+	// The null parameter
+	if ((numberMSB == 127) && (numberLSB == 127))
+		return NULL;
+
+	for (int32 i = 0; i < m_parameterCount; i++)
+	{
+		parameter &param = m_parameters[i];
+		if ((param.type == m_parameterType)
+		 && (param.numberMSB == numberMSB)
+		 && (param.numberLSB == numberLSB))
+			return &param;
+	}
+
+	if (!add || (m_parameterCount >= MAX_PARAMETERS))
+		return NULL;
+
+	parameter &param = m_parameters[m_parameterCount++];
+	param.type = m_parameterType;
+	param.numberMSB = numberMSB;
+	param.numberLSB = numberLSB;
+	param.valueMSB = MIDIValueUnset;
+	param.valueLSB = MIDIValueUnset;
+	return &param;
+}
+
+void
+CMidiChaseState::_makeController(
+	CEvent &event,
+	uint8 controller,
+	uint8 msb,
+	uint8 lsb)
+{
+	event.SetCommand(EvtType_Controller);
+	event.controlChange.start = 0;
+	event.controlChange.duration = 0;
+	event.controlChange.controller = controller;
+	event.controlChange.MSB = msb;
+	event.controlChange.LSB = lsb;
+	event.controlChange.updatePeriod = 0;
+}
+
+// END - MidiChaseState.cpp
@@ -0,0 +1,167 @@
+/* ===================================================================== *
+ * MidiChaseState.h (MeV/Midi)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s):
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ *  Collects the state of a MIDI channel while locating
+ * ---------------------------------------------------------------------
+ * To Do:
+ *
+ * ===================================================================== */
+
+#ifndef __C_MidiChaseState_H__
+#define __C_MidiChaseState_H__
+
+#include "Event.h"
+
+namespace Midi {
+
+/**	Keeps track of the channel state that the events before a locate
+	point leave behind: all controllers (pairing 14-bit MSB and LSB
+	controllers according to controllerInfoTable), the bank and program,
+	the values of registered and non-registered parameters, pitch bend
+	and channel pressure. Afterwards, MakeBurst() produces the events
+	which bring a device into the same state, at most one per setting.
+	@package	Midi
+ */
+class CMidiChaseState
+{
+
+public:							// Constants
+
+	enum
+	{
+		/** Number of parameters (RPN or NRPN) which are remembered. */
+								MAX_PARAMETERS = 32,
+
+		/** MakeBurst() never produces more events than this. */
+								MAX_BURST_EVENTS = 128 + 2 * MAX_PARAMETERS + 4
+	};
+
+public:							// Constructor/Destructor
+
+								CMidiChaseState();
+
+public:							// Accessors
+
+	/**	Returns true if no event has changed the state since the last
+		call to Clear().
+	*/
+	bool						IsEmpty() const
+								{ return !m_changed; }
+
+public:							// Operations
+
+	/**	Forget everything. */
+	void						Clear();
+
+	/**	Applies the event to the channel state. Events which don't
+		change the state of the channel are ignored.
+	*/
+	void						Chase(
+									const CEvent &event);
+
+	/**	Fills in the events which reproduce the channel state, and
+		returns their number. outEvents must have room for at least
+		MAX_BURST_EVENTS events. The bank select comes before the
+		program change, and the parameters are selected again after
+		their values have been sent.
+	*/
+	int32						MakeBurst(
+									CEvent *outEvents) const;
+
+private:						// Types
+
+	/** The kinds of parameters. */
+	enum parameter_type
+	{
+								NO_PARAMETER = 0,
+								REGISTERED_PARAMETER,
+								NON_REGISTERED_PARAMETER
+	};
+
+	/** The value of one RPN or NRPN. */
+	struct parameter
+	{
+		uint8					type;
+		uint8					numberMSB;
+		uint8					numberLSB;
+		uint8					valueMSB;
+		uint8					valueLSB;
+	};
+
+private:						// Internal Operations
+
+	void						_chaseController(
+									uint8 controller,
+									uint8 msb,
+									uint8 lsb);
+
+	void						_resetControllers();
+
+	/**	Returns the value of the currently selected parameter, adding
+		it if necessary. Returns NULL if no parameter is selected, or
+		if there is no more room.
+	*/
+	parameter *					_selectedParameter(
+									bool add);
+
+	static void					_makeController(
+									CEvent &event,
+									uint8 controller,
+									uint8 msb,
+									uint8 lsb);
+
+private:						// Instance Data
+
+	/** Controller values, or MIDIValueUnset. */
+	uint8						m_controllers[128];
+
+	/** Program number, or MIDIValueUnset. */
+	uint8						m_program;
+
+	/** Pitch bend, or 0xffff if it hasn't been set. */
+	uint16						m_pitchBend;
+
+	/** Channel pressure, or MIDIValueUnset. */
+	uint8						m_pressure;
+
+	/** Whether a 'reset all controllers' needs to be sent first. */
+	bool						m_reset;
+
+	/** Whether anything has been chased at all. */
+	bool						m_changed;
+
+	/** The kind of parameter which data entry currently applies to. */
+	uint8						m_parameterType;
+
+	/** The selected parameter number (MSB and LSB) of each kind. */
+	uint8						m_parameterNumber[3][2];
+
+	/** The values set through data entry. */
+	parameter					m_parameters[MAX_PARAMETERS];
+	int32						m_parameterCount;
+};
+
+};
+
+#endif /* __C_MidiChaseState_H__ */
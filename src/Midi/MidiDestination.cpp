@@ -29,7 +29,6 @@
 #define D_ACCESS(x) //PRINT(x)		// Accessors
 #define D_OPERATION(x) //PRINT(x)	// Operations
 #define D_SERIALIZE(x) //PRINT(x)	// Serialization
-#define D_MONITOR(x) //PRINT(x)		// Monitor Management
 #define D_INTERNAL(x) //PRINT(x)	// Internal Operations
 
 using namespace Midi;
@@ -51,6 +50,7 @@ CMidiDestination::CMidiDestination(
 		m_producer(NULL),
 		m_channel(0),
 		m_generalMidi(false),
+		m_connectCount(0),
 		m_currentPitch(0xff)
 {
 	D_ALLOC(("CMidiDestination::CMidiDestination()\n"));
@@ -70,6 +70,7 @@ CMidiDestination::CMidiDestination(
 		m_producer(NULL),
 		m_channel(0),
 		m_generalMidi(false),
+		m_connectCount(0),
 		m_currentPitch(0xff)
 {
 	D_ALLOC(("CMidiDestination::CMidiDestination(deserialize)\n"));
@@ -212,6 +213,7 @@ CMidiDestination::ConnectTo(
 	}
 
 	m_consumerName = consumer->Name();
+	m_connectCount++;
 	status_t error = m_producer->Connect(consumer);
 	if (error)
 		D_OPERATION((" -> error connecting to %s: %s\n",
@@ -255,6 +257,7 @@ CMidiDestination::Disconnect()
 	if ((consumer != NULL) && m_producer->IsConnected(consumer))
 	{
 		m_producer->Disconnect(consumer);
+		m_connectCount++;
 		m_generalMidi = false;
 		SetLatency(0LL);
 	}
@@ -270,11 +273,15 @@ CMidiDestination::DoneLocating(
 	D_HOOK(("CMidiDestination::DoneLocating(%Ld)\n",
 			when));
 
-	// we use this hook to flush the various cached states
-	map<event_type, CEvent>::iterator i;
-	for (i = m_state.begin(); i != m_state.end(); ++i)
-		Execute(i->second, when);
-	m_state.clear();
+	// we use this hook to flush the channel state collected while locating
+	if (m_chaseState.IsEmpty())
+		return;
+
+	CEvent burst[CMidiChaseState::MAX_BURST_EVENTS];
+	int32 count = m_chaseState.MakeBurst(burst);
+	for (int32 i = 0; i < count; i++)
+		Execute(burst[i], when);
+	m_chaseState.Clear();
 }
 
 void
@@ -292,30 +299,14 @@ CMidiDestination::Execute(
 		{
 			m_producer->SprayNoteOn(m_channel, event.note.pitch,
 									event.note.attackVelocity, time);
-			if (!m_monitors.empty())
-			{
-				BMessage message(CDestinationMonitorView::NOTE_ON);
-				message.AddInt8("mev:note", event.note.pitch);
-				message.AddInt8("mev:velocity", event.note.attackVelocity);
-				list<BMessenger>::iterator i;
-				for (i = m_monitors.begin(); i != m_monitors.end(); ++i)
-					i->SendMessage(&message);
-			}
+			m_activity.NoteOn(event.note.pitch, event.note.attackVelocity);
 			break;
 		}
 		case EvtType_NoteOff:
 		{
 			m_producer->SprayNoteOff(m_channel, event.note.pitch,
 									 event.note.releaseVelocity, time);
-			if (!m_monitors.empty())
-			{
-				BMessage message(CDestinationMonitorView::NOTE_OFF);
-				message.AddInt8("mev:note", event.note.pitch);
-				message.AddInt8("mev:velocity", event.note.releaseVelocity);
-				list<BMessenger>::iterator i;
-				for (i = m_monitors.begin(); i != m_monitors.end(); ++i)
-					i->SendMessage(&message);
-			}
+			m_activity.NoteOff(event.note.pitch);
 			break;
 		}
 		case EvtType_ChannelATouch:
@@ -340,15 +331,8 @@ CMidiDestination::Execute(
 				// It's an 8-bit controller.
 				m_producer->SprayControlChange(m_channel, event.controlChange.controller,
 											   event.controlChange.MSB, time);
-				if (!m_monitors.empty())
-				{
-					BMessage message(CDestinationMonitorView::CONTROL_CHANGE);
-					message.AddInt8("mev:control", event.controlChange.controller);
-					message.AddInt8("mev:value", event.controlChange.MSB);
-					list<BMessenger>::iterator i;
-					for (i = m_monitors.begin(); i != m_monitors.end(); ++i)
-						i->SendMessage(&message);
-				}
+				m_activity.ControlChange(event.controlChange.controller,
+										 event.controlChange.MSB * 128);
 			}
 			else
 			{
@@ -362,16 +346,14 @@ CMidiDestination::Execute(
 				if (event.controlChange.LSB < 128)
 					m_producer->SprayControlChange(m_channel, lsbIndex,
 												   event.controlChange.LSB, time);
-				if (!m_monitors.empty())
-				{
-					BMessage message(CDestinationMonitorView::CONTROL_CHANGE);
-					message.AddInt8("mev:control", event.controlChange.controller);
-					message.AddInt16("mev:value", event.controlChange.MSB * 128
-												  + event.controlChange.LSB);
-					list<BMessenger>::iterator i;
-					for (i = m_monitors.begin(); i != m_monitors.end(); ++i)
-						i->SendMessage(&message);
-				}
+				// The monitor shows the full value; a half which isn't
+				// sent counts as 0
+				uint8 msb = event.controlChange.MSB < 128
+							? event.controlChange.MSB : 0;
+				uint8 lsb = event.controlChange.LSB < 128
+							? event.controlChange.LSB : 0;
+				m_activity.ControlChange(event.controlChange.controller,
+										 msb * 128 + lsb);
 			}
 			break;
 		}
@@ -380,16 +362,9 @@ CMidiDestination::Execute(
 			m_producer->SprayProgramChange(m_channel,
 										   event.programChange.program,
 										   time);
-			if (!m_monitors.empty())
-			{
-				BMessage message(CDestinationMonitorView::PROGRAM_CHANGE);
-				message.AddInt16("mev:bank", event.programChange.bankMSB * 128 +
-											 event.programChange.bankLSB);
-				message.AddInt8("mev:program", event.programChange.program);
-				list<BMessenger>::iterator i;
-				for (i = m_monitors.begin(); i != m_monitors.end(); ++i)
-					i->SendMessage(&message);
-			}
+			m_activity.ProgramChange(event.programChange.bankMSB * 128
+									 + event.programChange.bankLSB,
+									 event.programChange.program);
 			break;
 		}	
 		case EvtType_StartInterpolate:
@@ -402,14 +377,7 @@ CMidiDestination::Execute(
 										   m_currentPitch & 0x7f,
 										   m_currentPitch >> 7,
 										   time);
-				if (!m_monitors.empty())
-				{
-					BMessage message(CDestinationMonitorView::PITCH_BEND);
-					message.AddInt16("mev:pitch", m_currentPitch - 8192);
-					list<BMessenger>::iterator i;
-					for (i = m_monitors.begin(); i != m_monitors.end(); ++i)
-						i->SendMessage(&message);
-				}
+				m_activity.PitchBend(m_currentPitch - 8192);
 			}
 			break;
 		}
@@ -419,14 +387,7 @@ CMidiDestination::Execute(
 									   event.pitchBend.targetBend & 0x7f,
 									   event.pitchBend.targetBend >> 7,
 									   time);
-			if (!m_monitors.empty())
-			{
-				BMessage message(CDestinationMonitorView::PITCH_BEND);
-				message.AddInt16("mev:pitch", event.pitchBend.targetBend - 8192);
-				list<BMessenger>::iterator i;
-				for (i = m_monitors.begin(); i != m_monitors.end(); ++i)
-					i->SendMessage(&message);
-			}
+			m_activity.PitchBend(event.pitchBend.targetBend - 8192);
 			break;
 		}
 		case EvtType_SysEx:
@@ -440,6 +401,29 @@ CMidiDestination::Execute(
 	}
 }
 
+bool
+CMidiDestination::GetChaseState(
+	CMidiChaseState &outState) const
+{
+	outState = m_chaseState;
+	return true;
+}
+
+uint32
+CMidiDestination::ChaseKey() const
+{
+	return (m_connectCount << 8) | m_channel;
+}
+
+void
+CMidiDestination::SetChaseState(
+	const CMidiChaseState &state)
+{
+	D_HOOK(("CMidiDestination::SetChaseState()\n"));
+
+	m_chaseState = state;
+}
+
 status_t
 CMidiDestination::GetIcon(
 	icon_size which,
@@ -641,7 +625,7 @@ CMidiDestination::Stack(
 			// If locating, update channel state table but don't stack the event
 			if (task.IsLocating())
 			{
-				m_state[EvtType_PitchBend] = event;
+				m_chaseState.Chase(event);
 				break;
 			}
 
@@ -676,7 +660,7 @@ CMidiDestination::Stack(
 		{
 			// If locating, update channel state table but don't stack the event
 			if (task.IsLocating())
-				m_state[EvtType_ProgramChange] = event;
+				m_chaseState.Chase(event);
 			else
 				stack.Push(event);
 			break;
@@ -685,21 +669,16 @@ CMidiDestination::Stack(
 		{
 			// If locating, update channel state table but don't stack the event
 			if (task.IsLocating())
-				m_state[EvtType_ChannelATouch] = event;
+				m_chaseState.Chase(event);
 			else
 				stack.Push(event);
 			break;
 		}
 		case EvtType_Controller:
 		{
-			// REM: Data entry controls should probably be passed through, since they
-			// can't be summarized in a simple way.
-			// (Actually, the ideal would be to aggregate data entry -- but that's a job for
-			// another time and another event type.)
-
 			// If locating, update channel state table but don't stack the event
 			if (task.IsLocating())
-				m_state[EvtType_Controller] = event;
+				m_chaseState.Chase(event);
 			else
 				stack.Push(event);
 			break;
@@ -769,31 +748,6 @@ CMidiDestination::Undeleted()
 	// +++ reconnect
 }
 
-// ---------------------------------------------------------------------------
-// Monitor Management
-
-void
-CMidiDestination::MonitorOpened(
-	const BMessenger &messenger)
-{
-	m_monitors.push_back(messenger);
-}
-
-void
-CMidiDestination::MonitorClosed(
-	const BMessenger &messenger)
-{
-	list<BMessenger>::iterator i;
-	for (i = m_monitors.begin(); i != m_monitors.end(); ++i)
-	{
-		if (*i == messenger)
-		{
-			m_monitors.erase(i);
-			return;
-		}
-	}
-}
-
 // ---------------------------------------------------------------------------
 // Internal Operations
 
@@ -40,6 +40,8 @@
 
 #include "Destination.h"
 #include "Event.h"
+#include "MidiActivity.h"
+#include "MidiChaseState.h"
 
 // Standard Template Library
 #include <list>
@@ -71,11 +73,6 @@ namespace Midi {
 class CMidiDestination
 	:	public CDestination
 {
-	/** Enable Monitor views to register/unregister with the destination,
-	 *	thus making multiple monitors possible.
-	 */
-	friend class CDestinationMonitorView;
-
 public:							// Constants
 
 	enum update_hints
@@ -99,6 +96,12 @@ public:							//Constructor/Destructor
 
 public:							// Accessors
 
+	/**	What the destination has played lately. Monitor views poll
+	 *	this instead of being sent every event.
+	 */
+	const CMidiActivity &		Activity() const
+								{ return m_activity; }
+
 	/**	Copies a string identifying a controller into outName.
 	 *	outName should point to a string buffer of at least
 	 *	CONTROLLER_NAME_LENGTH bytes.
@@ -156,6 +159,14 @@ public:							// CDestination Implementation
 									CEvent &event,
 									bigtime_t when);
 
+	virtual bool				GetChaseState(
+									CMidiChaseState &outState) const;
+
+	virtual void				SetChaseState(
+									const CMidiChaseState &state);
+
+	virtual uint32				ChaseKey() const;
+
 	virtual status_t			GetIcon(
 									icon_size which,
 									BBitmap *outIcon);
@@ -205,14 +216,6 @@ protected:
 
 	virtual void				Undeleted();
 
-protected:						// Monitor Management
-
-	void						MonitorOpened(
-									const BMessenger &messenger);
-
-	void						MonitorClosed(
-									const BMessenger &messenger);
-
 private:   						// Internal Operations
 
 	void 						_addIcons(
@@ -239,12 +242,17 @@ private:						// Instance Data
 	/** Whether or not this destination supports General Midi. */
 	bool						m_generalMidi;
 
-	map<event_type, CEvent>		m_state;
+	/** Counts the connections made and broken, for ChaseKey(). */
+	int32						m_connectCount;
+
+	/** The channel state collected while locating. */
+	CMidiChaseState				m_chaseState;
 
 	uint16						m_currentPitch;
 	uint16						m_targetPitch;
 
-	list<BMessenger>			m_monitors;
+	/** What has been played lately, for the monitor views. */
+	CMidiActivity				m_activity;
 };
 
 };
@@ -0,0 +1,191 @@
+/* ===================================================================== *
+ * FixedPool.cpp (MeV/Support)
+ * ===================================================================== */
+
+#include "FixedPool.h"
+
+// Standard C Library
+#include <stdlib.h>
+// Standard C++ Library
+#include <new>
+// Support Kit
+#include <Debug.h>
+
+// Debugging Macros
+#define D_ALLOC(x) //PRINT(x)			// Constructor/Destructor
+
+// The free stack keeps the block index in the lower 16 bits
+const int32 INDEX_MASK		= 0x0000ffff;
+const int32 TAG_INCREMENT	= 0x00010000;
+
+// Returns the tag that follows the one of the given top of the stack
+static inline int32
+next_tag(
+	int32 top)
+{
+	return (int32)(((uint32)top + TAG_INCREMENT) & ~INDEX_MASK);
+}
+
+// ---------------------------------------------------------------------------
+// Constructor/Destructor
+
+CFixedPool::CFixedPool(
+	size_t blockSize,
+	int32 blockCount)
+	:	m_blockSize(blockSize),
+		m_blockCount(blockCount),
+		m_blocks(NULL),
+		m_free(0),
+		m_used(0),
+		m_maxUsed(0),
+		m_heapAllocations(0)
+{
+	D_ALLOC(("CFixedPool::CFixedPool(%ld, %ld)\n", blockSize, blockCount));
+
+	if (m_blockCount < 0)
+		m_blockCount = 0;
+	if (m_blockCount > INDEX_MASK)
+		m_blockCount = INDEX_MASK;
+
+	// Round up, so that each header is aligned like the first one
+	m_stride = sizeof(header)
+			   + (m_blockSize + sizeof(header) - 1)
+			   / sizeof(header) * sizeof(header);
+
+	if (m_blockCount > 0)
+	{
+		m_blocks = (char *)malloc(m_blockCount * m_stride);
+		if (m_blocks == NULL)
+			m_blockCount = 0;
+	}
+
+	// Push them in reverse, so they're handed out in order
+	for (int32 i = m_blockCount - 1; i >= 0; i--)
+	{
+		header *block = _blockAt(i);
+		block->info.pool = this;
+		block->info.index = i;
+		_push(i);
+	}
+}
+
+CFixedPool::~CFixedPool()
+{
+	D_ALLOC(("CFixedPool::~CFixedPool()\n"));
+
+	ASSERT(m_used == 0);
+	free(m_blocks);
+}
+
+// ---------------------------------------------------------------------------
+// Accessors
+
+int32
+CFixedPool::CountUsed() const
+{
+	return atomic_get((volatile int32 *)&m_used);
+}
+
+int32
+CFixedPool::MaxUsed() const
+{
+	return atomic_get((volatile int32 *)&m_maxUsed);
+}
+
+int32
+CFixedPool::HeapAllocations() const
+{
+	return atomic_get((volatile int32 *)&m_heapAllocations);
+}
+
+// ---------------------------------------------------------------------------
+// Operations
+
+void *
+CFixedPool::Allocate(
+	size_t size,
+	bool *outFromHeap)
+{
+	int32 index = (size <= m_blockSize) ? _pop() : -1;
+	if (outFromHeap != NULL)
+		*outFromHeap = (index < 0);
+	if (index >= 0)
+	{
+		int32 used = atomic_add(&m_used, 1) + 1;
+		int32 maxUsed = atomic_get(&m_maxUsed);
+		while ((used > maxUsed)
+		 && (atomic_test_and_set(&m_maxUsed, used, maxUsed) != maxUsed))
+			maxUsed = atomic_get(&m_maxUsed);
+
+		return _blockAt(index) + 1;
+	}
+
+	atomic_add(&m_heapAllocations, 1);
+	header *block = (header *)malloc(sizeof(header) + size);
+	if (block == NULL)
+		throw std::bad_alloc();
+	block->info.pool = NULL;
+	block->info.index = -1;
+	return block + 1;
+}
+
+void
+CFixedPool::Free(
+	void *data)
+{
+	if (data == NULL)
+		return;
+
+	header *block = (header *)data - 1;
+	CFixedPool *pool = block->info.pool;
+	if (pool == NULL)
+	{
+		free(block);
+		return;
+	}
+
+	pool->_push(block->info.index);
+	atomic_add(&pool->m_used, -1);
+}
+
+// ---------------------------------------------------------------------------
+// Internal Operations
+
+int32
+CFixedPool::_pop()
+{
+	int32 top, next;
+	do
+	{
+		top = atomic_get(&m_free);
+		if ((top & INDEX_MASK) == 0)
+			return -1;
+
+		// If another thread takes the block first, this may read a
+		// stale link, but then the tag has changed as well
+		next = _blockAt((top & INDEX_MASK) - 1)->info.next;
+	}
+	while (atomic_test_and_set(&m_free,
+							   next_tag(top) | next,
+							   top) != top);
+
+	return (top & INDEX_MASK) - 1;
+}
+
+void
+CFixedPool::_push(
+	int32 index)
+{
+	header *block = _blockAt(index);
+	int32 top;
+	do
+	{
+		top = atomic_get(&m_free);
+		block->info.next = top & INDEX_MASK;
+	}
+	while (atomic_test_and_set(&m_free,
+							   next_tag(top) | (index + 1),
+							   top) != top);
+}
+
+// END - FixedPool.cpp
@@ -0,0 +1,153 @@
+/* ===================================================================== *
+ * FixedPool.h (MeV/Support)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s):
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ *  A preallocated set of equally sized memory blocks
+ * ---------------------------------------------------------------------
+ * To Do:
+ *
+ * ===================================================================== */
+
+#ifndef __C_FixedPool_H__
+#define __C_FixedPool_H__
+
+// Support Kit
+#include <SupportDefs.h>
+
+// Standard C Library
+#include <stddef.h>
+
+/**	Hands out memory blocks of up to a fixed size from a set that is
+	allocated once, up front, so that objects can be created and
+	destroyed on a realtime thread without touching the heap. The free
+	blocks are kept on a lock-free stack, so Allocate() and Free() may
+	be called from any number of threads at once.
+
+	Once all blocks are in use, or if a larger block is asked for,
+	Allocate() falls back to the heap and counts it in
+	HeapAllocations(). Free() knows where each block came from, so it
+	doesn't need the pool. The pool has to outlive its blocks, though.
+	@package	Support
+ */
+class CFixedPool
+{
+
+public:							// Constructor/Destructor
+
+	/**	Constructor. At most 65535 blocks can be pooled. */
+								CFixedPool(
+									size_t blockSize,
+									int32 blockCount);
+
+								~CFixedPool();
+
+public:							// Accessors
+
+	size_t						BlockSize() const
+								{ return m_blockSize; }
+
+	int32						CountBlocks() const
+								{ return m_blockCount; }
+
+	/**	Returns the number of pooled blocks currently in use. */
+	int32						CountUsed() const;
+
+	/**	Returns the most pooled blocks that have been in use at once. */
+	int32						MaxUsed() const;
+
+	/**	Returns the number of blocks that had to come from the heap. */
+	int32						HeapAllocations() const;
+
+public:							// Operations
+
+	/**	Returns a block of at least the given size, from the pool if
+		possible. If outFromHeap isn't NULL, it is set to whether the
+		block had to come from the heap. Throws std::bad_alloc if the
+		heap is out of memory.
+	*/
+	void *						Allocate(
+									size_t size,
+									bool *outFromHeap = NULL);
+
+	/**	Gives back a block returned by Allocate() of any pool. */
+	static void					Free(
+									void *block);
+
+private:						// Types
+
+	/** Precedes every block, keeping the rest suitably aligned. */
+	union header
+	{
+		struct
+		{
+			/** The pool, or NULL if the block is from the heap. */
+			CFixedPool *		pool;
+
+			int32				index;
+
+			/** Index of the next free block plus one, while free. */
+			volatile int32		next;
+		}						info;
+
+		double					align[2];
+	};
+
+private:						// Internal Operations
+
+	header *					_blockAt(
+									int32 index) const
+								{ return (header *)(m_blocks + index * m_stride); }
+
+	/** Returns the index of a free block, or -1 if there is none. */
+	int32						_pop();
+
+	void						_push(
+									int32 index);
+
+private:						// Instance Data
+
+	size_t						m_blockSize;
+
+	int32						m_blockCount;
+
+	/** Distance between the headers of two blocks. */
+	size_t						m_stride;
+
+	char *						m_blocks;
+
+	/** Top of the free stack: the index of the top block plus one in
+		the lower 16 bits (0 if empty), and a tag in the upper 16 bits
+		that changes with every push and pop, so that a pop can't be
+		fooled by the same block being popped and pushed again in
+		between.
+	*/
+	volatile int32				m_free;
+
+	volatile int32				m_used;
+
+	volatile int32				m_maxUsed;
+
+	volatile int32				m_heapAllocations;
+};
+
+#endif /* __C_FixedPool_H__ */
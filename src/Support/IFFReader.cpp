@@ -154,9 +154,18 @@ void CIFFReader::MustRead( void *buffer, int32 inLength )
 	}
 }
 
+const void *CIFFReader::View( int32 length )
+{
+	if (length > stack->filePos + stack->size - pos) return NULL;
+
+	const void *data = reader.View( length );
+	if (data != NULL) pos += length;
+	return data;
+}
+
 uint32 CIFFReader::Skip( uint32 length )
 {
-	return Seek( pos + length );
+	return Seek( ChunkPos() + length );
 }
 
 bool CIFFReader::Seek( uint32 inFilePos )
@@ -102,6 +102,12 @@ public:
 		/**	Read exactly 'inLength' bytes, or toss an exception. */
 	void MustRead( void *buffer, int32 inLength );
 
+		/**	Returns a pointer to the next 'length' bytes of the chunk, if the
+			underlying stream can hand them out in place. Won't go past the
+			end of the chunk.
+		*/
+	const void *View( int32 length );
+
 		/**	Skip over chunk data. Won't skip past end of chunk. */
 	uint32 Skip( uint32 length );
 
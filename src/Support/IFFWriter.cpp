@@ -8,6 +8,7 @@
 #include "IFFWriter.h"
 
 #include <netinet/in.h>
+#include <stdint.h>
 
 CIFFWriter::CIFFWriter( CWriter &inWriter )
 	: stack(0), writer(inWriter), limit(0), pos(0), m_allowOddLengthChunks(false)
@@ -24,7 +25,7 @@ void CIFFWriter::CalcLimit()
 {
 		// Look through the stack of chunks for chunks which have a predetermined
 		// size. Find the chunk who's predetermined end is the lowest in the file.
-	limit = LONG_MAX;
+	limit = INT32_MAX;
 	for (ChunkState *st = stack; st != NULL; st = st->parent)
 	{
 		if (st->maxSize >= 0 && limit > st->startPos + st->maxSize)
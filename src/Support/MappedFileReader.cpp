@@ -0,0 +1,67 @@
+/* ===================================================================== *
+ * MappedFileReader.cpp (MeV/Support)
+ * ===================================================================== */
+ 
+#include "MappedFileReader.h"
+
+// Gnu C Library
+#include <errno.h>
+#include <stdint.h>
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ---------------------------------------------------------------------------
+// Constructor/Destructor
+
+CMappedFileReader::CMappedFileReader(
+	const char *path)
+	:	CByteArrayReader(NULL, 0),
+		m_error(B_OK),
+		m_mapping(NULL),
+		m_mappingSize(0)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		m_error = errno;
+		return;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0)
+		m_error = errno;
+	else if (st.st_size > (off_t)UINT32_MAX)
+		// Positions are 32 bit
+		m_error = EFBIG;
+	else if (st.st_size > 0)
+	{
+		// (An empty file can't be mapped, but then there's nothing to read)
+		void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+							 fd, 0);
+		if (mapping == MAP_FAILED)
+		{
+			m_error = errno;
+		}
+		else
+		{
+			m_mapping = mapping;
+			m_mappingSize = st.st_size;
+			m_bytes = (uint8 *)mapping;
+			m_len = st.st_size;
+		}
+	}
+
+	// The mapping stays valid after the file is closed
+	close(fd);
+}
+
+CMappedFileReader::~CMappedFileReader()
+{
+	if (m_mapping != NULL)
+		munmap(m_mapping, m_mappingSize);
+}
+
+// END - MappedFileReader.cpp
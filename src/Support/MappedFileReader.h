@@ -0,0 +1,71 @@
+/* ===================================================================== *
+ * MappedFileReader.h (MeV/Support)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical 
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan 
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s): 
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ *  A reader for files which are mapped into memory
+ * ---------------------------------------------------------------------
+ * To Do:
+ *
+ * ===================================================================== */
+ 
+#ifndef __C_MappedFileReader_H__
+#define __C_MappedFileReader_H__
+
+#include "Reader.h"
+
+/**	Reads a file by mapping it into memory, so that reading doesn't cost
+	a system call per request, and so that View() can hand out pointers
+	into the file instead of copying from it.
+ */
+class CMappedFileReader
+	:	public CByteArrayReader
+{
+
+public:							// Constructor/Destructor
+
+	/**	Constructor. Maps the file at the given path. If that fails, the
+		reader is empty, and InitCheck() tells why.
+	*/
+								CMappedFileReader(
+									const char *path);
+
+	/**	Destructor. Unmaps the file. */
+								~CMappedFileReader();
+
+public:							// Accessors
+
+	/**	Returns B_OK if the file was mapped, or an error code. */
+	status_t					InitCheck() const
+								{ return m_error; }
+
+private:						// Instance Data
+
+	status_t					m_error;
+
+
+	void *						m_mapping;
+
+	size_t						m_mappingSize;
+};
+
+#endif /* __C_MappedFileReader_H__ */
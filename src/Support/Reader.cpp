@@ -172,4 +172,16 @@ CByteArrayReader::Seek(
 	return true;
 }
 
+const void *
+CByteArrayReader::View(
+	int32 length)
+{
+	if ((length < 0) || (uint32(length) > m_len - m_pos))
+		return NULL;
+
+	const void *data = &m_bytes[m_pos];
+	m_pos += length;
+	return data;
+}
+
 // END - Reader.cpp
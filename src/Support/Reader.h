@@ -109,6 +109,16 @@ public:							// Operations
 									int32 length)
 								{ Read(buffer, length, false); }
 
+	/**	Returns a pointer to the next 'length' bytes and skips over them,
+		if the stream can hand out its data in place rather than copying
+		it (e.g. because it is already in memory). Otherwise returns NULL
+		without reading anything. The data stays valid as long as the
+		stream does.
+	*/
+	virtual const void *		View(
+									int32 length)
+								{ return NULL; }
+
 	/**	Returns a 16-bit integer, or throws an exception.
 	 *	Also byte-swaps the integer if requested. */
 	int16						MustReadInt16();
@@ -252,7 +262,7 @@ public:							// Constructor/Destructor
 								{ return m_len - m_pos; }
 	
 	/**	Returns the current read position. */
-	uint32						Position()
+	uint32						Position() const
 								{ return m_pos; }
 
 	/**	Skip over data in the stream. */
@@ -265,7 +275,11 @@ public:							// Constructor/Destructor
 	bool						Seek(
 									uint32 filePos);
 
-private:						// Instance Data
+	/**	Returns a pointer into the byte array. */
+	const void *				View(
+									int32 length);
+
+protected:						// Instance Data
 
 	uint8 *						m_bytes;
 
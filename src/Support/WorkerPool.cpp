@@ -0,0 +1,102 @@
+/* ===================================================================== *
+ * WorkerPool.cpp (MeV/Support)
+ * ===================================================================== */
+
+#include "WorkerPool.h"
+
+// Support Kit
+#include <Debug.h>
+
+// Debugging Macros
+#define D_OPERATION(x) //PRINT(x)		// Operations
+
+// ---------------------------------------------------------------------------
+// Constructor/Destructor
+
+CWorkerPool::CWorkerPool(
+	const char *name,
+	int32 maxThreads)
+	:	m_name(name),
+		m_threads(maxThreads),
+		m_job(NULL),
+		m_data(NULL),
+		m_count(0),
+		m_next(0)
+{
+	if (m_threads <= 0)
+	{
+		system_info info;
+		if (get_system_info(&info) == B_OK)
+			m_threads = info.cpu_count;
+		if (m_threads <= 0)
+			m_threads = 1;
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Operations
+
+void
+CWorkerPool::Run(
+	int32 count,
+	job_func job,
+	void *data)
+{
+	D_OPERATION(("CWorkerPool::Run(%ld)\n", count));
+
+	if (count <= 0)
+		return;
+
+	m_job = job;
+	m_data = data;
+	m_count = count;
+	m_next = 0;
+
+	// The calling thread is one of the workers
+	int32 helpers = MIN(m_threads, count) - 1;
+	thread_id *threads = NULL;
+	if (helpers > 0)
+	{
+		threads = new thread_id[helpers];
+		for (int32 i = 0; i < helpers; i++)
+		{
+			threads[i] = spawn_thread(_worker, m_name, B_NORMAL_PRIORITY,
+									  this);
+			if (threads[i] >= 0)
+				resume_thread(threads[i]);
+		}
+	}
+
+	_worker(this);
+
+	for (int32 i = 0; i < helpers; i++)
+	{
+		if (threads[i] >= 0)
+		{
+			status_t result;
+			wait_for_thread(threads[i], &result);
+		}
+	}
+	delete [] threads;
+
+	m_job = NULL;
+	m_data = NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Internal Operations
+
+int32
+CWorkerPool::_worker(
+	void *data)
+{
+	CWorkerPool *pool = (CWorkerPool *)data;
+
+	int32 index;
+	while ((index = atomic_add(&pool->m_next, 1)) < pool->m_count)
+		pool->m_job(index, pool->m_data);
+
+	return B_OK;
+}
+
+// END - WorkerPool.cpp
@@ -0,0 +1,91 @@
+/* ===================================================================== *
+ * WorkerPool.h (MeV/Support)
+ * ---------------------------------------------------------------------
+ * License:
+ *  The contents of this file are subject to the Mozilla Public
+ *  License Version 1.1 (the "License"); you may not use this file
+ *  except in compliance with the License. You may obtain a copy of
+ *  the License at http://www.mozilla.org/MPL/
+ *
+ *  Software distributed under the License is distributed on an "AS
+ *  IS" basis, WITHOUT WARRANTY OF ANY KIND, either express or
+ *  implied. See the License for the specific language governing
+ *  rights and limitations under the License.
+ *
+ *  The Original Code is MeV (Musical Environment) code.
+ *
+ *  The Initial Developer of the Original Code is Sylvan Technical 
+ *  Arts. Portions created by Sylvan are Copyright (C) 1997 Sylvan 
+ *  Technical Arts. All Rights Reserved.
+ *
+ *  Contributor(s): 
+ *
+ * ---------------------------------------------------------------------
+ * Purpose:
+ *  Runs independent jobs on one thread per CPU
+ * ---------------------------------------------------------------------
+ * To Do:
+ *
+ * ===================================================================== */
+
+#ifndef __C_WorkerPool_H__
+#define __C_WorkerPool_H__
+
+// Kernel Kit
+#include <OS.h>
+
+/**	Runs a number of independent jobs concurrently, on up to one thread
+	per CPU, and waits until all of them are done. The calling thread
+	takes part, so with a single CPU (or a single job) everything simply
+	runs in line. Jobs are handed out in order of their index.
+ */
+class CWorkerPool
+{
+
+public:							// Types
+
+	/**	A job. Called once for every index from 0 to count - 1. */
+	typedef void				(*job_func)(
+									int32 index,
+									void *data);
+
+public:							// Constructor/Destructor
+
+	/**	Constructor. A maxThreads of 0 means one thread per CPU. */
+								CWorkerPool(
+									const char *name,
+									int32 maxThreads = 0);
+
+public:							// Operations
+
+	/**	Call job(index, data) for every index from 0 to count - 1,
+		and return once all of those calls have returned. Jobs must
+		not throw.
+	*/
+	void						Run(
+									int32 count,
+									job_func job,
+									void *data);
+
+private:						// Internal Operations
+
+	static int32				_worker(
+									void *data);
+
+private:						// Instance Data
+
+	const char *				m_name;
+
+	int32						m_threads;
+
+	// The state of the current Run()
+	job_func					m_job;
+
+	void *						m_data;
+
+	int32						m_count;
+
+	int32						m_next;
+};
+
+#endif /* __C_WorkerPool_H__ */
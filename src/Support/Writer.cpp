@@ -114,7 +114,7 @@ CWriter::operator<<(
 
 bool
 CFixedByteArrayWriter::Write(
-	void *buffer,
+	const void *buffer,
 	int32 length)
 {
 	if ((length < 0) || (uint32(length) > (m_len - m_pos)))
@@ -151,7 +151,7 @@ CDynamicByteArrayWriter::CDynamicByteArrayWriter(
 
 bool
 CDynamicByteArrayWriter::Write(
-	void *buffer,
+	const void *buffer,
 	int32 length)
 {
 	if (length < 0)
@@ -160,7 +160,9 @@ CDynamicByteArrayWriter::Write(
 	}
 	else if (uint32(length) > (m_len - m_pos))
 	{
-		int32 newSize = m_len + (m_len / 4) + 256;
+		uint32 newSize = m_len + (m_len / 4) + 256;
+		if (newSize < m_pos + length)
+			newSize = m_pos + length;
 		uint8 *newBuffer = new uint8[newSize];
 
 		memcpy(newBuffer, m_bytes, m_len);
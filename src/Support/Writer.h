@@ -230,11 +230,11 @@ public:							// CWriter Implementation
 	/**	Main writing function. */
 	
 	bool						Write(
-									void *buffer,
+									const void *buffer,
 									int32 length);
 
 	/**	Returns the current write position. */
-	uint32						Position()
+	uint32						Position() const
 								{ return m_pos; }
 
 	/**	Seek to a specific position in the file.
@@ -275,7 +275,7 @@ public:							// Constructor/Destructor
 
 	/**	Main writing function. */
 	bool						Write(
-									void *buffer,
+									const void *buffer,
 									int32 length);
 
 	/**	Returns the current write position. */
@@ -287,6 +287,10 @@ CAssemblyWindow::AddMenuBar()
 	menu->AddItem(new CQuickKeyMenuItem("Play Section", new BMessage(MENU_PLAY_SECTION ), 'p', "p"));
 	menu->AddSeparatorItem();
 	menu->AddItem(new BMenuItem("Set Section", new BMessage(MENU_SET_SECTION), 'S', B_SHIFT_KEY));
+#if DEBUG
+	menu->AddSeparatorItem();
+	menu->AddItem(new BMenuItem("Validate Locate", new BMessage(MENU_VALIDATE_LOCATE)));
+#endif
 	menuBar->AddItem(menu);
 	
 	// Create the 'View' menu
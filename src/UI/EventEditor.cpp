@@ -521,10 +521,9 @@ CEventEditor::StartDrag(
 				wasSelected = true;
 				if (modifierKeys & B_SHIFT_KEY)
 				{
-					const_cast<CEvent *>(ev)->SetSelected(false);
+					marker.SetSelected(false);
 					RendererFor(*ev)->Invalidate(*ev);
 				
-					// This could be faster.
 					Track()->SummarizeSelection();
 	
 					// Let the world know the selection has changed
@@ -538,10 +537,9 @@ CEventEditor::StartDrag(
 				if (!(modifierKeys & B_SHIFT_KEY))
 					Track()->DeselectAll(this);
 
-				const_cast<CEvent *>(ev)->SetSelected(true);
+				marker.SetSelected(true);
 				RendererFor(*ev)->Invalidate(*ev);
 
-				// This could be faster.
 				Track()->SummarizeSelection();
 
 				// Update document default attributes
@@ -799,14 +797,14 @@ CEventEditor::DoLassoTracking(
 			if (!ev->IsSelected() && r.Intersects(extent)
 			 && IsRectInLasso(extent, gPrefs.inclusiveSelection))
 			{
-				const_cast<CEvent *>(ev)->SetSelected(true);
+				marker.SetSelected(true);
 				selectionChanged = true;
 				renderer->Invalidate(*ev);
 			}
 			else if (ev->IsSelected()
 			 && !IsRectInLasso(extent, gPrefs.inclusiveSelection))
 			{
-				const_cast<CEvent *>(ev)->SetSelected(false);
+				marker.SetSelected(false);
 				selectionChanged = true;
 				renderer->Invalidate(*ev);
 			}
@@ -885,7 +883,7 @@ CEventEditor::DoRectangleTracking(
 			 && (gPrefs.inclusiveSelection ? r.Intersects(extent)
 			 							   : r.Contains(extent)))
 			{
-				const_cast<CEvent *>(ev)->SetSelected(true);
+				marker.SetSelected(true);
 				selectionChanged = true;
 				renderer->Invalidate(*ev);
 			}
@@ -893,7 +891,7 @@ CEventEditor::DoRectangleTracking(
 			 && (gPrefs.inclusiveSelection ? !r.Intersects(extent)
 			 							   : !r.Contains(extent)))
 			{
-				const_cast<CEvent *>(ev)->SetSelected(false);
+				marker.SetSelected(false);
 				selectionChanged = true;
 				renderer->Invalidate(*ev);
 			}
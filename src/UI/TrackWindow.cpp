@@ -33,6 +33,7 @@
 #include <MessageFilter.h>
 #include <Roster.h>
 // Interface Kit
+#include <Alert.h>
 #include <Bitmap.h>
 #include <MenuBar.h>
 #include <StringView.h>
@@ -489,6 +490,27 @@ CTrackWindow::MessageReceived(
 									 (app->GetLoopFlag() ? PB_Loop : 0) | PB_Folded );
 			break;
 		}
+#if DEBUG
+		case MENU_VALIDATE_LOCATE:
+		{
+			// Check the first 64 bars, so that songs which repeat
+			// forever are rendered too
+			BAlert *alert;
+			if (CPlayerControl::ValidateLocate(Document(),
+											   64 * 4 * Ticks_Per_QtrNote))
+				alert = new BAlert("Validate Locate",
+								   "Locating into the song plays it just "
+								   "like playing it from the start.", "OK");
+			else
+				alert = new BAlert("Validate Locate",
+								   "Locating into the song plays it "
+								   "differently than playing it from the "
+								   "start.", "OK", NULL, NULL,
+								   B_WIDTH_AS_USUAL, B_WARNING_ALERT);
+			alert->Go();
+			break;
+		}
+#endif
 		case MENU_SET_SECTION:
 		{
 			CWriteLock lock(Track());
@@ -387,6 +387,7 @@ CVelocityEditor::DoDrag(
 							// so just poke the event directly.
 						const_cast<CEvent *>(ev)->note.attackVelocity = evCopy.note.attackVelocity;
 						const_cast<CEvent *>(ev)->note.releaseVelocity = evCopy.note.releaseVelocity;
+						marker.ChangedInPlace();
 					}
 
 					RendererFor(*ev)->Invalidate(*ev);